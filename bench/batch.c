@@ -0,0 +1,111 @@
+/* bench/batch.c
+ *
+ * Copyright (C) 2016 Gary Munnelly
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+/**
+ * @file bench/batch.c
+ *
+ * @brief Throughput of the batch operations with each instruction set
+ *
+ * Fills a batch with positions from random games of Copenhagen
+ * Hnefatafl and times move counting, capture checks and winner
+ * detection over the whole batch with every instruction set the
+ * processor supports, next to counting the moves of each board with
+ * hnef_board_generate_moves.
+ *
+ * Usage: batch [games]
+ *
+ * @author Gary Munnelly
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "../libhnef/batch.h"
+#include "../libhnef/variant.h"
+
+#define BATCH_REPEATS 20
+
+static double
+batch_seconds( void ) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int
+main( int argc, char **argv ) {
+	static const char *names[] = { "scalar", "avx2", "avx512" };
+	HnefBoardBatch batch;
+	HnefBoard b, *boards;
+	HnefRays rays;
+	HnefMove moves[HNEF_MAX_MOVES];
+	HnefUndo records[1];
+	HnefUndoStack stack;
+	double start, ns[3];
+	uint64_t rng = 0x2545f4914f6cdd1dULL;
+	long sink;
+	int *results, count, game, ply, n, isa, r, op;
+
+	count = (argc > 1)? atoi(argv[1]) : 4096;
+	boards = malloc(count*sizeof(HnefBoard));
+	results = malloc(count*sizeof(int));
+	hnef_variant_setup(&b, HNEF_VARIANT_COPENHAGEN);
+	if(count < 1 || !boards || !results || !hnef_board_batch_init(&batch, &b, count)) {
+		return EXIT_FAILURE;
+	}
+
+	/* Each game is played a random number of moves from the start */
+	hnef_rays_init(&rays, b.height, b.width);
+	for( game=0; game<count; game++ ) {
+		boards[game] = b;
+		for( ply=game % 60; ply>0; ply-- ) {
+			n = hnef_board_generate_moves(&boards[game], &rays, boards[game].turn, moves, HNEF_MAX_MOVES);
+			if(n == 0 || hnef_board_get_winner(&boards[game]) != HNEF_NO_WINNER) {
+				break;
+			}
+			rng = rng * 6364136223846793005ULL + 1442695040888963407ULL;
+			hnef_undo_stack_init(&stack, records, 1);
+			hnef_board_make_move(&boards[game], moves[(rng >> 33) % n], &stack);
+		}
+		hnef_board_batch_set(&batch, game, &boards[game]);
+	}
+
+	sink = 0;
+	printf("%d Copenhagen games, nanoseconds per game\n", count);
+	printf("%-10s %10s %10s %10s\n", "", "moves", "captures", "winners");
+
+	start = batch_seconds();
+	for( r=0; r<BATCH_REPEATS; r++ ) {
+		for( game=0; game<count; game++ ) {
+			sink += hnef_board_generate_moves(&boards[game], &rays, boards[game].turn, moves, HNEF_MAX_MOVES);
+		}
+	}
+	printf("%-10s %10.1f\n", "boards", (batch_seconds() - start) * 1e9 / (BATCH_REPEATS*count));
+
+	for( isa=HNEF_BATCH_SCALAR; isa<=hnef_board_batch_get_best_isa(); isa++ ) {
+		hnef_board_batch_set_isa(&batch, isa);
+		for( op=0; op<3; op++ ) {
+			start = batch_seconds();
+			for( r=0; r<BATCH_REPEATS; r++ ) {
+				if(op == 0) {
+					hnef_board_batch_count_moves(&batch, results);
+				} else if(op == 1) {
+					hnef_board_batch_count_captures(&batch, results);
+				} else {
+					hnef_board_batch_get_winners(&batch, results);
+				}
+				sink += results[r % count];
+			}
+			ns[op] = (batch_seconds() - start) * 1e9 / (BATCH_REPEATS*count);
+		}
+		printf("%-10s %10.1f %10.1f %10.1f\n", names[isa], ns[0], ns[1], ns[2]);
+	}
+
+	hnef_board_batch_free(&batch);
+	free(boards);
+	free(results);
+	return sink < 0? EXIT_FAILURE : EXIT_SUCCESS;
+}
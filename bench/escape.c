@@ -0,0 +1,113 @@
+/* bench/escape.c
+ *
+ * Copyright (C) 2016 Gary Munnelly
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+/**
+ * @file bench/escape.c
+ *
+ * @brief Per-call latency of the king escape and enclosure checks
+ *
+ * Collects positions from random games of each standard variant and
+ * times every check over all of them.
+ *
+ * Usage: escape [positions-per-variant]
+ *
+ * @author Gary Munnelly
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "../libhnef/escape.h"
+#include "../libhnef/move.h"
+#include "../libhnef/variant.h"
+
+#define ESCAPE_REPEATS 20
+
+static double
+escape_seconds( void ) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Fill boards with positions taken from random games */
+static int
+escape_collect( int variant, HnefBoard *boards, int count ) {
+	HnefBoard b;
+	HnefRays rays;
+	HnefMove moves[HNEF_MAX_MOVES];
+	HnefUndo records[1];
+	HnefUndoStack stack;
+	uint64_t rng = 0x2545f4914f6cdd1dULL + variant;
+	int i, n;
+
+	hnef_variant_setup(&b, variant);
+	hnef_rays_init(&rays, b.height, b.width);
+	for( i=0; i<count; i++ ) {
+		n = 0;
+		if(hnef_board_get_winner(&b) == HNEF_NO_WINNER) {
+			n = hnef_board_generate_moves(&b, &rays, b.turn, moves, HNEF_MAX_MOVES);
+		}
+		if(n == 0) {
+			hnef_variant_setup(&b, variant);
+			n = hnef_board_generate_moves(&b, &rays, b.turn, moves, HNEF_MAX_MOVES);
+		}
+		rng = rng * 6364136223846793005ULL + 1442695040888963407ULL;
+		hnef_undo_stack_init(&stack, records, 1);
+		hnef_board_make_move(&b, moves[(rng >> 33) % n], &stack);
+		boards[i] = b;
+	}
+	return count;
+}
+
+int
+main( int argc, char **argv ) {
+	HnefBoard *boards;
+	double start, ns[3];
+	long sink;
+	int count, variant, r, i;
+
+	count = (argc > 1)? atoi(argv[1]) : 1000;
+	boards = malloc(count*sizeof(HnefBoard));
+	if(!boards) {
+		return EXIT_FAILURE;
+	}
+
+	sink = 0;
+	printf("%-18s %14s %14s %14s\n", "variant", "in one (ns)", "distance (ns)", "ringed (ns)");
+	for( variant=0; variant<HNEF_VARIANT_COUNT; variant++ ) {
+		escape_collect(variant, boards, count);
+
+		start = escape_seconds();
+		for( r=0; r<ESCAPE_REPEATS; r++ ) {
+			for( i=0; i<count; i++ ) {
+				sink += hnef_board_king_escapes_in_one(&(boards[i]), NULL);
+			}
+		}
+		ns[0] = (escape_seconds() - start) * 1e9 / (ESCAPE_REPEATS*count);
+
+		start = escape_seconds();
+		for( r=0; r<ESCAPE_REPEATS; r++ ) {
+			for( i=0; i<count; i++ ) {
+				sink += hnef_board_king_escape_distance(&(boards[i]), NULL, 64);
+			}
+		}
+		ns[1] = (escape_seconds() - start) * 1e9 / (ESCAPE_REPEATS*count);
+
+		start = escape_seconds();
+		for( r=0; r<ESCAPE_REPEATS; r++ ) {
+			for( i=0; i<count; i++ ) {
+				sink += hnef_board_king_is_ringed(&(boards[i]));
+			}
+		}
+		ns[2] = (escape_seconds() - start) * 1e9 / (ESCAPE_REPEATS*count);
+
+		printf("%-18s %14.1f %14.1f %14.1f\n", hnef_variant_get_name(variant), ns[0], ns[1], ns[2]);
+	}
+
+	free(boards);
+	return sink < 0? EXIT_FAILURE : EXIT_SUCCESS;
+}
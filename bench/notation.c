@@ -0,0 +1,132 @@
+/* bench/notation.c
+ *
+ * Copyright (C) 2016 Gary Munnelly
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+/**
+ * @file bench/notation.c
+ *
+ * @brief Rate at which games in coordinate notation are split, read
+ * and written
+ *
+ * Builds a corpus of random Copenhagen games, one per line, then times
+ * splitting it into games, reading and playing out every game, and
+ * writing every game back.
+ *
+ * Usage: notation [games]
+ *
+ * @author Gary Munnelly
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../libhnef/notation.h"
+#include "../libhnef/variant.h"
+
+#define MAX_PLIES 160
+
+static double
+notation_seconds( void ) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int
+main( int argc, char **argv ) {
+	HnefBoard start, b;
+	HnefRules rules;
+	HnefRuleTables tables;
+	HnefRays rays;
+	HnefMove moves[HNEF_MAX_MOVES], played[MAX_PLIES], *all;
+	HnefUndo records[1];
+	HnefUndoStack stack;
+	char *text, *line;
+	const char *game;
+	uint64_t rng;
+	size_t capacity, length, at, game_length, count, total;
+	double t, split, parse, write;
+	long sink;
+	int games, g, n, plies, *counts;
+
+	games = (argc > 1)? atoi(argv[1]) : 20000;
+	capacity = (size_t)games * (MAX_PLIES * (HNEF_NOTATION_MAX_MOVE + 6) + 1);
+	text = malloc(capacity);
+	line = malloc(MAX_PLIES * (HNEF_NOTATION_MAX_MOVE + 6));
+	all = malloc((size_t)games * MAX_PLIES * sizeof(HnefMove));
+	counts = malloc(games * sizeof(int));
+	if(!text || !line || !all || !counts) {
+		return EXIT_FAILURE;
+	}
+
+	hnef_variant_setup(&start, HNEF_VARIANT_COPENHAGEN);
+	hnef_rays_init(&rays, start.height, start.width);
+	hnef_rules_init(&rules, HNEF_RULES_COPENHAGEN);
+	hnef_rules_compile(&tables, &rules, &start);
+
+	/* Build the corpus */
+	rng = 0x2545f4914f6cdd1dULL;
+	length = 0;
+	total = 0;
+	for( g=0; g<games; g++ ) {
+		b = start;
+		for( plies=0; plies<MAX_PLIES; plies++ ) {
+			n = 0;
+			if(hnef_rules_get_winner(&tables, &b) == HNEF_NO_WINNER) {
+				n = hnef_board_generate_moves(&b, &rays, b.turn, moves, HNEF_MAX_MOVES);
+			}
+			if(n == 0) {
+				break;
+			}
+			rng = rng * 6364136223846793005ULL + 1442695040888963407ULL;
+			all[(size_t)g*MAX_PLIES + plies] = moves[(rng >> 33) % n];
+			hnef_undo_stack_init(&stack, records, 1);
+			hnef_rules_make_move(&tables, &b, all[(size_t)g*MAX_PLIES + plies], &stack);
+		}
+		counts[g] = plies;
+		hnef_notation_write_game(&start, all + (size_t)g*MAX_PLIES, plies, text + length, capacity - length, &count);
+		length += count;
+		text[length++] = '\n';
+		total += plies;
+	}
+
+	sink = 0;
+	t = notation_seconds();
+	for( at=0; hnef_notation_next_game(text, length, &at, &game, &game_length); ) {
+		sink += game_length;
+	}
+	split = notation_seconds() - t;
+
+	t = notation_seconds();
+	for( at=0; hnef_notation_next_game(text, length, &at, &game, &game_length); ) {
+		b = start;
+		if(!hnef_notation_parse_game(&tables, &rays, &b, game, game_length, played, MAX_PLIES, &count)) {
+			fprintf(stderr, "notation: game %.*s not read\n", (int)game_length, game);
+			return EXIT_FAILURE;
+		}
+		sink += b.key & 1;
+	}
+	parse = notation_seconds() - t;
+
+	t = notation_seconds();
+	for( g=0; g<games; g++ ) {
+		hnef_notation_write_game(&start, all + (size_t)g*MAX_PLIES, counts[g], line, MAX_PLIES * (HNEF_NOTATION_MAX_MOVE + 6), &game_length);
+		sink += game_length;
+	}
+	write = notation_seconds() - t;
+
+	printf("%-22s %14s %14s\n", "stage", "games/s", "MB/s");
+	printf("%-22s %14.0f %14.1f\n", "split lines", games/split, length/split/1e6);
+	printf("%-22s %14.0f %14.1f\n", "read and play", games/parse, length/parse/1e6);
+	printf("%-22s %14.0f %14.1f\n", "write", games/write, length/write/1e6);
+	printf("(%d games, %zu moves, %zu bytes, sink %ld)\n", games, total, length, sink);
+
+	free(counts);
+	free(all);
+	free(line);
+	free(text);
+	return EXIT_SUCCESS;
+}
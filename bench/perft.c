@@ -0,0 +1,125 @@
+/* bench/perft.c
+ *
+ * Copyright (C) 2016 Gary Munnelly
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+/**
+ * @file bench/perft.c
+ *
+ * @brief Perft correctness and speed benchmark for the standard
+ * variants
+ *
+ * Walks the move tree of each variant's starting position to a fixed
+ * depth, compares the leaf count with the reference below and reports
+ * nodes per second. Exits with a non-zero status if any count differs.
+ *
+ * Usage: perft [max-depth] [threads] [cache-megabytes]
+ *
+ * With more than one thread, or a cache, the parallel walker is used
+ * and must reach the same counts.
+ *
+ * The reference counts follow libhnef's default rules: soldiers are
+ * captured against a friendly token or an empty structure, the king is
+ * armed and is captured on four sides, and the game ends as soon as
+ * the king escapes or is captured.
+ *
+ * @author Gary Munnelly
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "../libhnef/perft.h"
+#include "../libhnef/variant.h"
+
+#define PERFT_REFERENCE_DEPTH 5
+
+/**
+ * @brief Known leaf counts and benchmark depth of one variant
+ */
+typedef struct PerftReference {
+	int variant;                              /**< HNEF_VARIANT_* code */
+	int depth;                                /**< Depth walked by the benchmark */
+	uint64_t nodes[PERFT_REFERENCE_DEPTH+1];  /**< Leaf counts by depth */
+} PerftReference;
+
+static const PerftReference references[] = {
+	{ HNEF_VARIANT_BRANDUBH,   5, { 1, 40, 960, 39512, 1007392, 41843336 } },
+	{ HNEF_VARIANT_TABLUT,     4, { 1, 80, 4344, 337880, 18542744, 1418486224 } },
+	{ HNEF_VARIANT_COPENHAGEN, 4, { 1, 116, 6788, 806344, 50456804, 0 } },
+	{ HNEF_VARIANT_LARGE,      4, { 1, 152, 11900, 1875176, 158600520, 0 } },
+};
+
+static double
+perft_seconds( void ) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int
+main( int argc, char **argv ) {
+	const PerftReference *ref;
+	HnefPerftOptions options;
+	HnefPerftStats stats;
+	HnefBoard board;
+	HnefRays rays;
+	uint64_t nodes, total;
+	double start, elapsed, time;
+	int i, d, depth, max_depth, failures;
+
+	max_depth = PERFT_REFERENCE_DEPTH;
+	if(argc > 1) {
+		max_depth = atoi(argv[1]);
+	}
+	hnef_perft_options_init(&options);
+	if(argc > 2) {
+		options.threads = atoi(argv[2]);
+	}
+	if(argc > 3) {
+		options.cache_megabytes = atoi(argv[3]);
+	}
+
+	failures = 0;
+	total = 0;
+	time = 0;
+	for( i=0; i<(int)(sizeof(references)/sizeof(references[0])); i++ ) {
+		ref = &(references[i]);
+		hnef_variant_setup(&board, ref->variant);
+		hnef_rays_init(&rays, hnef_board_get_height(&board), hnef_board_get_width(&board));
+
+		depth = ref->depth < max_depth ? ref->depth : max_depth;
+		printf("%s %dx%d\n", hnef_variant_get_name(ref->variant),
+		       hnef_board_get_width(&board), hnef_board_get_height(&board));
+
+		for( d=1; d<=depth; d++ ) {
+			start = perft_seconds();
+			if(options.threads > 1 || options.cache_megabytes > 0) {
+				hnef_perft_parallel(&board, &rays, d, &options, &stats);
+				nodes = stats.nodes;
+			} else {
+				nodes = hnef_perft(&board, &rays, d);
+			}
+			elapsed = perft_seconds() - start;
+			total += nodes;
+			time += elapsed;
+
+			printf("  perft(%d) = %12llu  %8.3fs  %12.0f nodes/s",
+			       d, (unsigned long long)nodes, elapsed,
+			       elapsed > 0 ? nodes / elapsed : 0.0);
+			if(ref->nodes[d] == 0) {
+				printf("\n");
+			} else if(ref->nodes[d] == nodes) {
+				printf("  ok\n");
+			} else {
+				printf("  FAIL, expected %llu\n", (unsigned long long)ref->nodes[d]);
+				failures++;
+			}
+		}
+	}
+
+	printf("total %llu nodes in %.3fs, %.0f nodes/s\n",
+	       (unsigned long long)total, time, time > 0 ? total / time : 0.0);
+	return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,74 @@
+/* bench/perft_specialized.cc
+ *
+ * Copyright (C) 2016 Gary Munnelly
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+/**
+ * @file bench/perft_specialized.cc
+ *
+ * @brief Compares perft on the compile-time sized hnef::Board with
+ * perft on the run-time sized HnefBoard
+ *
+ * Usage: perft_specialized [depth]
+ *
+ * Exits with a non-zero status if the two disagree on any count.
+ *
+ * @author Gary Munnelly
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "../libhnef/board.hpp"
+#include "../libhnef/perft.h"
+#include "../libhnef/variant.h"
+
+static double
+perft_seconds( void ) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+template <int N>
+static int
+perft_compare( int variant, int depth ) {
+	hnef::Board<N, N> fast;
+	HnefBoard board;
+	HnefRays rays;
+	uint64_t generic, specialized;
+	double start, t_generic, t_specialized;
+
+	hnef_variant_setup(&board, variant);
+	hnef_rays_init(&rays, N, N);
+	fast.load(&board);
+
+	start = perft_seconds();
+	generic = hnef_perft(&board, &rays, depth);
+	t_generic = perft_seconds() - start;
+
+	start = perft_seconds();
+	specialized = hnef::perft(fast, depth);
+	t_specialized = perft_seconds() - start;
+
+	printf("%-18s perft(%d) = %12llu  generic %12.0f nodes/s  specialized %12.0f nodes/s%s\n",
+	       hnef_variant_get_name(variant), depth, (unsigned long long)specialized,
+	       t_generic > 0 ? generic / t_generic : 0.0,
+	       t_specialized > 0 ? specialized / t_specialized : 0.0,
+	       generic == specialized ? "" : "  FAIL");
+	return generic == specialized;
+}
+
+int
+main( int argc, char **argv ) {
+	int depth, ok;
+
+	depth = (argc > 1)? atoi(argv[1]) : 4;
+
+	ok = perft_compare<7>(HNEF_VARIANT_BRANDUBH, depth + 1);
+	ok &= perft_compare<9>(HNEF_VARIANT_TABLUT, depth);
+	ok &= perft_compare<11>(HNEF_VARIANT_COPENHAGEN, depth);
+	ok &= perft_compare<13>(HNEF_VARIANT_LARGE, depth);
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,130 @@
+/* bench/posdb.c
+ *
+ * Copyright (C) 2016 Gary Munnelly
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+/**
+ * @file bench/posdb.c
+ *
+ * @brief Start up time and lookup rate of a position database against
+ * reading a file of hnef_board_serialize blobs
+ *
+ * Writes positions from random Copenhagen games both ways, then times
+ * loading each and looking up every position in a shuffled order.
+ *
+ * Usage: posdb [positions]
+ *
+ * @author Gary Munnelly
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../libhnef/posdb.h"
+#include "../libhnef/variant.h"
+
+#define POSDB_PATH  "posdb.bench"
+#define BLOBS_PATH  "posdb.blobs"
+
+static double
+posdb_seconds( void ) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int
+main( int argc, char **argv ) {
+	HnefPosDBWriter w;
+	HnefPosDB db;
+	HnefPosDBEntry entry;
+	HnefBoard b, loaded;
+	HnefRays rays;
+	HnefMove moves[HNEF_MAX_MOVES];
+	HnefUndo records[1];
+	HnefUndoStack stack;
+	uint8_t blob[2 + MAX_HEIGHT*MAX_WIDTH];
+	uint64_t *keys, rng, t;
+	double start, blob_load, db_load, db_find;
+	size_t blob_size;
+	FILE *f;
+	long sink;
+	int count, i, j, n;
+
+	count = (argc > 1)? atoi(argv[1]) : 200000;
+	keys = malloc(count*sizeof(uint64_t));
+	if(!keys || !hnef_posdb_writer_open(&w, POSDB_PATH, 11, 11) || !(f = fopen(BLOBS_PATH, "wb"))) {
+		return EXIT_FAILURE;
+	}
+
+	/* Write the same positions both ways */
+	rng = 0x2545f4914f6cdd1dULL;
+	hnef_variant_setup(&b, HNEF_VARIANT_COPENHAGEN);
+	hnef_rays_init(&rays, b.height, b.width);
+	memset(&entry, 0, sizeof(entry));
+	blob_size = 2 + b.height*b.width;
+	for( i=0; i<count; i++ ) {
+		n = 0;
+		if(hnef_board_get_winner(&b) == HNEF_NO_WINNER) {
+			n = hnef_board_generate_moves(&b, &rays, b.turn, moves, HNEF_MAX_MOVES);
+		}
+		if(n == 0) {
+			hnef_variant_setup(&b, HNEF_VARIANT_COPENHAGEN);
+			n = hnef_board_generate_moves(&b, &rays, b.turn, moves, HNEF_MAX_MOVES);
+		}
+		rng = rng * 6364136223846793005ULL + 1442695040888963407ULL;
+		hnef_undo_stack_init(&stack, records, 1);
+		hnef_board_make_move(&b, moves[(rng >> 33) % n], &stack);
+		entry.score = i;
+		hnef_posdb_writer_add(&w, &b, &entry);
+		hnef_board_serialize(&b, blob);
+		fwrite(blob, 1, blob_size, f);
+		keys[i] = b.key;
+	}
+	fclose(f);
+	if(!hnef_posdb_writer_close(&w)) {
+		return EXIT_FAILURE;
+	}
+	for( i=count-1; i>0; i-- ) {
+		rng = rng * 6364136223846793005ULL + 1442695040888963407ULL;
+		j = (rng >> 33) % (i + 1);
+		t = keys[i];
+		keys[i] = keys[j];
+		keys[j] = t;
+	}
+
+	/* Blobs must all be read and rebuilt before any can be found */
+	sink = 0;
+	start = posdb_seconds();
+	f = fopen(BLOBS_PATH, "rb");
+	while( fread(blob, 1, blob_size, f) == blob_size ) {
+		hnef_board_deserialize(&loaded, blob);
+		sink += loaded.key & 1;
+	}
+	fclose(f);
+	blob_load = posdb_seconds() - start;
+
+	start = posdb_seconds();
+	if(!hnef_posdb_open(&db, POSDB_PATH)) {
+		return EXIT_FAILURE;
+	}
+	db_load = posdb_seconds() - start;
+	start = posdb_seconds();
+	for( i=0; i<count; i++ ) {
+		sink += hnef_posdb_find(&db, keys[i]);
+	}
+	db_find = posdb_seconds() - start;
+	hnef_posdb_close(&db);
+
+	printf("%-22s %14s %14s\n", "store", "load (ms)", "lookup (ns)");
+	printf("%-22s %14.2f %14s\n", "serialize blobs", blob_load*1e3, "-");
+	printf("%-22s %14.2f %14.1f\n", "position database", db_load*1e3, db_find*1e9/count);
+	printf("(%d positions, sink %ld)\n", count, sink);
+
+	remove(POSDB_PATH);
+	remove(BLOBS_PATH);
+	free(keys);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,119 @@
+/* bench/tensor.c
+ *
+ * Copyright (C) 2016 Gary Munnelly
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+/**
+ * @file bench/tensor.c
+ *
+ * @brief Time taken to export a batch of boards as input planes
+ *
+ * Collects a batch of positions from random games of each standard
+ * variant and times float and int8 exports of the whole batch, as they
+ * stand and with a random symmetry applied to every board.
+ *
+ * Usage: tensor [batch-size]
+ *
+ * @author Gary Munnelly
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "../libhnef/tensor.h"
+#include "../libhnef/move.h"
+#include "../libhnef/variant.h"
+
+#define TENSOR_REPEATS 200
+
+static double
+tensor_seconds( void ) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Fill boards with positions taken from random games */
+static void
+tensor_collect( int variant, HnefBoard *boards, int count ) {
+	HnefBoard b;
+	HnefRays rays;
+	HnefMove moves[HNEF_MAX_MOVES];
+	HnefUndo records[1];
+	HnefUndoStack stack;
+	uint64_t rng = 0x2545f4914f6cdd1dULL + variant;
+	int i, n;
+
+	hnef_variant_setup(&b, variant);
+	hnef_rays_init(&rays, b.height, b.width);
+	for( i=0; i<count; i++ ) {
+		n = 0;
+		if(hnef_board_get_winner(&b) == HNEF_NO_WINNER) {
+			n = hnef_board_generate_moves(&b, &rays, b.turn, moves, HNEF_MAX_MOVES);
+		}
+		if(n == 0) {
+			hnef_variant_setup(&b, variant);
+			n = hnef_board_generate_moves(&b, &rays, b.turn, moves, HNEF_MAX_MOVES);
+		}
+		rng = rng * 6364136223846793005ULL + 1442695040888963407ULL;
+		hnef_undo_stack_init(&stack, records, 1);
+		hnef_board_make_move(&b, moves[(rng >> 33) % n], &stack);
+		boards[i] = b;
+	}
+}
+
+int
+main( int argc, char **argv ) {
+	HnefBoard *boards, **batch;
+	int *transforms;
+	float *f;
+	int8_t *q;
+	double start, us[4];
+	int count, variant, r, i, size;
+
+	count = (argc > 1)? atoi(argv[1]) : 256;
+	boards = malloc(count*sizeof(HnefBoard));
+	batch = malloc(count*sizeof(HnefBoard*));
+	transforms = malloc(count*sizeof(int));
+	f = malloc(count*HNEF_TENSOR_PLANES*32*32*sizeof(float));
+	q = malloc(count*HNEF_TENSOR_PLANES*32*32);
+	if(count < 1 || !boards || !batch || !transforms || !f || !q) {
+		return EXIT_FAILURE;
+	}
+	for( i=0; i<count; i++ ) {
+		batch[i] = &(boards[i]);
+		transforms[i] = (i * 5) % HNEF_TRANSFORM_COUNT;
+	}
+
+	printf("batch of %d, microseconds per batch\n", count);
+	printf("%-18s %10s %10s %10s %10s\n", "variant", "float", "float+aug", "int8", "int8+aug");
+	for( variant=0; variant<HNEF_VARIANT_COUNT; variant++ ) {
+		tensor_collect(variant, boards, count);
+		size = hnef_tensor_get_size(batch[0]);
+
+		for( i=0; i<4; i++ ) {
+			start = tensor_seconds();
+			for( r=0; r<TENSOR_REPEATS; r++ ) {
+				if(i < 2) {
+					hnef_tensor_export_float(batch, count, (i & 1)? transforms : NULL, f);
+				} else {
+					hnef_tensor_export_int8(batch, count, (i & 1)? transforms : NULL, q);
+				}
+			}
+			us[i] = (tensor_seconds() - start) * 1e6 / TENSOR_REPEATS;
+		}
+
+		printf("%-18s %10.1f %10.1f %10.1f %10.1f\n", hnef_variant_get_name(variant),
+		       us[0], us[1], us[2], us[3]);
+	}
+
+	/* Keep the exports from being optimized away */
+	r = (int)f[size - 1] + q[size - 1];
+	free(boards);
+	free(batch);
+	free(transforms);
+	free(f);
+	free(q);
+	return r < 0? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,614 @@
+/* libhnef/archive.c
+ *
+ * Copyright (C) 2016 Gary Munnelly
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+/**
+ * @file libhnef/archive.c
+ *
+ * @brief Code for writing and reading game archives
+ *
+ * An archive is a header of HNEF_ARCHIVE_HEADER bytes followed by the
+ * games, each a varint length and then
+ *
+ *     the rule set, a varint HNEF_RULES_* preset
+ *     the winner plus one, a varint, 0 if the game was unfinished
+ *     the length and bytes of the board's layout, see wire.h
+ *     the length and bytes of the starting position, see wire.h
+ *     the number of moves, a varint
+ *     the moves, each a varint
+ *
+ * A move is written as from*(width + height) + to, where from is the
+ * square it leaves, numbered y*width + x, and to is the column it lands
+ * on if it stays in its row, or width plus the row it lands on if it
+ * stays in its column. Most moves take two bytes.
+ *
+ * Closing the writer appends the offset of every HNEF_ARCHIVE_STRIDE'th
+ * game and a trailer of HNEF_ARCHIVE_TRAILER bytes holding the number
+ * of games, the number of offsets and a magic number. Readers use the
+ * offsets to split the games into shards. An archive whose writer was
+ * never closed has no trailer and can still be read from the start.
+ *
+ * Integers outside varints are little endian.
+ *
+ * @author Gary Munnelly
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include "archive.h"
+#include "image.h"
+#include "rules.h"
+#include "wire.h"
+
+#define HNEF_ARCHIVE_MAGIC   "HNEFGAM\n" /**< First bytes of an archive */
+#define HNEF_ARCHIVE_VERSION 1          /**< Version of the file format */
+#define HNEF_ARCHIVE_HEADER  16         /**< Bytes before the first game */
+#define HNEF_ARCHIVE_TRAILER 24         /**< Bytes after the index */
+#define HNEF_ARCHIVE_END     "HNEFEND\n" /**< Last bytes of a closed archive */
+
+/**
+ * @brief Make room for more bytes in the record of the game in progress
+ *
+ * @return A pointer to the first new byte, or NULL if memory could not
+ * be allocated
+ */
+static uint8_t*
+hnef_archive_grow( HnefArchiveWriter *w, size_t bytes ) {
+	uint8_t *buffer;
+	size_t capacity;
+
+	if(w->length + bytes > w->capacity) {
+		capacity = w->capacity? w->capacity : 1024;
+		while( capacity < w->length + bytes ) {
+			capacity *= 2;
+		}
+		buffer = realloc(w->buffer, capacity);
+		if(!buffer) {
+			w->failed = 1;
+			return NULL;
+		}
+		w->buffer = buffer;
+		w->capacity = capacity;
+	}
+	w->length += bytes;
+	return w->buffer + w->length - bytes;
+}
+
+/**
+ * @brief Write a varint
+ *
+ * @return The number of bytes it takes
+ */
+static int
+hnef_archive_put_varint( uint8_t *p, uint64_t v ) {
+	int n;
+
+	for( n=0; v>=0x80; n++ ) {
+		p[n] = (uint8_t)((v & 0x7f) | 0x80);
+		v >>= 7;
+	}
+	p[n] = (uint8_t)v;
+	return n + 1;
+}
+
+/**
+ * @brief Read a varint
+ *
+ * @return True on success, false if the buffer ends first
+ */
+static int
+hnef_archive_get_varint( const uint8_t *buffer, size_t length, size_t *at, uint64_t *v ) {
+	unsigned shift;
+	uint8_t byte;
+
+	*v = 0;
+	for( shift=0; shift<64; shift+=7 ) {
+		if(*at >= length) {
+			return 0;
+		}
+		byte = buffer[(*at)++];
+		*v |= (uint64_t)(byte & 0x7f) << shift;
+		if(!(byte & 0x80)) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/**
+ * @brief Append a varint to the record of the game in progress
+ */
+static int
+hnef_archive_append_varint( HnefArchiveWriter *w, uint64_t v ) {
+	uint8_t bytes[10];
+	uint8_t *p;
+	int n;
+
+	n = hnef_archive_put_varint(bytes, v);
+	p = hnef_archive_grow(w, n);
+	if(!p) {
+		return 0;
+	}
+	memcpy(p, bytes, n);
+	return 1;
+}
+
+/**
+ * @brief Write to the file, noting any failure
+ */
+static int
+hnef_archive_write( HnefArchiveWriter *w, const void *data, size_t bytes ) {
+	if(w->failed || fwrite(data, 1, bytes, w->file) != bytes) {
+		w->failed = 1;
+		return 0;
+	}
+	w->offset += bytes;
+	return 1;
+}
+
+/**
+ * @brief Start writing an archive
+ *
+ * @param w The writer to be initialized
+ *
+ * @param path The file to be written. It is replaced if it exists
+ *
+ * @return True on success, false if the file could not be created
+ */
+int
+hnef_archive_writer_open( HnefArchiveWriter *w, const char *path ) {
+	uint8_t header[HNEF_ARCHIVE_HEADER];
+
+	memset(w, 0, sizeof(HnefArchiveWriter));
+	w->file = fopen(path, "wb");
+	if(!w->file) {
+		return 0;
+	}
+	memset(header, 0, sizeof(header));
+	memcpy(header, HNEF_ARCHIVE_MAGIC, 8);
+	header[8] = HNEF_ARCHIVE_VERSION;
+	return hnef_archive_write(w, header, sizeof(header));
+}
+
+/**
+ * @brief Start a game. Its moves are given to hnef_archive_writer_move
+ * and it is written by hnef_archive_writer_end.
+ *
+ * @param w The writer
+ *
+ * @param start The position the game starts from, with its layout
+ *
+ * @param rules The HNEF_RULES_* preset the game is played under
+ *
+ * @return True on success, false if a game is already in progress,
+ * the preset is unknown or memory could not be allocated
+ */
+int
+hnef_archive_writer_begin( HnefArchiveWriter *w, HnefBoard *start, int rules ) {
+	HnefRules r;
+	uint8_t *p;
+	size_t length;
+
+	if(!w->file || w->failed || w->playing || !hnef_rules_init(&r, rules)) {
+		return 0;
+	}
+	w->length = 0;
+	w->plies = 0;
+	w->height = start->height;
+	w->width = start->width;
+
+	/* The winner is filled in at the end */
+	if(!hnef_archive_append_varint(w, rules)) {
+		return 0;
+	}
+	w->winner_at = w->length;
+	if(!hnef_archive_grow(w, 1)) {
+		return 0;
+	}
+
+	hnef_board_encode_layout(start, NULL, 0, &length);
+	if(!hnef_archive_append_varint(w, length) || !(p = hnef_archive_grow(w, length))) {
+		return 0;
+	}
+	hnef_board_encode_layout(start, p, length, &length);
+
+	hnef_board_encode(start, NULL, 0, &length);
+	if(!hnef_archive_append_varint(w, length) || !(p = hnef_archive_grow(w, length))) {
+		return 0;
+	}
+	hnef_board_encode(start, p, length, &length);
+	w->moves_at = w->length;
+	w->playing = 1;
+	return 1;
+}
+
+/**
+ * @brief Record the next move of the game in progress
+ *
+ * @param w The writer
+ *
+ * @param move The move, which must stay in its row or column
+ *
+ * @return True on success, false if no game is in progress, the move
+ * is malformed or memory could not be allocated
+ */
+int
+hnef_archive_writer_move( HnefArchiveWriter *w, HnefMove move ) {
+	int fx, fy, tx, ty, to;
+
+	fx = HNEF_SQUARE_X(move.from);
+	fy = HNEF_SQUARE_Y(move.from);
+	tx = HNEF_SQUARE_X(move.to);
+	ty = HNEF_SQUARE_Y(move.to);
+	if(!w->playing || fx >= w->width || fy >= w->height || tx >= w->width || ty >= w->height ||
+	   (fx != tx && fy != ty) || move.from == move.to) {
+		return 0;
+	}
+	to = (fy == ty)? tx : w->width + ty;
+	if(!hnef_archive_append_varint(w, (uint64_t)(fy*w->width + fx)*(w->width + w->height) + to)) {
+		return 0;
+	}
+	w->plies++;
+	return 1;
+}
+
+/**
+ * @brief Write the game in progress to the archive
+ *
+ * @param w The writer
+ *
+ * @param winner Team code of the winner, or HNEF_NO_WINNER if the game
+ * was not finished
+ *
+ * @return True on success, false if no game is in progress or the game
+ * could not be written
+ */
+int
+hnef_archive_writer_end( HnefArchiveWriter *w, int winner ) {
+	uint8_t length[10], plies[10];
+	uint64_t *index, capacity;
+	int n, m;
+
+	if(!w->playing) {
+		return 0;
+	}
+	w->playing = 0;
+	w->buffer[w->winner_at] = (winner == HNEF_NO_WINNER)? 0 : (winner & 0x01) + 1;
+
+	if(w->count % HNEF_ARCHIVE_STRIDE == 0) {
+		if(w->count / HNEF_ARCHIVE_STRIDE == w->index_capacity) {
+			capacity = w->index_capacity? w->index_capacity*2 : 64;
+			index = realloc(w->index, capacity*sizeof(uint64_t));
+			if(!index) {
+				w->failed = 1;
+				return 0;
+			}
+			w->index = index;
+			w->index_capacity = capacity;
+		}
+		w->index[w->count / HNEF_ARCHIVE_STRIDE] = w->offset;
+	}
+
+	/* The ply count goes between the position and the moves */
+	n = hnef_archive_put_varint(plies, w->plies);
+	m = hnef_archive_put_varint(length, w->length + n);
+	if(!hnef_archive_write(w, length, m) || !hnef_archive_write(w, w->buffer, w->moves_at) ||
+	   !hnef_archive_write(w, plies, n) ||
+	   !hnef_archive_write(w, w->buffer + w->moves_at, w->length - w->moves_at)) {
+		return 0;
+	}
+	w->count++;
+	return 1;
+}
+
+/**
+ * @brief Write the index and trailer of an archive and close its file.
+ * A game still in progress is dropped. The writer's memory is released
+ * whether or not this succeeds.
+ *
+ * @param w The writer
+ *
+ * @return True if every game, the index and the trailer were written
+ */
+int
+hnef_archive_writer_close( HnefArchiveWriter *w ) {
+	uint8_t bytes[HNEF_ARCHIVE_TRAILER];
+	uint64_t i, entries;
+	int ok;
+
+	if(!w->file) {
+		return 0;
+	}
+	entries = (w->count + HNEF_ARCHIVE_STRIDE - 1) / HNEF_ARCHIVE_STRIDE;
+	for( i=0; i<entries; i++ ) {
+		hnef_image_put64(bytes, w->index[i]);
+		hnef_archive_write(w, bytes, 8);
+	}
+	hnef_image_put64(bytes, w->count);
+	hnef_image_put64(bytes + 8, entries);
+	memcpy(bytes + 16, HNEF_ARCHIVE_END, 8);
+	ok = hnef_archive_write(w, bytes, HNEF_ARCHIVE_TRAILER);
+	ok = (fclose(w->file) == 0) && ok;
+
+	free(w->index);
+	free(w->buffer);
+	memset(w, 0, sizeof(HnefArchiveWriter));
+	return ok;
+}
+
+/**
+ * @brief Open an archive for reading. An archive whose writer was not
+ * closed is opened without its index, so it can only be read whole.
+ *
+ * @param a The archive to be opened
+ *
+ * @param path The file to be opened
+ *
+ * @return True on success, false if the file could not be read or is
+ * not an archive of this version
+ */
+int
+hnef_archive_open( HnefArchive *a, const char *path ) {
+	const uint8_t *trailer;
+	uint8_t *image;
+	uint64_t entries, count, i, previous, offset;
+	int ok;
+
+	/* Games are read front to back */
+	memset(a, 0, sizeof(HnefArchive));
+	if(!hnef_image_load(path, HNEF_IMAGE_SEQUENTIAL, &image, &(a->size), &(a->mapped))) {
+		return 0;
+	}
+	a->image = image;
+	if(a->size < HNEF_ARCHIVE_HEADER || memcmp(a->image, HNEF_ARCHIVE_MAGIC, 8) ||
+	   a->image[8] != HNEF_ARCHIVE_VERSION) {
+		hnef_archive_close(a);
+		return 0;
+	}
+	a->end = a->size;
+
+	/* Trust the index only if every offset lies in order among the
+	 * games */
+	trailer = a->image + a->size - HNEF_ARCHIVE_TRAILER;
+	if(a->size >= HNEF_ARCHIVE_HEADER + HNEF_ARCHIVE_TRAILER && !memcmp(trailer + 16, HNEF_ARCHIVE_END, 8)) {
+		count = hnef_image_get64(trailer);
+		entries = hnef_image_get64(trailer + 8);
+		ok = entries == (count + HNEF_ARCHIVE_STRIDE - 1) / HNEF_ARCHIVE_STRIDE &&
+			entries <= (a->size - HNEF_ARCHIVE_HEADER - HNEF_ARCHIVE_TRAILER) / 8;
+		if(ok) {
+			a->end = a->size - HNEF_ARCHIVE_TRAILER - 8*entries;
+			a->index = trailer - 8*entries;
+			previous = HNEF_ARCHIVE_HEADER;
+			for( i=0; ok && i<entries; i++ ) {
+				offset = hnef_image_get64(a->index + 8*i);
+				ok = offset >= previous && offset < a->end && (i > 0 || offset == HNEF_ARCHIVE_HEADER);
+				previous = offset + 1;
+			}
+		}
+		if(ok) {
+			a->count = count;
+			a->entries = entries;
+		} else {
+			a->index = NULL;
+			a->end = a->size;
+		}
+	}
+	return 1;
+}
+
+/**
+ * @brief Release the memory or mapping held by an archive
+ *
+ * @param a The archive to be closed
+ */
+void
+hnef_archive_close( HnefArchive *a ) {
+	hnef_image_free(a->image, a->size, a->mapped);
+	memset(a, 0, sizeof(HnefArchive));
+}
+
+/**
+ * @brief Prepare to read one shard of an archive's games. The shards
+ * are disjoint and together hold every game, so each may be read by
+ * its own thread. An archive without an index has a single shard.
+ *
+ * @param c The cursor to be initialized
+ *
+ * @param a The archive to be read
+ *
+ * @param shard The shard to be read, below shards
+ *
+ * @param shards The number of shards the games are split into
+ */
+void
+hnef_archive_cursor_init( HnefArchiveCursor *c, const HnefArchive *a, int shard, int shards ) {
+	uint64_t first, last;
+
+	c->archive = a;
+	c->offset = c->end = HNEF_ARCHIVE_HEADER;
+	if(!a->image || shards < 1 || shard < 0 || shard >= shards) {
+		return;
+	}
+	if(!a->index) {
+		if(shard == 0) {
+			c->end = a->end;
+		}
+		return;
+	}
+
+	/* Shards are whole runs of indexed games */
+	first = a->entries*shard/shards;
+	last = a->entries*(shard + 1)/shards;
+	c->offset = (first < a->entries)? hnef_image_get64(a->index + 8*first) : a->end;
+	c->end = (last < a->entries)? hnef_image_get64(a->index + 8*last) : a->end;
+}
+
+/**
+ * @brief Read the next game of a cursor's shard. Nothing is allocated:
+ * the game points into the archive.
+ *
+ * @param c The cursor
+ *
+ * @param game Receives the game
+ *
+ * @return True if a game was read, false at the end of the shard or if
+ * the next game is damaged
+ */
+int
+hnef_archive_next( HnefArchiveCursor *c, HnefArchiveGame *game ) {
+	HnefRules rules;
+	const uint8_t *p;
+	uint64_t v, length;
+	size_t at, n;
+
+	if(c->offset >= c->end) {
+		return 0;
+	}
+	at = 0;
+	n = c->end - c->offset;
+	p = c->archive->image + c->offset;
+	if(!hnef_archive_get_varint(p, n, &at, &length) || length > n - at) {
+		c->offset = c->end;
+		return 0;
+	}
+	p += at;
+	n = length;
+	at = 0;
+
+	if(!hnef_archive_get_varint(p, n, &at, &v) || v > 0xff || !hnef_rules_init(&rules, (int)v)) {
+		goto damaged;
+	}
+	game->rules = (int)v;
+	if(!hnef_archive_get_varint(p, n, &at, &v) || v > 2) {
+		goto damaged;
+	}
+	game->winner = (int)v - 1;
+
+	if(!hnef_archive_get_varint(p, n, &at, &v) || v > n - at || v < 3) {
+		goto damaged;
+	}
+	game->layout = p + at;
+	game->layout_length = v;
+	game->height = game->layout[1];
+	game->width = game->layout[2];
+	if(game->height < 1 || game->height > MAX_HEIGHT || game->width < 1 || game->width > MAX_WIDTH) {
+		goto damaged;
+	}
+	at += v;
+	if(!hnef_archive_get_varint(p, n, &at, &v) || v > n - at) {
+		goto damaged;
+	}
+	game->position = p + at;
+	game->position_length = v;
+	at += v;
+	if(!hnef_archive_get_varint(p, n, &at, &v)) {
+		goto damaged;
+	}
+	game->plies = v;
+	game->moves = p + at;
+	game->moves_length = n - at;
+
+	c->offset += (p - (c->archive->image + c->offset)) + length;
+	return 1;
+
+damaged:
+	c->offset = c->end;
+	return 0;
+}
+
+/**
+ * @brief Set up the starting position of a game
+ *
+ * @param game The game
+ *
+ * @param b Receives the position
+ *
+ * @return True on success, false if the game is damaged
+ */
+int
+hnef_archive_game_start( const HnefArchiveGame *game, HnefBoard *b ) {
+	return hnef_board_decode_layout(b, game->layout, game->layout_length, NULL) &&
+		hnef_board_decode(b, game->position, game->position_length, NULL);
+}
+
+/**
+ * @brief Read one move of a game
+ *
+ * @param game The game
+ *
+ * @param at Offset of the move in game->moves, 0 for the first. It is
+ * advanced to the next move
+ *
+ * @param move Receives the move
+ *
+ * @return True on success, false after the last move or if the move is
+ * damaged
+ */
+int
+hnef_archive_game_move( const HnefArchiveGame *game, size_t *at, HnefMove *move ) {
+	uint64_t v, line;
+	int from, to;
+
+	line = game->width + game->height;
+	if(line == 0 || !hnef_archive_get_varint(game->moves, game->moves_length, at, &v)) {
+		return 0;
+	}
+	from = (int)(v / line);
+	to = (int)(v % line);
+	if(v / line >= (uint64_t)(game->width*game->height)) {
+		return 0;
+	}
+	move->from = HNEF_SQUARE(from % game->width, from / game->width);
+	if(to < game->width) {
+		move->to = HNEF_SQUARE(to, from / game->width);
+	} else {
+		move->to = HNEF_SQUARE(from % game->width, to - game->width);
+	}
+	return move->from != move->to;
+}
+
+/**
+ * @brief Play out the start of a game under its rules. Each move is
+ * checked for legality before it is made, and a move after the game
+ * has been decided is damage.
+ *
+ * @param game The game
+ *
+ * @param b Receives the position
+ *
+ * @param plies The number of moves to play, at most game->plies
+ *
+ * @return True on success, false if the game is damaged
+ */
+int
+hnef_archive_game_replay( const HnefArchiveGame *game, HnefBoard *b, uint64_t plies ) {
+	HnefRules rules;
+	HnefRuleTables tables;
+	HnefRays rays;
+	HnefMove move;
+	HnefUndo records[1];
+	HnefUndoStack stack;
+	uint64_t i;
+	size_t at;
+
+	if(plies > game->plies || !hnef_rules_init(&rules, game->rules) || !hnef_archive_game_start(game, b) ||
+	   !hnef_rules_compile(&tables, &rules, b)) {
+		return 0;
+	}
+	hnef_rays_init(&rays, b->height, b->width);
+	at = 0;
+	for( i=0; i<plies; i++ ) {
+		if(hnef_rules_get_winner(&tables, b) != HNEF_NO_WINNER || !hnef_archive_game_move(game, &at, &move) ||
+		   !hnef_board_is_legal_move(b, &rays, b->turn, move)) {
+			return 0;
+		}
+		hnef_undo_stack_init(&stack, records, 1);
+		hnef_rules_make_move(&tables, b, move, &stack);
+	}
+	return 1;
+}
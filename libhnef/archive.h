@@ -0,0 +1,113 @@
+/* libhnef/archive.h
+ *
+ * Copyright (C) 2016 Gary Munnelly
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+/**
+ * @file libhnef/archive.h
+ *
+ * @brief Macros, typedefs and function forward declarations for game
+ * archives
+ *
+ * @author Gary Munnelly
+ */
+
+#ifndef LIBHNEF_ARCHIVE_H_
+#define LIBHNEF_ARCHIVE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "move.h"
+
+#define HNEF_ARCHIVE_STRIDE 256   /**< Games between entries of the index */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief An archive being written. Games are streamed to the file one
+ * at a time, and only the moves of the game in progress are held in
+ * memory.
+ */
+typedef struct HnefArchiveWriter {
+	FILE *file;               /**< File being written */
+	uint64_t offset;          /**< Bytes written to the file */
+	uint64_t count;           /**< Games finished */
+	uint64_t *index;          /**< Offset of every HNEF_ARCHIVE_STRIDE'th game */
+	uint64_t index_capacity;  /**< Index entries allocated */
+	uint8_t *buffer;          /**< Record of the game in progress */
+	size_t length;            /**< Bytes in buffer */
+	size_t capacity;          /**< Bytes allocated for buffer */
+	size_t winner_at;         /**< Offset of the winner in buffer */
+	size_t moves_at;          /**< Offset of the first move in buffer */
+	int height;               /**< Height of the game in progress */
+	int width;                /**< Width of the game in progress */
+	int playing;              /**< Set between begin and end */
+	uint64_t plies;           /**< Moves of the game in progress */
+	int failed;               /**< Set once a write has failed */
+} HnefArchiveWriter;
+
+/**
+ * @brief A read only archive of games, mapped into memory. It may be
+ * scanned by any number of threads at once.
+ */
+typedef struct HnefArchive {
+	const uint8_t *image;     /**< The whole file */
+	size_t size;              /**< Bytes in image */
+	int mapped;               /**< Set if image is mapped from the file */
+	uint64_t end;             /**< Offset of the end of the last game */
+	uint64_t count;           /**< Games held, if indexed */
+	uint64_t entries;         /**< Entries in the index */
+	const uint8_t *index;     /**< The index, or NULL if the file was not closed */
+} HnefArchive;
+
+/**
+ * @brief A position in an archive from which games are read. Each
+ * cursor belongs to one thread.
+ */
+typedef struct HnefArchiveCursor {
+	const HnefArchive *archive; /**< The archive being read */
+	uint64_t offset;          /**< Offset of the next game */
+	uint64_t end;             /**< Offset beyond the last game to be read */
+} HnefArchiveCursor;
+
+/**
+ * @brief One game of an archive. The game points into the archive's
+ * memory and owns nothing.
+ */
+typedef struct HnefArchiveGame {
+	int rules;                /**< One of the HNEF_RULES_* presets */
+	int winner;               /**< Team code of the winner, or HNEF_NO_WINNER */
+	int height;               /**< Height of the board */
+	int width;                /**< Width of the board */
+	uint64_t plies;           /**< Moves played */
+	const uint8_t *layout;    /**< Layout of the board, see wire.h */
+	size_t layout_length;     /**< Bytes in layout */
+	const uint8_t *position;  /**< Starting position, see wire.h */
+	size_t position_length;   /**< Bytes in position */
+	const uint8_t *moves;     /**< The moves, as varints */
+	size_t moves_length;      /**< Bytes in moves */
+} HnefArchiveGame;
+
+int          hnef_archive_writer_open      ( HnefArchiveWriter *w, const char *path );
+int          hnef_archive_writer_begin     ( HnefArchiveWriter *w, HnefBoard *start, int rules );
+int          hnef_archive_writer_move      ( HnefArchiveWriter *w, HnefMove move );
+int          hnef_archive_writer_end       ( HnefArchiveWriter *w, int winner );
+int          hnef_archive_writer_close     ( HnefArchiveWriter *w );
+int          hnef_archive_open             ( HnefArchive *a, const char *path );
+void         hnef_archive_close            ( HnefArchive *a );
+void         hnef_archive_cursor_init      ( HnefArchiveCursor *c, const HnefArchive *a, int shard, int shards );
+int          hnef_archive_next             ( HnefArchiveCursor *c, HnefArchiveGame *game );
+int          hnef_archive_game_start       ( const HnefArchiveGame *game, HnefBoard *b );
+int          hnef_archive_game_move        ( const HnefArchiveGame *game, size_t *at, HnefMove *move );
+int          hnef_archive_game_replay      ( const HnefArchiveGame *game, HnefBoard *b, uint64_t plies );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBHNEF_ARCHIVE_H_ */
@@ -0,0 +1,472 @@
+/* libhnef/batch.c
+ *
+ * Copyright (C) 2016 Gary Munnelly
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+/**
+ * @file libhnef/batch.c
+ *
+ * @brief Code for playing many games at once in structure of arrays
+ * form
+ *
+ * The batch operations are written once in batch_impl.h against a
+ * vector type and compiled here for plain C and, on x86 with GCC or
+ * Clang, for AVX2 and AVX-512. The best instruction set the processor
+ * supports is picked at run time when a batch is initialized, so the
+ * library itself needs no special compiler flags.
+ *
+ * Games follow the default rules of move.c.
+ *
+ * @author Gary Munnelly
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include "batch.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HNEF_BATCH_X86 1
+#else
+#define HNEF_BATCH_X86 0
+#endif
+
+static const int hnef_batch_dx[4] = { 0, 1, 0, -1 }; /**< x step of each direction */
+static const int hnef_batch_dy[4] = { -1, 0, 1, 0 }; /**< y step of each direction */
+
+/**
+ * @brief A batch operation on one vector of games
+ */
+typedef void (*HnefBatchKernel)( const HnefBoardBatch *b, const uint32_t *lanes,
+				 const uint32_t *turns, uint32_t *out );
+
+/**
+ * @brief The batch operations compiled for one instruction set
+ */
+typedef struct HnefBatchKernels {
+	int width;                    /**< Games per vector */
+	HnefBatchKernel count_moves;  /**< See hnef_board_batch_count_moves */
+	HnefBatchKernel count_captures; /**< See hnef_board_batch_count_captures */
+	HnefBatchKernel get_winners;  /**< See hnef_board_batch_get_winners */
+} HnefBatchKernels;
+
+#define HNEF_BATCH_VEC uint32_t
+#define HNEF_BATCH_WIDTH 1
+#define HNEF_BATCH_NAME(f) f##_scalar
+#define HNEF_BATCH_TARGET
+#include "batch_impl.h"
+#undef HNEF_BATCH_VEC
+#undef HNEF_BATCH_WIDTH
+#undef HNEF_BATCH_NAME
+#undef HNEF_BATCH_TARGET
+
+#if HNEF_BATCH_X86
+typedef uint32_t HnefBatchVec8 __attribute__((vector_size(32)));
+typedef uint32_t HnefBatchVec16 __attribute__((vector_size(64)));
+
+#define HNEF_BATCH_VEC HnefBatchVec8
+#define HNEF_BATCH_WIDTH 8
+#define HNEF_BATCH_NAME(f) f##_avx2
+#define HNEF_BATCH_TARGET __attribute__((target("avx2")))
+#include "batch_impl.h"
+#undef HNEF_BATCH_VEC
+#undef HNEF_BATCH_WIDTH
+#undef HNEF_BATCH_NAME
+#undef HNEF_BATCH_TARGET
+
+#define HNEF_BATCH_VEC HnefBatchVec16
+#define HNEF_BATCH_WIDTH 16
+#define HNEF_BATCH_NAME(f) f##_avx512
+#define HNEF_BATCH_TARGET __attribute__((target("avx512f")))
+#include "batch_impl.h"
+#undef HNEF_BATCH_VEC
+#undef HNEF_BATCH_WIDTH
+#undef HNEF_BATCH_NAME
+#undef HNEF_BATCH_TARGET
+#endif
+
+/**
+ * @brief The operations of each instruction set, indexed by the
+ * HNEF_BATCH_* codes
+ */
+static const HnefBatchKernels hnef_batch_kernels[] = {
+	{ 1, hnef_batch_count_moves_scalar, hnef_batch_count_captures_scalar, hnef_batch_get_winners_scalar },
+#if HNEF_BATCH_X86
+	{ 8, hnef_batch_count_moves_avx2, hnef_batch_count_captures_avx2, hnef_batch_get_winners_avx2 },
+	{ 16, hnef_batch_count_moves_avx512, hnef_batch_count_captures_avx512, hnef_batch_get_winners_avx512 },
+#endif
+};
+
+/**
+ * @brief Get the address of row y of plane p of a game's block. The
+ * game's own row is at the game's lane within it.
+ */
+static uint32_t*
+hnef_batch_row( HnefBoardBatch *batch, int game, int p, int y ) {
+	int block = game / HNEF_BATCH_LANES;
+	return batch->rows + ((block*HNEF_BATCH_PLANES + p)*batch->height + y)*HNEF_BATCH_LANES
+		+ game % HNEF_BATCH_LANES;
+}
+
+/**
+ * @brief Determine whether the square at (x,y) of a game is in plane p
+ */
+static int
+hnef_batch_test( HnefBoardBatch *batch, int game, int p, int x, int y ) {
+	return (*hnef_batch_row(batch, game, p, y) >> x) & 1;
+}
+
+/**
+ * @brief Add or remove the square at (x,y) of a game to plane p
+ */
+static void
+hnef_batch_put( HnefBoardBatch *batch, int game, int p, int x, int y, int on ) {
+	uint32_t *row = hnef_batch_row(batch, game, p, y);
+	if(on) {
+		*row |= (uint32_t)1 << x;
+	} else {
+		*row &= ~((uint32_t)1 << x);
+	}
+}
+
+/**
+ * @brief Run a batch operation over every block of games
+ */
+static void
+hnef_batch_run( HnefBoardBatch *batch, int op, int *results ) {
+	const HnefBatchKernels *k;
+	HnefBatchKernel kernel;
+	uint32_t out[HNEF_BATCH_LANES];
+	const uint32_t *lanes;
+	int i, j, block, stride;
+
+	k = &(hnef_batch_kernels[batch->isa]);
+	kernel = (op == 0)? k->count_moves : (op == 1)? k->count_captures : k->get_winners;
+	stride = HNEF_BATCH_PLANES*batch->height*HNEF_BATCH_LANES;
+
+	for( block=0; block<batch->blocks; block++ ) {
+		lanes = batch->rows + block*stride;
+		for( j=0; j<HNEF_BATCH_LANES; j+=k->width ) {
+			kernel(batch, lanes + j, batch->turns + block*HNEF_BATCH_LANES + j, out + j);
+		}
+		for( i=0; i<HNEF_BATCH_LANES && block*HNEF_BATCH_LANES + i < batch->count; i++ ) {
+			results[block*HNEF_BATCH_LANES + i] = (int)out[i];
+		}
+	}
+}
+
+/**
+ * @brief Allocate a batch of games, each starting from the position
+ * passed as an argument. Every game of the batch shares the layout's
+ * size and tile structure.
+ *
+ * @param batch The batch to be initialized
+ *
+ * @param layout The starting position of every game
+ *
+ * @param count The number of games
+ *
+ * @return True on success, false if the allocation fails
+ */
+int
+hnef_board_batch_init( HnefBoardBatch *batch, HnefBoard *layout, int count ) {
+	HnefBitboard restricted, hostile;
+	size_t bytes;
+	void *mem;
+	int i, y;
+
+	batch->height = layout->height;
+	batch->width = layout->width;
+	batch->count = count;
+	batch->blocks = (count + HNEF_BATCH_LANES - 1) / HNEF_BATCH_LANES;
+	batch->isa = hnef_board_batch_get_best_isa();
+
+	for( i=0; i<4; i++ ) {
+		batch->types[i] = layout->types[i];
+	}
+	batch->escapes = layout->escapes;
+	hnef_bitboard_or(&restricted, &(layout->types[HNEF_THRONE]), &(layout->types[HNEF_CASTLE]));
+	hnef_bitboard_fill(&hostile, layout->height, layout->width);
+	hnef_bitboard_andnot(&hostile, &hostile, &(layout->types[HNEF_EMPTY]));
+	for( y=0; y<32; y++ ) {
+		batch->full[y] = (y < layout->height)?
+			((layout->width >= 32)? 0xffffffffu : ((uint32_t)1 << layout->width) - 1) : 0;
+		batch->camps[y] = hnef_bitboard_get_row(&(layout->types[HNEF_CAMP]), y);
+		batch->restricted[y] = hnef_bitboard_get_row(&restricted, y);
+		batch->hostile[y] = hnef_bitboard_get_row(&hostile, y);
+		batch->exits[y] = hnef_bitboard_get_row(&(layout->escapes), y);
+	}
+
+	/* One allocation, aligned for the widest vector, holds the token
+	 * planes followed by the turns */
+	bytes = (size_t)batch->blocks*HNEF_BATCH_LANES*(HNEF_BATCH_PLANES*batch->height + 1)*sizeof(uint32_t);
+	if(posix_memalign(&mem, 64, bytes ? bytes : 64)) {
+		batch->rows = batch->turns = NULL;
+		return 0;
+	}
+	memset(mem, 0, bytes);
+	batch->rows = mem;
+	batch->turns = batch->rows + (size_t)batch->blocks*HNEF_BATCH_PLANES*batch->height*HNEF_BATCH_LANES;
+
+	for( i=0; i<count; i++ ) {
+		hnef_board_batch_set(batch, i, layout);
+	}
+	return 1;
+}
+
+/**
+ * @brief Release the memory held by a batch
+ */
+void
+hnef_board_batch_free( HnefBoardBatch *batch ) {
+	free(batch->rows);
+	batch->rows = batch->turns = NULL;
+}
+
+/**
+ * @brief Find the widest instruction set the processor supports
+ *
+ * @return One of the HNEF_BATCH_* instruction set codes
+ */
+int
+hnef_board_batch_get_best_isa( void ) {
+#if HNEF_BATCH_X86
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("avx512f")) {
+		return HNEF_BATCH_AVX512;
+	}
+	if(__builtin_cpu_supports("avx2")) {
+		return HNEF_BATCH_AVX2;
+	}
+#endif
+	return HNEF_BATCH_SCALAR;
+}
+
+/**
+ * @brief Choose the instruction set a batch's operations use in place
+ * of the best one available
+ *
+ * @param batch The batch to be changed
+ *
+ * @param isa One of the HNEF_BATCH_* instruction set codes
+ *
+ * @return True on success, false if the processor lacks the
+ * instruction set, in which case the batch is left unchanged
+ */
+int
+hnef_board_batch_set_isa( HnefBoardBatch *batch, int isa ) {
+	if(isa < HNEF_BATCH_SCALAR || isa > hnef_board_batch_get_best_isa()) {
+		return 0;
+	}
+	batch->isa = isa;
+	return 1;
+}
+
+/**
+ * @brief Replace the position of one game of a batch
+ *
+ * @param batch The batch holding the game
+ *
+ * @param game The index of the game
+ *
+ * @param board The new position, which must share the batch's size
+ * and tile structure
+ *
+ * @return True on success, false if game is out of range or the
+ * board does not fit the batch
+ */
+int
+hnef_board_batch_set( HnefBoardBatch *batch, int game, HnefBoard *board ) {
+	int i, y;
+
+	if(game < 0 || game >= batch->count) {
+		return 0;
+	}
+	if(board->height != batch->height || board->width != batch->width ||
+	   memcmp(&(board->escapes), &(batch->escapes), sizeof(HnefBitboard))) {
+		return 0;
+	}
+	for( i=0; i<4; i++ ) {
+		if(memcmp(&(board->types[i]), &(batch->types[i]), sizeof(HnefBitboard))) {
+			return 0;
+		}
+	}
+
+	for( y=0; y<batch->height; y++ ) {
+		*hnef_batch_row(batch, game, HNEF_BATCH_ATTACKERS, y) = hnef_bitboard_get_row(&(board->teams[HNEF_MUSCOVITE]), y);
+		*hnef_batch_row(batch, game, HNEF_BATCH_DEFENDERS, y) = hnef_bitboard_get_row(&(board->teams[HNEF_SWEDE]), y);
+		*hnef_batch_row(batch, game, HNEF_BATCH_KING, y) = hnef_bitboard_get_row(&(board->ranks[HNEF_KING]), y);
+	}
+	batch->turns[game] = (board->turn == HNEF_SWEDE)? 0xffffffffu : 0;
+	return 1;
+}
+
+/**
+ * @brief Copy the position of one game of a batch to a board
+ *
+ * @param batch The batch holding the game
+ *
+ * @param game The index of the game
+ *
+ * @param board The board to receive the position
+ */
+void
+hnef_board_batch_get( HnefBoardBatch *batch, int game, HnefBoard *board ) {
+	HnefToken token;
+	int x, y, t, sq;
+
+	hnef_board_init(board, batch->height, batch->width);
+	for( y=0; y<batch->height; y++ ) {
+		for( x=0; x<batch->width; x++ ) {
+			sq = HNEF_SQUARE(x, y);
+			for( t=HNEF_CASTLE; t<=HNEF_CAMP; t++ ) {
+				if(hnef_bitboard_test(&(batch->types[t]), sq)) {
+					hnef_board_set_tile_type(board, x, y, t);
+				}
+			}
+			if(hnef_bitboard_test(&(batch->escapes), sq)) {
+				hnef_board_set_tile_is_escape(board, x, y, HNEF_ESCAPE);
+			}
+			if(hnef_batch_test(batch, game, HNEF_BATCH_ATTACKERS, x, y)) {
+				hnef_token_init(&token, HNEF_MUSCOVITE, HNEF_SOLDIER);
+				hnef_board_set_token(board, x, y, token);
+			} else if(hnef_batch_test(batch, game, HNEF_BATCH_DEFENDERS, x, y)) {
+				hnef_token_init(&token, HNEF_SWEDE,
+					hnef_batch_test(batch, game, HNEF_BATCH_KING, x, y)? HNEF_KING : HNEF_SOLDIER);
+				hnef_board_set_token(board, x, y, token);
+			}
+		}
+	}
+	hnef_board_set_turn(board, batch->turns[game]? HNEF_SWEDE : HNEF_MUSCOVITE);
+}
+
+/**
+ * @brief Determine whether the square at (x,y) of a game can act as
+ * the far side of a capture made by team, as hnef_is_hostile of
+ * move.c does
+ */
+static int
+hnef_batch_is_hostile( HnefBoardBatch *batch, int game, int x, int y, int team ) {
+	if(x < 0 || y < 0 || x >= batch->width || y >= batch->height) {
+		return 0;
+	}
+	if(hnef_batch_test(batch, game, HNEF_BATCH_ATTACKERS, x, y)) {
+		return team == HNEF_MUSCOVITE;
+	}
+	if(hnef_batch_test(batch, game, HNEF_BATCH_DEFENDERS, x, y)) {
+		return team == HNEF_SWEDE;
+	}
+	return (batch->hostile[y] >> x) & 1;
+}
+
+/**
+ * @brief Make a move in one game of a batch, removing any tokens it
+ * captures. The turn passes to the opposing team. The move is not
+ * checked for legality.
+ *
+ * @param batch The batch holding the game
+ *
+ * @param game The index of the game
+ *
+ * @param move The move to be made
+ *
+ * @return The number of tokens captured, or 0 if game is out of range
+ */
+int
+hnef_board_batch_make_move( HnefBoardBatch *batch, int game, HnefMove move ) {
+	int fx, fy, x, y, vx, vy, team, plane, king, d, e, n, caught;
+
+	if(game < 0 || game >= batch->count) {
+		return 0;
+	}
+
+	fx = HNEF_SQUARE_X(move.from);
+	fy = HNEF_SQUARE_Y(move.from);
+	x = HNEF_SQUARE_X(move.to);
+	y = HNEF_SQUARE_Y(move.to);
+
+	team = hnef_batch_test(batch, game, HNEF_BATCH_DEFENDERS, fx, fy)? HNEF_SWEDE : HNEF_MUSCOVITE;
+	plane = team? HNEF_BATCH_DEFENDERS : HNEF_BATCH_ATTACKERS;
+	king = hnef_batch_test(batch, game, HNEF_BATCH_KING, fx, fy);
+
+	hnef_batch_put(batch, game, plane, fx, fy, 0);
+	hnef_batch_put(batch, game, HNEF_BATCH_KING, fx, fy, 0);
+	hnef_batch_put(batch, game, plane, x, y, 1);
+	hnef_batch_put(batch, game, HNEF_BATCH_KING, x, y, king);
+	batch->turns[game] = team? 0 : 0xffffffffu;
+
+	/* Look for enemy tokens sandwiched against the moved token */
+	n = 0;
+	for( d=0; d<4; d++ ) {
+		vx = x + hnef_batch_dx[d];
+		vy = y + hnef_batch_dy[d];
+		if(vx < 0 || vy < 0 || vx >= batch->width || vy >= batch->height ||
+		   !hnef_batch_test(batch, game, team? HNEF_BATCH_ATTACKERS : HNEF_BATCH_DEFENDERS, vx, vy)) {
+			continue;
+		}
+
+		if(hnef_batch_test(batch, game, HNEF_BATCH_KING, vx, vy)) {
+			/* The king must be enclosed on every side */
+			caught = 1;
+			for( e=0; e<4; e++ ) {
+				caught = caught && hnef_batch_is_hostile(batch, game,
+					vx + hnef_batch_dx[e], vy + hnef_batch_dy[e], team);
+			}
+		} else {
+			caught = hnef_batch_is_hostile(batch, game,
+				vx + hnef_batch_dx[d], vy + hnef_batch_dy[d], team);
+		}
+
+		if(caught) {
+			hnef_batch_put(batch, game, HNEF_BATCH_ATTACKERS, vx, vy, 0);
+			hnef_batch_put(batch, game, HNEF_BATCH_DEFENDERS, vx, vy, 0);
+			hnef_batch_put(batch, game, HNEF_BATCH_KING, vx, vy, 0);
+			n++;
+		}
+	}
+	return n;
+}
+
+/**
+ * @brief Count the legal moves of the side to move in every game of
+ * a batch, as hnef_board_generate_moves would find them
+ *
+ * @param batch The batch to be examined
+ *
+ * @param counts Receives the number of moves of each game
+ */
+void
+hnef_board_batch_count_moves( HnefBoardBatch *batch, int *counts ) {
+	hnef_batch_run(batch, 0, counts);
+}
+
+/**
+ * @brief Count, for every game of a batch, the enemy tokens the side
+ * to move could capture with its next move. Each token is counted
+ * once however many moves would capture it.
+ *
+ * @param batch The batch to be examined
+ *
+ * @param counts Receives the number of capturable tokens of each game
+ */
+void
+hnef_board_batch_count_captures( HnefBoardBatch *batch, int *counts ) {
+	hnef_batch_run(batch, 1, counts);
+}
+
+/**
+ * @brief Determine whether either team has won each game of a batch
+ *
+ * @param batch The batch to be examined
+ *
+ * @param winners Receives HNEF_SWEDE, HNEF_MUSCOVITE or HNEF_NO_WINNER
+ * for each game, as hnef_board_get_winner would return
+ */
+void
+hnef_board_batch_get_winners( HnefBoardBatch *batch, int *winners ) {
+	hnef_batch_run(batch, 2, winners);
+}
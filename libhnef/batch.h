@@ -0,0 +1,81 @@
+/* libhnef/batch.h
+ *
+ * Copyright (C) 2016 Gary Munnelly
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+/**
+ * @file libhnef/batch.h
+ *
+ * @brief Macros, typedefs and function forward declarations for the
+ * HnefBoardBatch struct
+ *
+ * @author Gary Munnelly
+ */
+
+#ifndef LIBHNEF_BATCH_H_
+#define LIBHNEF_BATCH_H_
+
+#include <stdint.h>
+#include "move.h"
+
+#define HNEF_BATCH_LANES     16   /**< Games per block, one 512 bit vector of rows */
+
+#define HNEF_BATCH_ATTACKERS 0x00 /**< Plane of attacking tokens */
+#define HNEF_BATCH_DEFENDERS 0x01 /**< Plane of defending tokens, the king included */
+#define HNEF_BATCH_KING      0x02 /**< Plane of the king */
+#define HNEF_BATCH_PLANES    0x03 /**< Token planes per game */
+
+#define HNEF_BATCH_SCALAR    0x00 /**< Plain C, one game at a time */
+#define HNEF_BATCH_AVX2      0x01 /**< 8 games per instruction */
+#define HNEF_BATCH_AVX512    0x02 /**< 16 games per instruction */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Many games played on boards of the same size and structure,
+ * stored as structure of arrays.
+ *
+ * Games are grouped in blocks of HNEF_BATCH_LANES. Within a block each
+ * plane is stored row by row, and each row holds the 32 bit row masks
+ * of every game of the block side by side. One vector load therefore
+ * fetches the same row of 8 or 16 games, and the batch operations work
+ * on all of them at once. The tiles' structure is shared by every game
+ * and kept once.
+ */
+typedef struct HnefBoardBatch {
+	int height;               /**< Height of every board */
+	int width;                /**< Width of every board */
+	int count;                /**< Number of games */
+	int blocks;               /**< Number of blocks of HNEF_BATCH_LANES games */
+	int isa;                  /**< HNEF_BATCH_* instruction set of the operations */
+	HnefBitboard types[4];    /**< Squares indexed by tile structure code */
+	HnefBitboard escapes;     /**< Escape squares */
+	uint32_t full[32];        /**< Squares of each row on the board */
+	uint32_t camps[32];       /**< Camps of each row */
+	uint32_t restricted[32];  /**< Thrones and castles of each row */
+	uint32_t hostile[32];     /**< Squares of each row with any structure */
+	uint32_t exits[32];       /**< Escapes of each row */
+	uint32_t *rows;           /**< Token planes, [block][plane][row][lane] */
+	uint32_t *turns;          /**< All ones where the defenders are to move, [block][lane] */
+} HnefBoardBatch;
+
+int          hnef_board_batch_init         ( HnefBoardBatch *batch, HnefBoard *layout, int count );
+void         hnef_board_batch_free         ( HnefBoardBatch *batch );
+int          hnef_board_batch_get_best_isa ( void );
+int          hnef_board_batch_set_isa      ( HnefBoardBatch *batch, int isa );
+int          hnef_board_batch_set          ( HnefBoardBatch *batch, int game, HnefBoard *b );
+void         hnef_board_batch_get          ( HnefBoardBatch *batch, int game, HnefBoard *b );
+int          hnef_board_batch_make_move    ( HnefBoardBatch *batch, int game, HnefMove move );
+void         hnef_board_batch_count_moves  ( HnefBoardBatch *batch, int *counts );
+void         hnef_board_batch_count_captures( HnefBoardBatch *batch, int *counts );
+void         hnef_board_batch_get_winners  ( HnefBoardBatch *batch, int *winners );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBHNEF_BATCH_H_ */
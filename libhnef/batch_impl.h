@@ -0,0 +1,284 @@
+/* libhnef/batch_impl.h
+ *
+ * Copyright (C) 2016 Gary Munnelly
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+/**
+ * @file libhnef/batch_impl.h
+ *
+ * @brief Operations on a vector of games of a HnefBoardBatch
+ *
+ * This file is included by batch.c once for each instruction set,
+ * with the following macros defined:
+ *
+ * - HNEF_BATCH_VEC, a type holding one 32 bit row of each of
+ *   HNEF_BATCH_WIDTH games: uint32_t itself, or a GCC vector of them
+ * - HNEF_BATCH_WIDTH, the number of games in HNEF_BATCH_VEC
+ * - HNEF_BATCH_NAME(f), which gives each function a unique name
+ * - HNEF_BATCH_TARGET, the attribute enabling the instruction set
+ *
+ * Every function takes a pointer to the rows of the first game of the
+ * vector within its block, and writes one result per game to out.
+ *
+ * @author Gary Munnelly
+ */
+
+/** Address of row y of plane p of the vector of games at lanes */
+#define HNEF_BATCH_ROW(b, lanes, p, y) \
+	(*(const HNEF_BATCH_VEC*)((lanes) + ((p)*(b)->height + (y))*HNEF_BATCH_LANES))
+
+/**
+ * @brief Count the set bits of each row
+ */
+HNEF_BATCH_TARGET static inline HNEF_BATCH_VEC
+HNEF_BATCH_NAME(hnef_batch_popcount)( HNEF_BATCH_VEC v ) {
+	v = v - ((v >> 1) & 0x55555555u);
+	v = (v & 0x33333333u) + ((v >> 2) & 0x33333333u);
+	v = (v + (v >> 4)) & 0x0f0f0f0fu;
+	return (v * 0x01010101u) >> 24;
+}
+
+/**
+ * @brief Find the squares of each row reached by sliding east from
+ * gen across pass
+ */
+HNEF_BATCH_TARGET static inline HNEF_BATCH_VEC
+HNEF_BATCH_NAME(hnef_batch_east)( HNEF_BATCH_VEC gen, HNEF_BATCH_VEC pass ) {
+	HNEF_BATCH_VEC pro = pass;
+
+	gen |= pro & (gen << 1);
+	pro &= pro << 1;
+	gen |= pro & (gen << 2);
+	pro &= pro << 2;
+	gen |= pro & (gen << 4);
+	pro &= pro << 4;
+	gen |= pro & (gen << 8);
+	pro &= pro << 8;
+	gen |= pro & (gen << 16);
+	return (gen << 1) & pass;
+}
+
+/**
+ * @brief Find the squares of each row reached by sliding west from
+ * gen across pass
+ */
+HNEF_BATCH_TARGET static inline HNEF_BATCH_VEC
+HNEF_BATCH_NAME(hnef_batch_west)( HNEF_BATCH_VEC gen, HNEF_BATCH_VEC pass ) {
+	HNEF_BATCH_VEC pro = pass;
+
+	gen |= pro & (gen >> 1);
+	pro &= pro >> 1;
+	gen |= pro & (gen >> 2);
+	pro &= pro >> 2;
+	gen |= pro & (gen >> 4);
+	pro &= pro >> 4;
+	gen |= pro & (gen >> 8);
+	pro &= pro >> 8;
+	gen |= pro & (gen >> 16);
+	return (gen >> 1) & pass;
+}
+
+/**
+ * @brief The tokens of the side to move, split into the classes of
+ * move.c, with the squares each class may cross and land on
+ */
+typedef struct HNEF_BATCH_NAME(HnefBatchRow) {
+	HNEF_BATCH_VEC gen[3];    /**< King, soldiers off camps, soldiers on camps */
+	HNEF_BATCH_VEC pass[3];   /**< Squares each class may cross */
+	HNEF_BATCH_VEC land[3];   /**< Squares each class may stop on */
+} HNEF_BATCH_NAME(HnefBatchRow);
+
+/**
+ * @brief Split row y of the side to move's tokens into classes
+ */
+HNEF_BATCH_TARGET static inline void
+HNEF_BATCH_NAME(hnef_batch_row)( const HnefBoardBatch *b, const uint32_t *lanes, HNEF_BATCH_VEC turn,
+				 int y, HNEF_BATCH_NAME(HnefBatchRow) *r ) {
+	HNEF_BATCH_VEC zero = {0}, att, def, king, mover, empty, camps, restricted;
+
+	att = HNEF_BATCH_ROW(b, lanes, HNEF_BATCH_ATTACKERS, y);
+	def = HNEF_BATCH_ROW(b, lanes, HNEF_BATCH_DEFENDERS, y);
+	king = HNEF_BATCH_ROW(b, lanes, HNEF_BATCH_KING, y);
+	camps = zero + b->camps[y];
+	restricted = zero + b->restricted[y];
+
+	mover = (def & turn) | (att & ~turn);
+	empty = (zero + b->full[y]) & ~(att | def);
+
+	/* The king may go anywhere but a camp */
+	r->gen[0] = mover & king;
+	r->pass[0] = empty & ~camps;
+	r->land[0] = r->pass[0];
+
+	/* Soldiers may not enter camps nor stop on thrones or castles */
+	r->gen[1] = mover & ~king & ~camps;
+	r->pass[1] = r->pass[0];
+	r->land[1] = r->pass[0] & ~restricted;
+
+	/* Soldiers on camps may cross them */
+	r->gen[2] = mover & ~king & camps;
+	r->pass[2] = empty;
+	r->land[2] = empty & ~restricted;
+}
+
+/**
+ * @brief Find the squares the side to move can reach, row by row. If
+ * counts is not NULL, the number of moves of each game is written to
+ * it. If reach is not NULL, the squares any move lands on are.
+ *
+ * Along a row each square is reached in a given direction by at most
+ * the one token nearest to it, so the moves are counted by adding up
+ * the squares reached in each direction.
+ */
+HNEF_BATCH_TARGET static inline void
+HNEF_BATCH_NAME(hnef_batch_moves)( const HnefBoardBatch *b, const uint32_t *lanes, const uint32_t *turns,
+				   HNEF_BATCH_VEC *counts, HNEF_BATCH_VEC *reach ) {
+	HNEF_BATCH_NAME(HnefBatchRow) rows[32];
+	HNEF_BATCH_VEC zero = {0}, turn, carry[3], east, west, vert, total;
+	int y, c;
+
+	turn = *(const HNEF_BATCH_VEC*)turns;
+	total = zero;
+
+	/* Rows east and west, columns south */
+	for( c=0; c<3; c++ ) {
+		carry[c] = zero;
+	}
+	for( y=0; y<b->height; y++ ) {
+		HNEF_BATCH_NAME(hnef_batch_row)(b, lanes, turn, y, &(rows[y]));
+		east = west = vert = zero;
+		for( c=0; c<3; c++ ) {
+			east |= HNEF_BATCH_NAME(hnef_batch_east)(rows[y].gen[c], rows[y].pass[c]) & rows[y].land[c];
+			west |= HNEF_BATCH_NAME(hnef_batch_west)(rows[y].gen[c], rows[y].pass[c]) & rows[y].land[c];
+			carry[c] &= rows[y].pass[c];
+			vert |= carry[c] & rows[y].land[c];
+			carry[c] |= rows[y].gen[c];
+		}
+		if(counts) {
+			total += HNEF_BATCH_NAME(hnef_batch_popcount)(east)
+				+ HNEF_BATCH_NAME(hnef_batch_popcount)(west)
+				+ HNEF_BATCH_NAME(hnef_batch_popcount)(vert);
+		}
+		if(reach) {
+			reach[y] = east | west | vert;
+		}
+	}
+
+	/* Columns north */
+	for( c=0; c<3; c++ ) {
+		carry[c] = zero;
+	}
+	for( y=b->height-1; y>=0; y-- ) {
+		vert = zero;
+		for( c=0; c<3; c++ ) {
+			carry[c] &= rows[y].pass[c];
+			vert |= carry[c] & rows[y].land[c];
+			carry[c] |= rows[y].gen[c];
+		}
+		if(counts) {
+			total += HNEF_BATCH_NAME(hnef_batch_popcount)(vert);
+		}
+		if(reach) {
+			reach[y] |= vert;
+		}
+	}
+
+	if(counts) {
+		*counts = total;
+	}
+}
+
+/**
+ * @brief Count the legal moves of the side to move of each game
+ */
+HNEF_BATCH_TARGET static void
+HNEF_BATCH_NAME(hnef_batch_count_moves)( const HnefBoardBatch *b, const uint32_t *lanes,
+					 const uint32_t *turns, uint32_t *out ) {
+	HNEF_BATCH_VEC counts;
+
+	HNEF_BATCH_NAME(hnef_batch_moves)(b, lanes, turns, &counts, NULL);
+	memcpy(out, &counts, sizeof(counts));
+}
+
+/**
+ * @brief Count the enemy tokens the side to move of each game can
+ * capture with its next move. A soldier is capturable if some move
+ * lands beside it with a hostile square opposite; the king if some
+ * move lands beside it with hostile squares on the other three sides.
+ */
+HNEF_BATCH_TARGET static void
+HNEF_BATCH_NAME(hnef_batch_count_captures)( const HnefBoardBatch *b, const uint32_t *lanes,
+					    const uint32_t *turns, uint32_t *out ) {
+	HNEF_BATCH_VEC reach[34], hostile[34], zero = {0}, turn, att, def, king, own, enemy, occ, full;
+	HNEF_BATCH_VEC n, s, e, w, ln, ls, le, lw, caught, total;
+	int y;
+
+	/* Pad with an empty row above and below the board */
+	HNEF_BATCH_NAME(hnef_batch_moves)(b, lanes, turns, NULL, reach + 1);
+	reach[0] = reach[b->height + 1] = zero;
+	hostile[0] = hostile[b->height + 1] = zero;
+
+	turn = *(const HNEF_BATCH_VEC*)turns;
+	for( y=0; y<b->height; y++ ) {
+		att = HNEF_BATCH_ROW(b, lanes, HNEF_BATCH_ATTACKERS, y);
+		def = HNEF_BATCH_ROW(b, lanes, HNEF_BATCH_DEFENDERS, y);
+		occ = att | def;
+		own = (def & turn) | (att & ~turn);
+		hostile[y+1] = own | ((zero + b->hostile[y]) & ~occ);
+	}
+
+	total = zero;
+	for( y=0; y<b->height; y++ ) {
+		att = HNEF_BATCH_ROW(b, lanes, HNEF_BATCH_ATTACKERS, y);
+		def = HNEF_BATCH_ROW(b, lanes, HNEF_BATCH_DEFENDERS, y);
+		king = HNEF_BATCH_ROW(b, lanes, HNEF_BATCH_KING, y);
+		full = zero + b->full[y];
+		enemy = (att & turn) | (def & ~turn);
+
+		/* Hostility and reach of the neighbours of each square */
+		n = hostile[y];
+		s = hostile[y+2];
+		e = hostile[y+1] >> 1;
+		w = hostile[y+1] << 1;
+		ln = reach[y];
+		ls = reach[y+2];
+		le = reach[y+1] >> 1;
+		lw = reach[y+1] << 1;
+
+		caught = enemy & ~king & ((le & w) | (lw & e) | (ln & s) | (ls & n));
+		caught |= enemy & king & ((ln & s & e & w) | (ls & n & e & w) |
+					  (le & n & s & w) | (lw & n & s & e));
+		total += HNEF_BATCH_NAME(hnef_batch_popcount)(caught & full);
+	}
+	memcpy(out, &total, sizeof(total));
+}
+
+/**
+ * @brief Find the winner of each game, as hnef_board_get_winner would
+ */
+HNEF_BATCH_TARGET static void
+HNEF_BATCH_NAME(hnef_batch_get_winners)( const HnefBoardBatch *b, const uint32_t *lanes,
+					 const uint32_t *turns, uint32_t *out ) {
+	HNEF_BATCH_VEC zero = {0}, king, kings, escaped;
+	int y;
+
+	(void)turns;
+	kings = escaped = zero;
+	for( y=0; y<b->height; y++ ) {
+		king = HNEF_BATCH_ROW(b, lanes, HNEF_BATCH_KING, y);
+		kings |= king;
+		escaped |= king & (zero + b->exits[y]);
+	}
+
+	/* Reduce each row to 1 if any bit is set, 0 otherwise */
+	kings = (kings | (zero - kings)) >> 31;
+	escaped = (escaped | (zero - escaped)) >> 31;
+
+	/* HNEF_SWEDE is 1, HNEF_MUSCOVITE 0 and HNEF_NO_WINNER all ones */
+	escaped = escaped - ((1 - escaped) & kings);
+	memcpy(out, &escaped, sizeof(escaped));
+}
+
+#undef HNEF_BATCH_ROW
@@ -0,0 +1,402 @@
+/* libhnef/bitboard.c
+ *
+ * Copyright (C) 2016 Gary Munnelly
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+/**
+ * @file libhnef/bitboard.c
+ *
+ * @brief Code for manipulating sets of board squares stored as one
+ * bit per square
+ *
+ * @author Gary Munnelly
+ */
+#include "bitboard.h"
+
+/**
+ * @brief Remove every square from the set
+ *
+ * @param bb The set to be cleared
+ */
+void
+hnef_bitboard_clear( HnefBitboard *bb ) {
+	int i;
+	for( i=0; i<HNEF_BITBOARD_WORDS; i++ ) {
+		bb->words[i] = 0;
+	}
+}
+
+/**
+ * @brief Make the set contain every square on a board of the
+ * dimensions passed as arguments
+ *
+ * @param bb The set to be filled
+ *
+ * @param height The height of the board
+ *
+ * @param width The width of the board
+ */
+void
+hnef_bitboard_fill( HnefBitboard *bb, int height, int width ) {
+	uint32_t row;
+	int y;
+
+	row = (width >= 32)? 0xffffffffu : ((uint32_t)1 << width) - 1;
+
+	hnef_bitboard_clear(bb);
+	for( y=0; y<height; y++ ) {
+		hnef_bitboard_set_row(bb, y, row);
+	}
+}
+
+/**
+ * @brief Count the squares in the set
+ *
+ * @param bb The set whose squares we wish to count
+ *
+ * @return The number of squares in the set
+ */
+int
+hnef_bitboard_popcount( const HnefBitboard *bb ) {
+	int i, n;
+
+	n = 0;
+	for( i=0; i<HNEF_BITBOARD_WORDS; i++ ) {
+		n += hnef_popcount64(bb->words[i]);
+	}
+	return n;
+}
+
+/**
+ * @brief Determine whether or not the set contains any squares
+ *
+ * @param bb The set to be examined
+ *
+ * @return True if the set is empty, false otherwise
+ */
+int
+hnef_bitboard_is_empty( const HnefBitboard *bb ) {
+	uint64_t acc;
+	int i;
+
+	acc = 0;
+	for( i=0; i<HNEF_BITBOARD_WORDS; i++ ) {
+		acc |= bb->words[i];
+	}
+	return acc == 0;
+}
+
+/**
+ * @brief Find the lowest numbered square in the set
+ *
+ * @param bb The set to be examined
+ *
+ * @return The bit index of the first square or -1 if the set is empty
+ */
+int
+hnef_bitboard_first( const HnefBitboard *bb ) {
+	int i;
+	for( i=0; i<HNEF_BITBOARD_WORDS; i++ ) {
+		if(bb->words[i]) {
+			return i*64 + hnef_ctz64(bb->words[i]);
+		}
+	}
+	return -1;
+}
+
+/**
+ * @brief Store the intersection of two sets in dst. dst may alias
+ * either argument.
+ */
+void
+hnef_bitboard_and( HnefBitboard *dst, const HnefBitboard *a, const HnefBitboard *b ) {
+	int i;
+	for( i=0; i<HNEF_BITBOARD_WORDS; i++ ) {
+		dst->words[i] = a->words[i] & b->words[i];
+	}
+}
+
+/**
+ * @brief Store the union of two sets in dst. dst may alias either
+ * argument.
+ */
+void
+hnef_bitboard_or( HnefBitboard *dst, const HnefBitboard *a, const HnefBitboard *b ) {
+	int i;
+	for( i=0; i<HNEF_BITBOARD_WORDS; i++ ) {
+		dst->words[i] = a->words[i] | b->words[i];
+	}
+}
+
+/**
+ * @brief Store the squares of a which are not in b in dst. dst may
+ * alias either argument.
+ */
+void
+hnef_bitboard_andnot( HnefBitboard *dst, const HnefBitboard *a, const HnefBitboard *b ) {
+	int i;
+	for( i=0; i<HNEF_BITBOARD_WORDS; i++ ) {
+		dst->words[i] = a->words[i] & ~b->words[i];
+	}
+}
+
+/**
+ * @brief Determine whether any square of column x is in the set
+ *
+ * @param bb The set to be examined
+ *
+ * @param x The column to be examined
+ *
+ * @return True if at least one square in column x is set
+ */
+int
+hnef_bitboard_column_any( const HnefBitboard *bb, int x ) {
+	uint64_t mask, acc;
+	int i;
+
+	/* Each word holds two rows, so test bit x of both halves */
+	mask = ((uint64_t)1 << x) | ((uint64_t)1 << (x + 32));
+	acc = 0;
+	for( i=0; i<HNEF_BITBOARD_WORDS; i++ ) {
+		acc |= bb->words[i];
+	}
+	return (acc & mask) != 0;
+}
+
+/**
+ * @brief Mirror the set about the main diagonal, so that square (x,y)
+ * of src becomes square (y,x) of dst. The 32x32 bit matrix is
+ * transposed in place with five rounds of block swaps rather than
+ * one bit at a time, or four rounds over 16x16 bits if nothing lies
+ * outside them. The swaps work on whole words, two rows at a time.
+ * dst may alias src.
+ *
+ * @param dst The set to hold the transposed squares
+ *
+ * @param src The set to be transposed
+ */
+void
+hnef_bitboard_transpose( HnefBitboard *dst, const HnefBitboard *src ) {
+	uint64_t w[HNEF_BITBOARD_WORDS], outside, m, t;
+	int i, j, k, h, n;
+
+	/* Sets confined to the top left 16x16 squares, which covers
+	 * every standard board, skip the first round of swaps */
+	outside = 0;
+	for( i=0; i<HNEF_BITBOARD_WORDS; i++ ) {
+		outside |= (i < HNEF_BITBOARD_WORDS/2)? src->words[i] & 0xffff0000ffff0000ULL : src->words[i];
+	}
+	n = outside? HNEF_BITBOARD_WORDS : HNEF_BITBOARD_WORDS/2;
+
+	for( k=0; k<n; k++ ) {
+		w[k] = src->words[k];
+	}
+
+	/* Swap off-diagonal blocks of size 16, 8, 4 and 2. Rows j apart
+	 * lie j/2 words apart in the same half, so both halves of a word
+	 * are swapped at once. */
+	m = (n == HNEF_BITBOARD_WORDS)? 0x0000ffff0000ffffULL : 0x00ff00ff00ff00ffULL;
+	for( j=n; j!=1; j>>=1, m^=(m<<j) ) {
+		h = j/2;
+		for( k=0; k<n; k=(k+h+1) & ~h ) {
+			t = ((w[k] >> j) ^ w[k+h]) & m;
+			w[k] ^= t << j;
+			w[k+h] ^= t;
+		}
+	}
+
+	/* Blocks of size 1 swap between the two rows of each word */
+	for( k=0; k<n; k++ ) {
+		t = ((w[k] >> 1) ^ (w[k] >> 32)) & 0x55555555ULL;
+		w[k] ^= (t << 1) | (t << 32);
+	}
+
+	for( k=0; k<n; k++ ) {
+		dst->words[k] = w[k];
+	}
+	for( ; k<HNEF_BITBOARD_WORDS; k++ ) {
+		dst->words[k] = 0;
+	}
+}
+
+/**
+ * @brief Apply one of the eight symmetries of the square to a set on
+ * a board of the given size. The transpose, if any, is applied first
+ * and swaps the height and width of the board; the mirrors then
+ * reverse each row and the order of the rows. dst may alias src.
+ *
+ * @param dst The set to hold the transformed squares
+ *
+ * @param src The set to be transformed
+ *
+ * @param transform One of the HNEF_TRANSFORM_* codes
+ *
+ * @param height The height of the board src lies on
+ *
+ * @param width The width of the board src lies on
+ */
+void
+hnef_bitboard_transform( HnefBitboard *dst, const HnefBitboard *src, int transform, int height, int width ) {
+	uint32_t a[HNEF_BITBOARD_ROWS];
+	int y, t;
+
+	if(transform & HNEF_TRANSFORM_TRANSPOSE) {
+		hnef_bitboard_transpose(dst, src);
+		src = dst;
+		t = height;
+		height = width;
+		width = t;
+	}
+
+	for( y=0; y<height; y++ ) {
+		a[y] = hnef_bitboard_get_row(src, y);
+		if(transform & HNEF_TRANSFORM_FLIP_X) {
+			a[y] = hnef_reverse32(a[y]) >> (HNEF_BITBOARD_STRIDE - width);
+		}
+	}
+	for( y=0; y<height; y++ ) {
+		hnef_bitboard_set_row(dst, y, (transform & HNEF_TRANSFORM_FLIP_Y)? a[height-1-y] : a[y]);
+	}
+	for( ; y<HNEF_BITBOARD_ROWS; y++ ) {
+		hnef_bitboard_set_row(dst, y, 0);
+	}
+}
+
+/**
+ * @brief Grow the squares of one word, two rows, as far as they go
+ * within it
+ */
+static uint64_t
+hnef_bitboard_flood_word( uint64_t w, uint64_t passable ) {
+	const uint64_t west = 0xfffffffefffffffeULL;  /* bits which may receive w << 1 */
+	const uint64_t east = 0x7fffffff7fffffffULL;  /* bits which may receive w >> 1 */
+	uint64_t last;
+
+	do {
+		last = w;
+		w |= (((w << 1) & west) | ((w >> 1) & east) | (w << 32) | (w >> 32)) & passable;
+	} while(w != last);
+	return w;
+}
+
+/**
+ * @brief Grow a set of squares to everything reachable from it by
+ * steps north, south, east and west without leaving a second set.
+ * Each word, two rows, is filled as far as it goes before the fill
+ * spills into the rows above and below, sweeping down and then up the
+ * board until the set stops growing.
+ *
+ * @param fill The seed squares, replaced by the squares reached. Seed
+ * squares outside passable are dropped
+ *
+ * @param passable The squares the fill may enter
+ */
+void
+hnef_bitboard_flood( HnefBitboard *fill, const HnefBitboard *passable ) {
+	uint64_t w, changed;
+	int i;
+
+	for( i=0; i<HNEF_BITBOARD_WORDS; i++ ) {
+		fill->words[i] &= passable->words[i];
+	}
+
+	do {
+		changed = 0;
+		for( i=0; i<HNEF_BITBOARD_WORDS; i++ ) {
+			w = fill->words[i];
+			if(i > 0) {
+				w |= (fill->words[i-1] >> 32) & passable->words[i];
+			}
+			if(w) {
+				w = hnef_bitboard_flood_word(w, passable->words[i]);
+			}
+			changed |= w ^ fill->words[i];
+			fill->words[i] = w;
+		}
+		for( i=HNEF_BITBOARD_WORDS-1; i>=0; i-- ) {
+			w = fill->words[i];
+			if(i < HNEF_BITBOARD_WORDS - 1) {
+				w |= (fill->words[i+1] << 32) & passable->words[i];
+			}
+			if(w) {
+				w = hnef_bitboard_flood_word(w, passable->words[i]);
+			}
+			changed |= w ^ fill->words[i];
+			fill->words[i] = w;
+		}
+	} while(changed);
+}
+
+/**
+ * @brief Extend a row of squares along the row through empty squares,
+ * in both directions at once, by doubling
+ */
+static uint32_t
+hnef_bitboard_row_slide( uint32_t gen, uint32_t empty ) {
+	uint32_t east, west, pe, pw;
+	int n;
+
+	east = west = gen;
+	pe = pw = empty;
+	for( n=1; n<HNEF_BITBOARD_STRIDE; n*=2 ) {
+		east |= pe & (east << n);
+		pe &= pe << n;
+		west |= pw & (west >> n);
+		pw &= pw >> n;
+	}
+	return ((east << 1) | (west >> 1)) & empty;
+}
+
+/**
+ * @brief Find every square a rook-moving token could reach in one move
+ * from any square of a set. Every token of the set is handled at
+ * once: rows are filled east and west by doubling shifts, and columns
+ * are filled north and south one row at a time for all 32 columns in
+ * parallel, so the cost does not depend on the number of tokens.
+ *
+ * @param dst The set to hold the reachable squares. May alias src
+ *
+ * @param src The squares the tokens stand on
+ *
+ * @param empty The squares a token may cross and land on
+ */
+void
+hnef_bitboard_slide_fill( HnefBitboard *dst, const HnefBitboard *src, const HnefBitboard *empty ) {
+	uint32_t g[HNEF_BITBOARD_ROWS], e[HNEF_BITBOARD_ROWS], out[HNEF_BITBOARD_ROWS];
+	uint32_t south, north;
+	int y, rows;
+
+	/* Rows past the last word holding a token or an empty square
+	 * neither reach nor can be reached, so they are never visited */
+	for( rows=HNEF_BITBOARD_ROWS; rows>0 && !(src->words[(rows >> 1) - 1] | empty->words[(rows >> 1) - 1]); rows-=2 );
+
+	for( y=0; y<rows; y++ ) {
+		g[y] = hnef_bitboard_get_row(src, y);
+		e[y] = hnef_bitboard_get_row(empty, y);
+		out[y] = hnef_bitboard_row_slide(g[y], e[y]);
+	}
+
+	if(rows > 0) {
+		south = g[0];
+		for( y=1; y<rows; y++ ) {
+			south &= e[y];
+			out[y] |= south;
+			south |= g[y];
+		}
+		north = g[rows-1];
+		for( y=rows-2; y>=0; y-- ) {
+			north &= e[y];
+			out[y] |= north;
+			north |= g[y];
+		}
+	}
+
+	for( y=0; y<rows; y+=2 ) {
+		dst->words[y >> 1] = (uint64_t)out[y] | ((uint64_t)out[y+1] << 32);
+	}
+	for( ; y<HNEF_BITBOARD_ROWS; y+=2 ) {
+		dst->words[y >> 1] = 0;
+	}
+}
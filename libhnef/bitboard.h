@@ -0,0 +1,180 @@
+/* libhnef/bitboard.h
+ *
+ * Copyright (C) 2016 Gary Munnelly
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+/**
+ * @file libhnef/bitboard.h
+ *
+ * @brief Macros, typedefs and function forward declarations for the
+ * HnefBitboard struct
+ *
+ * @author Gary Munnelly
+ */
+
+#ifndef LIBHNEF_BITBOARD_H_
+#define LIBHNEF_BITBOARD_H_
+
+#include <stdint.h>
+
+#define HNEF_BITBOARD_STRIDE 32   /**< Bits reserved for each board row */
+#define HNEF_BITBOARD_ROWS   32   /**< Number of rows a bitboard can hold */
+#define HNEF_BITBOARD_WORDS  16   /**< 64 bit words in a bitboard */
+
+#define HNEF_TRANSFORM_IDENTITY       0x00 /**< Leave every square in place */
+#define HNEF_TRANSFORM_FLIP_X         0x01 /**< Mirror left to right */
+#define HNEF_TRANSFORM_FLIP_Y         0x02 /**< Mirror top to bottom */
+#define HNEF_TRANSFORM_ROTATE_180     0x03 /**< Both mirrors, a half turn */
+#define HNEF_TRANSFORM_TRANSPOSE      0x04 /**< Mirror about the main diagonal */
+#define HNEF_TRANSFORM_ROTATE_CW      0x05 /**< Transpose, then mirror left to right */
+#define HNEF_TRANSFORM_ROTATE_CCW     0x06 /**< Transpose, then mirror top to bottom */
+#define HNEF_TRANSFORM_ANTI_TRANSPOSE 0x07 /**< Mirror about the other diagonal */
+#define HNEF_TRANSFORM_COUNT          0x08 /**< Number of symmetries of a square board */
+
+/** Bit index of the square at coordinates (x,y) */
+#define HNEF_SQUARE(x, y)   ((y) * HNEF_BITBOARD_STRIDE + (x))
+/** x coordinate of the square with bit index sq */
+#define HNEF_SQUARE_X(sq)   ((sq) & (HNEF_BITBOARD_STRIDE - 1))
+/** y coordinate of the square with bit index sq */
+#define HNEF_SQUARE_Y(sq)   ((sq) / HNEF_BITBOARD_STRIDE)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief A set of squares on a board of at most 32x32 tiles.
+ *
+ * Every row occupies 32 bits regardless of the width of the board,
+ * so each 64 bit word holds two complete rows. Square (x,y) is bit
+ * HNEF_SQUARE(x,y). Bits outside the board are always clear.
+ */
+typedef struct HnefBitboard {
+	uint64_t words[HNEF_BITBOARD_WORDS]; /**< Two board rows per word */
+} HnefBitboard;
+
+void         hnef_bitboard_clear           ( HnefBitboard *bb );
+void         hnef_bitboard_fill            ( HnefBitboard *bb, int height, int width );
+int          hnef_bitboard_popcount        ( const HnefBitboard *bb );
+int          hnef_bitboard_is_empty        ( const HnefBitboard *bb );
+int          hnef_bitboard_first           ( const HnefBitboard *bb );
+void         hnef_bitboard_and             ( HnefBitboard *dst, const HnefBitboard *a, const HnefBitboard *b );
+void         hnef_bitboard_or              ( HnefBitboard *dst, const HnefBitboard *a, const HnefBitboard *b );
+void         hnef_bitboard_andnot          ( HnefBitboard *dst, const HnefBitboard *a, const HnefBitboard *b );
+int          hnef_bitboard_column_any      ( const HnefBitboard *bb, int x );
+void         hnef_bitboard_transpose       ( HnefBitboard *dst, const HnefBitboard *src );
+void         hnef_bitboard_transform       ( HnefBitboard *dst, const HnefBitboard *src, int transform, int height, int width );
+void         hnef_bitboard_flood           ( HnefBitboard *fill, const HnefBitboard *passable );
+void         hnef_bitboard_slide_fill      ( HnefBitboard *dst, const HnefBitboard *src, const HnefBitboard *empty );
+
+/**
+ * @brief Count the set bits in a 64 bit word
+ */
+static inline int
+hnef_popcount64( uint64_t w ) {
+#if defined(__GNUC__)
+	return __builtin_popcountll(w);
+#else
+	w = w - ((w >> 1) & 0x5555555555555555ULL);
+	w = (w & 0x3333333333333333ULL) + ((w >> 2) & 0x3333333333333333ULL);
+	w = (w + (w >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+	return (int)((w * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+/**
+ * @brief Index of the least significant set bit of a non-zero word
+ */
+static inline int
+hnef_ctz64( uint64_t w ) {
+#if defined(__GNUC__)
+	return __builtin_ctzll(w);
+#else
+	int n = 0;
+	while( !(w & 1) ) {
+		w >>= 1;
+		n++;
+	}
+	return n;
+#endif
+}
+
+/**
+ * @brief Index of the most significant set bit of a non-zero 32 bit
+ * word
+ */
+static inline int
+hnef_msb32( uint32_t w ) {
+#if defined(__GNUC__)
+	return 31 - __builtin_clz(w);
+#else
+	int n = 0;
+	while( w >>= 1 ) {
+		n++;
+	}
+	return n;
+#endif
+}
+
+/**
+ * @brief Reverse the order of the bits of a 32 bit word
+ */
+static inline uint32_t
+hnef_reverse32( uint32_t w ) {
+	w = ((w >> 1) & 0x55555555u) | ((w & 0x55555555u) << 1);
+	w = ((w >> 2) & 0x33333333u) | ((w & 0x33333333u) << 2);
+	w = ((w >> 4) & 0x0f0f0f0fu) | ((w & 0x0f0f0f0fu) << 4);
+	w = ((w >> 8) & 0x00ff00ffu) | ((w & 0x00ff00ffu) << 8);
+	return (w >> 16) | (w << 16);
+}
+
+/**
+ * @brief Add square sq to the set
+ */
+static inline void
+hnef_bitboard_set( HnefBitboard *bb, int sq ) {
+	bb->words[sq >> 6] |= (uint64_t)1 << (sq & 63);
+}
+
+/**
+ * @brief Remove square sq from the set
+ */
+static inline void
+hnef_bitboard_unset( HnefBitboard *bb, int sq ) {
+	bb->words[sq >> 6] &= ~((uint64_t)1 << (sq & 63));
+}
+
+/**
+ * @brief Determine whether square sq is in the set
+ */
+static inline int
+hnef_bitboard_test( const HnefBitboard *bb, int sq ) {
+	return (int)((bb->words[sq >> 6] >> (sq & 63)) & 1);
+}
+
+/**
+ * @brief Get row y of the set as a 32 bit mask where bit x
+ * represents square (x,y)
+ */
+static inline uint32_t
+hnef_bitboard_get_row( const HnefBitboard *bb, int y ) {
+	return (uint32_t)(bb->words[y >> 1] >> ((y & 1) * 32));
+}
+
+/**
+ * @brief Replace row y of the set with the 32 bit mask passed
+ */
+static inline void
+hnef_bitboard_set_row( HnefBitboard *bb, int y, uint32_t row ) {
+	int shift = (y & 1) * 32;
+	bb->words[y >> 1] = (bb->words[y >> 1] & ~((uint64_t)0xffffffffu << shift))
+		| ((uint64_t)row << shift);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBHNEF_BITBOARD_H_ */
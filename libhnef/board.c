@@ -13,19 +13,130 @@
  *
  * @author Gary Munnelly
  */
+#include <stdlib.h>
 #include "board.h"
 
 /**
- * @brief Allocate memory for a new instance of the HnefBoard
- * struct. This function will return NULL in the event that the
- * allocation fails.
+ * @brief Bring the structure bitboards for the tile at (x,y) back in
+ * line with the tile itself. Token bitboards are handled separately
+ * by hnef_board_sync_token.
+ */
+static void
+hnef_board_sync_structure( HnefBoard *board, int x, int y ) {
+	HnefTile *tile;
+	int i, sq;
+
+	tile = &(board->tiles[board->width*y + x]);
+	sq = HNEF_SQUARE(x, y);
+
+	/* The masks still describe the old structure, so use them to
+	 * remove its key before recording the new one */
+	for( i=0; i<4; i++ ) {
+		if(hnef_bitboard_test(&(board->types[i]), sq)) {
+			board->key ^= hnef_zobrist_type(sq, i);
+		}
+		hnef_bitboard_unset(&(board->types[i]), sq);
+	}
+	hnef_bitboard_set(&(board->types[tile->type & 0x03]), sq);
+	board->key ^= hnef_zobrist_type(sq, tile->type & 0x03);
+
+	if(hnef_bitboard_test(&(board->escapes), sq)) {
+		board->key ^= hnef_zobrist_escape(sq);
+	}
+	if(tile->is_escape) {
+		hnef_bitboard_set(&(board->escapes), sq);
+		board->key ^= hnef_zobrist_escape(sq);
+	} else {
+		hnef_bitboard_unset(&(board->escapes), sq);
+	}
+}
+
+/**
+ * @brief Bring the occupancy bitboards for the tile at (x,y) back in
+ * line with the token standing on the tile, if any
+ */
+static void
+hnef_board_sync_token( HnefBoard *board, int x, int y ) {
+	HnefTile *tile;
+	int sq, team, rank;
+
+	tile = &(board->tiles[board->width*y + x]);
+	sq = HNEF_SQUARE(x, y);
+
+	/* Remove the key of the token the masks still hold, if any, and
+	 * tell the watcher it has gone */
+	if(hnef_bitboard_test(&(board->occupied), sq)) {
+		team = hnef_bitboard_test(&(board->teams[1]), sq);
+		rank = hnef_bitboard_test(&(board->ranks[1]), sq);
+		board->key ^= hnef_zobrist_token(sq, team, rank);
+		if(board->watcher) {
+			board->watcher(board, board->watcher_data, sq, team, rank, -1);
+		}
+	}
+
+	hnef_bitboard_unset(&(board->occupied), sq);
+	hnef_bitboard_unset(&(board->teams[0]), sq);
+	hnef_bitboard_unset(&(board->teams[1]), sq);
+	hnef_bitboard_unset(&(board->ranks[0]), sq);
+	hnef_bitboard_unset(&(board->ranks[1]), sq);
+
+	if(tile->is_occupied) {
+		hnef_bitboard_set(&(board->occupied), sq);
+		hnef_bitboard_set(&(board->teams[tile->token.team & 0x01]), sq);
+		hnef_bitboard_set(&(board->ranks[tile->token.rank & 0x01]), sq);
+		board->key ^= hnef_zobrist_token(sq, tile->token.team, tile->token.rank);
+		if(board->watcher) {
+			board->watcher(board, board->watcher_data, sq, tile->token.team, tile->token.rank, 1);
+		}
+	}
+}
+
+/**
+ * @brief Allocate a new HnefBoard on the heap and initialize it with
+ * blank, empty tiles. Boards made often should come from a
+ * HnefBoardPool or HnefBoardArena instead, see pool.h.
+ *
+ * @param height The height of the game board
+ *
+ * @param width The width of the game board
+ *
+ * @return A pointer to the new board, to be released with
+ * hnef_board_free, or NULL if the size is out of range or memory could
+ * not be allocated
+ */
+HnefBoard*
+hnef_board_new( int height, int width ) {
+	HnefBoard *board;
+
+	if(height < 1 || width < 1 || height > MAX_HEIGHT || width > MAX_WIDTH) {
+		return NULL;
+	}
+	board = malloc(sizeof(HnefBoard));
+	return hnef_board_init(board, height, width);
+}
+
+/**
+ * @brief Release a board made by hnef_board_new
+ *
+ * @param board The board to be released, which may be NULL
+ */
+void
+hnef_board_free( HnefBoard *board ) {
+	free(board);
+}
+
+/**
+ * @brief Initialize the HnefBoard struct passed as an argument with
+ * blank, empty tiles. This function will return NULL if board is
+ * NULL.
+ *
+ * @param board The board to be initialized
  *
  * @param height The height of the game board
  *
  * @param width The width of the game board
  *
- * @return A pointer to the newly allocated board or NULL on failed
- * allocation
+ * @return A pointer to the initialized board or NULL if board is NULL
  */
 HnefBoard*
 hnef_board_init ( HnefBoard *board, int height, int width ) {
@@ -39,7 +150,45 @@ hnef_board_init ( HnefBoard *board, int height, int width ) {
 		for( i=0; i<board->area; i++ ) {
 			hnef_tile_init( &(board->tiles[i]), HNEF_EMPTY, HNEF_NO_ESCAPE );	
 		}
+
+		/* Every square starts empty with no structure built on it */
+		hnef_bitboard_clear(&(board->occupied));
+		for( i=0; i<2; i++ ) {
+			hnef_bitboard_clear(&(board->teams[i]));
+			hnef_bitboard_clear(&(board->ranks[i]));
+		}
+		for( i=0; i<4; i++ ) {
+			hnef_bitboard_clear(&(board->types[i]));
+		}
+		hnef_bitboard_fill(&(board->types[HNEF_EMPTY]), height, width);
+		hnef_bitboard_clear(&(board->escapes));
+
+		/* Attackers move first */
+		board->turn = HNEF_MUSCOVITE;
+		board->key = hnef_zobrist_size(height, width);
+		board->watcher = NULL;
+		board->watcher_data = NULL;
+	}
+	return board;
+}
+
+/**
+ * @brief Copy a board without its watcher. A plain struct copy would
+ * share the watcher and its data, so tokens moved on the copy would
+ * be counted against the original; copies must be made with this
+ * function instead. dst may be src, which stops it being watched.
+ *
+ * @param dst The board to receive the copy
+ *
+ * @param src The board to be copied
+ */
+void
+hnef_board_copy( HnefBoard *dst, const HnefBoard *src ) {
+	if(dst != src) {
+		*dst = *src;
 	}
+	dst->watcher = NULL;
+	dst->watcher_data = NULL;
 }
 
 /**
@@ -73,8 +222,8 @@ hnef_board_serialize( HnefBoard *board, uint8_t *buffer ) {
 	/* Serialize each tile and store in the appropriate buffer slot */
 	for( y=0; y<height; y++ ) {
 		for( x=0; x<width; x++ ) {			
-			serialized = hnef_tile_serialize(&(board->tiles[board->height*y+x]));
-			buffer[y*height+x+2] = serialized;
+			serialized = hnef_tile_serialize(&(board->tiles[board->width*y+x]));
+			buffer[y*width+x+2] = serialized;
 		}
 	}
 }
@@ -103,9 +252,11 @@ hnef_board_deserialize( HnefBoard *board, uint8_t* buffer ) {
 	for( y=0; y<height; y++ ) {
 		for( x=0; x<width; x++ ) {
 			/* Deserialize tile */
-			if(!hnef_tile_deserialize(&board->tiles[y*height+x], buffer[y*height + x + 2])) {
+			if(!hnef_tile_deserialize(&board->tiles[y*width+x], buffer[y*width + x + 2])) {
 				return 0;
 			}
+			hnef_board_sync_structure(board, x, y);
+			hnef_board_sync_token(board, x, y);
 		}
 	}
 
@@ -152,6 +303,77 @@ hnef_board_get_area( HnefBoard *board ) {
 	return board->area;
 }
 
+/**
+ * @brief Get the team code of the side to move
+ *
+ * @param board The board whose turn we wish to determine
+ *
+ * @return The team which is to make the next move
+ */
+int
+hnef_board_get_turn( HnefBoard *board ) {
+	return board->turn;
+}
+
+/**
+ * @brief Set the team code of the side to move
+ *
+ * @param board The board whose turn we wish to set
+ *
+ * @param team The team which is to make the next move
+ */
+void
+hnef_board_set_turn( HnefBoard *board, int team ) {
+	board->key ^= hnef_zobrist_turn(board->turn) ^ hnef_zobrist_turn(team & 0x01);
+	board->turn = team & 0x01;
+}
+
+/**
+ * @brief Get the Zobrist key of the position on the board. The key is
+ * kept up to date incrementally by every function which modifies the
+ * board.
+ *
+ * @param board The board whose key we wish to retrieve
+ *
+ * @return The 64 bit Zobrist key of the position
+ */
+uint64_t
+hnef_board_get_key( HnefBoard *board ) {
+	return board->key;
+}
+
+/**
+ * @brief Compute the Zobrist key of the position on the board from
+ * scratch. This is slow and only intended for checking the key
+ * returned by hnef_board_get_key.
+ *
+ * @param board The board whose key we wish to compute
+ *
+ * @return The 64 bit Zobrist key of the position
+ */
+uint64_t
+hnef_board_compute_key( HnefBoard *board ) {
+	HnefTile *tile;
+	uint64_t key;
+	int x, y, sq;
+
+	key = hnef_zobrist_size(board->height, board->width) ^ hnef_zobrist_turn(board->turn);
+	for( y=0; y<board->height; y++ ) {
+		for( x=0; x<board->width; x++ ) {
+			tile = &(board->tiles[board->width*y + x]);
+			sq = HNEF_SQUARE(x, y);
+			key ^= hnef_zobrist_type(sq, tile->type);
+			if(tile->is_escape) {
+				key ^= hnef_zobrist_escape(sq);
+			}
+			if(tile->is_occupied) {
+				key ^= hnef_zobrist_token(sq, tile->token.team, tile->token.rank);
+			}
+		}
+	}
+	return key;
+}
+
 /**
  * @brief Get the board tile located at the coordinates passed as arguments
  *
@@ -165,7 +387,7 @@ hnef_board_get_area( HnefBoard *board ) {
  */
 HnefTile
 hnef_board_get_tile( HnefBoard *board, int x, int y ) {
-	return board->tiles[board->height*y+x];
+	return board->tiles[board->width*y+x];
 }
 
 /**
@@ -182,7 +404,9 @@ hnef_board_get_tile( HnefBoard *board, int x, int y ) {
  */
 void
 hnef_board_set_tile( HnefBoard *board, int x, int y, HnefTile tile ) {	
-	board->tiles[board->height*y+x] = tile;
+	board->tiles[board->width*y+x] = tile;
+	hnef_board_sync_structure(board, x, y);
+	hnef_board_sync_token(board, x, y);
 }
 
 /**
@@ -200,12 +424,13 @@ hnef_board_set_tile( HnefBoard *board, int x, int y, HnefTile tile ) {
  */
 int
 hnef_board_get_tile_type( HnefBoard *board, int x, int y ) {
-	return hnef_tile_get_type(&(board->tiles[board->height*y+x]));
+	return hnef_tile_get_type(&(board->tiles[board->width*y+x]));
 }
 
 void
 hnef_board_set_tile_type( HnefBoard *board, int x, int y, int type ) {
-	hnef_tile_set_type(&(board->tiles[board->height*y+x]), type);
+	hnef_tile_set_type(&(board->tiles[board->width*y+x]), type);
+	hnef_board_sync_structure(board, x, y);
 }
 
 /**
@@ -222,17 +447,30 @@ hnef_board_set_tile_type( HnefBoard *board, int x, int y, int type ) {
  */
 int
 hnef_board_get_tile_is_escape( HnefBoard *board, int x, int y ) {
-	return hnef_tile_get_is_escape(&(board->tiles[board->height*y+x]));
+	return hnef_tile_get_is_escape(&(board->tiles[board->width*y+x]));
 }
 
 void
 hnef_board_set_tile_is_escape( HnefBoard *board, int x, int y, int is_escape ) {
-	hnef_tile_set_is_escape(&(board->tiles[board->height*y+x]), is_escape);
+	hnef_tile_set_is_escape(&(board->tiles[board->width*y+x]), is_escape);
+	hnef_board_sync_structure(board, x, y);
 }
 
+/**
+ * @brief Determine whether or not a token stands on the tile at the
+ * given coordinates
+ *
+ * @param board The board whose tiles we are examining
+ *
+ * @param x The x coordinate of the tile we wish to examine
+ *
+ * @param y The y coordinate of the tile we wish to examine
+ *
+ * @return True if the tile at (x,y) is occupied, false otherwise
+ */
 int
 hnef_board_get_tile_is_occupied( HnefBoard *board, int x, int y ) {
-	return hnef_tile_get_is_occupied(&(board->tiles[board->height*y+x]));
+	return hnef_bitboard_test(&(board->occupied), HNEF_SQUARE(x, y));
 }
 
 /**
@@ -250,7 +488,7 @@ hnef_board_get_tile_is_occupied( HnefBoard *board, int x, int y ) {
  */
 HnefToken
 hnef_board_get_token( HnefBoard *board, int x, int y ) {	
-	return hnef_tile_get_token(&(board->tiles[board->height*y+x]));
+	return hnef_tile_get_token(&(board->tiles[board->width*y+x]));
 }
 
 /**
@@ -268,15 +506,130 @@ hnef_board_get_token( HnefBoard *board, int x, int y ) {
  */
 void
 hnef_board_set_token( HnefBoard *board, int x, int y, HnefToken token ) {	
-	hnef_tile_set_token( &(board->tiles[board->height*y + x]), token );
+	hnef_tile_set_token( &(board->tiles[board->width*y + x]), token );
+	hnef_board_sync_token(board, x, y);
 }
 
 int
 hnef_board_get_token_rank ( HnefBoard *b, int x, int y ) {
-	return b->tiles[b->height*y + x].token.rank;
+	return b->tiles[b->width*y + x].token.rank;
 }
 
 int
 hnef_board_get_token_team ( HnefBoard *b, int x, int y ) {
-	return b->tiles[b->height*y + x].token.team;
-}
\ No newline at end of file
+	return b->tiles[b->width*y + x].token.team;
+}
+
+/**
+ * @brief Remove the token standing on the tile positioned at the
+ * coordinates passed as arguments. Tiles belonging to a board must be
+ * cleared through this function rather than hnef_tile_unset_token so
+ * that the board's bitboards stay in sync.
+ *
+ * @param board The board whose tiles we are examining
+ *
+ * @param x The x coordinate of the tile we wish to clear
+ *
+ * @param y The y coordinate of the tile we wish to clear
+ */
+void
+hnef_board_unset_token( HnefBoard *b, int x, int y ) {
+	hnef_tile_unset_token( &(b->tiles[b->width*y + x]) );
+	hnef_board_sync_token(b, x, y);
+}
+
+/**
+ * @brief Count the tokens on the board belonging to a team
+ *
+ * @param b The board whose tokens we wish to count
+ *
+ * @param team The team code of the tokens to be counted
+ *
+ * @return The number of tokens belonging to team
+ */
+int
+hnef_board_count_team( HnefBoard *b, int team ) {
+	return hnef_bitboard_popcount(&(b->teams[team & 0x01]));
+}
+
+/**
+ * @brief Count the tokens on the board holding a given rank
+ *
+ * @param b The board whose tokens we wish to count
+ *
+ * @param rank The rank code of the tokens to be counted
+ *
+ * @return The number of tokens holding rank
+ */
+int
+hnef_board_count_rank( HnefBoard *b, int rank ) {
+	return hnef_bitboard_popcount(&(b->ranks[rank & 0x01]));
+}
+
+/**
+ * @brief Determine whether any token stands on row y of the board
+ *
+ * @param b The board whose tiles we are examining
+ *
+ * @param y The row to be examined
+ *
+ * @return True if at least one tile in row y is occupied
+ */
+int
+hnef_board_get_row_is_occupied( HnefBoard *b, int y ) {
+	return hnef_bitboard_get_row(&(b->occupied), y) != 0;
+}
+
+/**
+ * @brief Determine whether any token stands on column x of the board
+ *
+ * @param b The board whose tiles we are examining
+ *
+ * @param x The column to be examined
+ *
+ * @return True if at least one tile in column x is occupied
+ */
+int
+hnef_board_get_column_is_occupied( HnefBoard *b, int x ) {
+	return hnef_bitboard_column_any(&(b->occupied), x);
+}
+
+/**
+ * @brief Get the set of squares occupied by any token
+ */
+const HnefBitboard*
+hnef_board_get_occupied( HnefBoard *b ) {
+	return &(b->occupied);
+}
+
+/**
+ * @brief Get the set of squares occupied by tokens of a team
+ */
+const HnefBitboard*
+hnef_board_get_team_mask( HnefBoard *b, int team ) {
+	return &(b->teams[team & 0x01]);
+}
+
+/**
+ * @brief Get the set of squares occupied by tokens of a rank
+ */
+const HnefBitboard*
+hnef_board_get_rank_mask( HnefBoard *b, int rank ) {
+	return &(b->ranks[rank & 0x01]);
+}
+
+/**
+ * @brief Get the set of squares with a given structure built on them
+ */
+const HnefBitboard*
+hnef_board_get_type_mask( HnefBoard *b, int type ) {
+	return &(b->types[type & 0x03]);
+}
+
+/**
+ * @brief Get the set of squares via which the king may escape
+ */
+const HnefBitboard*
+hnef_board_get_escape_mask( HnefBoard *b ) {
+	return &(b->escapes);
+}
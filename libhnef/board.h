@@ -18,34 +18,71 @@
 #define LIBHNEF_BOARD_H
 
 #include "tile.h"
+#include "bitboard.h"
+#include "zobrist.h"
 
 #define MAX_WIDTH  32
 #define MAX_HEIGHT 32
 
 /* Allow us to compile this file as a C++ library */
-#ifdef _cplusplus
+#ifdef __cplusplus
 extern "C" {
 #endif
 
+struct HnefBoard;
+
+/**
+ * @brief Told of each token placed on (sign 1) or removed from (sign
+ * -1) a board, so that sums over the tokens can follow the position.
+ * data is the board's watcher_data.
+ */
+typedef void (*HnefBoardWatcher)( struct HnefBoard *b, void *data, int sq, int team, int rank, int sign );
+
 /**
  * @brief Represents a board on which a game of hnefatafl may be
  * played. Maintains a dynamic array of tiles, a height, width and
  * area parameter
+ *
+ * Alongside the tiles the board keeps a set of bitboards which
+ * mirror the occupancy and structure of each tile. These are kept in
+ * sync by the hnef_board_set_* functions, so tiles must only be
+ * modified through the board API once they belong to a board. A
+ * watcher, if set, is told of every token placed or removed; the
+ * evaluator uses one to keep its per-token features, see
+ * hnef_eval_track. Boards are copied with hnef_board_copy, which
+ * leaves the copy unwatched; a plain struct copy would share the
+ * watcher's data with the original.
  */
 typedef struct HnefBoard {
 	int height;           /**< Height of the board */
 	int width;            /**< Width of the board */
 	int area;             /**< Area of the board */
 	HnefTile tiles[MAX_HEIGHT*MAX_HEIGHT];     /**< HnefTiles of which the board is comprised */
+	HnefBitboard occupied;  /**< Squares occupied by any token */
+	HnefBitboard teams[2];  /**< Occupied squares indexed by team code */
+	HnefBitboard ranks[2];  /**< Occupied squares indexed by rank code */
+	HnefBitboard types[4];  /**< Squares indexed by tile structure code */
+	HnefBitboard escapes;   /**< Squares via which the king may escape */
+	int turn;               /**< Team code of the side to move */
+	uint64_t key;           /**< Zobrist key of the position */
+	HnefBoardWatcher watcher; /**< Told of token changes, or NULL */
+	void *watcher_data;     /**< Passed to watcher */
 } HnefBoard; 
 
 HnefBoard*   hnef_board_new                   ( int h, int w );
+void         hnef_board_free                  ( HnefBoard *b );
+HnefBoard*   hnef_board_init                  ( HnefBoard *b, int h, int w );
+void         hnef_board_copy                  ( HnefBoard *dst, const HnefBoard *src );
 void         hnef_board_serialize             ( HnefBoard *b, uint8_t *buffer);
 int          hnef_board_deserialize           ( HnefBoard *board, uint8_t *buf );
 
 int          hnef_board_get_height            ( HnefBoard *b );
 int          hnef_board_get_width             ( HnefBoard *b );
 int          hnef_board_get_area              ( HnefBoard *b );	
+int          hnef_board_get_turn              ( HnefBoard *b );
+void         hnef_board_set_turn              ( HnefBoard *b, int team );
+uint64_t     hnef_board_get_key               ( HnefBoard *b );
+uint64_t     hnef_board_compute_key           ( HnefBoard *b );
 HnefTile     hnef_board_get_tile              ( HnefBoard *b, int x, int y );
 void         hnef_board_set_tile              ( HnefBoard *b, int x, int y, HnefTile t );
 int          hnef_board_get_tile_type         ( HnefBoard *b, int x, int y );
@@ -57,8 +94,19 @@ int          hnef_board_get_tile_is_occupied  ( HnefBoard *b, int x, int y );
 void         hnef_board_set_token             ( HnefBoard *b, int x, int y, HnefToken t );
 int          hnef_board_get_token_rank        ( HnefBoard *b, int x, int y );
 int          hnef_board_get_token_team        ( HnefBoard *b, int x, int y );
+void         hnef_board_unset_token           ( HnefBoard *b, int x, int y );
+
+int          hnef_board_count_team            ( HnefBoard *b, int team );
+int          hnef_board_count_rank            ( HnefBoard *b, int rank );
+int          hnef_board_get_row_is_occupied   ( HnefBoard *b, int y );
+int          hnef_board_get_column_is_occupied( HnefBoard *b, int x );
+const HnefBitboard* hnef_board_get_occupied   ( HnefBoard *b );
+const HnefBitboard* hnef_board_get_team_mask  ( HnefBoard *b, int team );
+const HnefBitboard* hnef_board_get_rank_mask  ( HnefBoard *b, int rank );
+const HnefBitboard* hnef_board_get_type_mask  ( HnefBoard *b, int type );
+const HnefBitboard* hnef_board_get_escape_mask( HnefBoard *b );
 
-#ifdef _cplusplus
+#ifdef __cplusplus
 }
 #endif
 
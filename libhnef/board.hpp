@@ -0,0 +1,685 @@
+/* libhnef/board.hpp
+ *
+ * Copyright (C) 2016 Gary Munnelly
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+/**
+ * @file libhnef/board.hpp
+ *
+ * @brief C++ boards whose dimensions are fixed at compile time
+ *
+ * hnef::Board<H, W> holds a position as one W bit word per row, sized
+ * for exactly H rows, together with a column-major copy of the
+ * occupied squares. With both dimensions known to the compiler every
+ * loop over rows, columns and directions has a constant trip count and
+ * can be unrolled, and the masks of the whole board, its edges, its
+ * corners and its throne are computed at compile time.
+ *
+ * Movement and capture follow the same rules as move.c, moves are
+ * generated in the same order and Zobrist keys agree with those of an
+ * HnefBoard holding the same position, so the two can be mixed
+ * freely. Positions are converted with load and store. The C API in
+ * board.h remains the way to handle boards whose size is only known
+ * at run time.
+ *
+ * Requires C++14.
+ *
+ * @author Gary Munnelly
+ */
+
+#ifndef LIBHNEF_BOARD_HPP_
+#define LIBHNEF_BOARD_HPP_
+
+#include <stdint.h>
+#include "board.h"
+#include "move.h"
+
+namespace hnef {
+
+/**
+ * @brief A set of squares on a board of N lines, one bit per square
+ * in a 32 bit word per line
+ */
+template <int N>
+struct Mask {
+	uint32_t lines[N];    /**< Bit i of lines[j] is square i of line j */
+
+	constexpr uint32_t
+	operator[]( int j ) const {
+		return lines[j];
+	}
+
+	constexpr bool
+	test( int i, int j ) const {
+		return (lines[j] >> i) & 1u;
+	}
+
+	constexpr bool
+	empty() const {
+		uint32_t acc = 0;
+		for( int j=0; j<N; j++ ) {
+			acc |= lines[j];
+		}
+		return acc == 0;
+	}
+
+	int
+	count() const {
+		int n = 0;
+		for( int j=0; j<N; j++ ) {
+			n += hnef_popcount64(lines[j]);
+		}
+		return n;
+	}
+};
+
+/**
+ * @brief A board of H rows and W columns
+ */
+template <int H, int W>
+class Board {
+	static_assert(H >= 3 && H <= MAX_HEIGHT, "unsupported board height");
+	static_assert(W >= 3 && W <= MAX_WIDTH, "unsupported board width");
+
+public:
+	typedef hnef::Mask<H> Rows;      /**< Row-major set of squares */
+	typedef hnef::Mask<W> Columns;   /**< Column-major set of squares */
+
+	static constexpr int height = H;
+	static constexpr int width = W;
+	static constexpr int area = H*W;
+
+	static constexpr uint32_t row_mask = (W >= 32)? 0xffffffffu : (1u << W) - 1;
+	static constexpr uint32_t column_mask = (H >= 32)? 0xffffffffu : (1u << H) - 1;
+
+	/**
+	 * @brief Every square of the board
+	 */
+	static constexpr Rows
+	make_all() {
+		Rows m{};
+		for( int y=0; y<H; y++ ) {
+			m.lines[y] = row_mask;
+		}
+		return m;
+	}
+
+	/**
+	 * @brief The squares on the edge of the board
+	 */
+	static constexpr Rows
+	make_edges() {
+		Rows m{};
+		for( int y=0; y<H; y++ ) {
+			m.lines[y] = (y == 0 || y == H-1)? row_mask : (1u | (1u << (W-1)));
+		}
+		return m;
+	}
+
+	/**
+	 * @brief The four corner squares
+	 */
+	static constexpr Rows
+	make_corners() {
+		Rows m{};
+		m.lines[0] = 1u | (1u << (W-1));
+		m.lines[H-1] = m.lines[0];
+		return m;
+	}
+
+	/**
+	 * @brief The centre square, where the throne stands
+	 */
+	static constexpr Rows
+	make_throne() {
+		Rows m{};
+		m.lines[H/2] = 1u << (W/2);
+		return m;
+	}
+
+	static constexpr Rows all_mask = make_all();
+	static constexpr Rows edge_mask = make_edges();
+	static constexpr Rows corner_mask = make_corners();
+	static constexpr Rows throne_mask = make_throne();
+
+	/**
+	 * @brief An empty board with no structures, attackers to move
+	 */
+	Board() : occupied_{}, occupied_t_{}, teams_{}, kings_{}, types_{}, escapes_{},
+	          turn_(HNEF_MUSCOVITE), key_(hnef_zobrist_size(H, W)) {
+		types_[HNEF_EMPTY] = all_mask;
+		update_restrictions();
+	}
+
+	/**
+	 * @brief Copy the position held by a C board of the same size
+	 *
+	 * @return True on success, false if the dimensions differ
+	 */
+	bool
+	load( const HnefBoard *b ) {
+		int i, y;
+
+		if(b->height != H || b->width != W) {
+			return false;
+		}
+
+		occupied_ = Rows{};
+		occupied_t_ = Columns{};
+		for( y=0; y<H; y++ ) {
+			occupied_.lines[y] = hnef_bitboard_get_row(&(b->occupied), y);
+			kings_.lines[y] = hnef_bitboard_get_row(&(b->ranks[HNEF_KING]), y);
+			escapes_.lines[y] = hnef_bitboard_get_row(&(b->escapes), y);
+			for( i=0; i<2; i++ ) {
+				teams_[i].lines[y] = hnef_bitboard_get_row(&(b->teams[i]), y);
+			}
+			for( i=0; i<4; i++ ) {
+				types_[i].lines[y] = hnef_bitboard_get_row(&(b->types[i]), y);
+			}
+			for( i=0; i<W; i++ ) {
+				occupied_t_.lines[i] |= ((occupied_.lines[y] >> i) & 1u) << y;
+			}
+		}
+		turn_ = b->turn;
+		key_ = b->key;
+		update_restrictions();
+		return true;
+	}
+
+	/**
+	 * @brief Write the position to a C board, which is resized to fit
+	 */
+	void
+	store( HnefBoard *b ) const {
+		HnefToken token;
+		int x, y;
+
+		hnef_board_init(b, H, W);
+		for( y=0; y<H; y++ ) {
+			for( x=0; x<W; x++ ) {
+				hnef_board_set_tile_type(b, x, y, get_type(x, y));
+				hnef_board_set_tile_is_escape(b, x, y, is_escape(x, y));
+				if(is_occupied(x, y)) {
+					hnef_token_init(&token, get_team(x, y), get_rank(x, y));
+					hnef_board_set_token(b, x, y, token);
+				}
+			}
+		}
+		hnef_board_set_turn(b, turn_);
+	}
+
+	int
+	get_type( int x, int y ) const {
+		int t;
+		for( t=HNEF_CASTLE; t<=HNEF_CAMP; t++ ) {
+			if(types_[t].test(x, y)) {
+				return t;
+			}
+		}
+		return HNEF_EMPTY;
+	}
+
+	void
+	set_type( int x, int y, int type ) {
+		int old = get_type(x, y), sq = HNEF_SQUARE(x, y);
+
+		key_ ^= hnef_zobrist_type(sq, old) ^ hnef_zobrist_type(sq, type & 0x03);
+		types_[old].lines[y] &= ~(1u << x);
+		types_[type & 0x03].lines[y] |= 1u << x;
+		update_restrictions();
+	}
+
+	bool
+	is_escape( int x, int y ) const {
+		return escapes_.test(x, y);
+	}
+
+	void
+	set_escape( int x, int y, bool escape ) {
+		if(escape != is_escape(x, y)) {
+			key_ ^= hnef_zobrist_escape(HNEF_SQUARE(x, y));
+			escapes_.lines[y] ^= 1u << x;
+		}
+	}
+
+	/**
+	 * @brief Lay out the structures of the standard variants, as
+	 * hnef_variant_setup does: a throne on the centre square and either
+	 * every edge square an escape or, if edge_escape is false, castles
+	 * on the corners which are the only escapes. Tokens and camps are
+	 * left alone
+	 */
+	void
+	set_standard_structures( bool edge_escape ) {
+		const Rows &escapes = edge_escape? edge_mask : corner_mask;
+		int x, y;
+
+		for( y=0; y<H; y++ ) {
+			for( x=0; x<W; x++ ) {
+				if(throne_mask.test(x, y)) {
+					set_type(x, y, HNEF_THRONE);
+				} else if(!edge_escape && corner_mask.test(x, y)) {
+					set_type(x, y, HNEF_CASTLE);
+				}
+				set_escape(x, y, escapes.test(x, y));
+			}
+		}
+	}
+
+	bool
+	is_occupied( int x, int y ) const {
+		return occupied_.test(x, y);
+	}
+
+	/**
+	 * @brief Team code of the token at (x,y), which must be occupied
+	 */
+	int
+	get_team( int x, int y ) const {
+		return teams_[HNEF_SWEDE].test(x, y)? HNEF_SWEDE : HNEF_MUSCOVITE;
+	}
+
+	/**
+	 * @brief Rank code of the token at (x,y), which must be occupied
+	 */
+	int
+	get_rank( int x, int y ) const {
+		return kings_.test(x, y)? HNEF_KING : HNEF_SOLDIER;
+	}
+
+	/**
+	 * @brief Place a token on an empty square
+	 */
+	void
+	set_token( int x, int y, int team, int rank ) {
+		key_ ^= hnef_zobrist_token(HNEF_SQUARE(x, y), team, rank);
+		occupied_.lines[y] |= 1u << x;
+		occupied_t_.lines[x] |= 1u << y;
+		teams_[team & 0x01].lines[y] |= 1u << x;
+		if(rank == HNEF_KING) {
+			kings_.lines[y] |= 1u << x;
+		}
+	}
+
+	/**
+	 * @brief Remove the token from an occupied square
+	 */
+	void
+	unset_token( int x, int y ) {
+		key_ ^= hnef_zobrist_token(HNEF_SQUARE(x, y), get_team(x, y), get_rank(x, y));
+		occupied_.lines[y] &= ~(1u << x);
+		occupied_t_.lines[x] &= ~(1u << y);
+		teams_[0].lines[y] &= ~(1u << x);
+		teams_[1].lines[y] &= ~(1u << x);
+		kings_.lines[y] &= ~(1u << x);
+	}
+
+	int
+	get_turn() const {
+		return turn_;
+	}
+
+	void
+	set_turn( int team ) {
+		key_ ^= hnef_zobrist_turn(turn_) ^ hnef_zobrist_turn(team & 0x01);
+		turn_ = team & 0x01;
+	}
+
+	uint64_t
+	get_key() const {
+		return key_;
+	}
+
+	const Rows&
+	get_occupied() const {
+		return occupied_;
+	}
+
+	const Rows&
+	get_team_mask( int team ) const {
+		return teams_[team & 0x01];
+	}
+
+	const Rows&
+	get_king_mask() const {
+		return kings_;
+	}
+
+	const Rows&
+	get_type_mask( int type ) const {
+		return types_[type & 0x03];
+	}
+
+	const Rows&
+	get_escape_mask() const {
+		return escapes_;
+	}
+
+	int
+	count_team( int team ) const {
+		return teams_[team & 0x01].count();
+	}
+
+	/**
+	 * @brief Generate every legal move available to a team, in the
+	 * same order as hnef_board_generate_moves
+	 *
+	 * @return The number of moves written to moves
+	 */
+	int
+	generate_moves( int team, HnefMove *moves, int max ) const {
+		uint32_t pieces, row, col;
+		int c, n, t, x, y;
+
+		n = 0;
+		for( y=0; y<H; y++ ) {
+			pieces = teams_[team & 0x01].lines[y];
+			while(pieces) {
+				x = hnef_ctz64(pieces);
+				pieces &= pieces - 1;
+
+				c = token_class(x, y);
+				row = slide(occupied_.lines[y] | block_[c].lines[y], row_mask, x)
+					& ~forbid_[c].lines[y];
+				col = slide(occupied_t_.lines[x] | block_t_[c].lines[x], column_mask, y)
+					& ~forbid_t_[c].lines[x];
+
+				while(row && n < max) {
+					t = hnef_ctz64(row);
+					row &= row - 1;
+					moves[n].from = HNEF_SQUARE(x, y);
+					moves[n].to = HNEF_SQUARE(t, y);
+					n++;
+				}
+				while(col && n < max) {
+					t = hnef_ctz64(col);
+					col &= col - 1;
+					moves[n].from = HNEF_SQUARE(x, y);
+					moves[n].to = HNEF_SQUARE(x, t);
+					n++;
+				}
+			}
+		}
+		return n;
+	}
+
+	/**
+	 * @brief Make a move in place, removing any tokens it captures.
+	 * The turn passes to the opposing team.
+	 *
+	 * @param move The move to be made. It is not checked for legality
+	 *
+	 * @param undo Receives what is needed to take the move back
+	 *
+	 * @return The number of tokens captured
+	 */
+	int
+	make_move( HnefMove move, HnefUndo *undo ) {
+		int d, n, x, y, vx, vy, team, rank;
+
+		undo->move = move;
+		undo->captured = 0;
+		undo->king = 0;
+		undo->wall_edge = 0;
+		undo->wall = 0;
+
+		x = HNEF_SQUARE_X(move.from);
+		y = HNEF_SQUARE_Y(move.from);
+		team = get_team(x, y);
+		rank = get_rank(x, y);
+		unset_token(x, y);
+
+		x = HNEF_SQUARE_X(move.to);
+		y = HNEF_SQUARE_Y(move.to);
+		set_token(x, y, team, rank);
+		set_turn(!team);
+
+		n = 0;
+		for( d=0; d<4; d++ ) {
+			vx = x + dx(d);
+			vy = y + dy(d);
+			if(!on_board(vx, vy) || !teams_[!team].test(vx, vy)) {
+				continue;
+			}
+			if(is_captured(vx, vy, d, team)) {
+				if(kings_.test(vx, vy)) {
+					undo->king = d + 1;
+				}
+				undo->captured |= 1 << d;
+				unset_token(vx, vy);
+				n++;
+			}
+		}
+		return n;
+	}
+
+	/**
+	 * @brief Take back a move made with make_move, restoring any
+	 * tokens it captured
+	 */
+	void
+	unmake_move( const HnefUndo &undo ) {
+		int d, x, y, team, rank;
+
+		x = HNEF_SQUARE_X(undo.move.to);
+		y = HNEF_SQUARE_Y(undo.move.to);
+		team = get_team(x, y);
+		rank = get_rank(x, y);
+		unset_token(x, y);
+
+		for( d=0; d<4; d++ ) {
+			if(undo.captured & (1 << d)) {
+				set_token(x + dx(d), y + dy(d), !team,
+					(undo.king == d + 1)? HNEF_KING : HNEF_SOLDIER);
+			}
+		}
+
+		set_token(HNEF_SQUARE_X(undo.move.from), HNEF_SQUARE_Y(undo.move.from), team, rank);
+		set_turn(team);
+	}
+
+	/**
+	 * @brief HNEF_SWEDE if the king stands on an escape tile,
+	 * HNEF_MUSCOVITE if it has been captured, HNEF_NO_WINNER otherwise
+	 */
+	int
+	get_winner() const {
+		uint32_t king = 0, escaped = 0;
+		int y;
+
+		for( y=0; y<H; y++ ) {
+			king |= kings_.lines[y];
+			escaped |= kings_.lines[y] & escapes_.lines[y];
+		}
+		if(!king) {
+			return HNEF_MUSCOVITE;
+		}
+		return escaped? HNEF_SWEDE : HNEF_NO_WINNER;
+	}
+
+private:
+	enum { KING = 0, SOLDIER = 1, CAMPER = 2, CLASSES = 3 };
+
+	Rows occupied_;               /**< Squares occupied by any token */
+	Columns occupied_t_;          /**< occupied_, column-major */
+	Rows teams_[2];               /**< Occupied squares indexed by team code */
+	Rows kings_;                  /**< The square of the king */
+	Rows types_[4];               /**< Squares indexed by structure code */
+	Rows escapes_;                /**< Squares via which the king may escape */
+	Rows structures_;             /**< Squares with any structure built on them */
+	Rows block_[CLASSES];         /**< Squares each class of token may not cross */
+	Rows forbid_[CLASSES];        /**< Squares each class of token may not stop on */
+	Columns block_t_[CLASSES];    /**< block_, column-major */
+	Columns forbid_t_[CLASSES];   /**< forbid_, column-major */
+	int turn_;                    /**< Team code of the side to move */
+	uint64_t key_;                /**< Zobrist key of the position */
+
+	static constexpr int
+	dx( int d ) {
+		return (d == 1)? 1 : (d == 3)? -1 : 0;
+	}
+
+	static constexpr int
+	dy( int d ) {
+		return (d == 0)? -1 : (d == 2)? 1 : 0;
+	}
+
+	static constexpr bool
+	on_board( int x, int y ) {
+		return x >= 0 && y >= 0 && x < W && y < H;
+	}
+
+	/**
+	 * @brief The squares of a line reachable from position i, given
+	 * the squares of the line that stop a token
+	 */
+	static uint32_t
+	slide( uint32_t blockers, uint32_t line, int i ) {
+		uint32_t after, before, b;
+
+		after = line & ~((2u << i) - 1);
+		before = (1u << i) - 1;
+
+		b = blockers & after;
+		if(b) {
+			after &= (b & (~b + 1)) - 1;
+		}
+		b = blockers & before;
+		if(b) {
+			before &= ~((2u << hnef_msb32(b)) - 1);
+		}
+		return after | before;
+	}
+
+	int
+	token_class( int x, int y ) const {
+		if(kings_.test(x, y)) {
+			return KING;
+		}
+		return types_[HNEF_CAMP].test(x, y)? CAMPER : SOLDIER;
+	}
+
+	/**
+	 * @brief Rebuild the movement restrictions after a structure changes
+	 */
+	void
+	update_restrictions() {
+		uint32_t restricted, camp;
+		int c, x, y;
+
+		for( y=0; y<H; y++ ) {
+			restricted = types_[HNEF_THRONE].lines[y] | types_[HNEF_CASTLE].lines[y];
+			camp = types_[HNEF_CAMP].lines[y];
+			structures_.lines[y] = restricted | camp;
+
+			block_[KING].lines[y] = camp;
+			forbid_[KING].lines[y] = camp;
+			block_[SOLDIER].lines[y] = camp;
+			forbid_[SOLDIER].lines[y] = restricted | camp;
+			block_[CAMPER].lines[y] = 0;
+			forbid_[CAMPER].lines[y] = restricted;
+		}
+
+		for( c=0; c<CLASSES; c++ ) {
+			block_t_[c] = Columns{};
+			forbid_t_[c] = Columns{};
+			for( y=0; y<H; y++ ) {
+				for( x=0; x<W; x++ ) {
+					block_t_[c].lines[x] |= ((block_[c].lines[y] >> x) & 1u) << y;
+					forbid_t_[c].lines[x] |= ((forbid_[c].lines[y] >> x) & 1u) << y;
+				}
+			}
+		}
+	}
+
+	/**
+	 * @brief Whether (x,y) acts as the far side of a capture by team
+	 */
+	bool
+	is_hostile( int x, int y, int team ) const {
+		if(!on_board(x, y)) {
+			return false;
+		}
+		if(occupied_.test(x, y)) {
+			return teams_[team].test(x, y);
+		}
+		return structures_.test(x, y);
+	}
+
+	/**
+	 * @brief Whether the token at (x,y) is captured by the team which
+	 * just moved in direction dir of it
+	 */
+	bool
+	is_captured( int x, int y, int dir, int team ) const {
+		int d;
+
+		if(!kings_.test(x, y)) {
+			return is_hostile(x + dx(dir), y + dy(dir), team);
+		}
+		/* Off the board is never hostile, so a king on the edge cannot
+		 * be surrounded */
+		if(edge_mask.test(x, y)) {
+			return false;
+		}
+		for( d=0; d<4; d++ ) {
+			if(!is_hostile(x + dx(d), y + dy(d), team)) {
+				return false;
+			}
+		}
+		return true;
+	}
+};
+
+template <int H, int W> constexpr typename Board<H, W>::Rows Board<H, W>::all_mask;
+template <int H, int W> constexpr typename Board<H, W>::Rows Board<H, W>::edge_mask;
+template <int H, int W> constexpr typename Board<H, W>::Rows Board<H, W>::corner_mask;
+template <int H, int W> constexpr typename Board<H, W>::Rows Board<H, W>::throne_mask;
+
+/**
+ * @brief Count the positions reached by every line of play of a given
+ * length. Gives the same counts as hnef_perft.
+ *
+ * @param board The starting position, restored before returning
+ *
+ * @param depth Number of plies to play
+ */
+template <int H, int W>
+uint64_t
+perft( Board<H, W> &board, int depth ) {
+	HnefMove moves[HNEF_MAX_MOVES];
+	HnefUndo undo;
+	uint64_t nodes;
+	int i, n;
+
+	if(depth == 0) {
+		return 1;
+	}
+	if(board.get_winner() != HNEF_NO_WINNER) {
+		return 0;
+	}
+
+	n = board.generate_moves(board.get_turn(), moves, HNEF_MAX_MOVES);
+	if(depth == 1) {
+		return (uint64_t)n;
+	}
+
+	nodes = 0;
+	for( i=0; i<n; i++ ) {
+		board.make_move(moves[i], &undo);
+		nodes += perft(board, depth-1);
+		board.unmake_move(undo);
+	}
+	return nodes;
+}
+
+typedef Board<7, 7> Board7;      /**< Brandubh */
+typedef Board<9, 9> Board9;      /**< Tablut */
+typedef Board<11, 11> Board11;   /**< Copenhagen Hnefatafl */
+typedef Board<13, 13> Board13;   /**< Large Copenhagen */
+
+} /* namespace hnef */
+
+#endif /* LIBHNEF_BOARD_HPP_ */
@@ -0,0 +1,25 @@
+/* libhnef/bound.h
+ *
+ * Copyright (C) 2016 Gary Munnelly
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+/**
+ * @file libhnef/bound.h
+ *
+ * @brief Codes for how a stored search score bounds the true score,
+ * shared by the transposition table and the position database
+ *
+ * @author Gary Munnelly
+ */
+
+#ifndef LIBHNEF_BOUND_H_
+#define LIBHNEF_BOUND_H_
+
+#define HNEF_BOUND_NONE  0x00     /**< Entry carries no score */
+#define HNEF_BOUND_UPPER 0x01     /**< Score is an upper bound */
+#define HNEF_BOUND_LOWER 0x02     /**< Score is a lower bound */
+#define HNEF_BOUND_EXACT 0x03     /**< Score is exact */
+
+#endif /* LIBHNEF_BOUND_H_ */
@@ -0,0 +1,428 @@
+/* libhnef/cow.c
+ *
+ * Copyright (C) 2016 Gary Munnelly
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+/**
+ * @file libhnef/cow.c
+ *
+ * @brief Code for copy-on-write boards
+ *
+ * A HnefBoard holds room for a 32x32 board of tiles and every bitboard
+ * of the position, around 20 KB, though consecutive positions of a
+ * game differ by a few squares. A HnefCowBoard holds a position as a
+ * node of pointers to rows of serialized tiles. A snapshot shares the
+ * node. Changing a shared node first copies the node, which shares
+ * every row, and changing a shared row first copies the row, so a
+ * move costs one node and the two or three rows it touches. A game of
+ * 11x11 Hnefatafl with its full history takes a few hundred bytes a
+ * move instead of a HnefBoard a move.
+ *
+ * Only the tiles, the side to move and the key are kept. Positions
+ * are read back into a HnefBoard with hnef_cow_board_get, which
+ * rebuilds the bitboards as hnef_board_deserialize does.
+ *
+ * Reference counts are atomic, so snapshots of one board may be held,
+ * changed and released by different threads. A single HnefCowBoard
+ * must still be used by one thread at a time.
+ *
+ * @author Gary Munnelly
+ */
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cow.h"
+
+/**
+ * @brief One row of a position, as tiles in the hnef_board_serialize
+ * format. Rows are shared between every position in which they are
+ * the same.
+ */
+typedef struct HnefCowRow {
+	atomic_int refs;          /**< Positions holding the row */
+	uint8_t cells[MAX_WIDTH]; /**< Serialized tiles of the row */
+} HnefCowRow;
+
+/**
+ * @brief A position made of shared rows
+ */
+struct HnefCowNode {
+	atomic_int refs;          /**< Boards holding the node */
+	int height;               /**< Height of the board */
+	int width;                /**< Width of the board */
+	int turn;                 /**< Team code of the side to move */
+	uint64_t key;             /**< Zobrist key, as hnef_board_get_key gives */
+	HnefCowRow *rows[];       /**< The rows, height of them */
+};
+
+/**
+ * @brief Get the part of a Zobrist key belonging to one serialized
+ * tile, as kept by the board's sync functions
+ */
+static uint64_t
+hnef_cow_cell_key( int sq, uint8_t cell ) {
+	HnefTile tile;
+	uint64_t key;
+
+	hnef_tile_deserialize(&tile, cell);
+	key = hnef_zobrist_type(sq, tile.type & 0x03);
+	if(tile.is_escape) {
+		key ^= hnef_zobrist_escape(sq);
+	}
+	if(tile.is_occupied) {
+		key ^= hnef_zobrist_token(sq, tile.token.team, tile.token.rank);
+	}
+	return key;
+}
+
+/**
+ * @brief Allocate a node for a board of a given height with no rows
+ */
+static HnefCowNode*
+hnef_cow_node_new( int height ) {
+	HnefCowNode *node;
+
+	node = malloc(offsetof(HnefCowNode, rows) + height*sizeof(HnefCowRow*));
+	if(node) {
+		atomic_init(&(node->refs), 1);
+		node->height = height;
+	}
+	return node;
+}
+
+/**
+ * @brief Drop a reference to a row, releasing it once no position
+ * holds it
+ */
+static void
+hnef_cow_row_release( HnefCowRow *row ) {
+	if(atomic_fetch_sub_explicit(&(row->refs), 1, memory_order_acq_rel) == 1) {
+		free(row);
+	}
+}
+
+/**
+ * @brief Drop a reference to a node, releasing it and its rows once no
+ * board holds it
+ */
+static void
+hnef_cow_node_release( HnefCowNode *node ) {
+	int y;
+
+	if(!node || atomic_fetch_sub_explicit(&(node->refs), 1, memory_order_acq_rel) > 1) {
+		return;
+	}
+	for( y=0; y<node->height; y++ ) {
+		hnef_cow_row_release(node->rows[y]);
+	}
+	free(node);
+}
+
+/**
+ * @brief Make the node of a board its own, copying it if it is shared
+ *
+ * @return True on success, false if memory could not be allocated
+ */
+static int
+hnef_cow_board_own_node( HnefCowBoard *c ) {
+	HnefCowNode *node;
+	int y;
+
+	if(atomic_load_explicit(&(c->node->refs), memory_order_acquire) == 1) {
+		return 1;
+	}
+	node = hnef_cow_node_new(c->node->height);
+	if(!node) {
+		return 0;
+	}
+	node->width = c->node->width;
+	node->turn = c->node->turn;
+	node->key = c->node->key;
+	for( y=0; y<node->height; y++ ) {
+		node->rows[y] = c->node->rows[y];
+		atomic_fetch_add_explicit(&(node->rows[y]->refs), 1, memory_order_relaxed);
+	}
+	/* The other holders may have let go since refs was read */
+	hnef_cow_node_release(c->node);
+	c->node = node;
+	return 1;
+}
+
+/**
+ * @brief Get a row of a board which may be written, copying the node
+ * and the row if either is shared
+ *
+ * @return The row, or NULL if memory could not be allocated
+ */
+static HnefCowRow*
+hnef_cow_board_own_row( HnefCowBoard *c, int y ) {
+	HnefCowRow *row;
+
+	if(!hnef_cow_board_own_node(c)) {
+		return NULL;
+	}
+	if(atomic_load_explicit(&(c->node->rows[y]->refs), memory_order_acquire) == 1) {
+		return c->node->rows[y];
+	}
+	row = malloc(sizeof(HnefCowRow));
+	if(!row) {
+		return NULL;
+	}
+	memcpy(row->cells, c->node->rows[y]->cells, c->node->width);
+	atomic_init(&(row->refs), 1);
+	hnef_cow_row_release(c->node->rows[y]);
+	c->node->rows[y] = row;
+	return row;
+}
+
+/**
+ * @brief Build a copy-on-write board holding the position of a board
+ *
+ * @param c The board to be initialized
+ *
+ * @param b The position
+ *
+ * @return True on success, false if memory could not be allocated
+ */
+int
+hnef_cow_board_init( HnefCowBoard *c, HnefBoard *b ) {
+	HnefCowNode *node;
+	int x, y;
+
+	node = hnef_cow_node_new(b->height);
+	if(!node) {
+		return 0;
+	}
+	node->width = b->width;
+	node->turn = b->turn;
+	node->key = b->key;
+	for( y=0; y<b->height; y++ ) {
+		node->rows[y] = malloc(sizeof(HnefCowRow));
+		if(!node->rows[y]) {
+			node->height = y;
+			hnef_cow_node_release(node);
+			return 0;
+		}
+		atomic_init(&(node->rows[y]->refs), 1);
+		for( x=0; x<b->width; x++ ) {
+			node->rows[y]->cells[x] = hnef_tile_serialize(&(b->tiles[b->width*y + x]));
+		}
+	}
+	c->node = node;
+	return 1;
+}
+
+/**
+ * @brief Release a copy-on-write board. Its snapshots are unaffected.
+ *
+ * @param c The board to be released
+ */
+void
+hnef_cow_board_free( HnefCowBoard *c ) {
+	hnef_cow_node_release(c->node);
+	c->node = NULL;
+}
+
+/**
+ * @brief Take a snapshot of a board in O(1). Either board may be
+ * changed afterwards without affecting the other, and each must be
+ * released with hnef_cow_board_free.
+ *
+ * @param dst The board to receive the snapshot
+ *
+ * @param src The board to be copied
+ */
+void
+hnef_cow_board_snapshot( HnefCowBoard *dst, const HnefCowBoard *src ) {
+	atomic_fetch_add_explicit(&(src->node->refs), 1, memory_order_relaxed);
+	dst->node = src->node;
+}
+
+/**
+ * @brief Bring a copy-on-write board in line with a board, typically
+ * after a move has been made on it. Only the rows which differ are
+ * copied.
+ *
+ * @param c The copy-on-write board
+ *
+ * @param b The board holding the new position, of the same size
+ *
+ * @return True on success, false if the sizes differ or memory could
+ * not be allocated, in which case c holds a valid position part way
+ * between the two
+ */
+int
+hnef_cow_board_update( HnefCowBoard *c, HnefBoard *b ) {
+	HnefCowRow *row;
+	uint8_t cells[MAX_WIDTH];
+	int x, y;
+
+	if(b->height != c->node->height || b->width != c->node->width) {
+		return 0;
+	}
+
+	for( y=0; y<b->height; y++ ) {
+		for( x=0; x<b->width; x++ ) {
+			cells[x] = hnef_tile_serialize(&(b->tiles[b->width*y + x]));
+		}
+		if(memcmp(cells, c->node->rows[y]->cells, b->width) == 0) {
+			continue;
+		}
+		row = hnef_cow_board_own_row(c, y);
+		if(!row) {
+			return 0;
+		}
+		for( x=0; x<b->width; x++ ) {
+			if(row->cells[x] != cells[x]) {
+				c->node->key ^= hnef_cow_cell_key(HNEF_SQUARE(x, y), row->cells[x])
+					^ hnef_cow_cell_key(HNEF_SQUARE(x, y), cells[x]);
+				row->cells[x] = cells[x];
+			}
+		}
+	}
+	return hnef_cow_board_set_turn(c, b->turn);
+}
+
+/**
+ * @brief Replace the tile at (x,y), keeping the key up to date
+ *
+ * @param c The board
+ *
+ * @param x The x coordinate of the tile
+ *
+ * @param y The y coordinate of the tile
+ *
+ * @param tile The new tile
+ *
+ * @return True on success, false if memory could not be allocated, in
+ * which case the board is unchanged
+ */
+int
+hnef_cow_board_set_tile( HnefCowBoard *c, int x, int y, HnefTile tile ) {
+	HnefCowRow *row;
+	uint8_t cell;
+
+	cell = hnef_tile_serialize(&tile);
+	if(c->node->rows[y]->cells[x] == cell) {
+		return 1;
+	}
+	row = hnef_cow_board_own_row(c, y);
+	if(!row) {
+		return 0;
+	}
+	c->node->key ^= hnef_cow_cell_key(HNEF_SQUARE(x, y), row->cells[x])
+		^ hnef_cow_cell_key(HNEF_SQUARE(x, y), cell);
+	row->cells[x] = cell;
+	return 1;
+}
+
+/**
+ * @brief Set the side to move, keeping the key up to date
+ *
+ * @param c The board
+ *
+ * @param team The team code of the side to move
+ *
+ * @return True on success, false if memory could not be allocated, in
+ * which case the board is unchanged
+ */
+int
+hnef_cow_board_set_turn( HnefCowBoard *c, int team ) {
+	if(c->node->turn == (team & 0x01)) {
+		return 1;
+	}
+	if(!hnef_cow_board_own_node(c)) {
+		return 0;
+	}
+	c->node->key ^= hnef_zobrist_turn(c->node->turn) ^ hnef_zobrist_turn(team & 0x01);
+	c->node->turn = team & 0x01;
+	return 1;
+}
+
+/**
+ * @brief Get the tile at (x,y)
+ *
+ * @param c The board
+ *
+ * @param x The x coordinate of the tile
+ *
+ * @param y The y coordinate of the tile
+ *
+ * @param tile Set to the tile
+ */
+void
+hnef_cow_board_get_tile( const HnefCowBoard *c, int x, int y, HnefTile *tile ) {
+	hnef_tile_deserialize(tile, c->node->rows[y]->cells[x]);
+}
+
+/**
+ * @brief Get the team code of the side to move
+ */
+int
+hnef_cow_board_get_turn( const HnefCowBoard *c ) {
+	return c->node->turn;
+}
+
+/**
+ * @brief Get the Zobrist key of the position, which is the key a
+ * HnefBoard holding the position would have
+ */
+uint64_t
+hnef_cow_board_get_key( const HnefCowBoard *c ) {
+	return c->node->key;
+}
+
+/**
+ * @brief Read the position of a copy-on-write board into a board
+ *
+ * @param c The copy-on-write board
+ *
+ * @param b The board to receive the position
+ */
+void
+hnef_cow_board_get( const HnefCowBoard *c, HnefBoard *b ) {
+	uint8_t buffer[2 + MAX_HEIGHT*MAX_WIDTH];
+	int y;
+
+	buffer[0] = (uint8_t)c->node->height;
+	buffer[1] = (uint8_t)c->node->width;
+	for( y=0; y<c->node->height; y++ ) {
+		memcpy(buffer + 2 + y*c->node->width, c->node->rows[y]->cells, c->node->width);
+	}
+	hnef_board_deserialize(b, buffer);
+	hnef_board_set_turn(b, c->node->turn);
+}
+
+/**
+ * @brief Check whether a board shares its position with another
+ * board, so that changing it will first copy the position
+ *
+ * @param c The board
+ *
+ * @return True if another snapshot holds the same position
+ */
+int
+hnef_cow_board_is_shared( const HnefCowBoard *c ) {
+	return atomic_load_explicit(&(c->node->refs), memory_order_acquire) > 1;
+}
+
+/**
+ * @brief Check whether two boards of the same size hold one row in
+ * common. Rows are only shared between snapshots which have not
+ * changed them since, so a shared row is the same in both.
+ *
+ * @param a One board
+ *
+ * @param b The other board
+ *
+ * @param y The row to be compared
+ *
+ * @return True if a and b hold the same copy of row y
+ */
+int
+hnef_cow_board_shares_row( const HnefCowBoard *a, const HnefCowBoard *b, int y ) {
+	return a->node->rows[y] == b->node->rows[y];
+}
@@ -0,0 +1,58 @@
+/* libhnef/cow.h
+ *
+ * Copyright (C) 2016 Gary Munnelly
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+/**
+ * @file libhnef/cow.h
+ *
+ * @brief Typedefs and function forward declarations for copy-on-write
+ * boards
+ *
+ * @author Gary Munnelly
+ */
+
+#ifndef LIBHNEF_COW_H_
+#define LIBHNEF_COW_H_
+
+#include <stdint.h>
+#include "board.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief A position made of shared rows, see cow.c. Nodes are shared
+ * between every snapshot of the same position.
+ */
+typedef struct HnefCowNode HnefCowNode;
+
+/**
+ * @brief A board whose snapshots cost O(1) and share memory. Changing
+ * a board copies only its node and the rows it touches.
+ */
+typedef struct HnefCowBoard {
+	HnefCowNode *node;        /**< The position */
+} HnefCowBoard;
+
+int          hnef_cow_board_init           ( HnefCowBoard *c, HnefBoard *b );
+void         hnef_cow_board_free           ( HnefCowBoard *c );
+void         hnef_cow_board_snapshot       ( HnefCowBoard *dst, const HnefCowBoard *src );
+int          hnef_cow_board_update         ( HnefCowBoard *c, HnefBoard *b );
+int          hnef_cow_board_set_tile       ( HnefCowBoard *c, int x, int y, HnefTile tile );
+int          hnef_cow_board_set_turn       ( HnefCowBoard *c, int team );
+void         hnef_cow_board_get_tile       ( const HnefCowBoard *c, int x, int y, HnefTile *tile );
+int          hnef_cow_board_get_turn       ( const HnefCowBoard *c );
+uint64_t     hnef_cow_board_get_key        ( const HnefCowBoard *c );
+void         hnef_cow_board_get            ( const HnefCowBoard *c, HnefBoard *b );
+int          hnef_cow_board_is_shared      ( const HnefCowBoard *c );
+int          hnef_cow_board_shares_row     ( const HnefCowBoard *a, const HnefCowBoard *b, int y );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBHNEF_COW_H_ */
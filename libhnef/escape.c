@@ -0,0 +1,145 @@
+/* libhnef/escape.c
+ *
+ * Copyright (C) 2016 Gary Munnelly
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+/**
+ * @file libhnef/escape.c
+ *
+ * @brief Code for detecting king escapes and enclosures
+ *
+ * Every question is answered with whole-board bitboard operations
+ * rather than by walking tiles. Slides are found for every square of
+ * a set at once with hnef_bitboard_slide_fill, and regions with
+ * hnef_bitboard_flood.
+ *
+ * The king moves like a rook and may not enter camps. When counting
+ * the moves the king needs to escape, every other token is assumed to
+ * stay where it is.
+ *
+ * @author Gary Munnelly
+ */
+#include "escape.h"
+
+/**
+ * @brief Find the squares the king may cross and land on, treating
+ * its own square as empty
+ */
+static void
+hnef_escape_open( HnefBoard *board, HnefBitboard *open ) {
+	HnefBitboard blocked;
+
+	hnef_bitboard_fill(open, board->height, board->width);
+	hnef_bitboard_andnot(&blocked, &(board->occupied), &(board->ranks[HNEF_KING]));
+	hnef_bitboard_or(&blocked, &blocked, &(board->types[HNEF_CAMP]));
+	hnef_bitboard_andnot(open, open, &blocked);
+}
+
+/**
+ * @brief Count the escape squares the king can reach with its next
+ * move
+ *
+ * @param board The board to be examined
+ *
+ * @param escapes The squares via which the king escapes, or NULL for
+ * the tiles of the board marked as escapes
+ *
+ * @return The number of escape squares one move away. Two or more
+ * cannot both be blocked with one move
+ */
+int
+hnef_board_king_escapes_in_one( HnefBoard *board, const HnefBitboard *escapes ) {
+	HnefBitboard open, reach;
+
+	hnef_escape_open(board, &open);
+	hnef_bitboard_slide_fill(&reach, &(board->ranks[HNEF_KING]), &open);
+	hnef_bitboard_and(&reach, &reach, escapes? escapes : &(board->escapes));
+	return hnef_bitboard_popcount(&reach);
+}
+
+/**
+ * @brief Find the fewest moves the king needs to reach an escape
+ * square if no other token moves. Each step adds every square one
+ * slide away from the squares reached so far.
+ *
+ * @param board The board to be examined
+ *
+ * @param escapes The squares via which the king escapes, or NULL for
+ * the tiles of the board marked as escapes
+ *
+ * @param max The most moves worth looking for
+ *
+ * @return The number of moves, 0 if the king already stands on an
+ * escape, or HNEF_ESCAPE_UNREACHABLE if there is no king or no escape
+ * within max moves
+ */
+int
+hnef_board_king_escape_distance( HnefBoard *board, const HnefBitboard *escapes, int max ) {
+	HnefBitboard open, frontier, seen, hit;
+	int moves;
+
+	if(!escapes) {
+		escapes = &(board->escapes);
+	}
+	if(hnef_bitboard_is_empty(&(board->ranks[HNEF_KING]))) {
+		return HNEF_ESCAPE_UNREACHABLE;
+	}
+
+	hnef_escape_open(board, &open);
+	frontier = board->ranks[HNEF_KING];
+	seen = frontier;
+	for( moves=0; moves<=max; moves++ ) {
+		hnef_bitboard_and(&hit, &frontier, escapes);
+		if(!hnef_bitboard_is_empty(&hit)) {
+			return moves;
+		}
+
+		hnef_bitboard_slide_fill(&frontier, &frontier, &open);
+		hnef_bitboard_andnot(&frontier, &frontier, &seen);
+		if(hnef_bitboard_is_empty(&frontier)) {
+			break;
+		}
+		hnef_bitboard_or(&seen, &seen, &frontier);
+	}
+	return HNEF_ESCAPE_UNREACHABLE;
+}
+
+/**
+ * @brief Determine whether the attackers have closed a ring around
+ * the king, so that there is no path of orthogonal steps from the
+ * king to the edge of the board which avoids every attacker.
+ * Defenders and structures do not break a path.
+ *
+ * @param board The board to be examined
+ *
+ * @return True if the king is ringed, false if it can still reach the
+ * edge or there is no king
+ */
+int
+hnef_board_king_is_ringed( HnefBoard *board ) {
+	HnefBitboard open, fill, edge;
+	int x, y;
+
+	if(hnef_bitboard_is_empty(&(board->ranks[HNEF_KING]))) {
+		return 0;
+	}
+
+	hnef_bitboard_fill(&open, board->height, board->width);
+	hnef_bitboard_andnot(&open, &open, &(board->teams[HNEF_MUSCOVITE]));
+	fill = board->ranks[HNEF_KING];
+	hnef_bitboard_flood(&fill, &open);
+
+	hnef_bitboard_clear(&edge);
+	for( x=0; x<board->width; x++ ) {
+		hnef_bitboard_set(&edge, HNEF_SQUARE(x, 0));
+		hnef_bitboard_set(&edge, HNEF_SQUARE(x, board->height - 1));
+	}
+	for( y=0; y<board->height; y++ ) {
+		hnef_bitboard_set(&edge, HNEF_SQUARE(0, y));
+		hnef_bitboard_set(&edge, HNEF_SQUARE(board->width - 1, y));
+	}
+	hnef_bitboard_and(&fill, &fill, &edge);
+	return hnef_bitboard_is_empty(&fill);
+}
@@ -0,0 +1,36 @@
+/* libhnef/escape.h
+ *
+ * Copyright (C) 2016 Gary Munnelly
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+/**
+ * @file libhnef/escape.h
+ *
+ * @brief Function forward declarations for detecting king escapes and
+ * enclosures
+ *
+ * @author Gary Munnelly
+ */
+
+#ifndef LIBHNEF_ESCAPE_H_
+#define LIBHNEF_ESCAPE_H_
+
+#include "board.h"
+
+#define HNEF_ESCAPE_UNREACHABLE -1   /**< The king cannot reach an escape */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int          hnef_board_king_escapes_in_one  ( HnefBoard *b, const HnefBitboard *escapes );
+int          hnef_board_king_escape_distance ( HnefBoard *b, const HnefBitboard *escapes, int max );
+int          hnef_board_king_is_ringed       ( HnefBoard *b );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBHNEF_ESCAPE_H_ */
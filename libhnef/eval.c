@@ -0,0 +1,314 @@
+/* libhnef/eval.c
+ *
+ * Copyright (C) 2016 Gary Munnelly
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+/**
+ * @file libhnef/eval.c
+ *
+ * @brief Code for scoring positions without searching them
+ *
+ * The features which are sums over tokens (material, piece-square
+ * values and corner guards) can be kept in a HnefEvalAccumulator.
+ * Once hnef_eval_track has made hnef_eval_update the board's watcher,
+ * with the accumulator as its data, they are adjusted whenever a token
+ * is set or removed, so scoring the position never walks its tiles.
+ * Boards which are not tracked pay nothing as tokens move and have the
+ * sums computed when they are scored. The king's mobility and distance to an escape are found
+ * with whole-board bitboard operations when the position is scored.
+ *
+ * Piece-square values depend on the ring a square lies in, counted
+ * inwards from the edge of the board, and are tabulated separately
+ * for each standard board size.
+ *
+ * @author Gary Munnelly
+ */
+#include "eval.h"
+#include "escape.h"
+
+#define HNEF_EVAL_SIZES 4 /**< Board sizes with their own tables: 7, 9, 11 and 13 */
+#define HNEF_EVAL_RINGS 7 /**< Rings with their own entries, the last covering the rest */
+
+/**
+ * @brief Piece-square values indexed by board size, then attacker,
+ * defender or king, then ring. Attackers want to blockade a ring or
+ * two in from the edge, defenders to hold the centre and the king to
+ * get out towards the edge.
+ */
+static const int hnef_eval_rings[HNEF_EVAL_SIZES][3][HNEF_EVAL_RINGS] = {
+	{ { -2, 4, 2, 0, 0, 0, 0 }, { -4, 0, 2, 4, 4, 4, 4 }, {  6, 2, 0, -4, -4, -4, -4 } },
+	{ { -2, 4, 4, 2, 0, 0, 0 }, { -4, 0, 2, 3, 4, 4, 4 }, {  8, 4, 2,  0, -4, -4, -4 } },
+	{ { -2, 3, 5, 3, 1, 0, 0 }, { -4,-1, 2, 3, 4, 4, 4 }, { 10, 6, 3,  1, -2, -5, -5 } },
+	{ { -2, 2, 5, 4, 2, 1, 0 }, { -4,-2, 1, 3, 4, 4, 4 }, { 12, 8, 5,  2,  0, -3, -6 } },
+};
+
+/**
+ * @brief Bonus for the defenders indexed by the number of moves the
+ * king needs to escape
+ */
+static const int hnef_eval_escape[HNEF_EVAL_ESCAPE_DEPTH + 1] = { 0, 300, 60, 20 };
+
+#define HNEF_EVAL_ENCLOSED -30 /**< Bonus for the defenders when no escape is in range */
+
+/**
+ * @brief Find what a token contributes to each accumulated feature
+ */
+static void
+hnef_eval_token( int height, int width, int sq, int team, int rank,
+		 int *material, int *psq, int *guard ) {
+	int x, y, size, ring, piece;
+
+	x = HNEF_SQUARE_X(sq);
+	y = HNEF_SQUARE_Y(sq);
+	if(width - 1 - x < x) {
+		x = width - 1 - x;
+	}
+	if(height - 1 - y < y) {
+		y = height - 1 - y;
+	}
+
+	size = ((height < width? height : width) - 7) / 2;
+	if(size < 0) {
+		size = 0;
+	} else if(size >= HNEF_EVAL_SIZES) {
+		size = HNEF_EVAL_SIZES - 1;
+	}
+	ring = (x < y)? x : y;
+	if(ring >= HNEF_EVAL_RINGS) {
+		ring = HNEF_EVAL_RINGS - 1;
+	}
+
+	if(rank == HNEF_KING) {
+		piece = 2;
+		*material = 0;
+	} else {
+		piece = team & 0x01;
+		*material = team? HNEF_EVAL_DEFENDER : HNEF_EVAL_ATTACKER;
+	}
+	*psq = hnef_eval_rings[size][piece][ring];
+
+	/* x and y now measure from the nearest corner */
+	*guard = (team == HNEF_MUSCOVITE && rank == HNEF_SOLDIER &&
+		  x + y >= 1 && x + y <= 2);
+}
+
+/**
+ * @brief Add or remove a token's contribution to the accumulated
+ * features of a board. It is the watcher hnef_eval_track installs, so
+ * there is normally no need to call it directly.
+ *
+ * @param board The board whose features are to be updated
+ *
+ * @param data The HnefEvalAccumulator of the board
+ *
+ * @param sq The square the token stands on
+ *
+ * @param team The team code of the token
+ *
+ * @param rank The rank code of the token
+ *
+ * @param sign 1 if the token was placed, -1 if it was removed
+ */
+void
+hnef_eval_update( HnefBoard *board, void *data, int sq, int team, int rank, int sign ) {
+	HnefEvalAccumulator *acc;
+	int material, psq, guard;
+
+	acc = data;
+	hnef_eval_token(board->height, board->width, sq, team, rank, &material, &psq, &guard);
+	acc->material[team & 0x01] += sign * material;
+	acc->psq[team & 0x01] += sign * psq;
+	acc->corner_guards += sign * guard;
+}
+
+/**
+ * @brief Find the king's features with bitboard operations. The first
+ * step of the search for an escape is also the king's mobility.
+ */
+static void
+hnef_eval_king( HnefBoard *board, HnefEvalFeatures *f ) {
+	HnefBitboard open, blocked, frontier, seen, hit;
+	int moves;
+
+	f->king_mobility = 0;
+	f->king_distance = HNEF_ESCAPE_UNREACHABLE;
+	if(hnef_bitboard_is_empty(&(board->ranks[HNEF_KING]))) {
+		return;
+	}
+
+	hnef_bitboard_fill(&open, board->height, board->width);
+	hnef_bitboard_andnot(&blocked, &(board->occupied), &(board->ranks[HNEF_KING]));
+	hnef_bitboard_or(&blocked, &blocked, &(board->types[HNEF_CAMP]));
+	hnef_bitboard_andnot(&open, &open, &blocked);
+
+	frontier = board->ranks[HNEF_KING];
+	seen = frontier;
+	for( moves=0; moves<=HNEF_EVAL_ESCAPE_DEPTH; moves++ ) {
+		hnef_bitboard_and(&hit, &frontier, &(board->escapes));
+		if(!hnef_bitboard_is_empty(&hit)) {
+			f->king_distance = moves;
+			if(moves > 0) {
+				return;
+			}
+		}
+		if(moves == HNEF_EVAL_ESCAPE_DEPTH) {
+			return;
+		}
+
+		hnef_bitboard_slide_fill(&frontier, &frontier, &open);
+		if(moves == 0) {
+			f->king_mobility = hnef_bitboard_popcount(&frontier);
+			if(f->king_distance == 0) {
+				return;
+			}
+		}
+		hnef_bitboard_andnot(&frontier, &frontier, &seen);
+		if(hnef_bitboard_is_empty(&frontier)) {
+			return;
+		}
+		hnef_bitboard_or(&seen, &seen, &frontier);
+	}
+}
+
+/**
+ * @brief Sum the per-token features of a position by walking every
+ * tile
+ */
+static void
+hnef_eval_sum_tokens( HnefBoard *board, HnefEvalFeatures *f ) {
+	int x, y, team, material, psq, guard;
+
+	f->material[0] = f->material[1] = 0;
+	f->psq[0] = f->psq[1] = 0;
+	f->corner_guards = 0;
+	for( y=0; y<board->height; y++ ) {
+		for( x=0; x<board->width; x++ ) {
+			if(!hnef_board_get_tile_is_occupied(board, x, y)) {
+				continue;
+			}
+			team = hnef_board_get_token_team(board, x, y) & 0x01;
+			hnef_eval_token(board->height, board->width, HNEF_SQUARE(x, y), team,
+					hnef_board_get_token_rank(board, x, y), &material, &psq, &guard);
+			f->material[team] += material;
+			f->psq[team] += psq;
+			f->corner_guards += guard;
+		}
+	}
+}
+
+/**
+ * @brief Have a board keep its per-token features up to date as its
+ * tokens change, so that they are not recomputed each time it is
+ * scored. Boards made again by hnef_board_init, including those read
+ * back with hnef_board_deserialize, are no longer tracked, and neither
+ * are copies made with hnef_board_copy; a copy which should be tracked
+ * needs an accumulator of its own.
+ *
+ * @param board The board to be tracked
+ *
+ * @param acc Receives the features, and must outlive the tracking
+ */
+void
+hnef_eval_track( HnefBoard *board, HnefEvalAccumulator *acc ) {
+	HnefEvalFeatures f;
+	int i;
+
+	hnef_eval_sum_tokens(board, &f);
+	for( i=0; i<2; i++ ) {
+		acc->material[i] = f.material[i];
+		acc->psq[i] = f.psq[i];
+	}
+	acc->corner_guards = f.corner_guards;
+	board->watcher = hnef_eval_update;
+	board->watcher_data = acc;
+}
+
+/**
+ * @brief Get the features of a position, from the board's accumulator
+ * if it is tracked and from its tiles otherwise
+ *
+ * @param board The board to be examined
+ *
+ * @param f Filled with the features of the position
+ */
+void
+hnef_eval_get_features( HnefBoard *board, HnefEvalFeatures *f ) {
+	const HnefEvalAccumulator *acc;
+	int i;
+
+	if(board->watcher != hnef_eval_update) {
+		hnef_eval_compute_features(board, f);
+		return;
+	}
+	acc = board->watcher_data;
+	for( i=0; i<2; i++ ) {
+		f->material[i] = acc->material[i];
+		f->psq[i] = acc->psq[i];
+	}
+	f->corner_guards = acc->corner_guards;
+	hnef_eval_king(board, f);
+}
+
+/**
+ * @brief Compute the features of a position from scratch by walking
+ * every tile. Much slower than hnef_eval_get_features, but it does
+ * not trust the board's accumulator, so it can be used to check them.
+ *
+ * @param board The board to be examined
+ *
+ * @param f Filled with the features of the position
+ */
+void
+hnef_eval_compute_features( HnefBoard *board, HnefEvalFeatures *f ) {
+	hnef_eval_sum_tokens(board, f);
+	hnef_eval_king(board, f);
+}
+
+/**
+ * @brief Combine the features of a position into a score
+ *
+ * @param f The features of the position
+ *
+ * @return The score from the defenders' point of view
+ */
+int
+hnef_eval_score( const HnefEvalFeatures *f ) {
+	int score;
+
+	score = f->material[HNEF_SWEDE] - f->material[HNEF_MUSCOVITE]
+		+ f->psq[HNEF_SWEDE] - f->psq[HNEF_MUSCOVITE]
+		- HNEF_EVAL_CORNER_GUARD * f->corner_guards
+		+ HNEF_EVAL_MOBILITY * f->king_mobility;
+
+	if(f->king_distance == HNEF_ESCAPE_UNREACHABLE) {
+		score += HNEF_EVAL_ENCLOSED;
+	} else {
+		score += hnef_eval_escape[f->king_distance];
+	}
+	return score;
+}
+
+/**
+ * @brief Score a position on material, piece-square values, the
+ * king's mobility and distance to an escape, and the attackers'
+ * cover of the corners. May be used as the evaluation function of a
+ * search.
+ *
+ * @param board The position to be evaluated
+ *
+ * @param data Unused
+ *
+ * @return The score from the side to move's point of view
+ */
+int
+hnef_eval_evaluate( HnefBoard *board, void *data ) {
+	HnefEvalFeatures f;
+	int score;
+
+	(void)data;
+	hnef_eval_get_features(board, &f);
+	score = hnef_eval_score(&f);
+	return (board->turn == HNEF_SWEDE)? score : -score;
+}
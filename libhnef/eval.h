@@ -0,0 +1,66 @@
+/* libhnef/eval.h
+ *
+ * Copyright (C) 2016 Gary Munnelly
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+/**
+ * @file libhnef/eval.h
+ *
+ * @brief Macros, typedefs and function forward declarations for the
+ * static evaluator
+ *
+ * @author Gary Munnelly
+ */
+
+#ifndef LIBHNEF_EVAL_H_
+#define LIBHNEF_EVAL_H_
+
+#include "board.h"
+
+#define HNEF_EVAL_ATTACKER    100 /**< Material value of an attacker */
+#define HNEF_EVAL_DEFENDER    200 /**< Material value of a defender */
+#define HNEF_EVAL_MOBILITY      4 /**< Per square the king can reach in one move */
+#define HNEF_EVAL_CORNER_GUARD 15 /**< Per attacker guarding the approach to a corner */
+#define HNEF_EVAL_ESCAPE_DEPTH  3 /**< Most king moves to an escape worth counting */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief The features a position is scored on. Material, piece-square
+ * values and corner guards are sums over tokens; the king features
+ * depend on the whole board.
+ */
+typedef struct HnefEvalFeatures {
+	int material[2];          /**< Material of each team */
+	int psq[2];               /**< Piece-square value of each team */
+	int corner_guards;        /**< Attackers guarding the approaches to a corner */
+	int king_mobility;        /**< Squares the king can reach in one move */
+	int king_distance;        /**< Moves the king needs to escape, or HNEF_ESCAPE_UNREACHABLE */
+} HnefEvalFeatures;
+
+/**
+ * @brief The per-token features of a tracked board, kept up to date
+ * by hnef_eval_update as its tokens change
+ */
+typedef struct HnefEvalAccumulator {
+	int material[2];          /**< Material of each team */
+	int psq[2];               /**< Piece-square value of each team */
+	int corner_guards;        /**< Attackers guarding the approaches to a corner */
+} HnefEvalAccumulator;
+
+void         hnef_eval_update              ( HnefBoard *b, void *data, int sq, int team, int rank, int sign );
+void         hnef_eval_track               ( HnefBoard *b, HnefEvalAccumulator *acc );
+void         hnef_eval_get_features        ( HnefBoard *b, HnefEvalFeatures *f );
+void         hnef_eval_compute_features    ( HnefBoard *b, HnefEvalFeatures *f );
+int          hnef_eval_score               ( const HnefEvalFeatures *f );
+int          hnef_eval_evaluate            ( HnefBoard *b, void *data );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBHNEF_EVAL_H_ */
@@ -0,0 +1,127 @@
+/* libhnef/image.c
+ *
+ * Copyright (C) 2016 Gary Munnelly
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+/**
+ * @file libhnef/image.c
+ *
+ * @brief Code for bringing files whole into memory
+ *
+ * A file is mapped read only where the system allows, so that pages
+ * are only loaded as they are touched, and is otherwise read into a
+ * buffer of its own.
+ *
+ * @author Gary Munnelly
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#ifdef HAVE_SYS_MMAN_H
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "image.h"
+
+/**
+ * @brief Bring a file into memory, mapping it where the system allows
+ *
+ * @param path The file to be loaded
+ *
+ * @param access One of the HNEF_IMAGE_* access patterns, passed on to
+ * the system as advice for a mapped file
+ *
+ * @param image Receives the contents of the file
+ *
+ * @param size Receives the bytes in image
+ *
+ * @param mapped Set if image is mapped from the file
+ *
+ * @return True on success, false if the file could not be read or is
+ * empty
+ */
+int
+hnef_image_load( const char *path, int access, uint8_t **image, size_t *size, int *mapped ) {
+	FILE *f;
+	uint8_t *buffer;
+	long length;
+#ifdef HAVE_SYS_MMAN_H
+	struct stat st;
+	void *map;
+	int fd;
+
+	fd = open(path, O_RDONLY);
+	if(fd >= 0) {
+		map = MAP_FAILED;
+		if(fstat(fd, &st) == 0 && st.st_size > 0) {
+			map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+		}
+		close(fd);
+		if(map != MAP_FAILED) {
+#ifdef HAVE_MADVISE
+			if(access == HNEF_IMAGE_RANDOM) {
+				madvise(map, st.st_size, MADV_RANDOM);
+			} else if(access == HNEF_IMAGE_SEQUENTIAL) {
+				madvise(map, st.st_size, MADV_SEQUENTIAL);
+			}
+#endif
+			*image = map;
+			*size = st.st_size;
+			*mapped = 1;
+			return 1;
+		}
+	}
+#endif
+	(void)access;
+
+	f = fopen(path, "rb");
+	if(!f) {
+		return 0;
+	}
+	if(fseek(f, 0, SEEK_END) || (length = ftell(f)) <= 0 || fseek(f, 0, SEEK_SET)) {
+		fclose(f);
+		return 0;
+	}
+	buffer = malloc(length);
+	if(!buffer || fread(buffer, 1, length, f) != (size_t)length) {
+		free(buffer);
+		fclose(f);
+		return 0;
+	}
+	fclose(f);
+	*image = buffer;
+	*size = length;
+	*mapped = 0;
+	return 1;
+}
+
+/**
+ * @brief Release a file brought into memory by hnef_image_load
+ *
+ * @param image The contents of the file, which may be NULL
+ *
+ * @param size Bytes in image
+ *
+ * @param mapped Set if image is mapped from the file
+ */
+void
+hnef_image_free( const uint8_t *image, size_t size, int mapped ) {
+	if(!image) {
+		return;
+	}
+#ifdef HAVE_SYS_MMAN_H
+	if(mapped) {
+		munmap((void*)image, size);
+		return;
+	}
+#endif
+	(void)size;
+	(void)mapped;
+	free((void*)image);
+}
@@ -0,0 +1,75 @@
+/* libhnef/image.h
+ *
+ * Copyright (C) 2016 Gary Munnelly
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+/**
+ * @file libhnef/image.h
+ *
+ * @brief Function forward declarations for loading files whole into
+ * memory, shared by the library's file readers, and helpers for their
+ * little endian integers
+ *
+ * @author Gary Munnelly
+ */
+
+#ifndef LIBHNEF_IMAGE_H_
+#define LIBHNEF_IMAGE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HNEF_IMAGE_NORMAL     0 /**< No particular order of access */
+#define HNEF_IMAGE_RANDOM     1 /**< Reads land anywhere in the file */
+#define HNEF_IMAGE_SEQUENTIAL 2 /**< The file is read front to back */
+
+int          hnef_image_load               ( const char *path, int access, uint8_t **image, size_t *size, int *mapped );
+void         hnef_image_free               ( const uint8_t *image, size_t size, int mapped );
+
+/**
+ * @brief Write a 32 bit value in little endian order
+ */
+static inline void
+hnef_image_put32( uint8_t *p, uint32_t v ) {
+	p[0] = (uint8_t)v;
+	p[1] = (uint8_t)(v >> 8);
+	p[2] = (uint8_t)(v >> 16);
+	p[3] = (uint8_t)(v >> 24);
+}
+
+/**
+ * @brief Write a 64 bit value in little endian order
+ */
+static inline void
+hnef_image_put64( uint8_t *p, uint64_t v ) {
+	hnef_image_put32(p, (uint32_t)v);
+	hnef_image_put32(p + 4, (uint32_t)(v >> 32));
+}
+
+/**
+ * @brief Read a 32 bit value in little endian order
+ */
+static inline uint32_t
+hnef_image_get32( const uint8_t *p ) {
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/**
+ * @brief Read a 64 bit value in little endian order
+ */
+static inline uint64_t
+hnef_image_get64( const uint8_t *p ) {
+	return (uint64_t)hnef_image_get32(p) | ((uint64_t)hnef_image_get32(p + 4) << 32);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBHNEF_IMAGE_H_ */
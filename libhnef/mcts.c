@@ -0,0 +1,615 @@
+/* libhnef/mcts.c
+ *
+ * Copyright (C) 2016 Gary Munnelly
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+/**
+ * @file libhnef/mcts.c
+ *
+ * @brief Code for a parallel Monte Carlo tree search
+ *
+ * Threads descend the shared tree at the same time using UCT. While a
+ * thread is below a node it adds a virtual loss to it, which steers
+ * the other threads towards different branches. A leaf is expanded
+ * by whichever thread first moves its state from unexpanded to
+ * expanding with a compare-and-swap; the children are then published
+ * by a release store of the state. Threads arriving at a node that is
+ * still being expanded simply play out from it. Nothing blocks and
+ * nothing is allocated during the search.
+ *
+ * @author Gary Munnelly
+ */
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "mcts.h"
+
+#define HNEF_MCTS_UNEXPANDED 0    /**< Node has no children yet */
+#define HNEF_MCTS_EXPANDING  1    /**< A thread is creating the children */
+#define HNEF_MCTS_EXPANDED   2    /**< Children are published */
+#define HNEF_MCTS_TERMINAL   3    /**< The game is over at this node */
+
+#define HNEF_MCTS_MAX_THREADS 256 /**< Most threads a search may use */
+
+/**
+ * @brief A node of the search tree. The children of a node occupy a
+ * contiguous block of the arena.
+ */
+typedef struct HnefMctsNode {
+	HnefMove move;                /**< Move leading to this node */
+	atomic_int state;             /**< Expansion state of the node */
+	atomic_int virtual_loss;      /**< Threads currently below this node */
+	atomic_uint visits;           /**< Completed playouts through the node */
+	atomic_uint_fast64_t reward;  /**< Half points won by the side that made move */
+	atomic_uint first_child;      /**< Arena index of the first child */
+	uint32_t child_count;         /**< Number of children */
+} HnefMctsNode;
+
+/**
+ * @brief The fixed node arena of a tree
+ */
+struct HnefMctsArena {
+	HnefMctsNode *nodes;          /**< Node arena, root at index 0 */
+	HnefMctsNode *spare;          /**< Second arena used when re-rooting */
+	uint32_t capacity;            /**< Nodes in each arena */
+	atomic_uint size;             /**< Nodes handed out from the arena */
+};
+
+/**
+ * @brief State shared between the threads of one search
+ */
+typedef struct HnefMctsShared {
+	HnefMcts *tree;               /**< Tree being searched */
+	uint64_t target;              /**< Playouts to run, or 0 for no limit */
+	int milliseconds;             /**< Time budget, or 0 for none */
+	struct timespec start;        /**< Time the search began */
+	atomic_uint_fast64_t playouts;/**< Playouts started so far */
+	atomic_int stop;              /**< Set when the budget is spent */
+} HnefMctsShared;
+
+/**
+ * @brief State private to one search thread
+ */
+typedef struct HnefMctsWorker {
+	HnefMctsShared *shared;       /**< State shared with the other threads */
+	pthread_t handle;             /**< Handle of helper threads */
+	int started;                  /**< Set once handle refers to a thread */
+	HnefBoard board;              /**< Private copy of the root position */
+	HnefUndo undo[HNEF_MCTS_MAX_DEPTH];  /**< Storage for the undo stack */
+	HnefUndoStack stack;          /**< Moves made from the root */
+	HnefMove moves[HNEF_MAX_MOVES];      /**< Scratch move buffer */
+	uint32_t path[HNEF_MCTS_MAX_DEPTH];  /**< Nodes visited in the descent */
+	int movers[HNEF_MCTS_MAX_DEPTH];     /**< Team which moved into each node */
+	uint64_t rng;                 /**< Random number generator state */
+} HnefMctsWorker;
+
+/**
+ * @brief Milliseconds elapsed since the search began
+ */
+static int
+hnef_mcts_elapsed( HnefMctsShared *shared ) {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (int)((now.tv_sec - shared->start.tv_sec)*1000
+		+ (now.tv_nsec - shared->start.tv_nsec)/1000000);
+}
+
+/**
+ * @brief Reset a node to an unvisited leaf
+ */
+static void
+hnef_mcts_node_init( HnefMctsNode *node, HnefMove move ) {
+	node->move = move;
+	atomic_init(&(node->state), HNEF_MCTS_UNEXPANDED);
+	atomic_init(&(node->virtual_loss), 0);
+	atomic_init(&(node->visits), 0);
+	atomic_init(&(node->reward), 0);
+	atomic_init(&(node->first_child), 0);
+	node->child_count = 0;
+}
+
+/**
+ * @brief Copy a node from one arena to another. Not safe while the
+ * tree is being searched.
+ */
+static void
+hnef_mcts_node_copy( HnefMctsNode *dst, HnefMctsNode *src ) {
+	dst->move = src->move;
+	atomic_init(&(dst->state), atomic_load(&(src->state)));
+	atomic_init(&(dst->virtual_loss), 0);
+	atomic_init(&(dst->visits), atomic_load(&(src->visits)));
+	atomic_init(&(dst->reward), atomic_load(&(src->reward)));
+	atomic_init(&(dst->first_child), atomic_load(&(src->first_child)));
+	dst->child_count = src->child_count;
+}
+
+/**
+ * @brief Try to give a leaf its children
+ *
+ * @return True if the node now has children, false if the caller
+ * should play out from it instead
+ */
+static int
+hnef_mcts_expand( HnefMctsWorker *w, uint32_t index ) {
+	HnefMcts *tree;
+	HnefMctsNode *node;
+	uint32_t first;
+	int expected, n, i;
+
+	tree = w->shared->tree;
+	node = &(tree->arena->nodes[index]);
+
+	expected = HNEF_MCTS_UNEXPANDED;
+	if(!atomic_compare_exchange_strong(&(node->state), &expected, HNEF_MCTS_EXPANDING)) {
+		return expected == HNEF_MCTS_EXPANDED;
+	}
+
+	if(hnef_board_get_winner(&(w->board)) != HNEF_NO_WINNER) {
+		atomic_store_explicit(&(node->state), HNEF_MCTS_TERMINAL, memory_order_release);
+		return 0;
+	}
+	n = hnef_board_generate_moves(&(w->board), &(tree->rays), w->board.turn, w->moves, HNEF_MAX_MOVES);
+	if(n == 0) {
+		atomic_store_explicit(&(node->state), HNEF_MCTS_TERMINAL, memory_order_release);
+		return 0;
+	}
+
+	/* Only take the children's slots if all of them fit, so that a
+	 * full arena stays full rather than counting past its capacity */
+	first = atomic_load_explicit(&(tree->arena->size), memory_order_relaxed);
+	do {
+		if(first + n > tree->arena->capacity) {
+			/* The arena is full; leave the node for a later search */
+			atomic_store_explicit(&(node->state), HNEF_MCTS_UNEXPANDED, memory_order_release);
+			return 0;
+		}
+	} while( !atomic_compare_exchange_weak(&(tree->arena->size), &first, first + n) );
+
+	for( i=0; i<n; i++ ) {
+		hnef_mcts_node_init(&(tree->arena->nodes[first + i]), w->moves[i]);
+	}
+	node->child_count = n;
+	atomic_store_explicit(&(node->first_child), first, memory_order_relaxed);
+	atomic_store_explicit(&(node->state), HNEF_MCTS_EXPANDED, memory_order_release);
+	return 1;
+}
+
+/**
+ * @brief Choose the child of an expanded node with the highest UCT
+ * value, counting virtual losses as lost playouts
+ */
+static uint32_t
+hnef_mcts_select( HnefMctsWorker *w, uint32_t index ) {
+	HnefMcts *tree;
+	HnefMctsNode *node, *child;
+	uint32_t first, best, i;
+	double log_n, value, best_value, n;
+
+	tree = w->shared->tree;
+	node = &(tree->arena->nodes[index]);
+	first = atomic_load_explicit(&(node->first_child), memory_order_relaxed);
+
+	log_n = log(1.0 + atomic_load_explicit(&(node->visits), memory_order_relaxed)
+		+ atomic_load_explicit(&(node->virtual_loss), memory_order_relaxed));
+
+	best = first;
+	best_value = -1.0;
+	for( i=0; i<node->child_count; i++ ) {
+		child = &(tree->arena->nodes[first + i]);
+		n = (double)atomic_load_explicit(&(child->visits), memory_order_relaxed)
+			+ atomic_load_explicit(&(child->virtual_loss), memory_order_relaxed);
+		if(n == 0) {
+			/* Unvisited children first, in random order */
+			value = 1e9 + (hnef_mcts_random(&(w->rng)) & 0xffff);
+		} else {
+			value = atomic_load_explicit(&(child->reward), memory_order_relaxed)/(2.0*n)
+				+ tree->exploration*sqrt(log_n/n);
+		}
+		if(value > best_value) {
+			best_value = value;
+			best = first + i;
+		}
+	}
+	return best;
+}
+
+/**
+ * @brief Play random moves from the worker's board until the game
+ * ends or the playout grows too long
+ *
+ * @return The winning team, or HNEF_NO_WINNER for a draw
+ */
+static int
+hnef_mcts_playout( HnefMctsWorker *w ) {
+	HnefMcts *tree;
+	int ply, n, winner;
+
+	tree = w->shared->tree;
+	for( ply=0; ply<tree->max_playout; ply++ ) {
+		winner = hnef_board_get_winner(&(w->board));
+		if(winner != HNEF_NO_WINNER) {
+			return winner;
+		}
+		n = hnef_board_generate_moves(&(w->board), &(tree->rays), w->board.turn, w->moves, HNEF_MAX_MOVES);
+		if(n == 0) {
+			return !w->board.turn;
+		}
+		n = tree->policy(&(w->board), w->moves, n, &(w->rng), tree->policy_data);
+		if(hnef_board_make_move(&(w->board), w->moves[n], &(w->stack)) < 0) {
+			break;
+		}
+	}
+	return hnef_board_get_winner(&(w->board));
+}
+
+/**
+ * @brief Run one descent, playout and backup
+ */
+static void
+hnef_mcts_iterate( HnefMctsWorker *w ) {
+	HnefMcts *tree;
+	HnefMctsNode *node;
+	uint32_t index;
+	int depth, state, winner, d;
+
+	tree = w->shared->tree;
+	index = 0;
+	depth = 0;
+	w->path[0] = 0;
+	w->movers[0] = !w->board.turn;
+	atomic_fetch_add_explicit(&(tree->arena->nodes[0].virtual_loss), 1, memory_order_relaxed);
+
+	/* Descend to a leaf, expanding it if we are first to arrive */
+	while(depth < HNEF_MCTS_MAX_DEPTH/2) {
+		node = &(tree->arena->nodes[index]);
+		state = atomic_load_explicit(&(node->state), memory_order_acquire);
+		if(state != HNEF_MCTS_EXPANDED &&
+		   (state != HNEF_MCTS_UNEXPANDED || !hnef_mcts_expand(w, index))) {
+			break;
+		}
+
+		w->movers[depth + 1] = w->board.turn;
+		index = hnef_mcts_select(w, index);
+		hnef_board_make_move(&(w->board), tree->arena->nodes[index].move, &(w->stack));
+		depth++;
+		w->path[depth] = index;
+		atomic_fetch_add_explicit(&(tree->arena->nodes[index].virtual_loss), 1, memory_order_relaxed);
+	}
+
+	winner = hnef_mcts_playout(w);
+
+	/* Credit each node from the point of view of the team which
+	 * moved into it */
+	for( d=depth; d>=0; d-- ) {
+		node = &(tree->arena->nodes[w->path[d]]);
+		atomic_fetch_add_explicit(&(node->reward),
+			(winner == HNEF_NO_WINNER)? 1 : (winner == w->movers[d])? 2 : 0,
+			memory_order_relaxed);
+		atomic_fetch_add_explicit(&(node->visits), 1, memory_order_relaxed);
+		atomic_fetch_sub_explicit(&(node->virtual_loss), 1, memory_order_relaxed);
+	}
+
+	while(hnef_board_unmake_move(&(w->board), &(w->stack)));
+}
+
+/**
+ * @brief Search loop run by every thread
+ */
+static void*
+hnef_mcts_worker( void *arg ) {
+	HnefMctsWorker *w;
+	HnefMctsShared *shared;
+	uint64_t n;
+
+	w = arg;
+	shared = w->shared;
+	while(!atomic_load_explicit(&(shared->stop), memory_order_relaxed)) {
+		n = atomic_fetch_add_explicit(&(shared->playouts), 1, memory_order_relaxed);
+		if(shared->target && n >= shared->target) {
+			atomic_fetch_sub_explicit(&(shared->playouts), 1, memory_order_relaxed);
+			break;
+		}
+		if(shared->milliseconds && (n & 0xff) == 0 &&
+		   hnef_mcts_elapsed(shared) >= shared->milliseconds) {
+			atomic_store_explicit(&(shared->stop), 1, memory_order_relaxed);
+		}
+		hnef_mcts_iterate(w);
+	}
+	return NULL;
+}
+
+/**
+ * @brief Draw the next number from a xorshift64* generator
+ *
+ * @param rng The generator state. Must not be zero
+ *
+ * @return A pseudo-random 64 bit number
+ */
+uint64_t
+hnef_mcts_random( uint64_t *rng ) {
+	uint64_t x = *rng;
+
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	*rng = x;
+	return x * 0x2545f4914f6cdd1dULL;
+}
+
+/**
+ * @brief The default playout policy, choosing uniformly among the
+ * legal moves
+ */
+int
+hnef_mcts_policy_uniform( HnefBoard *board, const HnefMove *moves, int n,
+                          uint64_t *rng, void *data ) {
+	(void)board;
+	(void)moves;
+	(void)data;
+	return (int)(hnef_mcts_random(rng) % (uint64_t)n);
+}
+
+/**
+ * @brief Create a search tree rooted at the position passed as an
+ * argument
+ *
+ * @param tree The tree to be initialized
+ *
+ * @param board The root position. It is copied into the tree
+ *
+ * @param capacity The number of nodes the tree may hold
+ *
+ * @return True on success, false if the arena could not be allocated
+ */
+int
+hnef_mcts_init( HnefMcts *tree, HnefBoard *board, uint32_t capacity ) {
+	HnefMove none;
+
+	if(capacity < 1) {
+		capacity = 1;
+	}
+	tree->arena = malloc(sizeof(HnefMctsArena));
+	if(!tree->arena) {
+		return 0;
+	}
+	tree->arena->nodes = malloc(capacity*sizeof(HnefMctsNode));
+	tree->arena->spare = malloc(capacity*sizeof(HnefMctsNode));
+	if(!tree->arena->nodes || !tree->arena->spare) {
+		hnef_mcts_free(tree);
+		return 0;
+	}
+
+	hnef_board_copy(&(tree->board), board);
+	hnef_rays_init(&(tree->rays), board->height, board->width);
+	tree->arena->capacity = capacity;
+	tree->policy = hnef_mcts_policy_uniform;
+	tree->policy_data = NULL;
+	tree->exploration = 1.4;
+	tree->max_playout = HNEF_MCTS_MAX_DEPTH/2;
+
+	none.from = none.to = 0;
+	hnef_mcts_node_init(&(tree->arena->nodes[0]), none);
+	atomic_init(&(tree->arena->size), 1);
+	return 1;
+}
+
+/**
+ * @brief Release the memory held by a tree
+ */
+void
+hnef_mcts_free( HnefMcts *tree ) {
+	if(tree->arena) {
+		free(tree->arena->nodes);
+		free(tree->arena->spare);
+		free(tree->arena);
+		tree->arena = NULL;
+	}
+}
+
+/**
+ * @brief Replace the playout policy of a tree
+ *
+ * @param tree The tree whose policy we wish to set
+ *
+ * @param policy The new policy, or NULL for hnef_mcts_policy_uniform
+ *
+ * @param data Passed to every call of policy
+ */
+void
+hnef_mcts_set_policy( HnefMcts *tree, HnefPlayoutPolicy policy, void *data ) {
+	tree->policy = policy? policy : hnef_mcts_policy_uniform;
+	tree->policy_data = data;
+}
+
+/**
+ * @brief Grow the tree by running playouts on several threads. The
+ * calling thread takes part in the search.
+ *
+ * @param tree The tree to be searched
+ *
+ * @param threads The number of threads to use
+ *
+ * @param playouts The number of playouts to run, or 0 for no limit
+ *
+ * @param milliseconds The time budget, or 0 for none
+ *
+ * @param stats Receives the throughput of the search. May be NULL
+ *
+ * @return True on success, false if neither limit was given or
+ * memory for the threads could not be allocated
+ */
+int
+hnef_mcts_search( HnefMcts *tree, int threads, uint64_t playouts, int milliseconds,
+                  HnefMctsStats *stats ) {
+	HnefMctsShared shared;
+	HnefMctsWorker *workers;
+	int i, elapsed;
+
+	if(!playouts && !milliseconds) {
+		return 0;
+	}
+	if(threads < 1) {
+		threads = 1;
+	} else if(threads > HNEF_MCTS_MAX_THREADS) {
+		threads = HNEF_MCTS_MAX_THREADS;
+	}
+
+	workers = calloc(threads, sizeof(HnefMctsWorker));
+	if(!workers) {
+		return 0;
+	}
+
+	shared.tree = tree;
+	shared.target = playouts;
+	shared.milliseconds = milliseconds;
+	atomic_init(&(shared.playouts), 0);
+	atomic_init(&(shared.stop), 0);
+	clock_gettime(CLOCK_MONOTONIC, &(shared.start));
+
+	for( i=0; i<threads; i++ ) {
+		workers[i].shared = &shared;
+		hnef_board_copy(&(workers[i].board), &(tree->board));
+		workers[i].rng = hnef_zobrist_mix(tree->board.key + i) | 1;
+		hnef_undo_stack_init(&(workers[i].stack), workers[i].undo, HNEF_MCTS_MAX_DEPTH);
+	}
+	for( i=1; i<threads; i++ ) {
+		workers[i].started = !pthread_create(&(workers[i].handle), NULL,
+			hnef_mcts_worker, &(workers[i]));
+	}
+	hnef_mcts_worker(&(workers[0]));
+	for( i=1; i<threads; i++ ) {
+		if(workers[i].started) {
+			pthread_join(workers[i].handle, NULL);
+		}
+	}
+
+	if(stats) {
+		elapsed = hnef_mcts_elapsed(&shared);
+		stats->playouts = atomic_load(&(shared.playouts));
+		stats->milliseconds = elapsed;
+		stats->playouts_per_second = stats->playouts*1000.0/(elapsed? elapsed : 1);
+	}
+
+	free(workers);
+	return 1;
+}
+
+/**
+ * @brief Get the most visited move at the root of the tree
+ *
+ * @param tree The tree to be examined
+ *
+ * @param move Receives the move
+ *
+ * @return True on success, false if the root has no children
+ */
+int
+hnef_mcts_best_move( HnefMcts *tree, HnefMove *move ) {
+	HnefMctsNode *root, *child;
+	uint32_t first, i, best;
+
+	root = &(tree->arena->nodes[0]);
+	if(atomic_load(&(root->state)) != HNEF_MCTS_EXPANDED) {
+		return 0;
+	}
+
+	first = atomic_load(&(root->first_child));
+	best = first;
+	for( i=0; i<root->child_count; i++ ) {
+		child = &(tree->arena->nodes[first + i]);
+		if(atomic_load(&(child->visits)) > atomic_load(&(tree->arena->nodes[best].visits))) {
+			best = first + i;
+		}
+	}
+	*move = tree->arena->nodes[best].move;
+	return 1;
+}
+
+/**
+ * @brief Make a move at the root of the tree. If the move's subtree
+ * has been explored it becomes the new tree, compacted to the front
+ * of the arena; otherwise the tree starts afresh.
+ *
+ * @param tree The tree to be advanced
+ *
+ * @param move The move which was played
+ *
+ * @return True if a subtree was kept, false if the tree was reset
+ */
+int
+hnef_mcts_advance( HnefMcts *tree, HnefMove move ) {
+	HnefMctsNode *root, *swap, *node;
+	HnefUndo undo;
+	HnefUndoStack stack;
+	uint32_t first, i, j, size, found;
+
+	/* Look for the subtree of the move */
+	root = &(tree->arena->nodes[0]);
+	found = 0;
+	if(atomic_load(&(root->state)) == HNEF_MCTS_EXPANDED) {
+		first = atomic_load(&(root->first_child));
+		for( i=0; i<root->child_count; i++ ) {
+			if(tree->arena->nodes[first + i].move.from == move.from &&
+			   tree->arena->nodes[first + i].move.to == move.to) {
+				found = first + i;
+				break;
+			}
+		}
+	}
+
+	hnef_undo_stack_init(&stack, &undo, 1);
+	hnef_board_make_move(&(tree->board), move, &stack);
+
+	if(!found) {
+		hnef_mcts_node_init(&(tree->arena->nodes[0]), move);
+		atomic_store(&(tree->arena->size), 1);
+		return 0;
+	}
+
+	/* Copy the subtree breadth first into the spare arena. Copied
+	 * nodes still hold the arena index of their old children until
+	 * they are reached. */
+	hnef_mcts_node_copy(&(tree->arena->spare[0]), &(tree->arena->nodes[found]));
+	size = 1;
+	for( j=0; j<size; j++ ) {
+		node = &(tree->arena->spare[j]);
+		if(atomic_load(&(node->state)) != HNEF_MCTS_EXPANDED) {
+			atomic_store(&(node->first_child), 0);
+			continue;
+		}
+		first = atomic_load(&(node->first_child));
+		for( i=0; i<node->child_count; i++ ) {
+			hnef_mcts_node_copy(&(tree->arena->spare[size + i]), &(tree->arena->nodes[first + i]));
+		}
+		atomic_store(&(node->first_child), size);
+		size += node->child_count;
+	}
+
+	swap = tree->arena->nodes;
+	tree->arena->nodes = tree->arena->spare;
+	tree->arena->spare = swap;
+	atomic_store(&(tree->arena->size), size);
+	return 1;
+}
+
+/**
+ * @brief Get the number of nodes in the tree's arena
+ */
+uint32_t
+hnef_mcts_get_size( HnefMcts *tree ) {
+	return atomic_load(&(tree->arena->size));
+}
+
+/**
+ * @brief Get the number of playouts run through the root of the tree
+ */
+uint32_t
+hnef_mcts_get_root_visits( HnefMcts *tree ) {
+	return atomic_load(&(tree->arena->nodes[0].visits));
+}
@@ -0,0 +1,92 @@
+/* libhnef/mcts.h
+ *
+ * Copyright (C) 2016 Gary Munnelly
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+/**
+ * @file libhnef/mcts.h
+ *
+ * @brief Macros, typedefs and function forward declarations for the
+ * Monte Carlo tree search
+ *
+ * @author Gary Munnelly
+ */
+
+#ifndef LIBHNEF_MCTS_H_
+#define LIBHNEF_MCTS_H_
+
+#include <stdint.h>
+#include "move.h"
+
+#define HNEF_MCTS_MAX_DEPTH 512   /**< Longest descent plus playout */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Chooses the next move of a playout.
+ *
+ * @param board The position the move will be made from
+ *
+ * @param moves The legal moves of the side to move
+ *
+ * @param n The number of moves, always at least one
+ *
+ * @param rng State of the calling thread's random number generator.
+ * Pass it to hnef_mcts_random to draw numbers
+ *
+ * @param data The data registered with the policy
+ *
+ * @return The index of the chosen move
+ */
+typedef int (*HnefPlayoutPolicy)( HnefBoard *board, const HnefMove *moves, int n,
+                                  uint64_t *rng, void *data );
+
+/**
+ * @brief The nodes of a search tree, which threads share, see mcts.c
+ */
+typedef struct HnefMctsArena HnefMctsArena;
+
+/**
+ * @brief A Monte Carlo search tree over one game. Nodes come from a
+ * fixed arena so that no memory is allocated while searching.
+ */
+typedef struct HnefMcts {
+	HnefBoard board;              /**< Position at the root of the tree */
+	HnefRays rays;                /**< Ray table for the board's size */
+	HnefMctsArena *arena;         /**< Nodes of the tree */
+	HnefPlayoutPolicy policy;     /**< Playout policy */
+	void *policy_data;            /**< Passed to the playout policy */
+	double exploration;           /**< UCT exploration constant */
+	int max_playout;              /**< Playouts longer than this are draws */
+} HnefMcts;
+
+/**
+ * @brief Statistics of one call to hnef_mcts_search
+ */
+typedef struct HnefMctsStats {
+	uint64_t playouts;            /**< Playouts completed */
+	int milliseconds;             /**< Wall clock time taken */
+	double playouts_per_second;   /**< Throughput of the search */
+} HnefMctsStats;
+
+int          hnef_mcts_init                ( HnefMcts *tree, HnefBoard *board, uint32_t capacity );
+void         hnef_mcts_free                ( HnefMcts *tree );
+void         hnef_mcts_set_policy          ( HnefMcts *tree, HnefPlayoutPolicy policy, void *data );
+int          hnef_mcts_search              ( HnefMcts *tree, int threads, uint64_t playouts, int milliseconds, HnefMctsStats *stats );
+int          hnef_mcts_best_move           ( HnefMcts *tree, HnefMove *move );
+int          hnef_mcts_advance             ( HnefMcts *tree, HnefMove move );
+uint32_t     hnef_mcts_get_size            ( HnefMcts *tree );
+uint32_t     hnef_mcts_get_root_visits     ( HnefMcts *tree );
+
+uint64_t     hnef_mcts_random              ( uint64_t *rng );
+int          hnef_mcts_policy_uniform      ( HnefBoard *board, const HnefMove *moves, int n, uint64_t *rng, void *data );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBHNEF_MCTS_H_ */
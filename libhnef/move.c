@@ -0,0 +1,559 @@
+/* libhnef/move.c
+ *
+ * Copyright (C) 2016 Gary Munnelly
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+/**
+ * @file libhnef/move.c
+ *
+ * @brief Code for generating the moves available to a team
+ *
+ * Every token slides any number of empty squares along its row or
+ * column. Structures restrict where a token may go:
+ *
+ * - Only the king may stop on a throne or castle. Other tokens may
+ *   pass over an empty throne.
+ * - Camps may only be entered or crossed by a soldier which is
+ *   already standing on a camp.
+ *
+ * A soldier is captured when the token that just moved and a friendly
+ * token, or an empty castle, throne or camp, stand on opposite sides
+ * of it. The king is armed and may take part in captures. The king
+ * itself is only captured when attackers or hostile structures
+ * surround it on all four sides, so it is safe on the edge of the
+ * board. The defenders win when the king reaches an escape tile and
+ * the attackers win when the king is captured.
+ *
+ * @author Gary Munnelly
+ */
+#include "move.h"
+
+#define HNEF_CLASS_KING    0 /**< The king */
+#define HNEF_CLASS_SOLDIER 1 /**< A soldier standing outside a camp */
+#define HNEF_CLASS_CAMPER  2 /**< A soldier standing on a camp */
+#define HNEF_CLASSES       3
+
+static const int hnef_dx[4] = { 0, 1, 0, -1 }; /**< x step of each direction */
+static const int hnef_dy[4] = { -1, 0, 1, 0 }; /**< y step of each direction */
+
+/**
+ * @brief Squares which block or may not be landed on by each class of
+ * token, in both row-major and transposed form
+ */
+typedef struct HnefRestrictions {
+	HnefBitboard block[HNEF_CLASSES];    /**< Squares a token may not cross */
+	HnefBitboard forbid[HNEF_CLASSES];   /**< Squares a token may not stop on */
+	HnefBitboard block_t[HNEF_CLASSES];  /**< block, transposed */
+	HnefBitboard forbid_t[HNEF_CLASSES]; /**< forbid, transposed */
+	HnefBitboard occupied_t;             /**< Board occupancy, transposed */
+} HnefRestrictions;
+
+/**
+ * @brief Build the masks of squares which one class of token may not
+ * cross and may not stop on
+ */
+static void
+hnef_restrictions_masks( HnefBoard *board, int c, HnefBitboard *block, HnefBitboard *forbid ) {
+	HnefBitboard restricted;
+
+	hnef_bitboard_or(&restricted, &(board->types[HNEF_THRONE]), &(board->types[HNEF_CASTLE]));
+
+	switch(c) {
+	case HNEF_CLASS_KING:
+		/* The king may go anywhere except a camp */
+		*block = board->types[HNEF_CAMP];
+		*forbid = board->types[HNEF_CAMP];
+		break;
+	case HNEF_CLASS_SOLDIER:
+		/* Soldiers cannot stop on thrones or castles, nor enter camps */
+		*block = board->types[HNEF_CAMP];
+		hnef_bitboard_or(forbid, &restricted, &(board->types[HNEF_CAMP]));
+		break;
+	default:
+		/* Soldiers already in a camp may move about the camps */
+		hnef_bitboard_clear(block);
+		*forbid = restricted;
+		break;
+	}
+}
+
+/**
+ * @brief Build the restriction masks for the board passed as an
+ * argument
+ */
+static void
+hnef_restrictions_init( HnefRestrictions *r, HnefBoard *board ) {
+	int i;
+
+	for( i=0; i<HNEF_CLASSES; i++ ) {
+		hnef_restrictions_masks(board, i, &(r->block[i]), &(r->forbid[i]));
+		hnef_bitboard_transpose(&(r->block_t[i]), &(r->block[i]));
+		hnef_bitboard_transpose(&(r->forbid_t[i]), &(r->forbid[i]));
+	}
+	hnef_bitboard_transpose(&(r->occupied_t), &(board->occupied));
+}
+
+/**
+ * @brief Determine the class of the token standing on square sq
+ */
+static int
+hnef_restrictions_class( HnefBoard *board, int sq ) {
+	if(hnef_bitboard_test(&(board->ranks[HNEF_KING]), sq)) {
+		return HNEF_CLASS_KING;
+	}
+	if(hnef_bitboard_test(&(board->types[HNEF_CAMP]), sq)) {
+		return HNEF_CLASS_CAMPER;
+	}
+	return HNEF_CLASS_SOLDIER;
+}
+
+/**
+ * @brief Find the squares reachable by sliding along a line
+ *
+ * @param blockers The squares of the line which stop a token
+ *
+ * @param after The squares of the line after the token
+ *
+ * @param before The squares of the line before the token
+ *
+ * @return Every square between the token and the nearest blocker in
+ * either direction
+ */
+static uint32_t
+hnef_slide( uint32_t blockers, uint32_t after, uint32_t before ) {
+	uint32_t b;
+
+	b = blockers & after;
+	if(b) {
+		after &= (b & (~b + 1)) - 1;
+	}
+
+	b = blockers & before;
+	if(b) {
+		before &= ~((2u << hnef_msb32(b)) - 1);
+	}
+
+	return after | before;
+}
+
+/**
+ * @brief Find every square a token may move to along its row and
+ * along its column
+ *
+ * @param board The board on which the token stands
+ *
+ * @param rays The ray table for the board's dimensions
+ *
+ * @param r The restriction masks for the board
+ *
+ * @param sq The square the token stands on
+ *
+ * @param row Set to the reachable columns of the token's row
+ *
+ * @param col Set to the reachable rows of the token's column
+ */
+static void
+hnef_targets( HnefBoard *board, const HnefRays *rays, const HnefRestrictions *r,
+              int sq, uint32_t *row, uint32_t *col ) {
+	uint32_t blockers;
+	int c, x, y;
+
+	c = hnef_restrictions_class(board, sq);
+	x = HNEF_SQUARE_X(sq);
+	y = HNEF_SQUARE_Y(sq);
+
+	blockers = hnef_bitboard_get_row(&(board->occupied), y)
+		| hnef_bitboard_get_row(&(r->block[c]), y);
+	*row = hnef_slide(blockers, rays->row_after[x], rays->row_before[x])
+		& ~hnef_bitboard_get_row(&(r->forbid[c]), y);
+
+	blockers = hnef_bitboard_get_row(&(r->occupied_t), x)
+		| hnef_bitboard_get_row(&(r->block_t[c]), x);
+	*col = hnef_slide(blockers, rays->col_after[y], rays->col_before[y])
+		& ~hnef_bitboard_get_row(&(r->forbid_t[c]), x);
+}
+
+/**
+ * @brief Fill a ray table for boards of the dimensions passed as
+ * arguments
+ *
+ * @param rays The table to be filled
+ *
+ * @param height The height of the boards the table will serve
+ *
+ * @param width The width of the boards the table will serve
+ */
+void
+hnef_rays_init( HnefRays *rays, int height, int width ) {
+	uint32_t row, col;
+	int i;
+
+	rays->height = height;
+	rays->width = width;
+
+	row = (width >= 32)? 0xffffffffu : ((uint32_t)1 << width) - 1;
+	col = (height >= 32)? 0xffffffffu : ((uint32_t)1 << height) - 1;
+
+	for( i=0; i<32; i++ ) {
+		rays->row_before[i] = ((uint32_t)1 << i) - 1;
+		rays->col_before[i] = ((uint32_t)1 << i) - 1;
+		rays->row_after[i] = ~rays->row_before[i] & ~((uint32_t)1 << i);
+		rays->col_after[i] = rays->row_after[i];
+		rays->row_before[i] &= row;
+		rays->row_after[i] &= row;
+		rays->col_before[i] &= col;
+		rays->col_after[i] &= col;
+	}
+}
+
+/**
+ * @brief Generate every legal move available to a team. No memory is
+ * allocated; moves are written to the buffer passed by the caller.
+ *
+ * @param board The board on which the moves are to be made
+ *
+ * @param rays The ray table for the board's dimensions
+ *
+ * @param team The team whose moves we wish to generate
+ *
+ * @param moves A buffer to hold the generated moves
+ *
+ * @param max The capacity of moves. Generation stops once the buffer
+ * is full; HNEF_MAX_MOVES is always enough
+ *
+ * @return The number of moves written to the buffer
+ */
+int
+hnef_board_generate_moves( HnefBoard *board, const HnefRays *rays, int team,
+                           HnefMove *moves, int max ) {
+	HnefRestrictions r;
+	uint64_t pieces;
+	uint32_t row, col;
+	int i, n, sq, x, y, t;
+
+	hnef_restrictions_init(&r, board);
+
+	n = 0;
+	for( i=0; i<HNEF_BITBOARD_WORDS; i++ ) {
+		pieces = board->teams[team & 0x01].words[i];
+		while(pieces) {
+			sq = i*64 + hnef_ctz64(pieces);
+			pieces &= pieces - 1;
+
+			hnef_targets(board, rays, &r, sq, &row, &col);
+			x = HNEF_SQUARE_X(sq);
+			y = HNEF_SQUARE_Y(sq);
+
+			while(row && n < max) {
+				t = hnef_ctz64(row);
+				row &= row - 1;
+				moves[n].from = sq;
+				moves[n].to = HNEF_SQUARE(t, y);
+				n++;
+			}
+			while(col && n < max) {
+				t = hnef_ctz64(col);
+				col &= col - 1;
+				moves[n].from = sq;
+				moves[n].to = HNEF_SQUARE(x, t);
+				n++;
+			}
+		}
+	}
+
+	return n;
+}
+
+/**
+ * @brief Determine whether or not a move is legal for a team
+ *
+ * @param board The board on which the move is to be made
+ *
+ * @param rays The ray table for the board's dimensions
+ *
+ * @param team The team making the move
+ *
+ * @param move The move to be checked
+ *
+ * @return True if the move is legal, false otherwise
+ */
+int
+hnef_board_is_legal_move( HnefBoard *board, const HnefRays *rays, int team, HnefMove move ) {
+	HnefBitboard block, forbid;
+	uint32_t blockers, forbidden, reach;
+	int fx, fy, tx, ty, y;
+
+	fx = HNEF_SQUARE_X(move.from);
+	fy = HNEF_SQUARE_Y(move.from);
+	tx = HNEF_SQUARE_X(move.to);
+	ty = HNEF_SQUARE_Y(move.to);
+
+	if(fx >= board->width || fy >= board->height ||
+	   tx >= board->width || ty >= board->height) {
+		return 0;
+	}
+	if(!hnef_bitboard_test(&(board->teams[team & 0x01]), move.from)) {
+		return 0;
+	}
+	if((fx == tx) == (fy == ty)) {
+		return 0;
+	}
+
+	/* Only one line is checked, so the transposed masks built for
+	 * move generation are not needed */
+	hnef_restrictions_masks(board, hnef_restrictions_class(board, move.from), &block, &forbid);
+	hnef_bitboard_or(&block, &block, &(board->occupied));
+
+	if(fy == ty) {
+		blockers = hnef_bitboard_get_row(&block, fy);
+		forbidden = hnef_bitboard_get_row(&forbid, fy);
+		reach = hnef_slide(blockers, rays->row_after[fx], rays->row_before[fx]);
+		return ((reach & ~forbidden) >> tx) & 1;
+	}
+
+	/* Gather the one column a square at a time */
+	blockers = 0;
+	forbidden = 0;
+	for( y=0; y<board->height; y++ ) {
+		blockers |= (uint32_t)hnef_bitboard_test(&block, HNEF_SQUARE(fx, y)) << y;
+		forbidden |= (uint32_t)hnef_bitboard_test(&forbid, HNEF_SQUARE(fx, y)) << y;
+	}
+	reach = hnef_slide(blockers, rays->col_after[fy], rays->col_before[fy]);
+	return ((reach & ~forbidden) >> ty) & 1;
+}
+
+/**
+ * @brief Determine whether or not the square at (x,y) lies on the
+ * board
+ */
+static int
+hnef_on_board( HnefBoard *board, int x, int y ) {
+	return x >= 0 && y >= 0 && x < board->width && y < board->height;
+}
+
+/**
+ * @brief Find the square at position i along an edge of the board.
+ * Edges are numbered clockwise from the north: positions run along x
+ * on the north and south edges and along y on the east and west.
+ */
+void
+hnef_edge_square( HnefBoard *board, int edge, int i, int *x, int *y ) {
+	switch(edge & 0x03) {
+	case 0:
+		*x = i;
+		*y = 0;
+		break;
+	case 1:
+		*x = board->width - 1;
+		*y = i;
+		break;
+	case 2:
+		*x = i;
+		*y = board->height - 1;
+		break;
+	default:
+		*x = 0;
+		*y = i;
+		break;
+	}
+}
+
+/**
+ * @brief Determine whether or not the square at (x,y) can act as the
+ * far side of a capture made by team. Squares off the board never do.
+ */
+static int
+hnef_is_hostile( HnefBoard *board, int x, int y, int team ) {
+	int sq;
+
+	if(!hnef_on_board(board, x, y)) {
+		return 0;
+	}
+
+	sq = HNEF_SQUARE(x, y);
+	if(hnef_bitboard_test(&(board->occupied), sq)) {
+		return hnef_bitboard_test(&(board->teams[team]), sq);
+	}
+	return !hnef_bitboard_test(&(board->types[HNEF_EMPTY]), sq);
+}
+
+/**
+ * @brief Determine whether or not the token at (x,y) is captured by
+ * the team which just moved
+ */
+static int
+hnef_is_captured( HnefBoard *board, int x, int y, int dir, int team ) {
+	int d, sq;
+
+	sq = HNEF_SQUARE(x, y);
+	if(!hnef_bitboard_test(&(board->ranks[HNEF_KING]), sq)) {
+		return hnef_is_hostile(board, x + hnef_dx[dir], y + hnef_dy[dir], team);
+	}
+
+	/* The king must be enclosed on every side */
+	for( d=0; d<4; d++ ) {
+		if(!hnef_is_hostile(board, x + hnef_dx[d], y + hnef_dy[d], team)) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/**
+ * @brief Point an undo stack at storage provided by the caller
+ *
+ * @param stack The stack to be initialized
+ *
+ * @param records Storage for at least capacity undo records
+ *
+ * @param capacity The number of records the storage can hold
+ */
+void
+hnef_undo_stack_init( HnefUndoStack *stack, HnefUndo *records, int capacity ) {
+	stack->records = records;
+	stack->size = 0;
+	stack->capacity = capacity;
+}
+
+/**
+ * @brief Make a move in place, removing any tokens it captures, and
+ * push a record of it to the undo stack. The turn passes to the
+ * opposing team. The move is not checked for legality.
+ *
+ * @param board The board on which the move is to be made
+ *
+ * @param move The move to be made
+ *
+ * @param stack The stack which will receive the undo record
+ *
+ * @return The number of tokens captured, or -1 if the stack is full
+ * in which case the board is left unchanged
+ */
+int
+hnef_board_make_move( HnefBoard *board, HnefMove move, HnefUndoStack *stack ) {
+	HnefUndo *undo;
+	HnefToken token;
+	int d, x, y, vx, vy, team, n;
+
+	if(stack->size >= stack->capacity) {
+		return -1;
+	}
+
+	undo = &(stack->records[stack->size++]);
+	undo->move = move;
+	undo->captured = 0;
+	undo->king = 0;
+	undo->wall_edge = 0;
+	undo->wall = 0;
+
+	/* Slide the token to its new square */
+	x = HNEF_SQUARE_X(move.from);
+	y = HNEF_SQUARE_Y(move.from);
+	token = hnef_board_get_token(board, x, y);
+	team = token.team;
+	hnef_board_unset_token(board, x, y);
+
+	x = HNEF_SQUARE_X(move.to);
+	y = HNEF_SQUARE_Y(move.to);
+	hnef_board_set_token(board, x, y, token);
+	hnef_board_set_turn(board, !team);
+
+	/* Look for enemy tokens sandwiched against the moved token */
+	n = 0;
+	for( d=0; d<4; d++ ) {
+		vx = x + hnef_dx[d];
+		vy = y + hnef_dy[d];
+		if(!hnef_on_board(board, vx, vy) ||
+		   !hnef_bitboard_test(&(board->teams[!team]), HNEF_SQUARE(vx, vy))) {
+			continue;
+		}
+		if(hnef_is_captured(board, vx, vy, d, team)) {
+			if(hnef_board_get_token_rank(board, vx, vy) == HNEF_KING) {
+				undo->king = d + 1;
+			}
+			undo->captured |= 1 << d;
+			hnef_board_unset_token(board, vx, vy);
+			n++;
+		}
+	}
+
+	return n;
+}
+
+/**
+ * @brief Take back the move on top of the undo stack, restoring any
+ * tokens it captured
+ *
+ * @param board The board on which the move was made
+ *
+ * @param stack The stack holding the move's undo record
+ *
+ * @return True on success, false if the stack is empty
+ */
+int
+hnef_board_unmake_move( HnefBoard *board, HnefUndoStack *stack ) {
+	HnefUndo *undo;
+	HnefToken token, victim;
+	int d, i, x, y, vx, vy;
+
+	if(stack->size <= 0) {
+		return 0;
+	}
+	undo = &(stack->records[--stack->size]);
+
+	x = HNEF_SQUARE_X(undo->move.to);
+	y = HNEF_SQUARE_Y(undo->move.to);
+	token = hnef_board_get_token(board, x, y);
+	hnef_board_unset_token(board, x, y);
+
+	/* Put the captured tokens back */
+	for( d=0; d<4; d++ ) {
+		if(undo->captured & (1 << d)) {
+			hnef_token_init(&victim, !token.team,
+				(undo->king == d + 1)? HNEF_KING : HNEF_SOLDIER);
+			hnef_board_set_token(board, x + hnef_dx[d], y + hnef_dy[d], victim);
+		}
+	}
+
+	/* Put back the soldiers of a shieldwall */
+	if(undo->wall_edge) {
+		hnef_token_init(&victim, !token.team, HNEF_SOLDIER);
+		for( i=0; i<32; i++ ) {
+			if(undo->wall & ((uint32_t)1 << i)) {
+				hnef_edge_square(board, undo->wall_edge - 1, i, &vx, &vy);
+				hnef_board_set_token(board, vx, vy, victim);
+			}
+		}
+	}
+
+	hnef_board_set_token(board, HNEF_SQUARE_X(undo->move.from),
+		HNEF_SQUARE_Y(undo->move.from), token);
+	hnef_board_set_turn(board, token.team);
+	return 1;
+}
+
+/**
+ * @brief Determine whether either team has won the game
+ *
+ * @param board The board to be examined
+ *
+ * @return HNEF_SWEDE if the king stands on an escape tile,
+ * HNEF_MUSCOVITE if the king has been captured, HNEF_NO_WINNER
+ * otherwise
+ */
+int
+hnef_board_get_winner( HnefBoard *board ) {
+	HnefBitboard escaped;
+
+	if(hnef_bitboard_is_empty(&(board->ranks[HNEF_KING]))) {
+		return HNEF_MUSCOVITE;
+	}
+
+	hnef_bitboard_and(&escaped, &(board->ranks[HNEF_KING]), &(board->escapes));
+	if(!hnef_bitboard_is_empty(&escaped)) {
+		return HNEF_SWEDE;
+	}
+	return HNEF_NO_WINNER;
+}
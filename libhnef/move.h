@@ -0,0 +1,101 @@
+/* libhnef/move.h
+ *
+ * Copyright (C) 2016 Gary Munnelly
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+/**
+ * @file libhnef/move.h
+ *
+ * @brief Macros, typedefs and function forward declarations for
+ * HnefMove and move generation
+ *
+ * @author Gary Munnelly
+ */
+
+#ifndef LIBHNEF_MOVE_H_
+#define LIBHNEF_MOVE_H_
+
+#include "board.h"
+
+/** Enough room for every legal move of one team on any board. Every
+ * move lands on an empty square, which at most four tokens can reach:
+ * the nearest along its row and column on each side. */
+#define HNEF_MAX_MOVES (4*MAX_WIDTH*MAX_HEIGHT)
+
+#define HNEF_NO_WINNER -1   /**< Returned while neither team has won */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief A single token sliding from one square to another. Squares
+ * are bit indices as produced by HNEF_SQUARE.
+ */
+typedef struct HnefMove {
+	uint16_t from;        /**< Square the token leaves */
+	uint16_t to;          /**< Square the token lands on */
+} HnefMove;
+
+/**
+ * @brief Precomputed ray masks for one board size.
+ *
+ * For every coordinate the table holds the squares of a row (or a
+ * column) lying strictly after and strictly before it, clipped to the
+ * board. Initialize one table per board size with hnef_rays_init and
+ * share it between every board of that size.
+ */
+typedef struct HnefRays {
+	int height;                  /**< Height of the boards served */
+	int width;                   /**< Width of the boards served */
+	uint32_t row_after[32];      /**< Columns to the east of x */
+	uint32_t row_before[32];     /**< Columns to the west of x */
+	uint32_t col_after[32];      /**< Rows to the south of y */
+	uint32_t col_before[32];     /**< Rows to the north of y */
+} HnefRays;
+
+/**
+ * @brief Everything needed to take back a move made with
+ * hnef_board_make_move.
+ *
+ * Captured tokens always belong to the opposing team and at most one
+ * can be taken in each direction, so the record only notes which
+ * directions lost a token and whether one of them was the king.
+ * Soldiers taken by a shieldwall capture all lie on one edge of the
+ * board and are noted as a mask of positions along it.
+ */
+typedef struct HnefUndo {
+	HnefMove move;        /**< The move that was made */
+	uint8_t captured;     /**< Bit d is set if a token was taken in direction d */
+	uint8_t king;         /**< Direction of the captured king plus one, or 0 */
+	uint8_t wall_edge;    /**< Edge of a shieldwall capture plus one, or 0 */
+	uint32_t wall;        /**< Bit i is set if position i along that edge was taken */
+} HnefUndo;
+
+/**
+ * @brief A stack of undo records backed by memory owned by the caller
+ */
+typedef struct HnefUndoStack {
+	HnefUndo *records;    /**< Storage for the records */
+	int size;             /**< Number of records on the stack */
+	int capacity;         /**< Number of records the storage can hold */
+} HnefUndoStack;
+
+void         hnef_rays_init                ( HnefRays *rays, int h, int w );
+
+int          hnef_board_generate_moves     ( HnefBoard *b, const HnefRays *rays, int team, HnefMove *moves, int max );
+int          hnef_board_is_legal_move      ( HnefBoard *b, const HnefRays *rays, int team, HnefMove move );
+
+void         hnef_undo_stack_init          ( HnefUndoStack *s, HnefUndo *records, int capacity );
+int          hnef_board_make_move          ( HnefBoard *b, HnefMove move, HnefUndoStack *s );
+int          hnef_board_unmake_move        ( HnefBoard *b, HnefUndoStack *s );
+int          hnef_board_get_winner         ( HnefBoard *b );
+void         hnef_edge_square              ( HnefBoard *b, int edge, int i, int *x, int *y );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBHNEF_MOVE_H_ */
@@ -0,0 +1,422 @@
+/* libhnef/notation.c
+ *
+ * Copyright (C) 2016 Gary Munnelly
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+/**
+ * @file libhnef/notation.c
+ *
+ * @brief Code for reading and writing games in coordinate notation
+ *
+ * A square is named by its column, a to z from the west edge, and its
+ * rank, 1 upwards from the south edge, so that a1 is the south west
+ * corner: the square at (x,y) is named 'a' + x followed by
+ * height - y. A move names the square the token leaves, an optional
+ * '-' and the square it lands on, as in d1-d5. Captures may follow as
+ * 'x' and a square, repeated, as in d1-d5xd6xe5. They are checked for
+ * form only, since the rules decide what is taken.
+ *
+ * A game is a list of moves separated by white space. Move numbers,
+ * digits ending in '.' as in "1. d1-d5 f4-c4 2. ...", are skipped
+ * whether or not a space follows them. A text of games holds one game
+ * per line.
+ *
+ * Nothing is allocated. Separators and line ends are found sixteen
+ * bytes at a time with SSE2 where the compiler provides it.
+ *
+ * @author Gary Munnelly
+ */
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include <string.h>
+#include "notation.h"
+
+/**
+ * @brief Determine whether or not a character separates tokens. Every
+ * control character and the space do.
+ */
+static int
+hnef_notation_is_separator( char c ) {
+	return (unsigned char)c <= ' ';
+}
+
+/**
+ * @brief Find the first byte at or after i which is (want set) or is
+ * not (want clear) a separator
+ *
+ * @return Its offset, or length if there is none
+ */
+static size_t
+hnef_notation_scan( const char *text, size_t length, size_t i, int want ) {
+#if defined(__SSE2__)
+	const __m128i space = _mm_set1_epi8(' ');
+	__m128i v;
+	unsigned mask;
+
+	while( i + 16 <= length ) {
+		v = _mm_loadu_si128((const __m128i*)(text + i));
+		/* Unsigned v <= ' ' exactly where min(v, ' ') == v */
+		mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(v, space), v));
+		if(!want) {
+			mask ^= 0xffff;
+		}
+		if(mask) {
+			return i + __builtin_ctz(mask);
+		}
+		i += 16;
+	}
+#endif
+	while( i < length && hnef_notation_is_separator(text[i]) != want ) {
+		i++;
+	}
+	return i;
+}
+
+/**
+ * @brief Read a square from the start of text
+ *
+ * @return The number of characters read, or 0 if they do not name a
+ * square of the board
+ */
+static size_t
+hnef_notation_parse_square( HnefBoard *b, const char *text, size_t length, int *square ) {
+	size_t i;
+	int x, rank;
+
+	if(length < 2) {
+		return 0;
+	}
+	if(text[0] >= 'a' && text[0] <= 'z') {
+		x = text[0] - 'a';
+	} else if(text[0] >= 'A' && text[0] <= 'Z') {
+		x = text[0] - 'A';
+	} else {
+		return 0;
+	}
+
+	/* One or two digits without a leading zero */
+	if(text[1] < '1' || text[1] > '9') {
+		return 0;
+	}
+	rank = text[1] - '0';
+	i = 2;
+	if(i < length && text[i] >= '0' && text[i] <= '9') {
+		rank = rank*10 + (text[i] - '0');
+		i++;
+	}
+
+	if(x >= b->width || rank > b->height) {
+		return 0;
+	}
+	*square = HNEF_SQUARE(x, b->height - rank);
+	return i;
+}
+
+/**
+ * @brief Write the name of a square
+ *
+ * @return The number of characters written
+ */
+static size_t
+hnef_notation_write_square( HnefBoard *b, int square, char *buffer ) {
+	int rank;
+
+	rank = b->height - HNEF_SQUARE_Y(square);
+	buffer[0] = (char)('a' + HNEF_SQUARE_X(square));
+	if(rank < 10) {
+		buffer[1] = (char)('0' + rank);
+		return 2;
+	}
+	buffer[1] = (char)('0' + rank / 10);
+	buffer[2] = (char)('0' + rank % 10);
+	return 3;
+}
+
+/**
+ * @brief Measure the move number at the start of a token, digits
+ * followed by one or more '.'
+ *
+ * @return The characters in the number, or 0 if there is none
+ */
+static size_t
+hnef_notation_number_length( const char *text, size_t length ) {
+	size_t i;
+
+	for( i=0; i<length && text[i] >= '0' && text[i] <= '9'; i++ ) {
+	}
+	if(i == 0 || i == length || text[i] != '.') {
+		return 0;
+	}
+	for( ; i<length && text[i] == '.'; i++ ) {
+	}
+	return i;
+}
+
+/**
+ * @brief Read a move and check that it is legal for the side to move
+ *
+ * @param b The board on which the move is to be made
+ *
+ * @param rays The ray table for the board's dimensions
+ *
+ * @param text The move, which must take up all of length characters
+ *
+ * @param length Characters in text
+ *
+ * @param move The move read
+ *
+ * @return True on success, false if the text is not a move or the move
+ * is not legal
+ */
+int
+hnef_notation_parse_move( HnefBoard *b, const HnefRays *rays, const char *text, size_t length, HnefMove *move ) {
+	size_t i, n;
+	int from, to, captured;
+
+	i = hnef_notation_parse_square(b, text, length, &from);
+	if(!i) {
+		return 0;
+	}
+	if(i < length && text[i] == '-') {
+		i++;
+	}
+	n = hnef_notation_parse_square(b, text + i, length - i, &to);
+	if(!n) {
+		return 0;
+	}
+	i += n;
+
+	while( i < length ) {
+		if(text[i] != 'x' && text[i] != 'X') {
+			return 0;
+		}
+		i++;
+		n = hnef_notation_parse_square(b, text + i, length - i, &captured);
+		if(!n) {
+			return 0;
+		}
+		i += n;
+	}
+
+	move->from = (uint16_t)from;
+	move->to = (uint16_t)to;
+	return hnef_board_is_legal_move(b, rays, b->turn, *move);
+}
+
+/**
+ * @brief Write a move, such as d1-d5. The buffer is not terminated.
+ *
+ * @param b The board on which the move is made, which gives the ranks
+ *
+ * @param move The move
+ *
+ * @param buffer Buffer to receive the move
+ *
+ * @param capacity Bytes available in buffer. HNEF_NOTATION_MAX_MOVE
+ * is always enough.
+ *
+ * @param length Set to the number of bytes written
+ *
+ * @return True on success, false if either square is off the board or
+ * the buffer is too small
+ */
+int
+hnef_notation_write_move( HnefBoard *b, HnefMove move, char *buffer, size_t capacity, size_t *length ) {
+	char text[HNEF_NOTATION_MAX_MOVE];
+	size_t n;
+
+	if(b->width > HNEF_NOTATION_MAX_WIDTH ||
+	   HNEF_SQUARE_X(move.from) >= b->width || HNEF_SQUARE_Y(move.from) >= b->height ||
+	   HNEF_SQUARE_X(move.to) >= b->width || HNEF_SQUARE_Y(move.to) >= b->height) {
+		return 0;
+	}
+
+	n = hnef_notation_write_square(b, move.from, text);
+	text[n++] = '-';
+	n += hnef_notation_write_square(b, move.to, text + n);
+	if(n > capacity) {
+		return 0;
+	}
+	memcpy(buffer, text, n);
+	*length = n;
+	return 1;
+}
+
+/**
+ * @brief Read a game and play it out on a board. Every move is checked
+ * for legality as it is reached.
+ *
+ * @param t The rules the game is played under
+ *
+ * @param rays The ray table for the board's dimensions
+ *
+ * @param b The starting position, which is left at the end of the game
+ * or, on failure, before the move which could not be read
+ *
+ * @param text The game
+ *
+ * @param length Characters in text
+ *
+ * @param moves Array to receive the moves
+ *
+ * @param max Room in moves
+ *
+ * @param count Set to the number of moves read, which on failure is
+ * the index of the move which could not be read
+ *
+ * @return True on success, false if a move could not be read, was not
+ * legal, came after the game was won or did not fit in moves
+ */
+int
+hnef_notation_parse_game( const HnefRuleTables *t, const HnefRays *rays, HnefBoard *b, const char *text, size_t length, HnefMove *moves, size_t max, size_t *count ) {
+	HnefUndo records[1];
+	HnefUndoStack stack;
+	size_t start, end;
+
+	*count = 0;
+	end = 0;
+	for( ;; ) {
+		start = hnef_notation_scan(text, length, end, 0);
+		if(start == length) {
+			return 1;
+		}
+		end = hnef_notation_scan(text, length, start, 1);
+		start += hnef_notation_number_length(text + start, end - start);
+		if(start == end) {
+			continue;
+		}
+
+		/* Nothing may follow the move which decides the game */
+		if(*count == max || hnef_rules_get_winner(t, b) != HNEF_NO_WINNER ||
+		   !hnef_notation_parse_move(b, rays, text + start, end - start, moves + *count)) {
+			return 0;
+		}
+		hnef_undo_stack_init(&stack, records, 1);
+		hnef_rules_make_move(t, b, moves[*count], &stack);
+		(*count)++;
+	}
+}
+
+/**
+ * @brief Write a game with move numbers, as in "1. d1-d5 f4-c4 2. ...".
+ * The buffer is not terminated.
+ *
+ * @param b The starting position, which gives the ranks and the side
+ * which moves first
+ *
+ * @param moves The moves of the game
+ *
+ * @param count Moves in the game
+ *
+ * @param buffer Buffer to receive the game
+ *
+ * @param capacity Bytes available in buffer
+ *
+ * @param length Set to the number of bytes written
+ *
+ * @return True on success, false if a move is off the board or the
+ * buffer is too small
+ */
+int
+hnef_notation_write_game( HnefBoard *b, const HnefMove *moves, size_t count, char *buffer, size_t capacity, size_t *length ) {
+	char number[24];
+	size_t i, n, at, turn;
+	int k;
+
+	at = 0;
+	for( i=0; i<count; i++ ) {
+		/* Each turn is numbered before the first team's move, or
+		 * before the first move whichever team makes it */
+		turn = i + (b->turn != HNEF_MUSCOVITE);
+		if(i == 0 || turn % 2 == 0) {
+			k = sizeof(number);
+			number[--k] = ' ';
+			number[--k] = '.';
+			n = turn/2 + 1;
+			do {
+				number[--k] = (char)('0' + n % 10);
+				n /= 10;
+			} while( n );
+			if(i != 0) {
+				number[--k] = ' ';
+			}
+			n = sizeof(number) - k;
+			if(capacity - at < n) {
+				return 0;
+			}
+			memcpy(buffer + at, number + k, n);
+			at += n;
+		} else {
+			if(at == capacity) {
+				return 0;
+			}
+			buffer[at++] = ' ';
+		}
+
+		if(!hnef_notation_write_move(b, moves[i], buffer + at, capacity - at, &n)) {
+			return 0;
+		}
+		at += n;
+	}
+	*length = at;
+	return 1;
+}
+
+/**
+ * @brief Find the next game of a text holding one game per line. Blank
+ * lines are skipped.
+ *
+ * @param text The games
+ *
+ * @param length Characters in text
+ *
+ * @param at Offset at which to start looking, moved past the game
+ * found. Start at 0.
+ *
+ * @param game Set to the start of the game
+ *
+ * @param game_length Set to the characters in the game, without its
+ * line end
+ *
+ * @return True if a game was found, false at the end of the text
+ */
+int
+hnef_notation_next_game( const char *text, size_t length, size_t *at, const char **game, size_t *game_length ) {
+	size_t start, end;
+#if defined(__SSE2__)
+	const __m128i newline = _mm_set1_epi8('\n');
+	unsigned mask;
+#endif
+
+	start = hnef_notation_scan(text, length, *at, 0);
+	if(start >= length) {
+		*at = length;
+		return 0;
+	}
+
+	end = start;
+#if defined(__SSE2__)
+	while( end + 16 <= length ) {
+		mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(text + end)), newline));
+		if(mask) {
+			end += __builtin_ctz(mask);
+			break;
+		}
+		end += 16;
+	}
+#endif
+	while( end < length && text[end] != '\n' ) {
+		end++;
+	}
+
+	*game = text + start;
+	*game_length = end - start;
+	while( *game_length && hnef_notation_is_separator(text[start + *game_length - 1]) ) {
+		(*game_length)--;
+	}
+	*at = end;
+	return 1;
+}
@@ -0,0 +1,43 @@
+/* libhnef/notation.h
+ *
+ * Copyright (C) 2016 Gary Munnelly
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+/**
+ * @file libhnef/notation.h
+ *
+ * @brief Macros and function forward declarations for reading and
+ * writing games in coordinate notation
+ *
+ * @author Gary Munnelly
+ */
+
+#ifndef LIBHNEF_NOTATION_H_
+#define LIBHNEF_NOTATION_H_
+
+#include <stddef.h>
+#include "rules.h"
+
+/** Longest move written, such as "z32-z32" */
+#define HNEF_NOTATION_MAX_MOVE 7
+
+/** Widest board which can be named, with columns a to z */
+#define HNEF_NOTATION_MAX_WIDTH 26
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int          hnef_notation_parse_move      ( HnefBoard *b, const HnefRays *rays, const char *text, size_t length, HnefMove *move );
+int          hnef_notation_write_move      ( HnefBoard *b, HnefMove move, char *buffer, size_t capacity, size_t *length );
+int          hnef_notation_parse_game      ( const HnefRuleTables *t, const HnefRays *rays, HnefBoard *b, const char *text, size_t length, HnefMove *moves, size_t max, size_t *count );
+int          hnef_notation_write_game      ( HnefBoard *b, const HnefMove *moves, size_t count, char *buffer, size_t capacity, size_t *length );
+int          hnef_notation_next_game       ( const char *text, size_t length, size_t *at, const char **game, size_t *game_length );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBHNEF_NOTATION_H_ */
@@ -0,0 +1,276 @@
+/* libhnef/packed.c
+ *
+ * Copyright (C) 2016 Gary Munnelly
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+/**
+ * @file libhnef/packed.c
+ *
+ * @brief Code for manipulating a board stored in its serialized, one
+ * byte per tile form
+ *
+ * @author Gary Munnelly
+ */
+#include <string.h>
+#include "packed.h"
+
+/**
+ * @brief Get the number of bytes needed to store a packed board of
+ * the dimensions passed as arguments
+ *
+ * @param height The height of the game board
+ *
+ * @param width The width of the game board
+ *
+ * @return The size of the packed board in bytes
+ */
+size_t
+hnef_packed_board_size( int height, int width ) {
+	return HNEF_PACKED_BOARD_SIZE(height, width);
+}
+
+/**
+ * @brief Initialize the packed board passed as an argument with
+ * blank, empty tiles. The board must be backed by at least
+ * hnef_packed_board_size(height, width) bytes.
+ *
+ * @param board The board to be initialized
+ *
+ * @param height The height of the game board
+ *
+ * @param width The width of the game board
+ *
+ * @return A pointer to the initialized board or NULL if board is NULL
+ */
+HnefPackedBoard*
+hnef_packed_board_init( HnefPackedBoard *board, int height, int width ) {
+	if(board) {
+		board->height = height;
+		board->width = width;
+		memset(board->tiles, HNEF_PACKED_VALID, height*width);
+	}
+	return board;
+}
+
+/**
+ * @brief Serialize a packed board. The packed board already is the
+ * serialized form, so this is a plain copy.
+ *
+ * @param board The board to be serialized into a buffer
+ *
+ * @param buffer A buffer of at least hnef_packed_board_size bytes
+ */
+void
+hnef_packed_board_serialize( HnefPackedBoard *board, uint8_t *buffer ) {
+	memcpy(buffer, board, HNEF_PACKED_BOARD_SIZE(board->height, board->width));
+}
+
+/**
+ * @brief Deserialize the buffer passed as an argument into a packed
+ * board. Every tile is validated before the copy is made, so board
+ * is left untouched if the buffer is malformed.
+ *
+ * @param board The board to hold the deserialized data. It must be
+ * large enough for the dimensions stored in the buffer
+ *
+ * @param buffer The buffer containing the data to be deserialized
+ *
+ * @return True on success, false if the buffer is malformed
+ */
+int
+hnef_packed_board_deserialize( HnefPackedBoard *board, uint8_t *buffer ) {
+	int i, area;
+
+	area = buffer[0]*buffer[1];
+	for( i=0; i<area; i++ ) {
+		if(!(buffer[i+2] & HNEF_PACKED_VALID)) {
+			return 0;
+		}
+	}
+
+	memcpy(board, buffer, HNEF_PACKED_BOARD_SIZE(buffer[0], buffer[1]));
+	return 1;
+}
+
+/**
+ * @brief Pack a HnefBoard. The packed board must be large enough for
+ * the dimensions of board.
+ *
+ * @param packed The packed board to be written
+ *
+ * @param board The board to be packed
+ */
+void
+hnef_packed_board_from_board( HnefPackedBoard *packed, HnefBoard *board ) {
+	hnef_board_serialize(board, (uint8_t*)packed);
+}
+
+/**
+ * @brief Unpack a packed board into a HnefBoard
+ *
+ * @param packed The packed board to be read
+ *
+ * @param board The board to be written
+ */
+void
+hnef_packed_board_to_board( HnefPackedBoard *packed, HnefBoard *board ) {
+	hnef_board_deserialize(board, (uint8_t*)packed);
+}
+
+/**
+ * @brief Get the height attribute of the packed board passed as an
+ * argument
+ */
+int
+hnef_packed_board_get_height( HnefPackedBoard *board ) {
+	return board->height;
+}
+
+/**
+ * @brief Get the width attribute of the packed board passed as an
+ * argument
+ */
+int
+hnef_packed_board_get_width( HnefPackedBoard *board ) {
+	return board->width;
+}
+
+/**
+ * @brief Get the area attribute of the packed board passed as an
+ * argument
+ */
+int
+hnef_packed_board_get_area( HnefPackedBoard *board ) {
+	return board->height*board->width;
+}
+
+/**
+ * @brief Unpack the tile located at the coordinates passed as
+ * arguments
+ *
+ * @param board The board whose tiles we are examining
+ *
+ * @param x The x coordinate of the tile we wish to examine
+ *
+ * @param y The y coordinate of the tile we wish to examine
+ *
+ * @return A copy of the tile at coordinates (x,y)
+ */
+HnefTile
+hnef_packed_board_get_tile( HnefPackedBoard *board, int x, int y ) {
+	HnefTile tile;
+	hnef_tile_deserialize(&tile, board->tiles[board->width*y + x]);
+	return tile;
+}
+
+/**
+ * @brief Pack the tile passed as an argument into the coordinates
+ * (x,y)
+ *
+ * @param board The board whose tiles we are modifying
+ *
+ * @param x The x coordinate of the tile we wish to replace
+ *
+ * @param y The y coordinate of the tile we wish to replace
+ *
+ * @param tile The tile we would like to assign to the coordinates (x,y)
+ */
+void
+hnef_packed_board_set_tile( HnefPackedBoard *board, int x, int y, HnefTile tile ) {
+	board->tiles[board->width*y + x] = hnef_tile_serialize(&tile);
+}
+
+/**
+ * @brief Get the integer code for the structure built on the tile at
+ * (x,y)
+ */
+int
+hnef_packed_board_get_tile_type( HnefPackedBoard *board, int x, int y ) {
+	return (board->tiles[board->width*y + x] & HNEF_PACKED_TYPE) >> HNEF_PACKED_TYPE_SHIFT;
+}
+
+/**
+ * @brief Set the integer code for the structure built on the tile at
+ * (x,y)
+ */
+void
+hnef_packed_board_set_tile_type( HnefPackedBoard *board, int x, int y, int type ) {
+	uint8_t *tile = &(board->tiles[board->width*y + x]);
+	*tile = (*tile & ~HNEF_PACKED_TYPE) | ((type << HNEF_PACKED_TYPE_SHIFT) & HNEF_PACKED_TYPE);
+}
+
+/**
+ * @brief Determine whether or not the tile at (x,y) is a tile via
+ * which the king may escape
+ */
+int
+hnef_packed_board_get_tile_is_escape( HnefPackedBoard *board, int x, int y ) {
+	return (board->tiles[board->width*y + x] & HNEF_PACKED_ESCAPE) != 0;
+}
+
+/**
+ * @brief Set whether or not the tile at (x,y) is a tile via which the
+ * king may escape
+ */
+void
+hnef_packed_board_set_tile_is_escape( HnefPackedBoard *board, int x, int y, int is_escape ) {
+	uint8_t *tile = &(board->tiles[board->width*y + x]);
+	*tile = is_escape? (*tile | HNEF_PACKED_ESCAPE) : (*tile & ~HNEF_PACKED_ESCAPE);
+}
+
+/**
+ * @brief Unpack the token standing on the tile at (x,y). The result
+ * is a soldier of team 0 if the tile is unoccupied.
+ */
+HnefToken
+hnef_packed_board_get_token( HnefPackedBoard *board, int x, int y ) {
+	HnefToken token;
+
+	hnef_token_init(&token, 0, 0);
+	hnef_token_deserialize(&token, board->tiles[board->width*y + x]);
+	return token;
+}
+
+/**
+ * @brief Determine whether or not a token stands on the tile at (x,y)
+ */
+int
+hnef_packed_board_get_tile_is_occupied( HnefPackedBoard *board, int x, int y ) {
+	return board->tiles[board->width*y + x] & HNEF_PACKED_OCCUPIED;
+}
+
+/**
+ * @brief Place a token on the tile at (x,y), replacing any token
+ * already standing there
+ */
+void
+hnef_packed_board_set_token( HnefPackedBoard *board, int x, int y, HnefToken token ) {
+	uint8_t *tile = &(board->tiles[board->width*y + x]);
+	*tile = (*tile & ~HNEF_PACKED_TOKEN) | hnef_token_serialize(&token);
+}
+
+/**
+ * @brief Remove the token standing on the tile at (x,y), if any
+ */
+void
+hnef_packed_board_unset_token( HnefPackedBoard *board, int x, int y ) {
+	board->tiles[board->width*y + x] &= ~HNEF_PACKED_TOKEN;
+}
+
+/**
+ * @brief Get the rank of the token standing on the tile at (x,y)
+ */
+int
+hnef_packed_board_get_token_rank( HnefPackedBoard *board, int x, int y ) {
+	return (board->tiles[board->width*y + x] & HNEF_PACKED_RANK) != 0;
+}
+
+/**
+ * @brief Get the team of the token standing on the tile at (x,y)
+ */
+int
+hnef_packed_board_get_token_team( HnefPackedBoard *board, int x, int y ) {
+	return (board->tiles[board->width*y + x] & HNEF_PACKED_TEAM) != 0;
+}
@@ -0,0 +1,83 @@
+/* libhnef/packed.h
+ *
+ * Copyright (C) 2016 Gary Munnelly
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+/**
+ * @file libhnef/packed.h
+ *
+ * @brief Macros, typedefs and function forward declarations for the
+ * HnefPackedBoard struct
+ *
+ * @author Gary Munnelly
+ */
+
+#ifndef LIBHNEF_PACKED_H_
+#define LIBHNEF_PACKED_H_
+
+#include <stddef.h>
+#include "board.h"
+
+/* Bit layout of a packed tile. This is the encoding produced by
+ * hnef_tile_serialize */
+#define HNEF_PACKED_OCCUPIED   0x01 /**< Set when a token stands on the tile */
+#define HNEF_PACKED_TEAM       0x02 /**< Team of the token on the tile */
+#define HNEF_PACKED_RANK       0x04 /**< Rank of the token on the tile */
+#define HNEF_PACKED_TOKEN      0x07 /**< All bits describing the token */
+#define HNEF_PACKED_TYPE_SHIFT 3    /**< Offset of the structure code */
+#define HNEF_PACKED_TYPE       0x18 /**< Bits holding the structure code */
+#define HNEF_PACKED_ESCAPE     0x20 /**< Set on escape tiles */
+#define HNEF_PACKED_VALID      0x40 /**< Always set on a serialized tile */
+
+/** Number of bytes needed to hold a packed board of the given size */
+#define HNEF_PACKED_BOARD_SIZE(h, w) ((size_t)(2 + (h)*(w)))
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief A board stored as one byte per tile.
+ *
+ * The memory layout is identical to the buffer written by
+ * hnef_board_serialize: height, width, then the serialized tiles in
+ * row-major order. A packed board is therefore variable in size and
+ * must be backed by at least HNEF_PACKED_BOARD_SIZE(h,w) bytes; an
+ * 11x11 board needs 123 bytes.
+ */
+typedef struct HnefPackedBoard {
+	uint8_t height;       /**< Height of the board */
+	uint8_t width;        /**< Width of the board */
+	uint8_t tiles[];      /**< Serialized tiles, width*height of them */
+} HnefPackedBoard;
+
+size_t       hnef_packed_board_size             ( int h, int w );
+HnefPackedBoard* hnef_packed_board_init         ( HnefPackedBoard *b, int h, int w );
+void         hnef_packed_board_serialize        ( HnefPackedBoard *b, uint8_t *buffer );
+int          hnef_packed_board_deserialize      ( HnefPackedBoard *b, uint8_t *buffer );
+void         hnef_packed_board_from_board       ( HnefPackedBoard *b, HnefBoard *board );
+void         hnef_packed_board_to_board         ( HnefPackedBoard *b, HnefBoard *board );
+
+int          hnef_packed_board_get_height       ( HnefPackedBoard *b );
+int          hnef_packed_board_get_width        ( HnefPackedBoard *b );
+int          hnef_packed_board_get_area         ( HnefPackedBoard *b );
+HnefTile     hnef_packed_board_get_tile         ( HnefPackedBoard *b, int x, int y );
+void         hnef_packed_board_set_tile         ( HnefPackedBoard *b, int x, int y, HnefTile t );
+int          hnef_packed_board_get_tile_type    ( HnefPackedBoard *b, int x, int y );
+void         hnef_packed_board_set_tile_type    ( HnefPackedBoard *b, int x, int y, int type );
+int          hnef_packed_board_get_tile_is_escape ( HnefPackedBoard *b, int x, int y );
+void         hnef_packed_board_set_tile_is_escape ( HnefPackedBoard *b, int x, int y, int is_escape );
+HnefToken    hnef_packed_board_get_token        ( HnefPackedBoard *b, int x, int y );
+int          hnef_packed_board_get_tile_is_occupied ( HnefPackedBoard *b, int x, int y );
+void         hnef_packed_board_set_token        ( HnefPackedBoard *b, int x, int y, HnefToken t );
+void         hnef_packed_board_unset_token      ( HnefPackedBoard *b, int x, int y );
+int          hnef_packed_board_get_token_rank   ( HnefPackedBoard *b, int x, int y );
+int          hnef_packed_board_get_token_team   ( HnefPackedBoard *b, int x, int y );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBHNEF_PACKED_H_ */
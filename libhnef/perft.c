@@ -0,0 +1,560 @@
+/* libhnef/perft.c
+ *
+ * Copyright (C) 2016 Gary Munnelly
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+/**
+ * @file libhnef/perft.c
+ *
+ * @brief Counting the leaves of the move tree
+ *
+ * Perft walks every line of play to a fixed depth and counts the
+ * positions reached. The totals are a fingerprint of the move
+ * generator and of make/unmake, and the time taken to compute them is
+ * a measure of their speed.
+ *
+ * A game ends as soon as one team has won, so a won position has no
+ * children. Moves of the last ply are counted without being made.
+ *
+ * The parallel walk shares out the subtrees rooted split_depth plies
+ * below the root. Each thread owns a deque of tasks, every task being
+ * the line of moves that leads from the root to a subtree. A thread
+ * expands its own tasks depth first from the back of its deque and,
+ * when it runs dry, steals the oldest and so largest task from the
+ * front of another thread's deque. Each thread keeps a single board
+ * and reaches the next task by unmaking moves back to the line the
+ * two tasks share and making the rest, so no board is copied while
+ * walking. Leaf counts are added as integers, which makes the total
+ * independent of the number of threads and of who walked what.
+ *
+ * Below the split, subtree counts may be kept in a cache indexed by
+ * the board's Zobrist key and the remaining depth. Transpositions are
+ * common, so the cache saves a great deal of work in deep walks.
+ *
+ * @author Gary Munnelly
+ */
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "perft.h"
+
+#define HNEF_PERFT_DEPTH_SHIFT 56   /**< Position of the depth in a cache entry */
+#define HNEF_PERFT_COUNT_MASK  ((UINT64_C(1) << HNEF_PERFT_DEPTH_SHIFT) - 1)
+
+/**
+ * @brief A cached subtree count. The depth is kept in the top bits
+ * of data, and check holds the key XOR data so that an entry torn by
+ * two threads writing at once is never mistaken for a hit.
+ */
+typedef struct HnefPerftEntry {
+	_Atomic uint64_t check;       /**< Zobrist key XOR data */
+	_Atomic uint64_t data;        /**< Leaf count and remaining depth */
+} HnefPerftEntry;
+
+/**
+ * @brief Direct mapped cache of subtree counts shared by every thread
+ */
+typedef struct HnefPerftCache {
+	HnefPerftEntry *entries;      /**< The entries, a power of two of them */
+	uint64_t mask;                /**< Number of entries minus one */
+} HnefPerftCache;
+
+/**
+ * @brief A subtree waiting to be walked, named by the line of moves
+ * that leads to it from the root
+ */
+typedef struct HnefPerftTask {
+	HnefMove path[HNEF_PERFT_MAX_SPLIT];  /**< Moves from the root */
+	uint16_t length;              /**< Number of moves in path */
+	uint16_t root;                /**< Index of path[0] among the root moves */
+} HnefPerftTask;
+
+/**
+ * @brief A double ended queue of tasks. The owner pushes and pops at
+ * the tail, thieves take from the head.
+ */
+typedef struct HnefPerftDeque {
+	pthread_mutex_t lock;         /**< Guards every other field */
+	HnefPerftTask *tasks;         /**< Ring buffer of tasks */
+	uint64_t head;                /**< Position of the oldest task */
+	uint64_t tail;                /**< Position one past the newest task */
+	uint64_t capacity;            /**< Number of tasks the ring can hold */
+} HnefPerftDeque;
+
+struct HnefPerftThread;
+
+/**
+ * @brief State shared between every thread of one walk
+ */
+typedef struct HnefPerftShared {
+	const HnefRays *rays;         /**< Ray table for the root's size */
+	int depth;                    /**< Length of the lines being counted */
+	int split;                    /**< Plies below the root that become tasks */
+	int threads;                  /**< Number of threads */
+	HnefPerftCache cache;         /**< Subtree cache, entries NULL if none */
+	struct HnefPerftThread **workers; /**< Every thread's private state */
+	atomic_uint_fast64_t pending; /**< Tasks queued or being walked */
+} HnefPerftShared;
+
+/**
+ * @brief Private state of one thread of the walk
+ */
+typedef struct HnefPerftThread {
+	HnefPerftShared *shared;      /**< State shared with the other threads */
+	int id;                       /**< Index of the thread, 0 for the caller */
+	pthread_t handle;             /**< Thread handle for helpers */
+	int started;                  /**< True if handle refers to a running thread */
+	HnefBoard board;              /**< The thread's own copy of the position */
+	HnefUndo undo[HNEF_PERFT_MAX_DEPTH];  /**< Storage for stack */
+	HnefUndoStack stack;          /**< Moves made on board since the root */
+	HnefPerftDeque deque;         /**< Tasks owned by this thread */
+	HnefMove moves[HNEF_MAX_MOVES];       /**< Scratch space for expanding tasks */
+	uint64_t nodes;               /**< Leaves counted by this thread */
+	uint64_t tasks;               /**< Tasks walked by this thread */
+	uint64_t steals;              /**< Tasks taken from other threads */
+	uint64_t cache_hits;          /**< Subtrees answered by the cache */
+	uint64_t divide[HNEF_MAX_MOVES];      /**< Leaves counted below each root move */
+} HnefPerftThread;
+
+/**
+ * @brief Look up the leaf count of a subtree in the cache
+ *
+ * @return True if the count was found
+ */
+static int
+hnef_perft_cache_probe( HnefPerftCache *cache, uint64_t key, int depth, uint64_t *nodes ) {
+	HnefPerftEntry *e = &(cache->entries[key & cache->mask]);
+	uint64_t data, check;
+
+	data = atomic_load_explicit(&(e->data), memory_order_relaxed);
+	check = atomic_load_explicit(&(e->check), memory_order_relaxed);
+	if((check ^ data) != key || (int)(data >> HNEF_PERFT_DEPTH_SHIFT) != depth) {
+		return 0;
+	}
+	*nodes = data & HNEF_PERFT_COUNT_MASK;
+	return 1;
+}
+
+/**
+ * @brief Record the leaf count of a subtree in the cache, replacing
+ * whatever shared its slot
+ */
+static void
+hnef_perft_cache_store( HnefPerftCache *cache, uint64_t key, int depth, uint64_t nodes ) {
+	HnefPerftEntry *e = &(cache->entries[key & cache->mask]);
+	uint64_t data;
+
+	if(nodes > HNEF_PERFT_COUNT_MASK) {
+		return;
+	}
+	data = nodes | ((uint64_t)depth << HNEF_PERFT_DEPTH_SHIFT);
+	atomic_store_explicit(&(e->data), data, memory_order_relaxed);
+	atomic_store_explicit(&(e->check), key ^ data, memory_order_relaxed);
+}
+
+/**
+ * @brief Count the leaves below the current position
+ *
+ * @param board The position, which is restored before returning
+ *
+ * @param rays Ray table for the board's size
+ *
+ * @param depth Remaining plies, at least 1
+ *
+ * @param stack Undo stack shared by the whole walk
+ *
+ * @param cache Subtree cache, or NULL for none
+ *
+ * @param hits Incremented for every subtree answered by the cache
+ *
+ * @return The number of leaves
+ */
+static uint64_t
+hnef_perft_walk( HnefBoard *board, const HnefRays *rays, int depth, HnefUndoStack *stack,
+                 HnefPerftCache *cache, uint64_t *hits ) {
+	HnefMove moves[HNEF_MAX_MOVES];
+	uint64_t nodes;
+	int i, n;
+
+	if(hnef_board_get_winner(board) != HNEF_NO_WINNER) {
+		return 0;
+	}
+
+	n = hnef_board_generate_moves(board, rays, hnef_board_get_turn(board), moves, HNEF_MAX_MOVES);
+	if(depth == 1) {
+		return (uint64_t)n;
+	}
+	if(cache && hnef_perft_cache_probe(cache, board->key, depth, &nodes)) {
+		(*hits)++;
+		return nodes;
+	}
+
+	nodes = 0;
+	for( i=0; i<n; i++ ) {
+		hnef_board_make_move(board, moves[i], stack);
+		nodes += hnef_perft_walk(board, rays, depth-1, stack, cache, hits);
+		hnef_board_unmake_move(board, stack);
+	}
+
+	if(cache) {
+		hnef_perft_cache_store(cache, board->key, depth, nodes);
+	}
+	return nodes;
+}
+
+/**
+ * @brief Count the positions reached by every line of play of a given
+ * length, starting with the team whose turn it is
+ *
+ * @param board The starting position. It is used as scratch space and
+ * is restored before returning
+ *
+ * @param rays Ray table for the board's size
+ *
+ * @param depth Number of plies to play, from 0 to HNEF_PERFT_MAX_DEPTH
+ *
+ * @return The number of positions, or 0 if depth is out of range
+ */
+uint64_t
+hnef_perft( HnefBoard *board, const HnefRays *rays, int depth ) {
+	HnefUndo records[HNEF_PERFT_MAX_DEPTH];
+	HnefUndoStack stack;
+
+	if(depth < 0 || depth > HNEF_PERFT_MAX_DEPTH) {
+		return 0;
+	}
+	if(depth == 0) {
+		return 1;
+	}
+
+	hnef_undo_stack_init(&stack, records, HNEF_PERFT_MAX_DEPTH);
+	return hnef_perft_walk(board, rays, depth, &stack, NULL, NULL);
+}
+
+/**
+ * @brief Take the newest task from the thread's own deque
+ */
+static int
+hnef_perft_deque_pop( HnefPerftDeque *q, HnefPerftTask *task ) {
+	int found;
+
+	pthread_mutex_lock(&(q->lock));
+	found = q->tail != q->head;
+	if(found) {
+		q->tail--;
+		*task = q->tasks[q->tail % q->capacity];
+	}
+	pthread_mutex_unlock(&(q->lock));
+	return found;
+}
+
+/**
+ * @brief Take the oldest task from another thread's deque
+ */
+static int
+hnef_perft_deque_steal( HnefPerftDeque *q, HnefPerftTask *task ) {
+	int found;
+
+	pthread_mutex_lock(&(q->lock));
+	found = q->tail != q->head;
+	if(found) {
+		*task = q->tasks[q->head % q->capacity];
+		q->head++;
+	}
+	pthread_mutex_unlock(&(q->lock));
+	return found;
+}
+
+/**
+ * @brief Walk the board from the line it is on to the line of a task,
+ * unmaking only the moves the two lines do not share
+ */
+static void
+hnef_perft_goto( HnefPerftThread *t, const HnefPerftTask *task ) {
+	HnefUndoStack *stack = &(t->stack);
+	int i, k;
+
+	k = 0;
+	while( k < stack->size && k < task->length &&
+	       stack->records[k].move.from == task->path[k].from &&
+	       stack->records[k].move.to == task->path[k].to ) {
+		k++;
+	}
+	while( stack->size > k ) {
+		hnef_board_unmake_move(&(t->board), stack);
+	}
+	for( i=k; i<task->length; i++ ) {
+		hnef_board_make_move(&(t->board), task->path[i], stack);
+	}
+}
+
+/**
+ * @brief Walk one task. Above the split the task is replaced by one
+ * task per move, pushed to the thread's own deque; at the split its
+ * subtree is walked by this thread alone.
+ */
+static void
+hnef_perft_run( HnefPerftThread *t, const HnefPerftTask *task ) {
+	HnefPerftShared *shared = t->shared;
+	HnefPerftDeque *q = &(t->deque);
+	HnefPerftTask *child;
+	uint64_t nodes;
+	int i, n, remaining;
+
+	t->tasks++;
+	hnef_perft_goto(t, task);
+	remaining = shared->depth - task->length;
+
+	if(remaining > 0 && task->length < shared->split) {
+		n = 0;
+		if(hnef_board_get_winner(&(t->board)) == HNEF_NO_WINNER) {
+			n = hnef_board_generate_moves(&(t->board), shared->rays,
+				hnef_board_get_turn(&(t->board)), t->moves, HNEF_MAX_MOVES);
+		}
+		atomic_fetch_add(&(shared->pending), (uint64_t)n);
+
+		pthread_mutex_lock(&(q->lock));
+		for( i=0; i<n; i++ ) {
+			child = &(q->tasks[q->tail % q->capacity]);
+			*child = *task;
+			child->path[task->length] = t->moves[i];
+			child->length = task->length + 1;
+			if(task->length == 0) {
+				child->root = (uint16_t)i;
+			}
+			q->tail++;
+		}
+		pthread_mutex_unlock(&(q->lock));
+		return;
+	}
+
+	if(remaining == 0) {
+		nodes = 1;
+	} else {
+		nodes = hnef_perft_walk(&(t->board), shared->rays, remaining, &(t->stack),
+			shared->cache.entries? &(shared->cache) : NULL, &(t->cache_hits));
+	}
+	t->nodes += nodes;
+	if(task->length > 0) {
+		t->divide[task->root] += nodes;
+	}
+}
+
+/**
+ * @brief Main loop of every thread. Tasks are taken from the thread's
+ * own deque first and stolen from the others when it is empty, until
+ * no task is queued or being walked anywhere.
+ */
+static void*
+hnef_perft_worker( void *arg ) {
+	HnefPerftThread *t = arg;
+	HnefPerftShared *shared = t->shared;
+	HnefPerftTask task;
+	int i, found;
+
+	for(;;) {
+		found = hnef_perft_deque_pop(&(t->deque), &task);
+		for( i=1; !found && i<shared->threads; i++ ) {
+			found = hnef_perft_deque_steal(
+				&(shared->workers[(t->id + i) % shared->threads]->deque), &task);
+			t->steals += found;
+		}
+
+		if(found) {
+			hnef_perft_run(t, &task);
+			atomic_fetch_sub(&(shared->pending), 1);
+		} else if(atomic_load(&(shared->pending)) == 0) {
+			break;
+		} else {
+			sched_yield();
+		}
+	}
+	return NULL;
+}
+
+/**
+ * @brief Allocate and prepare the private state of one thread
+ */
+static HnefPerftThread*
+hnef_perft_thread_new( HnefPerftShared *shared, HnefBoard *root, int id ) {
+	HnefPerftThread *t;
+
+	t = calloc(1, sizeof(HnefPerftThread));
+	if(!t) {
+		return NULL;
+	}
+
+	/* Depth first expansion leaves fewer than HNEF_MAX_MOVES siblings
+	 * behind at each of the split plies */
+	t->deque.capacity = (uint64_t)shared->split*HNEF_MAX_MOVES + 1;
+	t->deque.tasks = malloc(t->deque.capacity*sizeof(HnefPerftTask));
+	if(!t->deque.tasks) {
+		free(t);
+		return NULL;
+	}
+	pthread_mutex_init(&(t->deque.lock), NULL);
+
+	t->shared = shared;
+	t->id = id;
+	hnef_board_copy(&(t->board), root);
+	hnef_undo_stack_init(&(t->stack), t->undo, HNEF_PERFT_MAX_DEPTH);
+	return t;
+}
+
+/**
+ * @brief Release the private state of one thread
+ */
+static void
+hnef_perft_thread_free( HnefPerftThread *t ) {
+	if(t) {
+		pthread_mutex_destroy(&(t->deque.lock));
+		free(t->deque.tasks);
+		free(t);
+	}
+}
+
+/**
+ * @brief Fill a set of walk options with their defaults: a single
+ * thread, work shared two plies below the root and no cache
+ *
+ * @param options The options to be initialized
+ */
+void
+hnef_perft_options_init( HnefPerftOptions *options ) {
+	options->threads = 1;
+	options->split_depth = 2;
+	options->cache_megabytes = 0;
+	options->divide = NULL;
+}
+
+/**
+ * @brief Count the positions reached by every line of play of a given
+ * length using several threads. The calling thread takes part in the
+ * walk. The count is the same as that of hnef_perft whatever the
+ * number of threads.
+ *
+ * @param board The starting position. It is not modified
+ *
+ * @param rays Ray table for the board's size
+ *
+ * @param depth Number of plies to play, from 0 to HNEF_PERFT_MAX_DEPTH
+ *
+ * @param options Settings of the walk
+ *
+ * @param stats Receives the count and statistics of the walk
+ *
+ * @return True on success, false if depth is out of range or memory
+ * could not be allocated
+ */
+int
+hnef_perft_parallel( HnefBoard *board, const HnefRays *rays, int depth,
+                     const HnefPerftOptions *options, HnefPerftStats *stats ) {
+	HnefPerftShared shared;
+	HnefPerftThread *workers[HNEF_PERFT_MAX_THREADS];
+	HnefPerftThread *t;
+	struct timespec start, end;
+	uint64_t entries;
+	int i, j, n, ok;
+
+	memset(stats, 0, sizeof(HnefPerftStats));
+	if(depth < 0 || depth > HNEF_PERFT_MAX_DEPTH) {
+		return 0;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	n = options->threads;
+	if(n < 1) {
+		n = 1;
+	} else if(n > HNEF_PERFT_MAX_THREADS) {
+		n = HNEF_PERFT_MAX_THREADS;
+	}
+
+	/* Dividing needs the root moves to be tasks of their own */
+	shared.split = options->split_depth;
+	if(options->divide && shared.split < 1) {
+		shared.split = 1;
+	}
+	if(shared.split > HNEF_PERFT_MAX_SPLIT) {
+		shared.split = HNEF_PERFT_MAX_SPLIT;
+	}
+	if(shared.split > depth) {
+		shared.split = depth;
+	}
+	if(shared.split < 0) {
+		shared.split = 0;
+	}
+
+	shared.rays = rays;
+	shared.depth = depth;
+	shared.threads = n;
+	shared.workers = workers;
+	shared.cache.entries = NULL;
+	shared.cache.mask = 0;
+	atomic_init(&(shared.pending), 1);
+
+	if(options->cache_megabytes > 0) {
+		entries = 1;
+		while( entries*2*sizeof(HnefPerftEntry) <= (uint64_t)options->cache_megabytes << 20 ) {
+			entries *= 2;
+		}
+		shared.cache.entries = calloc(entries, sizeof(HnefPerftEntry));
+		if(!shared.cache.entries) {
+			return 0;
+		}
+		shared.cache.mask = entries - 1;
+	}
+
+	ok = 1;
+	for( i=0; i<n; i++ ) {
+		workers[i] = hnef_perft_thread_new(&shared, board, i);
+		ok = ok && workers[i];
+	}
+	if(!ok) {
+		for( i=0; i<n; i++ ) {
+			hnef_perft_thread_free(workers[i]);
+		}
+		free(shared.cache.entries);
+		return 0;
+	}
+
+	/* The root is the first task of the calling thread */
+	memset(&(workers[0]->deque.tasks[0]), 0, sizeof(HnefPerftTask));
+	workers[0]->deque.tail = 1;
+
+	for( i=1; i<n; i++ ) {
+		workers[i]->started = !pthread_create(&(workers[i]->handle), NULL,
+			hnef_perft_worker, workers[i]);
+	}
+	hnef_perft_worker(workers[0]);
+	for( i=1; i<n; i++ ) {
+		if(workers[i]->started) {
+			pthread_join(workers[i]->handle, NULL);
+		}
+	}
+
+	if(options->divide) {
+		memset(options->divide, 0, HNEF_MAX_MOVES*sizeof(uint64_t));
+	}
+	for( i=0; i<n; i++ ) {
+		t = workers[i];
+		stats->nodes += t->nodes;
+		stats->tasks += t->tasks;
+		stats->steals += t->steals;
+		stats->cache_hits += t->cache_hits;
+		for( j=0; options->divide && j<HNEF_MAX_MOVES; j++ ) {
+			options->divide[j] += t->divide[j];
+		}
+		hnef_perft_thread_free(t);
+	}
+	free(shared.cache.entries);
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	stats->milliseconds = (int)((end.tv_sec - start.tv_sec)*1000
+		+ (end.tv_nsec - start.tv_nsec)/1000000);
+	return 1;
+}
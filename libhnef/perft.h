@@ -0,0 +1,62 @@
+/* libhnef/perft.h
+ *
+ * Copyright (C) 2016 Gary Munnelly
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+/**
+ * @file libhnef/perft.h
+ *
+ * @brief Macros, typedefs and function forward declarations for
+ * counting the leaves of the move tree
+ *
+ * @author Gary Munnelly
+ */
+
+#ifndef LIBHNEF_PERFT_H_
+#define LIBHNEF_PERFT_H_
+
+#include <stdint.h>
+#include "move.h"
+
+#define HNEF_PERFT_MAX_DEPTH   32   /**< Deepest tree hnef_perft will walk */
+#define HNEF_PERFT_MAX_SPLIT   8    /**< Deepest ply at which work is shared */
+#define HNEF_PERFT_MAX_THREADS 256  /**< Most threads a parallel walk may use */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Settings of a parallel tree walk
+ */
+typedef struct HnefPerftOptions {
+	int threads;              /**< Number of threads, including the caller's */
+	int split_depth;          /**< Plies below the root that are shared out */
+	int cache_megabytes;      /**< Size of the subtree cache, or 0 for none */
+	uint64_t *divide;         /**< If not NULL, receives the count below each
+	                               root move in generation order. Must hold
+	                               HNEF_MAX_MOVES entries */
+} HnefPerftOptions;
+
+/**
+ * @brief Statistics of one parallel tree walk
+ */
+typedef struct HnefPerftStats {
+	uint64_t nodes;           /**< Leaf count of the tree */
+	uint64_t tasks;           /**< Subtrees handed out as units of work */
+	uint64_t steals;          /**< Subtrees taken from another thread */
+	uint64_t cache_hits;      /**< Subtrees answered by the cache */
+	int milliseconds;         /**< Wall clock time taken */
+} HnefPerftStats;
+
+uint64_t     hnef_perft                    ( HnefBoard *b, const HnefRays *rays, int depth );
+void         hnef_perft_options_init       ( HnefPerftOptions *options );
+int          hnef_perft_parallel           ( HnefBoard *b, const HnefRays *rays, int depth, const HnefPerftOptions *options, HnefPerftStats *stats );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBHNEF_PERFT_H_ */
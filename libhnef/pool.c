@@ -0,0 +1,350 @@
+/* libhnef/pool.c
+ *
+ * Copyright (C) 2016 Gary Munnelly
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+/**
+ * @file libhnef/pool.c
+ *
+ * @brief Code for allocating boards from pools and arenas
+ *
+ * A HnefBoard is around 20 KB, most of it tiles, so code which makes
+ * and drops boards at a high rate spends its time in malloc and free.
+ * A pool keeps the boards it is given back on a free list threaded
+ * through the boards themselves, and an arena hands out a fixed block
+ * of boards in order. Both initialize each board with hnef_board_init
+ * as it is handed out, exactly as hnef_board_new does.
+ *
+ * @author Gary Munnelly
+ */
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pool.h"
+
+static pthread_key_t hnef_board_pool_key;          /**< Each thread's pool */
+static pthread_once_t hnef_board_pool_once = PTHREAD_ONCE_INIT;
+static int hnef_board_pool_key_ok;                 /**< Set if the key was created */
+
+/**
+ * @brief Determine whether or not boards of a size may be made
+ */
+static int
+hnef_board_pool_size_ok( int height, int width ) {
+	return height >= 1 && width >= 1 && height <= MAX_HEIGHT && width <= MAX_WIDTH;
+}
+
+/**
+ * @brief Note that a board has been handed out
+ */
+static void
+hnef_board_pool_count( HnefBoardPoolStats *stats ) {
+	stats->live++;
+	if(stats->live > stats->peak) {
+		stats->peak = stats->live;
+	}
+}
+
+/**
+ * @brief Put a board on a pool's free list. The board's contents are
+ * dead, so its first bytes hold the link.
+ */
+static void
+hnef_board_pool_push( HnefBoardPool *p, HnefBoard *board ) {
+	memcpy(board, &(p->free), sizeof(void*));
+	p->free = board;
+}
+
+/**
+ * @brief Initialize an empty pool
+ *
+ * @param p The pool to be initialized
+ *
+ * @param limit The most boards which may be live at once, or 0 for no
+ * limit
+ */
+void
+hnef_board_pool_init( HnefBoardPool *p, size_t limit ) {
+	memset(p, 0, sizeof(HnefBoardPool));
+	p->limit = limit;
+}
+
+/**
+ * @brief Release every slab of a pool. Boards still live become
+ * invalid.
+ *
+ * @param p The pool to be released
+ */
+void
+hnef_board_pool_free( HnefBoardPool *p ) {
+	HnefBoardSlab *slab;
+
+	while( p->slabs ) {
+		slab = p->slabs;
+		p->slabs = slab->next;
+		free(slab);
+	}
+	p->free = NULL;
+	p->stats.live = 0;
+	p->stats.bytes = 0;
+}
+
+/**
+ * @brief Take a board from a pool, allocating another slab if none is
+ * free, and initialize it with blank, empty tiles
+ *
+ * @param p The pool
+ *
+ * @param height The height of the game board
+ *
+ * @param width The width of the game board
+ *
+ * @return The board, to be given back with hnef_board_pool_release,
+ * or NULL if the size is out of range, the pool's limit is reached or
+ * memory could not be allocated
+ */
+HnefBoard*
+hnef_board_pool_acquire( HnefBoardPool *p, int height, int width ) {
+	HnefBoardSlab *slab;
+	HnefBoard *board;
+	int i;
+
+	if(!hnef_board_pool_size_ok(height, width) || (p->limit && p->stats.live >= p->limit)) {
+		return NULL;
+	}
+
+	if(!p->free) {
+		slab = malloc(sizeof(HnefBoardSlab));
+		if(!slab) {
+			return NULL;
+		}
+		slab->next = p->slabs;
+		p->slabs = slab;
+		p->stats.bytes += sizeof(HnefBoardSlab);
+		for( i=HNEF_BOARD_POOL_SLAB-1; i>=0; i-- ) {
+			hnef_board_pool_push(p, &(slab->boards[i]));
+		}
+	}
+
+	board = p->free;
+	memcpy(&(p->free), board, sizeof(void*));
+	hnef_board_pool_count(&(p->stats));
+	return hnef_board_init(board, height, width);
+}
+
+/**
+ * @brief Give a board back to the pool it was taken from. Releasing a
+ * board twice, or one taken before the pool was last reset, is
+ * undefined.
+ *
+ * @param p The pool
+ *
+ * @param board The board, which may be NULL
+ */
+void
+hnef_board_pool_release( HnefBoardPool *p, HnefBoard *board ) {
+	if(!board) {
+		return;
+	}
+	hnef_board_pool_push(p, board);
+	p->stats.live--;
+}
+
+/**
+ * @brief Give back every board of a pool at once. Boards still live
+ * become invalid and must not be released afterwards, but the slabs
+ * are kept for reuse.
+ *
+ * @param p The pool
+ */
+void
+hnef_board_pool_reset( HnefBoardPool *p ) {
+	HnefBoardSlab *slab;
+	int i;
+
+	p->free = NULL;
+	for( slab=p->slabs; slab; slab=slab->next ) {
+		for( i=HNEF_BOARD_POOL_SLAB-1; i>=0; i-- ) {
+			hnef_board_pool_push(p, &(slab->boards[i]));
+		}
+	}
+	p->stats.live = 0;
+}
+
+/**
+ * @brief Give the memory of a pool back to the system if none of its
+ * boards are live. A pool which has served a burst of load may be
+ * trimmed once the burst has passed.
+ *
+ * @param p The pool
+ */
+void
+hnef_board_pool_trim( HnefBoardPool *p ) {
+	if(p->stats.live == 0) {
+		hnef_board_pool_free(p);
+	}
+}
+
+/**
+ * @brief Get the memory use of a pool
+ *
+ * @param p The pool
+ *
+ * @param stats Set to the pool's live and peak boards and bytes held
+ */
+void
+hnef_board_pool_get_stats( const HnefBoardPool *p, HnefBoardPoolStats *stats ) {
+	*stats = p->stats;
+}
+
+/**
+ * @brief Release the pool of a thread which is exiting
+ */
+static void
+hnef_board_pool_destroy( void *pool ) {
+	hnef_board_pool_free(pool);
+	free(pool);
+}
+
+/**
+ * @brief Create the key under which each thread's pool is kept
+ */
+static void
+hnef_board_pool_create_key( void ) {
+	hnef_board_pool_key_ok = !pthread_key_create(&hnef_board_pool_key, hnef_board_pool_destroy);
+}
+
+/**
+ * @brief Get the calling thread's own pool, which has no limit. It is
+ * created on first use and freed when the thread exits, so boards
+ * taken from it must not outlive their thread or be handed to
+ * another thread which might.
+ *
+ * @return The pool, or NULL if it could not be created
+ */
+HnefBoardPool*
+hnef_board_pool_local( void ) {
+	HnefBoardPool *p;
+
+	pthread_once(&hnef_board_pool_once, hnef_board_pool_create_key);
+	if(!hnef_board_pool_key_ok) {
+		return NULL;
+	}
+
+	p = pthread_getspecific(hnef_board_pool_key);
+	if(!p) {
+		p = malloc(sizeof(HnefBoardPool));
+		if(!p) {
+			return NULL;
+		}
+		hnef_board_pool_init(p, 0);
+		if(pthread_setspecific(hnef_board_pool_key, p)) {
+			free(p);
+			return NULL;
+		}
+	}
+	return p;
+}
+
+/**
+ * @brief Allocate an arena
+ *
+ * @param a The arena to be initialized
+ *
+ * @param capacity The number of boards the arena holds
+ *
+ * @return True on success, false if memory could not be allocated
+ */
+int
+hnef_board_arena_init( HnefBoardArena *a, size_t capacity ) {
+	memset(a, 0, sizeof(HnefBoardArena));
+	if(capacity) {
+		a->boards = malloc(capacity*sizeof(HnefBoard));
+		if(!a->boards) {
+			return 0;
+		}
+	}
+	a->capacity = capacity;
+	a->stats.bytes = capacity*sizeof(HnefBoard);
+	return 1;
+}
+
+/**
+ * @brief Release the memory of an arena. Its boards become invalid.
+ *
+ * @param a The arena to be released
+ */
+void
+hnef_board_arena_free( HnefBoardArena *a ) {
+	free(a->boards);
+	memset(a, 0, sizeof(HnefBoardArena));
+}
+
+/**
+ * @brief Take the next board of an arena and initialize it with blank,
+ * empty tiles
+ *
+ * @param a The arena
+ *
+ * @param height The height of the game board
+ *
+ * @param width The width of the game board
+ *
+ * @return The board, which lives until the arena is reset to a mark
+ * taken before it, or NULL if the size is out of range or the arena is
+ * full
+ */
+HnefBoard*
+hnef_board_arena_alloc( HnefBoardArena *a, int height, int width ) {
+	HnefBoard *board;
+
+	if(!hnef_board_pool_size_ok(height, width) || a->stats.live == a->capacity) {
+		return NULL;
+	}
+	board = &(a->boards[a->stats.live]);
+	hnef_board_pool_count(&(a->stats));
+	return hnef_board_init(board, height, width);
+}
+
+/**
+ * @brief Note how far an arena has been used, so that the boards
+ * taken after this point can be given back together
+ *
+ * @param a The arena
+ *
+ * @return A mark for hnef_board_arena_reset
+ */
+size_t
+hnef_board_arena_mark( const HnefBoardArena *a ) {
+	return a->stats.live;
+}
+
+/**
+ * @brief Give back every board taken from an arena since a mark was
+ * taken. A mark of 0 gives back every board.
+ *
+ * @param a The arena
+ *
+ * @param mark A mark from hnef_board_arena_mark, or 0
+ */
+void
+hnef_board_arena_reset( HnefBoardArena *a, size_t mark ) {
+	if(mark < a->stats.live) {
+		a->stats.live = mark;
+	}
+}
+
+/**
+ * @brief Get the memory use of an arena
+ *
+ * @param a The arena
+ *
+ * @param stats Set to the arena's boards in use, the most ever in use
+ * and its bytes
+ */
+void
+hnef_board_arena_get_stats( const HnefBoardArena *a, HnefBoardPoolStats *stats ) {
+	*stats = a->stats;
+}
@@ -0,0 +1,90 @@
+/* libhnef/pool.h
+ *
+ * Copyright (C) 2016 Gary Munnelly
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+/**
+ * @file libhnef/pool.h
+ *
+ * @brief Macros, typedefs and function forward declarations for board
+ * pools and arenas
+ *
+ * @author Gary Munnelly
+ */
+
+#ifndef LIBHNEF_POOL_H_
+#define LIBHNEF_POOL_H_
+
+#include <stddef.h>
+#include "board.h"
+
+#define HNEF_BOARD_POOL_SLAB 16   /**< Boards allocated by a pool at once */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Memory use of a pool or arena
+ */
+typedef struct HnefBoardPoolStats {
+	size_t live;              /**< Boards handed out and not yet returned */
+	size_t peak;              /**< Most boards live at once */
+	size_t bytes;             /**< Bytes held, including free boards */
+} HnefBoardPoolStats;
+
+/**
+ * @brief A block of boards allocated by a pool
+ */
+typedef struct HnefBoardSlab {
+	struct HnefBoardSlab *next; /**< Slab allocated before this one */
+	HnefBoard boards[HNEF_BOARD_POOL_SLAB]; /**< The boards */
+} HnefBoardSlab;
+
+/**
+ * @brief A free list of boards, which grows a slab at a time and only
+ * gives memory back when freed. A pool has no lock and belongs to one
+ * thread; hnef_board_pool_local gives each thread its own, whose
+ * boards are freed with it when the thread exits.
+ */
+typedef struct HnefBoardPool {
+	HnefBoardSlab *slabs;     /**< Every slab, newest first */
+	void *free;               /**< Free boards, linked through their first bytes */
+	size_t limit;             /**< Most boards live at once, or 0 for no limit */
+	HnefBoardPoolStats stats; /**< Memory use */
+} HnefBoardPool;
+
+/**
+ * @brief A fixed block of boards handed out in order and taken back
+ * all at once, for scratch boards whose lifetimes end together such
+ * as those of a search
+ */
+typedef struct HnefBoardArena {
+	HnefBoard *boards;        /**< The block */
+	size_t capacity;          /**< Boards in the block */
+	HnefBoardPoolStats stats; /**< Memory use, where live is the boards used */
+} HnefBoardArena;
+
+void         hnef_board_pool_init          ( HnefBoardPool *p, size_t limit );
+void         hnef_board_pool_free          ( HnefBoardPool *p );
+HnefBoard*   hnef_board_pool_acquire       ( HnefBoardPool *p, int h, int w );
+void         hnef_board_pool_release       ( HnefBoardPool *p, HnefBoard *b );
+void         hnef_board_pool_reset         ( HnefBoardPool *p );
+void         hnef_board_pool_trim          ( HnefBoardPool *p );
+void         hnef_board_pool_get_stats     ( const HnefBoardPool *p, HnefBoardPoolStats *stats );
+HnefBoardPool* hnef_board_pool_local       ( void );
+
+int          hnef_board_arena_init         ( HnefBoardArena *a, size_t capacity );
+void         hnef_board_arena_free         ( HnefBoardArena *a );
+HnefBoard*   hnef_board_arena_alloc        ( HnefBoardArena *a, int h, int w );
+size_t       hnef_board_arena_mark         ( const HnefBoardArena *a );
+void         hnef_board_arena_reset        ( HnefBoardArena *a, size_t mark );
+void         hnef_board_arena_get_stats    ( const HnefBoardArena *a, HnefBoardPoolStats *stats );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBHNEF_POOL_H_ */
@@ -0,0 +1,384 @@
+/* libhnef/posdb.c
+ *
+ * Copyright (C) 2016 Gary Munnelly
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+/**
+ * @file libhnef/posdb.c
+ *
+ * @brief Code for writing and reading memory mapped position databases
+ *
+ * A database file is little endian and laid out as a header of
+ * HNEF_POSDB_HEADER bytes, the records, then the index. Each record
+ * is
+ *
+ *     0   key
+ *     8   score, 32 bits
+ *     12  depth, 16 bits
+ *     14  bound
+ *     15  side to move
+ *     16  best move, from and to, 16 bits each
+ *     20  reserved
+ *     24  the position as written by hnef_board_serialize
+ *
+ * padded to a multiple of eight bytes. The index holds a power of two
+ * number of 32 bit slots, at least twice the number of records. A
+ * slot holds a record number plus one, or 0 if it is empty, and a key
+ * is looked for by linear probing from the slot its low bits select.
+ * Keys are Zobrist hashes, so their low bits need no further mixing.
+ *
+ * @author Gary Munnelly
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include "image.h"
+#include "posdb.h"
+
+#define HNEF_POSDB_MAGIC   "HNEFPDB\n" /**< First bytes of a database file */
+#define HNEF_POSDB_VERSION 1          /**< Version of the file format */
+#define HNEF_POSDB_HEADER  64         /**< Bytes before the first record */
+#define HNEF_POSDB_FIELDS  24         /**< Bytes of a record before the position */
+
+/**
+ * @brief Bytes per record for positions of the given size
+ */
+static size_t
+hnef_posdb_record_size( int height, int width ) {
+	return (HNEF_POSDB_FIELDS + 2 + (size_t)height*width + 7) & ~(size_t)7;
+}
+
+/**
+ * @brief Start writing a database of positions of one board size
+ *
+ * @param w The writer to be initialized
+ *
+ * @param path The file to be written. It is replaced if it exists
+ *
+ * @param height Height of every position to be added
+ *
+ * @param width Width of every position to be added
+ *
+ * @return True on success, false if the size is out of range or the
+ * file could not be created
+ */
+int
+hnef_posdb_writer_open( HnefPosDBWriter *w, const char *path, int height, int width ) {
+	uint8_t header[HNEF_POSDB_HEADER];
+
+	memset(w, 0, sizeof(HnefPosDBWriter));
+	if(height < 1 || height > MAX_HEIGHT || width < 1 || width > MAX_WIDTH) {
+		return 0;
+	}
+	w->height = height;
+	w->width = width;
+	w->record_size = hnef_posdb_record_size(height, width);
+	w->buffer = calloc(1, w->record_size);
+	if(!w->buffer) {
+		return 0;
+	}
+	w->file = fopen(path, "wb");
+	if(!w->file) {
+		free(w->buffer);
+		w->buffer = NULL;
+		return 0;
+	}
+
+	/* The header is rewritten once the index is known */
+	memset(header, 0, sizeof(header));
+	w->failed = fwrite(header, 1, sizeof(header), w->file) != sizeof(header);
+	return 1;
+}
+
+/**
+ * @brief Append a position to a database. A position added twice is
+ * found with the entry it was given last.
+ *
+ * @param w The writer
+ *
+ * @param b The position, which must have the writer's size
+ *
+ * @param entry What is known about the position
+ *
+ * @return True on success, false if the position has the wrong size,
+ * the database is full or the record could not be written
+ */
+int
+hnef_posdb_writer_add( HnefPosDBWriter *w, HnefBoard *b, const HnefPosDBEntry *entry ) {
+	uint64_t *keys, capacity;
+	uint8_t *p;
+
+	if(!w->file || w->failed || b->height != w->height || b->width != w->width ||
+	   w->count >= HNEF_POSDB_MAX_RECORDS) {
+		return 0;
+	}
+	if(w->count == w->capacity) {
+		capacity = w->capacity? w->capacity*2 : 1024;
+		keys = realloc(w->keys, capacity*sizeof(uint64_t));
+		if(!keys) {
+			return 0;
+		}
+		w->keys = keys;
+		w->capacity = capacity;
+	}
+
+	p = w->buffer;
+	hnef_image_put64(p, b->key);
+	hnef_image_put32(p + 8, (uint32_t)entry->score);
+	p[12] = (uint8_t)entry->depth;
+	p[13] = (uint8_t)(entry->depth >> 8);
+	p[14] = (uint8_t)entry->bound;
+	p[15] = (uint8_t)b->turn;
+	hnef_image_put32(p + 16, entry->move.from | ((uint32_t)entry->move.to << 16));
+	hnef_board_serialize(b, p + HNEF_POSDB_FIELDS);
+	if(fwrite(p, 1, w->record_size, w->file) != w->record_size) {
+		w->failed = 1;
+		return 0;
+	}
+	w->keys[w->count++] = b->key;
+	return 1;
+}
+
+/**
+ * @brief Write the index and header of a database and close its file.
+ * The writer's memory is released whether or not this succeeds.
+ *
+ * @param w The writer
+ *
+ * @return True if every record, the index and the header were written
+ */
+int
+hnef_posdb_writer_close( HnefPosDBWriter *w ) {
+	uint8_t header[HNEF_POSDB_HEADER];
+	uint32_t *slots;
+	uint64_t size, mask, r, i;
+	int ok;
+
+	if(!w->file) {
+		return 0;
+	}
+	size = 16;
+	while( size < 2*w->count ) {
+		size *= 2;
+	}
+	mask = size - 1;
+
+	/* Later records of a key take the slot of earlier ones */
+	ok = !w->failed;
+	slots = ok? calloc(size, sizeof(uint32_t)) : NULL;
+	ok = ok && slots;
+	for( r=0; ok && r<w->count; r++ ) {
+		i = w->keys[r] & mask;
+		while( slots[i] && w->keys[slots[i] - 1] != w->keys[r] ) {
+			i = (i + 1) & mask;
+		}
+		slots[i] = (uint32_t)(r + 1);
+	}
+	for( i=0; ok && i<size; i++ ) {
+		hnef_image_put32((uint8_t*)&slots[i], slots[i]);
+	}
+	ok = ok && fwrite(slots, sizeof(uint32_t), size, w->file) == size;
+
+	memset(header, 0, sizeof(header));
+	memcpy(header, HNEF_POSDB_MAGIC, 8);
+	hnef_image_put32(header + 8, HNEF_POSDB_VERSION);
+	hnef_image_put32(header + 12, w->height);
+	hnef_image_put32(header + 16, w->width);
+	hnef_image_put32(header + 20, (uint32_t)w->record_size);
+	hnef_image_put64(header + 24, w->count);
+	hnef_image_put64(header + 32, size);
+	ok = ok && fseek(w->file, 0, SEEK_SET) == 0 && fwrite(header, 1, sizeof(header), w->file) == sizeof(header);
+	ok = (fclose(w->file) == 0) && ok;
+
+	free(slots);
+	free(w->keys);
+	free(w->buffer);
+	memset(w, 0, sizeof(HnefPosDBWriter));
+	return ok;
+}
+
+/**
+ * @brief Open a database written by hnef_posdb_writer_close. Only the
+ * header is read; records and index pages are loaded as lookups touch
+ * them.
+ *
+ * @param db The database to be opened
+ *
+ * @param path The file to be opened
+ *
+ * @return True on success, false if the file could not be read or is
+ * not a database of this version
+ */
+int
+hnef_posdb_open( HnefPosDB *db, const char *path ) {
+	const uint8_t *p;
+	uint8_t *image;
+	uint64_t slots;
+	int ok;
+
+	/* Probes land anywhere in the file */
+	memset(db, 0, sizeof(HnefPosDB));
+	if(!hnef_image_load(path, HNEF_IMAGE_RANDOM, &image, &(db->size), &(db->mapped))) {
+		return 0;
+	}
+	db->image = image;
+
+	p = db->image;
+	ok = db->size >= HNEF_POSDB_HEADER && !memcmp(p, HNEF_POSDB_MAGIC, 8) &&
+		hnef_image_get32(p + 8) == HNEF_POSDB_VERSION;
+	if(ok) {
+		db->height = hnef_image_get32(p + 12);
+		db->width = hnef_image_get32(p + 16);
+		db->record_size = hnef_image_get32(p + 20);
+		db->count = hnef_image_get64(p + 24);
+		slots = hnef_image_get64(p + 32);
+		ok = db->height >= 1 && db->height <= MAX_HEIGHT && db->width >= 1 && db->width <= MAX_WIDTH &&
+			db->record_size == hnef_posdb_record_size(db->height, db->width) &&
+			db->count <= HNEF_POSDB_MAX_RECORDS && slots >= 2*db->count && slots >= 16 &&
+			(slots & (slots - 1)) == 0 && slots <= (db->size - HNEF_POSDB_HEADER) / sizeof(uint32_t) &&
+			db->size == HNEF_POSDB_HEADER + db->count*db->record_size + slots*sizeof(uint32_t);
+	}
+	if(!ok) {
+		hnef_posdb_close(db);
+		return 0;
+	}
+	db->mask = slots - 1;
+	db->records = db->image + HNEF_POSDB_HEADER;
+	db->index = db->records + db->count*db->record_size;
+	return 1;
+}
+
+/**
+ * @brief Release the memory or mapping held by a database
+ *
+ * @param db The database to be closed
+ */
+void
+hnef_posdb_close( HnefPosDB *db ) {
+	hnef_image_free(db->image, db->size, db->mapped);
+	memset(db, 0, sizeof(HnefPosDB));
+}
+
+/**
+ * @brief Find the record of a key
+ *
+ * @param db The database
+ *
+ * @param key The Zobrist key of the position
+ *
+ * @return The record number, or HNEF_POSDB_NOT_FOUND
+ */
+int64_t
+hnef_posdb_find( const HnefPosDB *db, uint64_t key ) {
+	uint64_t i, n, r;
+
+	if(!db->image) {
+		return HNEF_POSDB_NOT_FOUND;
+	}
+	i = key & db->mask;
+	for( n=0; n<=db->mask; n++ ) {
+		r = hnef_image_get32(db->index + 4*i);
+		/* A corrupt slot reads as the end of the chain */
+		if(r == 0 || r > db->count) {
+			break;
+		}
+		if(hnef_image_get64(db->records + (r - 1)*db->record_size) == key) {
+			return (int64_t)(r - 1);
+		}
+		i = (i + 1) & db->mask;
+	}
+	return HNEF_POSDB_NOT_FOUND;
+}
+
+/**
+ * @brief Get the key of a record
+ */
+uint64_t
+hnef_posdb_get_key( const HnefPosDB *db, uint64_t record ) {
+	return hnef_image_get64(db->records + record*db->record_size);
+}
+
+/**
+ * @brief Get the entry of a record
+ *
+ * @param db The database
+ *
+ * @param record A record number below db->count
+ *
+ * @param entry Receives the entry
+ */
+void
+hnef_posdb_get_entry( const HnefPosDB *db, uint64_t record, HnefPosDBEntry *entry ) {
+	const uint8_t *p;
+
+	p = db->records + record*db->record_size;
+	entry->score = (int32_t)hnef_image_get32(p + 8);
+	entry->depth = (int16_t)(p[12] | (p[13] << 8));
+	entry->bound = p[14];
+	entry->move.from = p[16] | (p[17] << 8);
+	entry->move.to = p[18] | (p[19] << 8);
+}
+
+/**
+ * @brief Rebuild the position of a record
+ *
+ * @param db The database
+ *
+ * @param record A record number below db->count
+ *
+ * @param b Receives the position
+ *
+ * @return True on success, false if the record is damaged
+ */
+int
+hnef_posdb_get_board( const HnefPosDB *db, uint64_t record, HnefBoard *b ) {
+	const uint8_t *p;
+
+	p = db->records + record*db->record_size;
+	if(p[HNEF_POSDB_FIELDS] != db->height || p[HNEF_POSDB_FIELDS + 1] != db->width || p[15] > HNEF_SWEDE) {
+		return 0;
+	}
+	if(!hnef_board_deserialize(b, (uint8_t*)p + HNEF_POSDB_FIELDS)) {
+		return 0;
+	}
+	hnef_board_set_turn(b, p[15]);
+	return 1;
+}
+
+/**
+ * @brief Look up a position, checking that the record holds the same
+ * position and not just the same key
+ *
+ * @param db The database
+ *
+ * @param b The position to be looked up
+ *
+ * @param entry Receives the entry if the position is found
+ *
+ * @return True if the position is found
+ */
+int
+hnef_posdb_probe( const HnefPosDB *db, HnefBoard *b, HnefPosDBEntry *entry ) {
+	uint8_t buffer[2 + MAX_HEIGHT*MAX_WIDTH];
+	const uint8_t *p;
+	int64_t record;
+
+	if(b->height != db->height || b->width != db->width) {
+		return 0;
+	}
+	record = hnef_posdb_find(db, b->key);
+	if(record == HNEF_POSDB_NOT_FOUND) {
+		return 0;
+	}
+	p = db->records + record*db->record_size;
+	hnef_board_serialize(b, buffer);
+	if(p[15] != b->turn || memcmp(p + HNEF_POSDB_FIELDS, buffer, 2 + (size_t)b->height*b->width)) {
+		return 0;
+	}
+	hnef_posdb_get_entry(db, record, entry);
+	return 1;
+}
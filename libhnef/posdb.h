@@ -0,0 +1,97 @@
+/* libhnef/posdb.h
+ *
+ * Copyright (C) 2016 Gary Munnelly
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+/**
+ * @file libhnef/posdb.h
+ *
+ * @brief Macros, typedefs and function forward declarations for
+ * memory mapped position databases
+ *
+ * @author Gary Munnelly
+ */
+
+#ifndef LIBHNEF_POSDB_H_
+#define LIBHNEF_POSDB_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "bound.h"
+#include "move.h"
+
+#define HNEF_POSDB_NOT_FOUND -1           /**< Returned by hnef_posdb_find for a missing key */
+#define HNEF_POSDB_MAX_RECORDS 0xfffffffeU /**< Most records a database can hold */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief What is known about one position of a database
+ */
+typedef struct HnefPosDBEntry {
+	HnefMove move;            /**< Best move, from == to if none */
+	int score;                /**< Score from the side to move's point of view */
+	int depth;                /**< Depth the position was analysed to */
+	int bound;                /**< One of the HNEF_BOUND_* codes */
+} HnefPosDBEntry;
+
+/**
+ * @brief A read only database of analysed positions of one board size.
+ *
+ * Records have a fixed size and hold the position's key, its entry and
+ * the position as written by hnef_board_serialize. An open addressing
+ * table of record numbers follows them, so a key is found with one or
+ * two reads of the mapping and nothing is parsed when the file is
+ * opened. The mapping is read only and may be shared by any number of
+ * processes.
+ */
+typedef struct HnefPosDB {
+	const uint8_t *image;     /**< The whole file */
+	size_t size;              /**< Bytes in image */
+	int mapped;               /**< Set if image is mapped from the file */
+	int height;               /**< Height of every position */
+	int width;                /**< Width of every position */
+	size_t record_size;       /**< Bytes per record */
+	uint64_t count;           /**< Records held */
+	uint64_t mask;            /**< Index slots minus one */
+	const uint8_t *records;   /**< First record */
+	const uint8_t *index;     /**< First index slot */
+} HnefPosDB;
+
+/**
+ * @brief A database being written. Records are streamed to the file
+ * as they are added and the index is written when it is closed.
+ */
+typedef struct HnefPosDBWriter {
+	FILE *file;               /**< File being written */
+	int height;               /**< Height of every position */
+	int width;                /**< Width of every position */
+	size_t record_size;       /**< Bytes per record */
+	uint64_t count;           /**< Records written */
+	uint64_t *keys;           /**< Key of each record, for the index */
+	uint64_t capacity;        /**< Keys allocated */
+	uint8_t *buffer;          /**< Room for one record */
+	int failed;               /**< Set once a write has failed */
+} HnefPosDBWriter;
+
+int          hnef_posdb_writer_open        ( HnefPosDBWriter *w, const char *path, int height, int width );
+int          hnef_posdb_writer_add         ( HnefPosDBWriter *w, HnefBoard *b, const HnefPosDBEntry *entry );
+int          hnef_posdb_writer_close       ( HnefPosDBWriter *w );
+int          hnef_posdb_open               ( HnefPosDB *db, const char *path );
+void         hnef_posdb_close              ( HnefPosDB *db );
+int64_t      hnef_posdb_find               ( const HnefPosDB *db, uint64_t key );
+uint64_t     hnef_posdb_get_key            ( const HnefPosDB *db, uint64_t record );
+void         hnef_posdb_get_entry          ( const HnefPosDB *db, uint64_t record, HnefPosDBEntry *entry );
+int          hnef_posdb_get_board          ( const HnefPosDB *db, uint64_t record, HnefBoard *b );
+int          hnef_posdb_probe              ( const HnefPosDB *db, HnefBoard *b, HnefPosDBEntry *entry );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBHNEF_POSDB_H_ */
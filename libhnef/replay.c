@@ -0,0 +1,240 @@
+/* libhnef/replay.c
+ *
+ * Copyright (C) 2016 Gary Munnelly
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+/**
+ * @file libhnef/replay.c
+ *
+ * @brief Code for game replays which seek to any ply quickly
+ *
+ * @author Gary Munnelly
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "replay.h"
+
+/**
+ * @brief Make room for at least one more snapshot
+ *
+ * @return True on success, false if memory could not be allocated
+ */
+static int
+hnef_replay_reserve( HnefReplay *r ) {
+	uint64_t capacity;
+	uint8_t *snapshots;
+
+	if(r->plies / r->interval + 1 < r->snapshot_capacity) {
+		return 1;
+	}
+	capacity = r->snapshot_capacity? r->snapshot_capacity*2 : 8;
+	snapshots = realloc(r->snapshots, capacity*r->snapshot_size);
+	if(!snapshots) {
+		return 0;
+	}
+	r->snapshots = snapshots;
+	r->snapshot_capacity = capacity;
+	return 1;
+}
+
+/**
+ * @brief Store the last position as the snapshot for the current ply,
+ * which must fall on an interval and have room reserved
+ */
+static void
+hnef_replay_snapshot( HnefReplay *r ) {
+	uint8_t *snapshot;
+
+	snapshot = r->snapshots + (r->plies / r->interval)*r->snapshot_size;
+	snapshot[0] = (uint8_t)r->last.turn;
+	hnef_board_serialize(&(r->last), snapshot + 1);
+}
+
+/**
+ * @brief Start the replay of a game
+ *
+ * @param r The replay to be initialized
+ *
+ * @param start The position the game starts from
+ *
+ * @param rules The HNEF_RULES_* preset the game is played under
+ *
+ * @param interval Plies between snapshots. Smaller intervals seek
+ * faster and take more memory: each snapshot takes 3 + area bytes,
+ * against 4 bytes a move
+ *
+ * @return True on success, false if the preset is unknown, the
+ * interval is not positive or memory could not be allocated
+ */
+int
+hnef_replay_init( HnefReplay *r, HnefBoard *start, int rules, int interval ) {
+	HnefRules preset;
+
+	memset(r, 0, sizeof(HnefReplay));
+	if(interval < 1 || !hnef_rules_init(&preset, rules) || !hnef_rules_compile(&(r->tables), &preset, start)) {
+		return 0;
+	}
+	r->interval = interval;
+	r->snapshot_size = 1 + 2 + (size_t)start->height*start->width;
+	hnef_board_copy(&(r->last), start);
+	if(!hnef_replay_reserve(r)) {
+		return 0;
+	}
+	hnef_replay_snapshot(r);
+	return 1;
+}
+
+/**
+ * @brief Start the replay of a game read from an archive, with every
+ * move of the game. Each move is checked for legality before it is
+ * made, and a move after the game has been decided is damage.
+ *
+ * @param r The replay to be initialized
+ *
+ * @param game The game
+ *
+ * @param interval Plies between snapshots
+ *
+ * @return True on success, false if the game is damaged, the interval
+ * is not positive or memory could not be allocated
+ */
+int
+hnef_replay_init_from_game( HnefReplay *r, const HnefArchiveGame *game, int interval ) {
+	HnefBoard *start;
+	HnefRays rays;
+	HnefMove move;
+	uint64_t i;
+	size_t at;
+	int ok;
+
+	memset(r, 0, sizeof(HnefReplay));
+	start = malloc(sizeof(HnefBoard));
+	if(!start) {
+		return 0;
+	}
+	ok = hnef_archive_game_start(game, start) && hnef_replay_init(r, start, game->rules, interval);
+	free(start);
+	if(!ok) {
+		return 0;
+	}
+
+	hnef_rays_init(&rays, r->last.height, r->last.width);
+	at = 0;
+	for( i=0; i<game->plies; i++ ) {
+		if(hnef_rules_get_winner(&(r->tables), &(r->last)) != HNEF_NO_WINNER ||
+		   !hnef_archive_game_move(game, &at, &move) ||
+		   !hnef_board_is_legal_move(&(r->last), &rays, r->last.turn, move) || !hnef_replay_push(r, move)) {
+			hnef_replay_free(r);
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/**
+ * @brief Release the memory held by a replay
+ *
+ * @param r The replay to be released
+ */
+void
+hnef_replay_free( HnefReplay *r ) {
+	free(r->moves);
+	free(r->snapshots);
+	r->moves = NULL;
+	r->snapshots = NULL;
+	r->plies = 0;
+	r->move_capacity = 0;
+	r->snapshot_capacity = 0;
+}
+
+/**
+ * @brief Play the next move of the game
+ *
+ * @param r The replay
+ *
+ * @param move The move, which is not checked for legality
+ *
+ * @return True on success, false if memory could not be allocated, in
+ * which case the replay is unchanged
+ */
+int
+hnef_replay_push( HnefReplay *r, HnefMove move ) {
+	HnefUndo records[1];
+	HnefUndoStack stack;
+	HnefMove *moves;
+	uint64_t capacity;
+
+	if(r->plies == r->move_capacity) {
+		capacity = r->move_capacity? r->move_capacity*2 : 64;
+		moves = realloc(r->moves, capacity*sizeof(HnefMove));
+		if(!moves) {
+			return 0;
+		}
+		r->moves = moves;
+		r->move_capacity = capacity;
+	}
+	if(!hnef_replay_reserve(r)) {
+		return 0;
+	}
+
+	hnef_undo_stack_init(&stack, records, 1);
+	hnef_rules_make_move(&(r->tables), &(r->last), move, &stack);
+	r->moves[r->plies++] = move;
+	if(r->plies % r->interval == 0) {
+		hnef_replay_snapshot(r);
+	}
+	return 1;
+}
+
+/**
+ * @brief Rebuild the position of a game after a number of moves, by
+ * restoring the nearest snapshot at or before that ply and playing the
+ * remaining moves. At most interval - 1 moves are played.
+ *
+ * @param r The replay
+ *
+ * @param ply Moves played to reach the position, 0 for the start
+ *
+ * @param b Board to receive the position, which is left untracked
+ *
+ * @return True on success, false if ply is beyond the last move
+ */
+int
+hnef_replay_seek( HnefReplay *r, uint64_t ply, HnefBoard *b ) {
+	HnefUndo records[1];
+	HnefUndoStack stack;
+	uint8_t *snapshot;
+	uint64_t i;
+
+	if(ply > r->plies) {
+		return 0;
+	}
+	if(ply == r->plies) {
+		hnef_board_copy(b, &(r->last));
+		return 1;
+	}
+
+	snapshot = r->snapshots + (ply / r->interval)*r->snapshot_size;
+	hnef_board_deserialize(b, snapshot + 1);
+	hnef_board_set_turn(b, snapshot[0]);
+	for( i=ply - ply % r->interval; i<ply; i++ ) {
+		hnef_undo_stack_init(&stack, records, 1);
+		hnef_rules_make_move(&(r->tables), b, r->moves[i], &stack);
+	}
+	return 1;
+}
+
+/**
+ * @brief Count the bytes used to store the moves and snapshots of a
+ * replay, excluding the HnefReplay itself
+ *
+ * @param r The replay
+ *
+ * @return Bytes allocated
+ */
+size_t
+hnef_replay_bytes( HnefReplay *r ) {
+	return (size_t)(r->move_capacity*sizeof(HnefMove) + r->snapshot_capacity*r->snapshot_size);
+}
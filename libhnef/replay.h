@@ -0,0 +1,58 @@
+/* libhnef/replay.h
+ *
+ * Copyright (C) 2016 Gary Munnelly
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+/**
+ * @file libhnef/replay.h
+ *
+ * @brief Typedefs and function forward declarations for game replays
+ * with checkpoints
+ *
+ * @author Gary Munnelly
+ */
+
+#ifndef LIBHNEF_REPLAY_H_
+#define LIBHNEF_REPLAY_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "archive.h"
+#include "rules.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief The moves of a game together with a snapshot of the board
+ * every interval plies, so that any position of the game can be
+ * rebuilt with at most interval - 1 moves. Snapshots are the side to
+ * move followed by the buffer written by hnef_board_serialize.
+ */
+typedef struct HnefReplay {
+	HnefRuleTables tables;    /**< Rules the game is played under */
+	int interval;             /**< Plies between snapshots */
+	uint64_t plies;           /**< Moves recorded */
+	HnefMove *moves;          /**< The moves */
+	uint64_t move_capacity;   /**< Moves allocated */
+	uint8_t *snapshots;       /**< Snapshot of every interval'th position */
+	size_t snapshot_size;     /**< Bytes per snapshot */
+	uint64_t snapshot_capacity; /**< Snapshots allocated */
+	HnefBoard last;           /**< Position after the last move */
+} HnefReplay;
+
+int          hnef_replay_init              ( HnefReplay *r, HnefBoard *start, int rules, int interval );
+int          hnef_replay_init_from_game    ( HnefReplay *r, const HnefArchiveGame *game, int interval );
+void         hnef_replay_free              ( HnefReplay *r );
+int          hnef_replay_push              ( HnefReplay *r, HnefMove move );
+int          hnef_replay_seek              ( HnefReplay *r, uint64_t ply, HnefBoard *b );
+size_t       hnef_replay_bytes             ( HnefReplay *r );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBHNEF_REPLAY_H_ */
@@ -0,0 +1,412 @@
+/* libhnef/rules.c
+ *
+ * Copyright (C) 2016 Gary Munnelly
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+/**
+ * @file libhnef/rules.c
+ *
+ * @brief Code for compiling rule sets into capture tables and playing
+ * moves under them
+ *
+ * A rule set is a plain description of the variant's capture and
+ * victory rules. hnef_rules_compile combines it with the structures
+ * built on a board to give, for each team, the set of empty squares
+ * which act against that team's tokens, along with the escape squares
+ * and the positions from which a capture can reach two squares in
+ * each direction. Resolving the captures of a move then needs only a
+ * handful of bit tests around its destination.
+ *
+ * The rules supported are:
+ *
+ * - An armed king takes part in captures; an unarmed one does not.
+ * - The king is taken like a soldier, between two hostile squares, or
+ *   only when enclosed on all four sides. The edge of the board is
+ *   never hostile, so a four sided king is safe on the edge.
+ * - Empty thrones, castles and camps may each be hostile to either
+ *   team, to both or to neither.
+ * - The king escapes via the tiles marked as escapes, via any edge
+ *   tile or via the four corners.
+ * - Shieldwall: two or more tokens in a row along the edge, each with
+ *   an enemy directly in front of it, are taken together when the row
+ *   is closed at both ends by enemies or by hostile squares. A king in
+ *   the row is not taken.
+ * - Encirclement: the attackers win when no defender can reach the
+ *   edge of the board without passing an attacker.
+ *
+ * Moves are taken back with hnef_board_unmake_move.
+ *
+ * @author Gary Munnelly
+ */
+#include "rules.h"
+
+static const int hnef_rules_dx[4] = { 0, 1, 0, -1 };   /**< x step of each direction */
+static const int hnef_rules_dy[4] = { -1, 0, 1, 0 };   /**< y step of each direction */
+static const int hnef_rules_step[4] = {                /**< Bit index step of each direction */
+	-HNEF_BITBOARD_STRIDE, 1, HNEF_BITBOARD_STRIDE, -1
+};
+
+/**
+ * @brief Fill a rule set with one of the presets
+ *
+ * @param rules The rule set to be initialized
+ *
+ * @param preset One of the HNEF_RULES_* codes
+ *
+ * @return True on success, false if the preset is unknown
+ */
+int
+hnef_rules_init( HnefRules *rules, int preset ) {
+	rules->king_armed = 1;
+	rules->king_sides = 4;
+	rules->hostile_throne = HNEF_HOSTILE_ALL;
+	rules->hostile_castle = HNEF_HOSTILE_ALL;
+
+	switch(preset) {
+	case HNEF_RULES_DEFAULT:
+		rules->hostile_camp = HNEF_HOSTILE_ALL;
+		rules->escape = HNEF_ESCAPE_TILES;
+		rules->shieldwall = 0;
+		rules->encirclement = 0;
+		return 1;
+	case HNEF_RULES_COPENHAGEN:
+		rules->hostile_camp = HNEF_HOSTILE_NONE;
+		rules->escape = HNEF_ESCAPE_CORNER;
+		rules->shieldwall = 1;
+		rules->encirclement = 1;
+		return 1;
+	case HNEF_RULES_FETLAR:
+		rules->hostile_camp = HNEF_HOSTILE_NONE;
+		rules->escape = HNEF_ESCAPE_CORNER;
+		rules->shieldwall = 0;
+		rules->encirclement = 0;
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+/**
+ * @brief Compile a rule set for the structures of a board. Boards of
+ * the same size and structures may share the tables.
+ *
+ * @param t The tables to be filled
+ *
+ * @param rules The rule set to be compiled
+ *
+ * @param board A board whose structures are in place
+ *
+ * @return True on success, false if the rule set is malformed
+ */
+int
+hnef_rules_compile( HnefRuleTables *t, const HnefRules *rules, HnefBoard *board ) {
+	int d, team, x, y, h, w;
+
+	if((rules->king_sides != 2 && rules->king_sides != 4) ||
+	   rules->escape < HNEF_ESCAPE_TILES || rules->escape > HNEF_ESCAPE_CORNER) {
+		return 0;
+	}
+
+	t->rules = *rules;
+	t->height = h = board->height;
+	t->width = w = board->width;
+
+	hnef_bitboard_fill(&(t->board), h, w);
+	hnef_bitboard_clear(&(t->edges));
+	for( x=0; x<w; x++ ) {
+		hnef_bitboard_set(&(t->edges), HNEF_SQUARE(x, 0));
+		hnef_bitboard_set(&(t->edges), HNEF_SQUARE(x, h-1));
+	}
+	for( y=0; y<h; y++ ) {
+		hnef_bitboard_set(&(t->edges), HNEF_SQUARE(0, y));
+		hnef_bitboard_set(&(t->edges), HNEF_SQUARE(w-1, y));
+	}
+
+	for( team=0; team<2; team++ ) {
+		hnef_bitboard_clear(&(t->hostile[team]));
+		if(rules->hostile_throne & HNEF_HOSTILE_TO(team)) {
+			hnef_bitboard_or(&(t->hostile[team]), &(t->hostile[team]), &(board->types[HNEF_THRONE]));
+		}
+		if(rules->hostile_castle & HNEF_HOSTILE_TO(team)) {
+			hnef_bitboard_or(&(t->hostile[team]), &(t->hostile[team]), &(board->types[HNEF_CASTLE]));
+		}
+		if(rules->hostile_camp & HNEF_HOSTILE_TO(team)) {
+			hnef_bitboard_or(&(t->hostile[team]), &(t->hostile[team]), &(board->types[HNEF_CAMP]));
+		}
+	}
+
+	switch(rules->escape) {
+	case HNEF_ESCAPE_EDGE:
+		t->escapes = t->edges;
+		break;
+	case HNEF_ESCAPE_CORNER:
+		hnef_bitboard_clear(&(t->escapes));
+		hnef_bitboard_set(&(t->escapes), HNEF_SQUARE(0, 0));
+		hnef_bitboard_set(&(t->escapes), HNEF_SQUARE(w-1, 0));
+		hnef_bitboard_set(&(t->escapes), HNEF_SQUARE(0, h-1));
+		hnef_bitboard_set(&(t->escapes), HNEF_SQUARE(w-1, h-1));
+		break;
+	default:
+		t->escapes = board->escapes;
+		break;
+	}
+
+	for( y=0; y<HNEF_BITBOARD_ROWS; y++ ) {
+		for( x=0; x<HNEF_BITBOARD_STRIDE; x++ ) {
+			t->reach[HNEF_SQUARE(x, y)] = 0;
+			for( d=0; d<4 && x<w && y<h; d++ ) {
+				if(x + 2*hnef_rules_dx[d] >= 0 && x + 2*hnef_rules_dx[d] < w &&
+				   y + 2*hnef_rules_dy[d] >= 0 && y + 2*hnef_rules_dy[d] < h) {
+					t->reach[HNEF_SQUARE(x, y)] |= 1 << d;
+				}
+			}
+		}
+	}
+	return 1;
+}
+
+/**
+ * @brief Determine whether square sq acts against the tokens of team
+ * victim, as a token of the other team or as a hostile empty square
+ */
+static int
+hnef_rules_is_hostile( const HnefRuleTables *t, HnefBoard *board, int sq, int victim ) {
+	if(hnef_bitboard_test(&(board->occupied), sq)) {
+		return hnef_bitboard_test(&(board->teams[!victim]), sq) &&
+			(t->rules.king_armed || !hnef_bitboard_test(&(board->ranks[HNEF_KING]), sq));
+	}
+	return hnef_bitboard_test(&(t->hostile[victim]), sq);
+}
+
+/**
+ * @brief Determine whether the king at (x,y) is enclosed on all four
+ * sides. Squares off the board are never hostile.
+ */
+static int
+hnef_rules_king_enclosed( const HnefRuleTables *t, HnefBoard *board, int x, int y ) {
+	int d, vx, vy;
+
+	for( d=0; d<4; d++ ) {
+		vx = x + hnef_rules_dx[d];
+		vy = y + hnef_rules_dy[d];
+		if(vx < 0 || vy < 0 || vx >= t->width || vy >= t->height ||
+		   !hnef_rules_is_hostile(t, board, HNEF_SQUARE(vx, vy), HNEF_SWEDE)) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/**
+ * @brief Find the tokens taken by a shieldwall which the token of team
+ * just moved to (x,y) closes
+ *
+ * @param edge Set to the edge of the wall
+ *
+ * @return A mask of positions along the edge, or 0 if there is no wall
+ */
+static uint32_t
+hnef_rules_shieldwall( const HnefRuleTables *t, HnefBoard *board, int x, int y, int team, int *edge ) {
+	uint32_t wall, run;
+	int e, s, dir, in, cx, cy, n;
+
+	wall = 0;
+	for( e=0; e<4 && !wall; e++ ) {
+		if((e == 0 && y != 0) || (e == 1 && x != t->width - 1) ||
+		   (e == 2 && y != t->height - 1) || (e == 3 && x != 0)) {
+			continue;
+		}
+		in = (e + 2) & 0x03;
+
+		/* Walk the two ways along the edge */
+		for( s=1; s<4; s+=2 ) {
+			dir = (e + s) & 0x03;
+			cx = x + hnef_rules_dx[dir];
+			cy = y + hnef_rules_dy[dir];
+			run = 0;
+			n = 0;
+			while(cx >= 0 && cy >= 0 && cx < t->width && cy < t->height &&
+			      hnef_bitboard_test(&(board->teams[!team]), HNEF_SQUARE(cx, cy))) {
+				if(!hnef_bitboard_test(&(board->teams[team]),
+					HNEF_SQUARE(cx + hnef_rules_dx[in], cy + hnef_rules_dy[in]))) {
+					break;
+				}
+				if(!hnef_bitboard_test(&(board->ranks[HNEF_KING]), HNEF_SQUARE(cx, cy))) {
+					run |= (uint32_t)1 << ((e & 1)? cy : cx);
+				}
+				n++;
+				cx += hnef_rules_dx[dir];
+				cy += hnef_rules_dy[dir];
+			}
+
+			/* The row must be at least two long and closed at the far end */
+			if(n >= 2 && cx >= 0 && cy >= 0 && cx < t->width && cy < t->height &&
+			   hnef_rules_is_hostile(t, board, HNEF_SQUARE(cx, cy), !team)) {
+				wall |= run;
+			}
+		}
+		*edge = e;
+	}
+	return wall;
+}
+
+/**
+ * @brief Make a move in place under a rule set, removing any tokens
+ * it captures, and push a record of it to the undo stack. The turn
+ * passes to the opposing team. The move is not checked for legality.
+ *
+ * @param t The compiled rules
+ *
+ * @param board The board on which the move is to be made
+ *
+ * @param move The move to be made
+ *
+ * @param stack The stack which will receive the undo record
+ *
+ * @return The number of tokens captured, or -1 if the stack is full
+ * in which case the board is left unchanged
+ */
+int
+hnef_rules_make_move( const HnefRuleTables *t, HnefBoard *board, HnefMove move, HnefUndoStack *stack ) {
+	HnefUndo *undo;
+	HnefToken token;
+	uint32_t wall;
+	int d, i, n, sq, v, team, edge, x, y;
+
+	if(stack->size >= stack->capacity) {
+		return -1;
+	}
+
+	undo = &(stack->records[stack->size++]);
+	undo->move = move;
+	undo->captured = 0;
+	undo->king = 0;
+	undo->wall_edge = 0;
+	undo->wall = 0;
+
+	x = HNEF_SQUARE_X(move.from);
+	y = HNEF_SQUARE_Y(move.from);
+	token = hnef_board_get_token(board, x, y);
+	team = token.team;
+	hnef_board_unset_token(board, x, y);
+
+	x = HNEF_SQUARE_X(move.to);
+	y = HNEF_SQUARE_Y(move.to);
+	hnef_board_set_token(board, x, y, token);
+	hnef_board_set_turn(board, !team);
+
+	if(token.rank == HNEF_KING && !t->rules.king_armed) {
+		return 0;
+	}
+
+	/* Find every capture before removing anything */
+	sq = move.to;
+	edge = 0;
+	wall = t->rules.shieldwall? hnef_rules_shieldwall(t, board, x, y, team, &edge) : 0;
+
+	for( d=0; d<4; d++ ) {
+		if(!(t->reach[sq] & (1 << d))) {
+			continue;
+		}
+		v = sq + hnef_rules_step[d];
+		if(!hnef_bitboard_test(&(board->teams[!team]), v)) {
+			continue;
+		}
+		if(hnef_bitboard_test(&(board->ranks[HNEF_KING]), v)) {
+			if(t->rules.king_sides == 4?
+			   hnef_rules_king_enclosed(t, board, x + hnef_rules_dx[d], y + hnef_rules_dy[d]) :
+			   hnef_rules_is_hostile(t, board, v + hnef_rules_step[d], !team)) {
+				undo->king = d + 1;
+				undo->captured |= 1 << d;
+			}
+		} else if(hnef_rules_is_hostile(t, board, v + hnef_rules_step[d], !team)) {
+			undo->captured |= 1 << d;
+		}
+	}
+
+	n = 0;
+	for( d=0; d<4; d++ ) {
+		if(undo->captured & (1 << d)) {
+			hnef_board_unset_token(board, x + hnef_rules_dx[d], y + hnef_rules_dy[d]);
+			n++;
+		}
+	}
+
+	/* Soldiers of the wall already taken by the move itself are not
+	 * recorded twice */
+	for( i=0; wall && i<32; i++ ) {
+		if(wall & ((uint32_t)1 << i)) {
+			hnef_edge_square(board, edge, i, &x, &y);
+			if(hnef_board_get_tile_is_occupied(board, x, y)) {
+				hnef_board_unset_token(board, x, y);
+				n++;
+			} else {
+				wall &= ~((uint32_t)1 << i);
+			}
+		}
+	}
+	if(wall) {
+		undo->wall_edge = edge + 1;
+		undo->wall = wall;
+	}
+
+	return n;
+}
+
+/**
+ * @brief Determine whether every defender is enclosed by attackers,
+ * that is whether none of them can reach the edge of the board
+ * without crossing an attacker
+ *
+ * @param t The compiled rules
+ *
+ * @param board The board to be examined
+ *
+ * @return True if there are defenders and all of them are enclosed
+ */
+int
+hnef_rules_is_encircled( const HnefRuleTables *t, HnefBoard *board ) {
+	HnefBitboard open, fill;
+
+	if(hnef_bitboard_is_empty(&(board->teams[HNEF_SWEDE]))) {
+		return 0;
+	}
+
+	hnef_bitboard_andnot(&open, &(t->board), &(board->teams[HNEF_MUSCOVITE]));
+	fill = t->edges;
+	hnef_bitboard_flood(&fill, &open);
+	hnef_bitboard_and(&fill, &fill, &(board->teams[HNEF_SWEDE]));
+	return hnef_bitboard_is_empty(&fill);
+}
+
+/**
+ * @brief Determine whether either team has won the game under a rule
+ * set
+ *
+ * @param t The compiled rules
+ *
+ * @param board The board to be examined
+ *
+ * @return HNEF_SWEDE if the king stands on an escape square,
+ * HNEF_MUSCOVITE if the king has been captured or, where the rules
+ * allow it, every defender is encircled, HNEF_NO_WINNER otherwise
+ */
+int
+hnef_rules_get_winner( const HnefRuleTables *t, HnefBoard *board ) {
+	HnefBitboard escaped;
+
+	if(hnef_bitboard_is_empty(&(board->ranks[HNEF_KING]))) {
+		return HNEF_MUSCOVITE;
+	}
+
+	hnef_bitboard_and(&escaped, &(board->ranks[HNEF_KING]), &(t->escapes));
+	if(!hnef_bitboard_is_empty(&escaped)) {
+		return HNEF_SWEDE;
+	}
+	if(t->rules.encirclement && hnef_rules_is_encircled(t, board)) {
+		return HNEF_MUSCOVITE;
+	}
+	return HNEF_NO_WINNER;
+}
@@ -0,0 +1,81 @@
+/* libhnef/rules.h
+ *
+ * Copyright (C) 2016 Gary Munnelly
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+/**
+ * @file libhnef/rules.h
+ *
+ * @brief Macros, typedefs and function forward declarations for
+ * describing rule sets and compiling them into capture tables
+ *
+ * @author Gary Munnelly
+ */
+
+#ifndef LIBHNEF_RULES_H_
+#define LIBHNEF_RULES_H_
+
+#include "move.h"
+
+#define HNEF_RULES_DEFAULT    0x00 /**< The rules applied by hnef_board_make_move */
+#define HNEF_RULES_COPENHAGEN 0x01 /**< Copenhagen Hnefatafl */
+#define HNEF_RULES_FETLAR     0x02 /**< Fetlar Hnefatafl */
+
+#define HNEF_ESCAPE_TILES     0x00 /**< The king escapes via tiles marked as escapes */
+#define HNEF_ESCAPE_EDGE      0x01 /**< The king escapes via any edge tile */
+#define HNEF_ESCAPE_CORNER    0x02 /**< The king escapes via the four corners */
+
+/** Bit of a hostility field making a structure hostile to a team */
+#define HNEF_HOSTILE_TO(team) (1 << ((team) & 0x01))
+#define HNEF_HOSTILE_NONE     0x00 /**< Hostile to neither team */
+#define HNEF_HOSTILE_ALL      0x03 /**< Hostile to both teams */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief A description of the capture and victory rules of a variant.
+ * Movement is not affected.
+ */
+typedef struct HnefRules {
+	int king_armed;       /**< True if the king takes part in captures */
+	int king_sides;       /**< Hostile sides needed to capture the king, 2 or 4 */
+	int hostile_throne;   /**< Teams to which an empty throne is hostile */
+	int hostile_castle;   /**< Teams to which an empty castle is hostile */
+	int hostile_camp;     /**< Teams to which an empty camp is hostile */
+	int escape;           /**< One of the HNEF_ESCAPE_* codes */
+	int shieldwall;       /**< True if rows on the edge can be captured together */
+	int encirclement;     /**< True if the attackers win by enclosing every defender */
+} HnefRules;
+
+/**
+ * @brief A rule set compiled for one board. Every square's hostility
+ * is worked out in advance, so captures are resolved with a few mask
+ * tests. Compile again if the structures on the board change.
+ */
+typedef struct HnefRuleTables {
+	HnefRules rules;              /**< The rules compiled */
+	int height;                   /**< Height of the board compiled for */
+	int width;                    /**< Width of the board compiled for */
+	HnefBitboard hostile[2];      /**< Empty squares hostile to each team's tokens */
+	HnefBitboard escapes;         /**< Squares via which the king escapes */
+	HnefBitboard edges;           /**< Squares on the edge of the board */
+	HnefBitboard board;           /**< Every square of the board */
+	uint8_t reach[HNEF_BITBOARD_ROWS*HNEF_BITBOARD_STRIDE]; /**< Bit d set if the
+	                                   square two steps in direction d is on the board */
+} HnefRuleTables;
+
+int          hnef_rules_init               ( HnefRules *rules, int preset );
+int          hnef_rules_compile            ( HnefRuleTables *t, const HnefRules *rules, HnefBoard *b );
+int          hnef_rules_make_move          ( const HnefRuleTables *t, HnefBoard *b, HnefMove move, HnefUndoStack *s );
+int          hnef_rules_get_winner         ( const HnefRuleTables *t, HnefBoard *b );
+int          hnef_rules_is_encircled       ( const HnefRuleTables *t, HnefBoard *b );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBHNEF_RULES_H_ */
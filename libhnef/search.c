@@ -0,0 +1,518 @@
+/* libhnef/search.c
+ *
+ * Copyright (C) 2016 Gary Munnelly
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+/**
+ * @file libhnef/search.c
+ *
+ * @brief Code for a multithreaded alpha-beta search
+ *
+ * The search is an iterative deepening principal variation search
+ * with transposition table, killer and history move ordering. Extra
+ * threads follow the Lazy SMP scheme: every thread searches the same
+ * root position on its own copy of the board and they cooperate only
+ * through the shared transposition table. Helpers on odd numbered
+ * threads start one ply deeper so that the threads spread out over
+ * the tree. The result is taken from the calling thread.
+ *
+ * @author Gary Munnelly
+ */
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "eval.h"
+#include "search.h"
+
+#define HNEF_SCORE_INFINITE (HNEF_SCORE_WIN + 1)
+#define HNEF_CHECK_INTERVAL 2048  /**< Nodes between clock checks */
+
+/**
+ * @brief State shared between every thread of one search
+ */
+typedef struct HnefSearchShared {
+	HnefBoard *root;              /**< Position being searched */
+	HnefTT *tt;                   /**< Shared transposition table */
+	HnefRays rays;                /**< Ray table for the root's size */
+	const HnefSearchLimits *limits; /**< Limits of the search */
+	HnefEvaluator evaluate;       /**< Evaluation function */
+	struct timespec start;        /**< Time the search began */
+	atomic_int stop;              /**< Set when every thread must return */
+	atomic_uint_fast64_t nodes;   /**< Nodes visited by finished threads */
+} HnefSearchShared;
+
+/**
+ * @brief State private to one search thread
+ */
+typedef struct HnefSearchThread {
+	HnefSearchShared *shared;     /**< State shared with the other threads */
+	int id;                       /**< 0 for the calling thread */
+	pthread_t handle;             /**< Handle of helper threads */
+	int started;                  /**< Set once handle refers to a thread */
+	HnefBoard board;              /**< Private copy of the root position */
+	HnefEvalAccumulator sums;     /**< Evaluator's features of board, if the root is tracked */
+	HnefUndo undo[HNEF_MAX_PLY];  /**< Storage for the undo stack */
+	HnefUndoStack stack;          /**< Moves made from the root */
+	HnefMove moves[HNEF_MAX_PLY][HNEF_MAX_MOVES]; /**< Moves at each ply */
+	int order[HNEF_MAX_PLY][HNEF_MAX_MOVES];      /**< Ordering scores of moves */
+	HnefMove killers[HNEF_MAX_PLY][2];            /**< Quiet moves which caused cutoffs */
+	int *history;                 /**< Cutoff counts by from and to square */
+	HnefMove pv[HNEF_MAX_PLY][HNEF_MAX_PLY];      /**< Triangular PV table */
+	int pv_length[HNEF_MAX_PLY];  /**< Length of each row of pv */
+	uint64_t nodes;               /**< Nodes visited by this thread */
+	int depth;                    /**< Deepest iteration completed */
+	int score;                    /**< Score of that iteration */
+	HnefMove root_pv[HNEF_MAX_PLY]; /**< Principal variation of that iteration */
+	int root_pv_length;           /**< Number of moves in root_pv */
+} HnefSearchThread;
+
+/**
+ * @brief Milliseconds elapsed since the search began
+ */
+static int
+hnef_search_elapsed( HnefSearchShared *shared ) {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (int)((now.tv_sec - shared->start.tv_sec)*1000
+		+ (now.tv_nsec - shared->start.tv_nsec)/1000000);
+}
+
+/**
+ * @brief Determine whether the thread should abandon its search. The
+ * calling thread watches the clock once it has a result to return.
+ */
+static int
+hnef_search_should_stop( HnefSearchThread *t ) {
+	HnefSearchShared *shared = t->shared;
+
+	if(t->id == 0 && t->depth > 0 && shared->limits->milliseconds > 0 &&
+	   (t->nodes % HNEF_CHECK_INTERVAL) == 0 &&
+	   hnef_search_elapsed(shared) >= shared->limits->milliseconds) {
+		atomic_store_explicit(&(shared->stop), 1, memory_order_relaxed);
+	}
+	return atomic_load_explicit(&(shared->stop), memory_order_relaxed);
+}
+
+/**
+ * @brief Index of the entry of the history table for a move
+ */
+static int
+hnef_search_history_index( HnefBoard *b, HnefMove m ) {
+	int from, to;
+
+	from = HNEF_SQUARE_Y(m.from)*b->width + HNEF_SQUARE_X(m.from);
+	to = HNEF_SQUARE_Y(m.to)*b->width + HNEF_SQUARE_X(m.to);
+	return from*b->area + to;
+}
+
+/**
+ * @brief Determine whether two moves are the same
+ */
+static int
+hnef_search_same_move( HnefMove a, HnefMove b ) {
+	return a.from == b.from && a.to == b.to;
+}
+
+/**
+ * @brief Convert a forced result score, a won position's or a
+ * tablebase result's, from distance-to-root to distance-to-node form
+ * before it is stored
+ */
+static int
+hnef_search_score_to_tt( int score, int ply ) {
+	if(score >= HNEF_SCORE_FORCED) {
+		return score + ply;
+	}
+	if(score <= -HNEF_SCORE_FORCED) {
+		return score - ply;
+	}
+	return score;
+}
+
+/**
+ * @brief Reverse hnef_search_score_to_tt
+ */
+static int
+hnef_search_score_from_tt( int score, int ply ) {
+	if(score >= HNEF_SCORE_FORCED) {
+		return score - ply;
+	}
+	if(score <= -HNEF_SCORE_FORCED) {
+		return score + ply;
+	}
+	return score;
+}
+
+/**
+ * @brief Give each move a score for ordering: the hash move first,
+ * then the killers, then the rest by history
+ */
+static void
+hnef_search_order( HnefSearchThread *t, int ply, int n, HnefMove hash_move ) {
+	HnefMove *moves;
+	int *order, i;
+
+	moves = t->moves[ply];
+	order = t->order[ply];
+	for( i=0; i<n; i++ ) {
+		if(hnef_search_same_move(moves[i], hash_move)) {
+			order[i] = 1 << 30;
+		} else if(hnef_search_same_move(moves[i], t->killers[ply][0])) {
+			order[i] = 1 << 29;
+		} else if(hnef_search_same_move(moves[i], t->killers[ply][1])) {
+			order[i] = 1 << 28;
+		} else {
+			order[i] = t->history[hnef_search_history_index(&(t->board), moves[i])];
+		}
+	}
+}
+
+/**
+ * @brief Move the best ordered of the remaining moves into slot i
+ */
+static void
+hnef_search_pick( HnefSearchThread *t, int ply, int n, int i ) {
+	HnefMove *moves, m;
+	int *order, j, best, s;
+
+	moves = t->moves[ply];
+	order = t->order[ply];
+	best = i;
+	for( j=i+1; j<n; j++ ) {
+		if(order[j] > order[best]) {
+			best = j;
+		}
+	}
+	if(best != i) {
+		m = moves[i];
+		moves[i] = moves[best];
+		moves[best] = m;
+		s = order[i];
+		order[i] = order[best];
+		order[best] = s;
+	}
+}
+
+/**
+ * @brief Principal variation search of the thread's board
+ *
+ * @return The score of the position from the side to move's point of
+ * view, or 0 if the search was stopped
+ */
+static int
+hnef_search_node( HnefSearchThread *t, int depth, int ply, int alpha, int beta ) {
+	HnefSearchShared *shared;
+	HnefBoard *b;
+	HnefTTData entry;
+	HnefMove hash_move, best_move, *moves;
+	int n, i, score, best, winner, alpha_orig, captures, bound, distance;
+
+	shared = t->shared;
+	b = &(t->board);
+	t->pv_length[ply] = 0;
+
+	if(hnef_search_should_stop(t)) {
+		return 0;
+	}
+	t->nodes++;
+
+	winner = hnef_board_get_winner(b);
+	if(winner != HNEF_NO_WINNER) {
+		return (winner == b->turn)? HNEF_SCORE_WIN - ply : -(HNEF_SCORE_WIN - ply);
+	}
+
+	/* Endgames the tablebase covers need no search. The root is
+	 * searched so that a move is still chosen. Scores count the plies
+	 * from the root, like those of won positions, and are stored in
+	 * the table relative to the node in the same way. */
+	if(ply > 0 && shared->limits->tablebase) {
+		switch(hnef_tablebase_probe(shared->limits->tablebase, b, &distance)) {
+		case HNEF_TB_WIN:
+			return HNEF_SCORE_TABLEBASE - ply - distance;
+		case HNEF_TB_LOSS:
+			return -(HNEF_SCORE_TABLEBASE - ply - distance);
+		case HNEF_TB_DRAW:
+			return 0;
+		}
+	}
+	if(depth <= 0 || ply >= HNEF_MAX_PLY - 1) {
+		return shared->evaluate(b, shared->limits->evaluate_data);
+	}
+
+	/* Consult the shared table */
+	alpha_orig = alpha;
+	hash_move.from = hash_move.to = 0;
+	if(hnef_tt_probe(shared->tt, b->key, &entry)) {
+		hash_move = entry.move;
+		if(ply > 0 && entry.depth >= depth) {
+			score = hnef_search_score_from_tt(entry.score, ply);
+			if(entry.bound == HNEF_BOUND_EXACT ||
+			   (entry.bound == HNEF_BOUND_LOWER && score >= beta) ||
+			   (entry.bound == HNEF_BOUND_UPPER && score <= alpha)) {
+				return score;
+			}
+		}
+	}
+
+	moves = t->moves[ply];
+	n = hnef_board_generate_moves(b, &(shared->rays), b->turn, moves, HNEF_MAX_MOVES);
+	if(n == 0) {
+		/* A team with no moves loses */
+		return -(HNEF_SCORE_WIN - ply);
+	}
+	hnef_search_order(t, ply, n, hash_move);
+
+	best = -HNEF_SCORE_INFINITE;
+	best_move = moves[0];
+	for( i=0; i<n; i++ ) {
+		hnef_search_pick(t, ply, n, i);
+
+		captures = hnef_board_make_move(b, moves[i], &(t->stack));
+		if(i == 0) {
+			score = -hnef_search_node(t, depth - 1, ply + 1, -beta, -alpha);
+		} else {
+			score = -hnef_search_node(t, depth - 1, ply + 1, -alpha - 1, -alpha);
+			if(score > alpha && score < beta) {
+				score = -hnef_search_node(t, depth - 1, ply + 1, -beta, -alpha);
+			}
+		}
+		hnef_board_unmake_move(b, &(t->stack));
+
+		if(atomic_load_explicit(&(shared->stop), memory_order_relaxed)) {
+			return 0;
+		}
+
+		if(score > best) {
+			best = score;
+			best_move = moves[i];
+		}
+		if(score > alpha) {
+			alpha = score;
+			t->pv[ply][0] = moves[i];
+			memcpy(&(t->pv[ply][1]), t->pv[ply + 1], t->pv_length[ply + 1]*sizeof(HnefMove));
+			t->pv_length[ply] = t->pv_length[ply + 1] + 1;
+		}
+		if(alpha >= beta) {
+			/* Remember quiet moves which refute this position */
+			if(captures == 0) {
+				if(!hnef_search_same_move(moves[i], t->killers[ply][0])) {
+					t->killers[ply][1] = t->killers[ply][0];
+					t->killers[ply][0] = moves[i];
+				}
+				t->history[hnef_search_history_index(b, moves[i])] += depth*depth;
+			}
+			break;
+		}
+	}
+
+	if(best <= alpha_orig) {
+		bound = HNEF_BOUND_UPPER;
+	} else if(best >= beta) {
+		bound = HNEF_BOUND_LOWER;
+	} else {
+		bound = HNEF_BOUND_EXACT;
+	}
+	hnef_tt_store(shared->tt, b->key, best_move, hnef_search_score_to_tt(best, ply), depth, bound);
+
+	return best;
+}
+
+/**
+ * @brief Iterative deepening loop run by every thread
+ */
+static void*
+hnef_search_worker( void *arg ) {
+	HnefSearchThread *t;
+	HnefSearchShared *shared;
+	int depth, score;
+
+	t = arg;
+	shared = t->shared;
+
+	for( depth = 1 + (t->id & 1); depth <= shared->limits->depth; depth++ ) {
+		score = hnef_search_node(t, depth, 0, -HNEF_SCORE_INFINITE, HNEF_SCORE_INFINITE);
+		if(atomic_load_explicit(&(shared->stop), memory_order_relaxed)) {
+			break;
+		}
+		t->depth = depth;
+		t->score = score;
+		memcpy(t->root_pv, t->pv[0], t->pv_length[0]*sizeof(HnefMove));
+		t->root_pv_length = t->pv_length[0];
+	}
+
+	/* The helpers are only useful while the calling thread searches */
+	if(t->id == 0) {
+		atomic_store(&(shared->stop), 1);
+	}
+	atomic_fetch_add(&(shared->nodes), t->nodes);
+	return NULL;
+}
+
+/**
+ * @brief Allocate and prepare the private state of one thread
+ */
+static HnefSearchThread*
+hnef_search_thread_new( HnefSearchShared *shared, int id ) {
+	HnefSearchThread *t;
+
+	t = calloc(1, sizeof(HnefSearchThread));
+	if(!t) {
+		return NULL;
+	}
+	t->history = calloc((size_t)shared->root->area*shared->root->area, sizeof(int));
+	if(!t->history) {
+		free(t);
+		return NULL;
+	}
+
+	t->shared = shared;
+	t->id = id;
+	/* A root tracked by the evaluator stays tracked, with sums of the
+	 * thread's own */
+	hnef_board_copy(&(t->board), shared->root);
+	if(shared->root->watcher == hnef_eval_update) {
+		hnef_eval_track(&(t->board), &(t->sums));
+	}
+	hnef_undo_stack_init(&(t->stack), t->undo, HNEF_MAX_PLY);
+	return t;
+}
+
+/**
+ * @brief Release the private state of one thread
+ */
+static void
+hnef_search_thread_free( HnefSearchThread *t ) {
+	if(t) {
+		free(t->history);
+		free(t);
+	}
+}
+
+/**
+ * @brief Fill a set of search limits with their defaults: a single
+ * thread searching to depth 6 with no time limit
+ *
+ * @param limits The limits to be initialized
+ */
+void
+hnef_search_limits_init( HnefSearchLimits *limits ) {
+	limits->depth = 6;
+	limits->milliseconds = 0;
+	limits->threads = 1;
+	limits->evaluate = NULL;
+	limits->evaluate_data = NULL;
+	limits->tablebase = NULL;
+}
+
+/**
+ * @brief Find the best move for the side to move. The calling thread
+ * takes part in the search, and limits->threads - 1 helpers are
+ * started alongside it.
+ *
+ * @param board The position to be searched. It is not modified
+ *
+ * @param tt The transposition table shared by the threads. It may
+ * hold results of earlier searches
+ *
+ * @param limits The limits of the search
+ *
+ * @param result Receives the best move, its score and the principal
+ * variation
+ *
+ * @return True on success, false if the side to move has no legal
+ * moves, the game is over or memory could not be allocated
+ */
+int
+hnef_search( HnefBoard *board, HnefTT *tt, const HnefSearchLimits *limits, HnefSearchResult *result ) {
+	HnefSearchShared shared;
+	HnefSearchThread *threads[HNEF_MAX_THREADS];
+	HnefMove first;
+	int i, n, ok;
+
+	memset(result, 0, sizeof(HnefSearchResult));
+
+	shared.root = board;
+	shared.tt = tt;
+	shared.limits = limits;
+	shared.evaluate = limits->evaluate? limits->evaluate : hnef_search_evaluate_material;
+	hnef_rays_init(&(shared.rays), board->height, board->width);
+	atomic_init(&(shared.stop), 0);
+	atomic_init(&(shared.nodes), 0);
+	clock_gettime(CLOCK_MONOTONIC, &(shared.start));
+
+	if(hnef_board_get_winner(board) != HNEF_NO_WINNER ||
+	   hnef_board_generate_moves(board, &(shared.rays), board->turn, &first, 1) == 0) {
+		return 0;
+	}
+
+	n = limits->threads;
+	if(n < 1) {
+		n = 1;
+	} else if(n > HNEF_MAX_THREADS) {
+		n = HNEF_MAX_THREADS;
+	}
+
+	ok = 1;
+	for( i=0; i<n; i++ ) {
+		threads[i] = hnef_search_thread_new(&shared, i);
+		ok = ok && threads[i];
+	}
+	if(!ok) {
+		for( i=0; i<n; i++ ) {
+			hnef_search_thread_free(threads[i]);
+		}
+		return 0;
+	}
+
+	hnef_tt_new_search(tt);
+	for( i=1; i<n; i++ ) {
+		threads[i]->started = !pthread_create(&(threads[i]->handle), NULL,
+			hnef_search_worker, threads[i]);
+	}
+	hnef_search_worker(threads[0]);
+	for( i=1; i<n; i++ ) {
+		if(threads[i]->started) {
+			pthread_join(threads[i]->handle, NULL);
+		}
+	}
+
+	/* Report the calling thread's deepest completed iteration */
+	result->depth = threads[0]->depth;
+	result->score = threads[0]->score;
+	result->pv_length = threads[0]->root_pv_length;
+	memcpy(result->pv, threads[0]->root_pv, result->pv_length*sizeof(HnefMove));
+	result->best = (result->pv_length > 0)? result->pv[0] : first;
+	result->nodes = atomic_load(&(shared.nodes));
+	result->milliseconds = hnef_search_elapsed(&shared);
+
+	for( i=0; i<n; i++ ) {
+		hnef_search_thread_free(threads[i]);
+	}
+	return 1;
+}
+
+/**
+ * @brief A simple evaluation counting material. Each defender is
+ * worth two attackers, reflecting the usual two to one ratio of the
+ * starting positions.
+ *
+ * @param board The position to be evaluated
+ *
+ * @param data Unused
+ *
+ * @return The score from the side to move's point of view
+ */
+int
+hnef_search_evaluate_material( HnefBoard *board, void *data ) {
+	int score;
+
+	(void)data;
+	score = 200*hnef_bitboard_popcount(&(board->teams[HNEF_SWEDE]))
+		- 100*hnef_bitboard_popcount(&(board->teams[HNEF_MUSCOVITE]));
+	return (board->turn == HNEF_SWEDE)? score : -score;
+}
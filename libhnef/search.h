@@ -0,0 +1,74 @@
+/* libhnef/search.h
+ *
+ * Copyright (C) 2016 Gary Munnelly
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+/**
+ * @file libhnef/search.h
+ *
+ * @brief Macros, typedefs and function forward declarations for the
+ * alpha-beta search
+ *
+ * @author Gary Munnelly
+ */
+
+#ifndef LIBHNEF_SEARCH_H_
+#define LIBHNEF_SEARCH_H_
+
+#include "move.h"
+#include "tablebase.h"
+#include "tt.h"
+
+#define HNEF_MAX_PLY     64      /**< Deepest line the search will follow */
+#define HNEF_SCORE_WIN   30000   /**< Score of a won position at the root */
+#define HNEF_SCORE_MATE  (HNEF_SCORE_WIN - HNEF_MAX_PLY) /**< Scores beyond this are wins the search has seen */
+#define HNEF_SCORE_TABLEBASE (HNEF_SCORE_MATE - 1) /**< Score of a tablebase win, less its plies from the root */
+#define HNEF_SCORE_FORCED (HNEF_SCORE_TABLEBASE - HNEF_MAX_PLY - HNEF_TB_MAX_DISTANCE) /**< Scores beyond this count plies to a known result */
+#define HNEF_MAX_THREADS 256     /**< Most threads a search may use */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief A static evaluation function. Returns the score of the
+ * position from the point of view of the side to move.
+ */
+typedef int (*HnefEvaluator)( HnefBoard *board, void *data );
+
+/**
+ * @brief Parameters controlling a search
+ */
+typedef struct HnefSearchLimits {
+	int depth;                /**< Deepest iteration to complete */
+	int milliseconds;         /**< Time budget, or 0 for none */
+	int threads;              /**< Number of threads, including the caller's */
+	HnefEvaluator evaluate;   /**< Evaluation function, or NULL for the default */
+	void *evaluate_data;      /**< Passed to evaluate */
+	const HnefTablebase *tablebase; /**< Probed below the root, or NULL for none */
+} HnefSearchLimits;
+
+/**
+ * @brief The outcome of a search
+ */
+typedef struct HnefSearchResult {
+	HnefMove best;            /**< Best move for the side to move */
+	int score;                /**< Score of best from the mover's point of view */
+	int depth;                /**< Deepest iteration completed */
+	HnefMove pv[HNEF_MAX_PLY];/**< Principal variation, starting with best */
+	int pv_length;            /**< Number of moves in pv */
+	uint64_t nodes;           /**< Nodes visited by every thread */
+	int milliseconds;         /**< Wall clock time taken */
+} HnefSearchResult;
+
+void         hnef_search_limits_init       ( HnefSearchLimits *limits );
+int          hnef_search                   ( HnefBoard *b, HnefTT *tt, const HnefSearchLimits *limits, HnefSearchResult *result );
+int          hnef_search_evaluate_material ( HnefBoard *b, void *data );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBHNEF_SEARCH_H_ */
@@ -0,0 +1,426 @@
+/* libhnef/symmetry.c
+ *
+ * Copyright (C) 2016 Gary Munnelly
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+/**
+ * @file libhnef/symmetry.c
+ *
+ * @brief Code for mirroring, rotating and canonicalizing positions
+ *
+ * A square board has eight symmetries and a rectangular one four. A
+ * position and its mirror images play out identically, so books,
+ * tablebases and training sets need only keep one of them: the
+ * canonical orientation, which is the image whose planes compare
+ * smallest row by row. The images are read from the board's
+ * bitboards, transposing a plane as a bit matrix the first time a
+ * transposed image needs it and mirroring rows as they are read.
+ * Comparisons stop at the first row which differs, which in most
+ * positions lies in the king's plane. The tiles of the chosen image
+ * are then written straight from its rows.
+ *
+ * @author Gary Munnelly
+ */
+#include "symmetry.h"
+
+#define HNEF_SYMMETRY_KING    0x00 /**< Plane of the king */
+#define HNEF_SYMMETRY_ATTACK  0x01 /**< Plane of attacking tokens */
+#define HNEF_SYMMETRY_DEFEND  0x02 /**< Plane of defending tokens */
+#define HNEF_SYMMETRY_CASTLE  0x03 /**< Plane of castles */
+#define HNEF_SYMMETRY_THRONE  0x04 /**< Plane of thrones */
+#define HNEF_SYMMETRY_CAMP    0x05 /**< Plane of camps */
+#define HNEF_SYMMETRY_ESCAPE  0x06 /**< Plane of escape tiles */
+#define HNEF_SYMMETRY_PLANES  0x07 /**< Planes compared, most telling first */
+
+/**
+ * @brief The images of a position under its symmetries. Each is a
+ * mirror of the position or of its transpose, whose planes are
+ * gathered only once they are first read.
+ */
+typedef struct HnefSymmetryImages {
+	HnefBoard *board;         /**< The position */
+	int ready[2];             /**< Planes gathered, one bit each, plain and transposed */
+	uint32_t rows[2][HNEF_SYMMETRY_PLANES][2][HNEF_BITBOARD_ROWS]; /**< Rows of each plane, as they are and mirrored left to right */
+} HnefSymmetryImages;
+
+/**
+ * @brief Get the rows of plane p of the position, or of its transpose
+ * if k is set, gathering them on first use. The rows mirrored left to
+ * right follow the rows themselves.
+ */
+static const uint32_t (*hnef_symmetry_plane( HnefSymmetryImages *images, int k, int p ))[HNEF_BITBOARD_ROWS] {
+	const HnefBitboard *plane;
+	HnefBitboard t;
+	HnefBoard *b;
+	uint32_t bits;
+	int y, n, width;
+
+	if(images->ready[k] & (1 << p)) {
+		return images->rows[k][p];
+	}
+
+	b = images->board;
+	switch(p) {
+	case HNEF_SYMMETRY_KING:
+		plane = &(b->ranks[HNEF_KING]);
+		break;
+	case HNEF_SYMMETRY_ATTACK:
+		plane = &(b->teams[HNEF_MUSCOVITE]);
+		break;
+	case HNEF_SYMMETRY_DEFEND:
+		plane = &(b->teams[HNEF_SWEDE]);
+		break;
+	case HNEF_SYMMETRY_ESCAPE:
+		plane = &(b->escapes);
+		break;
+	default:
+		plane = &(b->types[HNEF_CASTLE + p - HNEF_SYMMETRY_CASTLE]);
+	}
+	if(k) {
+		hnef_bitboard_transpose(&t, plane);
+		plane = &t;
+	}
+	n = k? b->width : b->height;
+	width = k? b->height : b->width;
+	for( y=0; y<n; y++ ) {
+		bits = hnef_bitboard_get_row(plane, y);
+		images->rows[k][p][0][y] = bits;
+		images->rows[k][p][1][y] = hnef_reverse32(bits) >> (HNEF_BITBOARD_STRIDE - width);
+	}
+	images->ready[k] |= 1 << p;
+	return images->rows[k][p];
+}
+
+/**
+ * @brief Get row y of a plane's image under a transform, given the
+ * plane's rows from hnef_symmetry_plane and the height of the image
+ */
+static inline uint32_t
+hnef_symmetry_row( const uint32_t (*rows)[HNEF_BITBOARD_ROWS], int transform, int y, int height ) {
+	return rows[transform & HNEF_TRANSFORM_FLIP_X][(transform & HNEF_TRANSFORM_FLIP_Y)? height - 1 - y : y];
+}
+
+/**
+ * @brief Order the images of a position under two transforms by their
+ * planes, row by row, reading no further than the first difference.
+ * The board must be square if either transform transposes it.
+ *
+ * @return Negative, zero or positive as the image under a is smaller
+ * than, equal to or larger than the image under b
+ */
+static int
+hnef_symmetry_compare( HnefSymmetryImages *images, int a, int b ) {
+	const uint32_t (*pa)[HNEF_BITBOARD_ROWS], (*pb)[HNEF_BITBOARD_ROWS];
+	uint32_t ra, rb;
+	int p, y, height;
+
+	height = images->board->height;
+	for( p=0; p<HNEF_SYMMETRY_PLANES; p++ ) {
+		pa = hnef_symmetry_plane(images, (a & HNEF_TRANSFORM_TRANSPOSE) != 0, p);
+		pb = hnef_symmetry_plane(images, (b & HNEF_TRANSFORM_TRANSPOSE) != 0, p);
+		for( y=0; y<height; y++ ) {
+			ra = hnef_symmetry_row(pa, a, y, height);
+			rb = hnef_symmetry_row(pb, b, y, height);
+			if(ra != rb) {
+				return (ra < rb)? -1 : 1;
+			}
+		}
+	}
+	return 0;
+}
+
+/**
+ * @brief Write out every row of the image of a position under a
+ * transform of the given height
+ */
+static void
+hnef_symmetry_image( HnefSymmetryImages *images, int transform, int height,
+		     uint32_t rows[HNEF_SYMMETRY_PLANES][HNEF_BITBOARD_ROWS] ) {
+	const uint32_t (*plane)[HNEF_BITBOARD_ROWS];
+	int p, y;
+
+	for( p=0; p<HNEF_SYMMETRY_PLANES; p++ ) {
+		plane = hnef_symmetry_plane(images, (transform & HNEF_TRANSFORM_TRANSPOSE) != 0, p);
+		for( y=0; y<height; y++ ) {
+			rows[p][y] = hnef_symmetry_row(plane, transform, y, height);
+		}
+	}
+}
+
+/**
+ * @brief Compute the Zobrist key of a position from the rows of its
+ * planes, as hnef_board_compute_key would for the board they describe
+ */
+static uint64_t
+hnef_symmetry_key( uint32_t rows[HNEF_SYMMETRY_PLANES][HNEF_BITBOARD_ROWS], int height, int width, int turn ) {
+	uint32_t bits, king;
+	uint64_t key;
+	int p, y, sq;
+
+	key = hnef_zobrist_size(height, width) ^ hnef_zobrist_turn(turn);
+	for( y=0; y<height; y++ ) {
+		king = rows[HNEF_SYMMETRY_KING][y];
+		for( p=HNEF_SYMMETRY_ATTACK; p<HNEF_SYMMETRY_PLANES; p++ ) {
+			for( bits=rows[p][y]; bits; bits&=bits-1 ) {
+				sq = HNEF_SQUARE(hnef_ctz64(bits), y);
+				switch(p) {
+				case HNEF_SYMMETRY_ATTACK:
+				case HNEF_SYMMETRY_DEFEND:
+					key ^= hnef_zobrist_token(sq, p == HNEF_SYMMETRY_DEFEND, (king >> HNEF_SQUARE_X(sq)) & 1);
+					break;
+				case HNEF_SYMMETRY_ESCAPE:
+					key ^= hnef_zobrist_escape(sq);
+					break;
+				default:
+					key ^= hnef_zobrist_type(sq, HNEF_CASTLE + p - HNEF_SYMMETRY_CASTLE);
+				}
+			}
+		}
+	}
+	return key;
+}
+
+/**
+ * @brief Rebuild a board from the rows of its planes. The side to move
+ * is taken from src. dst may alias src, in which case it keeps its
+ * watcher, as sums over the tokens are the same in every image; a
+ * separate dst is left unwatched, like a board from hnef_board_copy.
+ */
+static void
+hnef_symmetry_build( HnefBoard *dst, HnefBoard *src, uint32_t rows[HNEF_SYMMETRY_PLANES][HNEF_BITBOARD_ROWS],
+		     int height, int width, uint64_t key ) {
+	HnefToken token;
+	HnefTile *tile;
+	HnefBoardWatcher watcher;
+	void *watcher_data;
+	uint32_t bits, king;
+	int turn, i, p, x, y;
+
+	turn = src->turn;
+	watcher = (dst == src)? src->watcher : NULL;
+	watcher_data = (dst == src)? src->watcher_data : NULL;
+
+	hnef_board_init(dst, height, width);
+	for( y=0; y<height; y++ ) {
+		king = rows[HNEF_SYMMETRY_KING][y];
+		hnef_bitboard_set_row(&(dst->ranks[HNEF_KING]), y, king);
+		hnef_bitboard_set_row(&(dst->teams[HNEF_MUSCOVITE]), y, rows[HNEF_SYMMETRY_ATTACK][y]);
+		hnef_bitboard_set_row(&(dst->teams[HNEF_SWEDE]), y, rows[HNEF_SYMMETRY_DEFEND][y]);
+		hnef_bitboard_set_row(&(dst->types[HNEF_CASTLE]), y, rows[HNEF_SYMMETRY_CASTLE][y]);
+		hnef_bitboard_set_row(&(dst->types[HNEF_THRONE]), y, rows[HNEF_SYMMETRY_THRONE][y]);
+		hnef_bitboard_set_row(&(dst->types[HNEF_CAMP]), y, rows[HNEF_SYMMETRY_CAMP][y]);
+		hnef_bitboard_set_row(&(dst->escapes), y, rows[HNEF_SYMMETRY_ESCAPE][y]);
+
+		/* Only tiles with something on them differ from the blank
+		 * tiles hnef_board_init left */
+		for( p=HNEF_SYMMETRY_ATTACK; p<HNEF_SYMMETRY_PLANES; p++ ) {
+			for( bits=rows[p][y]; bits; bits&=bits-1 ) {
+				x = hnef_ctz64(bits);
+				tile = &(dst->tiles[width*y + x]);
+				switch(p) {
+				case HNEF_SYMMETRY_ATTACK:
+				case HNEF_SYMMETRY_DEFEND:
+					hnef_token_init(&token, p == HNEF_SYMMETRY_DEFEND, (king >> x) & 1);
+					hnef_tile_set_token(tile, token);
+					break;
+				case HNEF_SYMMETRY_ESCAPE:
+					hnef_tile_set_is_escape(tile, HNEF_ESCAPE);
+					break;
+				default:
+					hnef_tile_set_type(tile, HNEF_CASTLE + p - HNEF_SYMMETRY_CASTLE);
+				}
+			}
+		}
+	}
+
+	hnef_bitboard_or(&(dst->occupied), &(dst->teams[HNEF_MUSCOVITE]), &(dst->teams[HNEF_SWEDE]));
+	hnef_bitboard_andnot(&(dst->ranks[HNEF_SOLDIER]), &(dst->occupied), &(dst->ranks[HNEF_KING]));
+	for( i=HNEF_CASTLE; i<=HNEF_CAMP; i++ ) {
+		hnef_bitboard_andnot(&(dst->types[HNEF_EMPTY]), &(dst->types[HNEF_EMPTY]), &(dst->types[i]));
+	}
+
+	dst->turn = turn;
+	dst->key = key;
+	dst->watcher = watcher;
+	dst->watcher_data = watcher_data;
+}
+
+/**
+ * @brief Check whether a transform can be applied to a board.
+ * Transposing symmetries need a square board.
+ *
+ * @param b The board to be transformed
+ *
+ * @param transform One of the HNEF_TRANSFORM_* codes
+ *
+ * @return True if the transform maps the board onto itself
+ */
+int
+hnef_symmetry_is_valid( HnefBoard *b, int transform ) {
+	if(transform < 0 || transform >= HNEF_TRANSFORM_COUNT) {
+		return 0;
+	}
+	return !(transform & HNEF_TRANSFORM_TRANSPOSE) || b->height == b->width;
+}
+
+/**
+ * @brief Get the transform which undoes another. A transposing
+ * transform mirrors after transposing, so its inverse mirrors the
+ * other axis.
+ *
+ * @param transform One of the HNEF_TRANSFORM_* codes
+ *
+ * @return The HNEF_TRANSFORM_* code of the inverse transform
+ */
+int
+hnef_symmetry_inverse( int transform ) {
+	if(transform & HNEF_TRANSFORM_TRANSPOSE) {
+		return HNEF_TRANSFORM_TRANSPOSE |
+			((transform & HNEF_TRANSFORM_FLIP_X)? HNEF_TRANSFORM_FLIP_Y : 0) |
+			((transform & HNEF_TRANSFORM_FLIP_Y)? HNEF_TRANSFORM_FLIP_X : 0);
+	}
+	return transform;
+}
+
+/**
+ * @brief Find where a square lands under a transform
+ *
+ * @param sq The square, as produced by HNEF_SQUARE
+ *
+ * @param transform One of the HNEF_TRANSFORM_* codes
+ *
+ * @param height The height of the board before the transform
+ *
+ * @param width The width of the board before the transform
+ *
+ * @return The square sq is carried to
+ */
+int
+hnef_symmetry_square( int sq, int transform, int height, int width ) {
+	int x, y, t;
+
+	x = HNEF_SQUARE_X(sq);
+	y = HNEF_SQUARE_Y(sq);
+	if(transform & HNEF_TRANSFORM_TRANSPOSE) {
+		t = x;
+		x = y;
+		y = t;
+		t = height;
+		height = width;
+		width = t;
+	}
+	if(transform & HNEF_TRANSFORM_FLIP_X) {
+		x = width - 1 - x;
+	}
+	if(transform & HNEF_TRANSFORM_FLIP_Y) {
+		y = height - 1 - y;
+	}
+	return HNEF_SQUARE(x, y);
+}
+
+/**
+ * @brief Find the move a move becomes under a transform. Use the
+ * inverse of the transform returned by hnef_board_canonicalize to
+ * carry a move found for the canonical position back to the original.
+ *
+ * @param move The move to be transformed
+ *
+ * @param transform One of the HNEF_TRANSFORM_* codes
+ *
+ * @param height The height of the board before the transform
+ *
+ * @param width The width of the board before the transform
+ *
+ * @return The transformed move
+ */
+HnefMove
+hnef_symmetry_move( HnefMove move, int transform, int height, int width ) {
+	HnefMove m;
+
+	m.from = hnef_symmetry_square(move.from, transform, height, width);
+	m.to = hnef_symmetry_square(move.to, transform, height, width);
+	return m;
+}
+
+/**
+ * @brief Write the image of a position under a transform to another
+ * board. dst may alias src, and keeps its watcher if it does; a
+ * separate dst is left unwatched.
+ *
+ * @param dst The board to hold the transformed position
+ *
+ * @param src The position to be transformed
+ *
+ * @param transform One of the HNEF_TRANSFORM_* codes
+ *
+ * @return True on success, false if the transform does not suit the
+ * board
+ */
+int
+hnef_board_transform( HnefBoard *dst, HnefBoard *src, int transform ) {
+	HnefSymmetryImages images;
+	uint32_t rows[HNEF_SYMMETRY_PLANES][HNEF_BITBOARD_ROWS];
+	int height, width;
+
+	if(!hnef_symmetry_is_valid(src, transform)) {
+		return 0;
+	}
+
+	height = (transform & HNEF_TRANSFORM_TRANSPOSE)? src->width : src->height;
+	width = (transform & HNEF_TRANSFORM_TRANSPOSE)? src->height : src->width;
+	images.board = src;
+	images.ready[0] = images.ready[1] = 0;
+	hnef_symmetry_image(&images, transform, height, rows);
+	hnef_symmetry_build(dst, src, rows, height, width, hnef_symmetry_key(rows, height, width, src->turn));
+	return 1;
+}
+
+/**
+ * @brief Find the canonical orientation of a position. Every image of
+ * a position under the board's symmetries has the same canonical
+ * orientation, so its key identifies the position whichever way it
+ * was reached. The key is the ordinary Zobrist key of the canonical
+ * board and may be used wherever hnef_board_get_key is.
+ *
+ * @param dst The board to hold the canonical orientation, or NULL if
+ * only the key and transform are wanted. dst may alias src, and keeps
+ * its watcher if it does; a separate dst is left unwatched.
+ *
+ * @param src The position to be canonicalized
+ *
+ * @param transform If not NULL, receives the HNEF_TRANSFORM_* code
+ * which carries src to its canonical orientation
+ *
+ * @return The Zobrist key of the canonical orientation
+ */
+uint64_t
+hnef_board_canonicalize( HnefBoard *dst, HnefBoard *src, int *transform ) {
+	HnefSymmetryImages images;
+	uint32_t rows[HNEF_SYMMETRY_PLANES][HNEF_BITBOARD_ROWS];
+	uint64_t key;
+	int n, t, best;
+
+	/* Only square boards may be transposed */
+	n = (src->height == src->width)? HNEF_TRANSFORM_COUNT : HNEF_TRANSFORM_TRANSPOSE;
+	images.board = src;
+	images.ready[0] = images.ready[1] = 0;
+
+	best = HNEF_TRANSFORM_IDENTITY;
+	for( t=1; t<n; t++ ) {
+		if(hnef_symmetry_compare(&images, t, best) < 0) {
+			best = t;
+		}
+	}
+	if(transform) {
+		*transform = best;
+	}
+
+	hnef_symmetry_image(&images, best, src->height, rows);
+	key = hnef_symmetry_key(rows, src->height, src->width, src->turn);
+	if(dst) {
+		hnef_symmetry_build(dst, src, rows, src->height, src->width, key);
+	}
+	return key;
+}
@@ -0,0 +1,38 @@
+/* libhnef/symmetry.h
+ *
+ * Copyright (C) 2016 Gary Munnelly
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+/**
+ * @file libhnef/symmetry.h
+ *
+ * @brief Function forward declarations for mirroring, rotating and
+ * canonicalizing positions
+ *
+ * @author Gary Munnelly
+ */
+
+#ifndef LIBHNEF_SYMMETRY_H_
+#define LIBHNEF_SYMMETRY_H_
+
+#include <stdint.h>
+#include "move.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int          hnef_symmetry_is_valid        ( HnefBoard *b, int transform );
+int          hnef_symmetry_inverse         ( int transform );
+int          hnef_symmetry_square          ( int sq, int transform, int height, int width );
+HnefMove     hnef_symmetry_move            ( HnefMove move, int transform, int height, int width );
+int          hnef_board_transform          ( HnefBoard *dst, HnefBoard *src, int transform );
+uint64_t     hnef_board_canonicalize       ( HnefBoard *dst, HnefBoard *src, int *transform );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBHNEF_SYMMETRY_H_ */
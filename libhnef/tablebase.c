@@ -0,0 +1,1105 @@
+/* libhnef/tablebase.c
+ *
+ * Copyright (C) 2016 Gary Munnelly
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+/**
+ * @file libhnef/tablebase.c
+ *
+ * @brief Code for generating, storing and probing endgame tablebases
+ *
+ * A table holds one byte per position: 0 for a draw, or d + 1 for a
+ * result d plies away, which is a loss for the side to move if d is
+ * even and a win if it is odd. Positions whose game is already over
+ * are marked HNEF_TB_OVER and answered from the board instead.
+ *
+ * Tables are generated smallest material first, so that the positions
+ * reached by a capture are already solved. A table is solved backwards
+ * from its terminal positions, one distance at a time. At distance n
+ * every unsolved position is examined by the worker threads: it is won
+ * in n plies if a move reaches a position lost in n - 1, and lost in n
+ * if every move reaches a position won in n - 1 plies or fewer. Moves
+ * are generated forwards rather than taken back, since taking back a
+ * capture would need the tables of larger material. Positions still
+ * unsolved once a distance adds nothing new are draws.
+ *
+ * A position's index is a perfect hash of its placement: the king's
+ * square, then the attackers' squares and the defenders' squares each
+ * ranked in the combinatorial number system among the squares left
+ * free, then the side to move. If the board's structure has all eight
+ * symmetries, every position is first turned so that its king lies in
+ * one eighth of the board.
+ *
+ * The tables are split into blocks of HNEF_TB_BLOCK values. Each block
+ * lists the distinct values it holds and packs the position of each
+ * value in that list into 0, 1, 2, 4 or 8 bits, so that any value can
+ * be read straight from the image without unpacking the block. Files
+ * are little endian and are mapped into memory where the system
+ * allows.
+ *
+ * @author Gary Munnelly
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "image.h"
+#include "tablebase.h"
+#include "symmetry.h"
+
+#define HNEF_TB_MAGIC     "HNEFTB\r\n" /**< First bytes of a tablebase file */
+#define HNEF_TB_VERSION   1        /**< Version of the file format */
+#define HNEF_TB_BLOCK     4096     /**< Values per compressed block */
+#define HNEF_TB_CHUNK     1024     /**< Positions handed to a worker at a time */
+#define HNEF_TB_HEADER    (40 + 5*HNEF_BITBOARD_WORDS*8) /**< Bytes before the directory */
+#define HNEF_TB_ENTRY     24       /**< Bytes of a directory entry */
+#define HNEF_TB_OVER      0xff     /**< Value of positions whose game is over */
+
+/**
+ * @brief State shared by the workers generating one table
+ */
+typedef struct HnefTablebaseGen {
+	HnefTablebase *tb;            /**< Tablebase under construction */
+	HnefBoard *layout;            /**< Empty board with the covered structure */
+	HnefRays rays;                /**< Ray table for the board's size */
+	int attackers;                /**< Attackers of the table being solved */
+	int defenders;                /**< Defenders of the table being solved */
+	uint64_t entries;             /**< Positions in the table */
+	atomic_uchar *values;         /**< Values solved so far */
+	int level;                    /**< Distance being solved */
+	atomic_uint_fast64_t next;    /**< Next chunk of positions to hand out */
+	size_t capacity;              /**< Bytes allocated for the image */
+	pthread_mutex_t gate;         /**< Held while helpers are being started */
+	pthread_barrier_t barrier;    /**< Marks the start and end of each sweep */
+	int done;                     /**< Set when the helpers must return */
+} HnefTablebaseGen;
+
+/**
+ * @brief State private to one worker
+ */
+typedef struct HnefTablebaseWorker {
+	HnefTablebaseGen *gen;        /**< State shared with the other workers */
+	pthread_t handle;             /**< Handle of helper threads */
+	int started;                  /**< Set once handle refers to a thread */
+	HnefBoard board;              /**< Position being examined */
+	int placed[2*HNEF_TB_MAX_PIECES + 1]; /**< Squares holding tokens */
+	int count;                    /**< Number of squares in placed */
+	HnefUndo undo[1];             /**< Storage for the undo stack */
+	HnefUndoStack stack;          /**< Undo stack of the move being tried */
+	HnefMove moves[HNEF_MAX_MOVES]; /**< Moves of the position */
+	uint64_t solved;              /**< Positions solved by this worker */
+} HnefTablebaseWorker;
+
+/**
+ * @brief Prepare the tables derived from a board layout: binomial
+ * coefficients, the images of every square under the symmetries and
+ * the king squares indexed
+ *
+ * @return True on success, false if the board is too large
+ */
+static int
+hnef_tb_setup( HnefTablebase *tb, int height, int width ) {
+	const HnefBitboard *plane;
+	HnefBitboard image;
+	int n, k, t, i, c, x, y, half, sq;
+
+	if(height < 1 || width < 1 || height*width > HNEF_TB_MAX_AREA) {
+		return 0;
+	}
+	tb->height = height;
+	tb->width = width;
+	tb->area = height*width;
+
+	for( n=0; n<=tb->area; n++ ) {
+		tb->binomial[n][0] = 1;
+		for( k=1; k<=HNEF_TB_MAX_PIECES; k++ ) {
+			tb->binomial[n][k] = n? tb->binomial[n-1][k-1] + tb->binomial[n-1][k] : 0;
+		}
+	}
+
+	/* The king may be confined to one eighth of the board only if
+	 * every symmetry maps the structure onto itself */
+	tb->symmetric = (height == width);
+	for( t=1; t<HNEF_TRANSFORM_COUNT && tb->symmetric; t++ ) {
+		for( i=HNEF_CASTLE; i<=HNEF_CAMP + 1; i++ ) {
+			plane = (i <= HNEF_CAMP)? &(tb->types[i]) : &(tb->escapes);
+			hnef_bitboard_transform(&image, plane, t, height, width);
+			if(memcmp(&image, plane, sizeof(image))) {
+				tb->symmetric = 0;
+			}
+		}
+	}
+
+	for( t=0; t<HNEF_TRANSFORM_COUNT; t++ ) {
+		for( c=0; c<tb->area; c++ ) {
+			if(tb->symmetric || t == HNEF_TRANSFORM_IDENTITY) {
+				sq = hnef_symmetry_square(HNEF_SQUARE(c % width, c / width), t, height, width);
+				tb->map[t][c] = HNEF_SQUARE_Y(sq)*width + HNEF_SQUARE_X(sq);
+			} else {
+				tb->map[t][c] = c;
+			}
+		}
+	}
+
+	/* With the symmetries the king is kept to the squares with
+	 * x <= y <= half. Each square is sent there by the first
+	 * transform which does so. */
+	half = (height - 1) / 2;
+	tb->kings = 0;
+	for( c=0; c<tb->area; c++ ) {
+		x = c % width;
+		y = c / width;
+		if(!tb->symmetric || (x <= y && y <= half)) {
+			tb->king_square[tb->kings++] = c;
+		}
+	}
+	for( c=0; c<tb->area; c++ ) {
+		tb->king_transform[c] = HNEF_TRANSFORM_IDENTITY;
+		tb->king_index[c] = c;
+		for( t=0; tb->symmetric && t<HNEF_TRANSFORM_COUNT; t++ ) {
+			x = tb->map[t][c] % width;
+			y = tb->map[t][c] / width;
+			if(x <= y && y <= half) {
+				break;
+			}
+		}
+		if(tb->symmetric) {
+			tb->king_transform[c] = t;
+			i = 0;
+			while( tb->king_square[i] != tb->map[t][c] ) {
+				i++;
+			}
+			tb->king_index[c] = i;
+		}
+	}
+	return 1;
+}
+
+/**
+ * @brief Number of positions in the table of a material balance
+ */
+static uint64_t
+hnef_tb_entries( const HnefTablebase *tb, int attackers, int defenders ) {
+	return (uint64_t)tb->kings * tb->binomial[tb->area - 1][attackers]
+		* tb->binomial[tb->area - 1 - attackers][defenders] * 2;
+}
+
+/**
+ * @brief Rank a sorted set of k numbers in the combinatorial number
+ * system
+ */
+static uint64_t
+hnef_tb_rank( const HnefTablebase *tb, const int *r, int k ) {
+	uint64_t rank;
+	int i;
+
+	rank = 0;
+	for( i=0; i<k; i++ ) {
+		rank += tb->binomial[r[i]][i+1];
+	}
+	return rank;
+}
+
+/**
+ * @brief Recover the sorted set of k numbers below n with the given
+ * rank
+ */
+static void
+hnef_tb_unrank( const HnefTablebase *tb, uint64_t rank, int k, int n, int *r ) {
+	int i, c;
+
+	c = n;
+	for( i=k; i>0; i-- ) {
+		do {
+			c--;
+		} while( tb->binomial[c][i] > rank );
+		r[i-1] = c;
+		rank -= tb->binomial[c][i];
+	}
+}
+
+/**
+ * @brief Sort a few numbers into ascending order
+ */
+static void
+hnef_tb_sort( int *r, int n ) {
+	int i, j, v;
+
+	for( i=1; i<n; i++ ) {
+		v = r[i];
+		for( j=i; j>0 && r[j-1] > v; j-- ) {
+			r[j] = r[j-1];
+		}
+		r[j] = v;
+	}
+}
+
+/**
+ * @brief Gather the squares of a set as board cells, turned by a
+ * transform
+ *
+ * @return The number of squares gathered
+ */
+static int
+hnef_tb_cells( const HnefTablebase *tb, const HnefBitboard *bb, int t, int *cells ) {
+	uint64_t w;
+	int i, n, sq;
+
+	n = 0;
+	for( i=0; i<HNEF_BITBOARD_WORDS; i++ ) {
+		for( w=bb->words[i]; w; w&=w-1 ) {
+			sq = i*64 + hnef_ctz64(w);
+			cells[n++] = tb->map[t][HNEF_SQUARE_Y(sq)*tb->width + HNEF_SQUARE_X(sq)];
+		}
+	}
+	return n;
+}
+
+/**
+ * @brief Index of a position in the table of its material balance.
+ * The board must hold a king and the given numbers of tokens.
+ */
+static uint64_t
+hnef_tb_index( const HnefTablebase *tb, HnefBoard *b, int attackers, int defenders ) {
+	HnefBitboard soldiers;
+	int att[HNEF_TB_MAX_PIECES], def[HNEF_TB_MAX_PIECES], r[HNEF_TB_MAX_PIECES], k, c, t, i, j;
+	uint64_t index;
+
+	hnef_tb_cells(tb, &(b->ranks[HNEF_KING]), HNEF_TRANSFORM_IDENTITY, &c);
+	t = tb->king_transform[c];
+	index = tb->king_index[c];
+	k = tb->map[t][c];
+
+	/* Attackers are ranked among the squares the king leaves */
+	hnef_tb_cells(tb, &(b->teams[HNEF_MUSCOVITE]), t, att);
+	hnef_tb_sort(att, attackers);
+	for( i=0; i<attackers; i++ ) {
+		r[i] = att[i] - (att[i] > k);
+	}
+	index = index*tb->binomial[tb->area - 1][attackers] + hnef_tb_rank(tb, r, attackers);
+
+	/* Defenders among the squares the king and attackers leave */
+	hnef_bitboard_andnot(&soldiers, &(b->teams[HNEF_SWEDE]), &(b->ranks[HNEF_KING]));
+	hnef_tb_cells(tb, &soldiers, t, def);
+	hnef_tb_sort(def, defenders);
+	for( i=0; i<defenders; i++ ) {
+		r[i] = def[i] - (def[i] > k);
+		for( j=0; j<attackers; j++ ) {
+			r[i] -= (att[j] < def[i]);
+		}
+	}
+	index = index*tb->binomial[tb->area - 1 - attackers][defenders] + hnef_tb_rank(tb, r, defenders);
+
+	return index*2 + (b->turn == HNEF_SWEDE);
+}
+
+/**
+ * @brief Read one value of a table from the image
+ */
+static int
+hnef_tb_value( const HnefTablebase *tb, const HnefTablebaseTable *table, uint64_t index ) {
+	const uint8_t *block, *palette, *data;
+	int bits, i;
+
+	block = tb->image + hnef_image_get64(tb->image + table->offset + 8*(index / HNEF_TB_BLOCK));
+	i = (int)(index % HNEF_TB_BLOCK);
+	bits = block[0];
+	palette = block + 2;
+	if(bits == 8) {
+		return palette[i];
+	}
+	if(bits == 0) {
+		return palette[0];
+	}
+	data = palette + block[1] + 1;
+	return palette[(data[(i*bits) >> 3] >> ((i*bits) & 7)) & ((1 << bits) - 1)];
+}
+
+/**
+ * @brief Check that a board matches the layout a tablebase covers
+ */
+static int
+hnef_tb_covers( const HnefTablebase *tb, HnefBoard *b ) {
+	int i;
+
+	if(!tb->image || b->height != tb->height || b->width != tb->width) {
+		return 0;
+	}
+	for( i=HNEF_CASTLE; i<=HNEF_CAMP; i++ ) {
+		if(memcmp(&(b->types[i]), &(tb->types[i]), sizeof(HnefBitboard))) {
+			return 0;
+		}
+	}
+	return !memcmp(&(b->escapes), &(tb->escapes), sizeof(HnefBitboard));
+}
+
+/**
+ * @brief Value of the position on a worker's board, which must hold a
+ * king, from the table being solved or a smaller one
+ */
+static int
+hnef_tb_lookup( HnefTablebaseWorker *w ) {
+	HnefTablebaseGen *gen;
+	HnefBoard *b;
+	uint64_t index;
+	int attackers, defenders;
+
+	gen = w->gen;
+	b = &(w->board);
+	attackers = hnef_bitboard_popcount(&(b->teams[HNEF_MUSCOVITE]));
+	defenders = hnef_bitboard_popcount(&(b->teams[HNEF_SWEDE])) - 1;
+	index = hnef_tb_index(gen->tb, b, attackers, defenders);
+	if(attackers == gen->attackers && defenders == gen->defenders) {
+		return atomic_load_explicit(&(gen->values[index]), memory_order_relaxed);
+	}
+	return hnef_tb_value(gen->tb, &(gen->tb->tables[attackers][defenders]), index);
+}
+
+/**
+ * @brief Set up the position with the given index on a worker's board
+ */
+static void
+hnef_tb_place( HnefTablebaseWorker *w, uint64_t index ) {
+	const HnefTablebase *tb;
+	HnefBoard *b;
+	HnefToken token;
+	int occupied[HNEF_TB_MAX_PIECES + 1], r[HNEF_TB_MAX_PIECES];
+	int a, d, k, c, i, j, turn;
+	uint64_t ca, cd, rank;
+
+	tb = w->gen->tb;
+	b = &(w->board);
+	a = w->gen->attackers;
+	d = w->gen->defenders;
+	ca = tb->binomial[tb->area - 1][a];
+	cd = tb->binomial[tb->area - 1 - a][d];
+
+	turn = (int)(index & 1);
+	index >>= 1;
+	rank = index % cd;
+	index /= cd;
+	k = tb->king_square[index / ca];
+
+	for( i=0; i<w->count; i++ ) {
+		hnef_board_unset_token(b, w->placed[i] % tb->width, w->placed[i] / tb->width);
+	}
+	w->count = 0;
+
+	hnef_token_init(&token, HNEF_SWEDE, HNEF_KING);
+	hnef_board_set_token(b, k % tb->width, k / tb->width, token);
+	w->placed[w->count++] = k;
+	occupied[0] = k;
+
+	/* Undo the ranking of hnef_tb_index */
+	hnef_token_init(&token, HNEF_MUSCOVITE, HNEF_SOLDIER);
+	hnef_tb_unrank(tb, index % ca, a, tb->area - 1, r);
+	for( i=0; i<a; i++ ) {
+		c = r[i] + (r[i] >= k);
+		hnef_board_set_token(b, c % tb->width, c / tb->width, token);
+		w->placed[w->count++] = c;
+		occupied[1 + i] = c;
+	}
+
+	hnef_tb_sort(occupied, 1 + a);
+	hnef_token_init(&token, HNEF_SWEDE, HNEF_SOLDIER);
+	hnef_tb_unrank(tb, rank, d, tb->area - 1 - a, r);
+	for( i=0; i<d; i++ ) {
+		c = r[i];
+		for( j=0; j<=a; j++ ) {
+			c += (occupied[j] <= c);
+		}
+		hnef_board_set_token(b, c % tb->width, c / tb->width, token);
+		w->placed[w->count++] = c;
+	}
+
+	hnef_board_set_turn(b, turn? HNEF_SWEDE : HNEF_MUSCOVITE);
+}
+
+/**
+ * @brief Try to solve one position at the distance being solved
+ *
+ * @return The position's value, or 0 if it stays unsolved
+ */
+static int
+hnef_tb_solve( HnefTablebaseWorker *w, uint64_t index ) {
+	HnefTablebaseGen *gen;
+	HnefBoard *b;
+	int n, i, v, open, worst, winner;
+
+	gen = w->gen;
+	b = &(w->board);
+	hnef_tb_place(w, index);
+
+	if(gen->level == 0) {
+		if(hnef_board_get_winner(b) != HNEF_NO_WINNER) {
+			return HNEF_TB_OVER;
+		}
+		/* A team with no moves loses */
+		return hnef_board_generate_moves(b, &(gen->rays), b->turn, w->moves, HNEF_MAX_MOVES)? 0 : 1;
+	}
+
+	n = hnef_board_generate_moves(b, &(gen->rays), b->turn, w->moves, HNEF_MAX_MOVES);
+	open = 0;
+	worst = 0;
+	for( i=0; i<n; i++ ) {
+		hnef_board_make_move(b, w->moves[i], &(w->stack));
+		winner = hnef_board_get_winner(b);
+		if(winner == HNEF_NO_WINNER) {
+			v = hnef_tb_lookup(w);
+		} else {
+			/* A move can only win the game for the side making it */
+			v = 1;
+		}
+		hnef_board_unmake_move(b, &(w->stack));
+
+		/* Values found at this distance by other workers are left
+		 * for the next */
+		if(v == 0 || v > gen->level) {
+			open = 1;
+		} else if(((v - 1) & 1) == 0) {
+			/* Any win found now is as short as the position has,
+			 * or it would have been solved at an earlier distance */
+			return v + 1;
+		} else if(v > worst) {
+			worst = v;
+		}
+	}
+	return open? 0 : worst + 1;
+}
+
+/**
+ * @brief Examine chunks of positions until none remain
+ */
+static void
+hnef_tb_examine( HnefTablebaseWorker *w ) {
+	HnefTablebaseGen *gen;
+	uint64_t i, first, last;
+	int v;
+
+	gen = w->gen;
+	for( ;; ) {
+		first = atomic_fetch_add(&(gen->next), 1) * HNEF_TB_CHUNK;
+		if(first >= gen->entries) {
+			break;
+		}
+		last = (first + HNEF_TB_CHUNK < gen->entries)? first + HNEF_TB_CHUNK : gen->entries;
+		for( i=first; i<last; i++ ) {
+			if(gen->level > 0 && atomic_load_explicit(&(gen->values[i]), memory_order_relaxed)) {
+				continue;
+			}
+			v = hnef_tb_solve(w, i);
+			if(v) {
+				atomic_store_explicit(&(gen->values[i]), v, memory_order_relaxed);
+				w->solved++;
+			}
+		}
+	}
+}
+
+/**
+ * @brief Run a helper, which takes part in every sweep of a generation
+ * until it is told to stop
+ */
+static void*
+hnef_tb_helper( void *arg ) {
+	HnefTablebaseWorker *w;
+	HnefTablebaseGen *gen;
+
+	w = arg;
+	gen = w->gen;
+
+	/* The barrier is sized once every helper has been started */
+	pthread_mutex_lock(&(gen->gate));
+	pthread_mutex_unlock(&(gen->gate));
+
+	for( ;; ) {
+		pthread_barrier_wait(&(gen->barrier));
+		if(gen->done) {
+			break;
+		}
+		hnef_tb_examine(w);
+		pthread_barrier_wait(&(gen->barrier));
+	}
+	return NULL;
+}
+
+/**
+ * @brief Start up to n - 1 helpers for a generation
+ *
+ * @return The number of helpers started
+ */
+static int
+hnef_tb_start( HnefTablebaseGen *gen, HnefTablebaseWorker **workers, int n ) {
+	int i, started;
+
+	gen->done = 0;
+	started = 0;
+	pthread_mutex_init(&(gen->gate), NULL);
+	pthread_mutex_lock(&(gen->gate));
+	for( i=1; i<n; i++ ) {
+		workers[i]->started = !pthread_create(&(workers[i]->handle), NULL, hnef_tb_helper, workers[i]);
+		started += workers[i]->started;
+	}
+	pthread_barrier_init(&(gen->barrier), NULL, started + 1);
+	pthread_mutex_unlock(&(gen->gate));
+	return started;
+}
+
+/**
+ * @brief Tell the helpers of a generation to return and wait for them
+ */
+static void
+hnef_tb_stop( HnefTablebaseGen *gen, HnefTablebaseWorker **workers, int n ) {
+	int i;
+
+	gen->done = 1;
+	pthread_barrier_wait(&(gen->barrier));
+	for( i=1; i<n; i++ ) {
+		if(workers[i]->started) {
+			pthread_join(workers[i]->handle, NULL);
+		}
+	}
+	pthread_barrier_destroy(&(gen->barrier));
+	pthread_mutex_destroy(&(gen->gate));
+}
+
+/**
+ * @brief Examine every position of the table once, sharing them out
+ * between the calling thread and the helpers started for the
+ * generation
+ *
+ * @return The number of positions solved
+ */
+static uint64_t
+hnef_tb_sweep( HnefTablebaseGen *gen, HnefTablebaseWorker **workers, int n ) {
+	uint64_t solved;
+	int i;
+
+	atomic_store(&(gen->next), 0);
+	for( i=0; i<n; i++ ) {
+		workers[i]->solved = 0;
+	}
+
+	/* The first wait sets the helpers going, the second waits for
+	 * them to run out of positions */
+	pthread_barrier_wait(&(gen->barrier));
+	hnef_tb_examine(workers[0]);
+	pthread_barrier_wait(&(gen->barrier));
+
+	solved = 0;
+	for( i=0; i<n; i++ ) {
+		solved += workers[i]->solved;
+	}
+	return solved;
+}
+
+/**
+ * @brief Make room for more bytes at the end of the image
+ *
+ * @return A pointer to the first new byte, or NULL if memory could not
+ * be allocated
+ */
+static uint8_t*
+hnef_tb_grow( HnefTablebaseGen *gen, size_t bytes ) {
+	HnefTablebase *tb;
+	uint8_t *image;
+	size_t capacity;
+
+	tb = gen->tb;
+	if(tb->size + bytes > gen->capacity) {
+		capacity = gen->capacity? gen->capacity : 4096;
+		while( capacity < tb->size + bytes ) {
+			capacity *= 2;
+		}
+		image = realloc(tb->image, capacity);
+		if(!image) {
+			return NULL;
+		}
+		tb->image = image;
+		gen->capacity = capacity;
+	}
+	tb->size += bytes;
+	return tb->image + tb->size - bytes;
+}
+
+/**
+ * @brief Append the solved table to the image as compressed blocks
+ *
+ * @return True on success, false if memory could not be allocated
+ */
+static int
+hnef_tb_compress( HnefTablebaseGen *gen, HnefTablebaseTable *table ) {
+	HnefTablebase *tb;
+	uint8_t values[HNEF_TB_BLOCK], palette[256], lookup[256], present[256], *p;
+	uint64_t block, first;
+	int len, n, bits, i, v;
+
+	tb = gen->tb;
+	table->entries = gen->entries;
+	table->blocks = (gen->entries + HNEF_TB_BLOCK - 1) / HNEF_TB_BLOCK;
+	table->offset = tb->size;
+	if(!hnef_tb_grow(gen, (table->blocks + 1)*8)) {
+		return 0;
+	}
+
+	for( block=0; block<table->blocks; block++ ) {
+		first = block*HNEF_TB_BLOCK;
+		len = (gen->entries - first < HNEF_TB_BLOCK)? (int)(gen->entries - first) : HNEF_TB_BLOCK;
+
+		/* List the distinct values in ascending order */
+		memset(present, 0, sizeof(present));
+		for( i=0; i<len; i++ ) {
+			values[i] = atomic_load_explicit(&(gen->values[first + i]), memory_order_relaxed);
+			present[values[i]] = 1;
+		}
+		n = 0;
+		for( v=0; v<256; v++ ) {
+			if(present[v]) {
+				lookup[v] = n;
+				palette[n++] = v;
+			}
+		}
+		bits = (n <= 1)? 0 : (n <= 2)? 1 : (n <= 4)? 2 : (n <= 16)? 4 : 8;
+
+		hnef_image_put64(tb->image + table->offset + 8*block, tb->size);
+		p = hnef_tb_grow(gen, 2 + ((bits == 8)? len : n + (len*bits + 7)/8));
+		if(!p) {
+			return 0;
+		}
+		p[0] = bits;
+		p[1] = n - 1;
+		if(bits == 8) {
+			memcpy(p + 2, values, len);
+			continue;
+		}
+		memcpy(p + 2, palette, n);
+		p += 2 + n;
+		memset(p, 0, (len*bits + 7)/8);
+		for( i=0; bits && i<len; i++ ) {
+			p[(i*bits) >> 3] |= lookup[values[i]] << ((i*bits) & 7);
+		}
+	}
+	hnef_image_put64(tb->image + table->offset + 8*table->blocks, tb->size);
+	return 1;
+}
+
+/**
+ * @brief Write the header and directory at the start of the image
+ */
+static void
+hnef_tb_write_header( HnefTablebase *tb ) {
+	const HnefBitboard *plane;
+	uint8_t *p;
+	int a, d, i, j;
+
+	p = tb->image;
+	memcpy(p, HNEF_TB_MAGIC, 8);
+	hnef_image_put32(p + 8, HNEF_TB_VERSION);
+	hnef_image_put32(p + 12, tb->height);
+	hnef_image_put32(p + 16, tb->width);
+	hnef_image_put32(p + 20, tb->max_attackers);
+	hnef_image_put32(p + 24, tb->max_defenders);
+	hnef_image_put32(p + 28, tb->symmetric);
+	hnef_image_put32(p + 32, HNEF_TB_BLOCK);
+	hnef_image_put32(p + 36, 0);
+	for( i=0; i<5; i++ ) {
+		plane = (i < 4)? &(tb->types[i]) : &(tb->escapes);
+		for( j=0; j<HNEF_BITBOARD_WORDS; j++ ) {
+			hnef_image_put64(p + 40 + (i*HNEF_BITBOARD_WORDS + j)*8, plane->words[j]);
+		}
+	}
+
+	p += HNEF_TB_HEADER;
+	for( a=0; a<=tb->max_attackers; a++ ) {
+		for( d=0; d<=tb->max_defenders; d++ ) {
+			hnef_image_put64(p, tb->tables[a][d].entries);
+			hnef_image_put64(p + 8, tb->tables[a][d].blocks);
+			hnef_image_put64(p + 16, tb->tables[a][d].offset);
+			p += HNEF_TB_ENTRY;
+		}
+	}
+}
+
+/**
+ * @brief Solve every position with a king and up to the given numbers
+ * of attackers and defenders on a board layout. Generation time and
+ * size grow steeply with the material: a few tokens on a 7x7 board
+ * take seconds, while a handful on 9x9 take minutes.
+ *
+ * @param tb The tablebase to be generated
+ *
+ * @param layout A board whose structure and escape tiles the tablebase
+ * covers. Its tokens are ignored, and it is not changed
+ *
+ * @param attackers The most attackers covered
+ *
+ * @param defenders The most defenders covered, not counting the king
+ *
+ * @param threads The number of threads to use, including the caller's
+ *
+ * @return True on success, false if the material is out of range, a
+ * result lies further than HNEF_TB_MAX_DISTANCE plies away or memory
+ * could not be allocated
+ */
+int
+hnef_tablebase_generate( HnefTablebase *tb, HnefBoard *layout, int attackers, int defenders, int threads ) {
+	HnefTablebaseGen gen;
+	HnefTablebaseWorker *workers[HNEF_TB_MAX_THREADS];
+	HnefBoard *empty;
+	HnefBitboard occupied;
+	int a, d, i, ok, helping, sq, deepest, longest;
+	uint64_t solved;
+
+	memset(tb, 0, sizeof(HnefTablebase));
+	if(attackers < 0 || attackers > HNEF_TB_MAX_PIECES || defenders < 0 || defenders > HNEF_TB_MAX_PIECES ||
+	   attackers + defenders >= layout->area) {
+		return 0;
+	}
+	for( i=0; i<4; i++ ) {
+		tb->types[i] = layout->types[i];
+	}
+	tb->escapes = layout->escapes;
+	if(!hnef_tb_setup(tb, layout->height, layout->width)) {
+		return 0;
+	}
+	tb->max_attackers = attackers;
+	tb->max_defenders = defenders;
+	threads = (threads < 1)? 1 : (threads > HNEF_TB_MAX_THREADS)? HNEF_TB_MAX_THREADS : threads;
+
+	/* Workers start from the layout with its tokens removed, and
+	 * without the layout's watcher */
+	empty = malloc(sizeof(HnefBoard));
+	if(!empty) {
+		return 0;
+	}
+	hnef_board_copy(empty, layout);
+	occupied = layout->occupied;
+	while( !hnef_bitboard_is_empty(&occupied) ) {
+		sq = hnef_bitboard_first(&occupied);
+		hnef_bitboard_unset(&occupied, sq);
+		hnef_board_unset_token(empty, HNEF_SQUARE_X(sq), HNEF_SQUARE_Y(sq));
+	}
+
+	memset(&gen, 0, sizeof(gen));
+	gen.tb = tb;
+	gen.layout = empty;
+	hnef_rays_init(&(gen.rays), tb->height, tb->width);
+	ok = hnef_tb_grow(&gen, HNEF_TB_HEADER + (attackers + 1)*(defenders + 1)*HNEF_TB_ENTRY) != NULL;
+	for( i=0; i<threads; i++ ) {
+		workers[i] = ok? malloc(sizeof(HnefTablebaseWorker)) : NULL;
+		if(workers[i]) {
+			workers[i]->gen = &gen;
+			hnef_board_copy(&(workers[i]->board), empty);
+			workers[i]->count = 0;
+			hnef_undo_stack_init(&(workers[i]->stack), workers[i]->undo, 1);
+		}
+		ok = ok && workers[i];
+	}
+	helping = ok;
+	if(helping) {
+		hnef_tb_start(&gen, workers, threads);
+	}
+
+	/* Captures only ever lead to tables solved before */
+	longest = 0;
+	for( a=0; ok && a<=attackers; a++ ) {
+		for( d=0; ok && d<=defenders; d++ ) {
+			gen.attackers = a;
+			gen.defenders = d;
+			gen.entries = hnef_tb_entries(tb, a, d);
+			gen.values = calloc(gen.entries, sizeof(atomic_uchar));
+			if(!gen.values) {
+				ok = 0;
+				break;
+			}
+
+			/* Stop once a distance solves nothing and no smaller
+			 * table has a longer result to build on */
+			deepest = 0;
+			for( gen.level=0; ; gen.level++ ) {
+				if(gen.level > HNEF_TB_MAX_DISTANCE) {
+					ok = 0;
+					break;
+				}
+				solved = hnef_tb_sweep(&gen, workers, threads);
+				if(solved) {
+					deepest = gen.level;
+				} else if(gen.level > longest) {
+					break;
+				}
+			}
+			if(deepest > longest) {
+				longest = deepest;
+			}
+
+			ok = ok && hnef_tb_compress(&gen, &(tb->tables[a][d]));
+			free(gen.values);
+		}
+	}
+
+	if(helping) {
+		hnef_tb_stop(&gen, workers, threads);
+	}
+	for( i=0; i<threads; i++ ) {
+		free(workers[i]);
+	}
+	free(empty);
+	if(!ok) {
+		free(tb->image);
+		tb->image = NULL;
+		tb->size = 0;
+		return 0;
+	}
+	hnef_tb_write_header(tb);
+	return 1;
+}
+
+/**
+ * @brief Write a tablebase to a file
+ *
+ * @param tb The tablebase to be written
+ *
+ * @param path The file to be written
+ *
+ * @return True on success, false if the file could not be written
+ */
+int
+hnef_tablebase_save( const HnefTablebase *tb, const char *path ) {
+	FILE *f;
+	int ok;
+
+	if(!tb->image) {
+		return 0;
+	}
+	f = fopen(path, "wb");
+	if(!f) {
+		return 0;
+	}
+	ok = fwrite(tb->image, 1, tb->size, f) == tb->size;
+	return (fclose(f) == 0) && ok;
+}
+
+/**
+ * @brief Check that every block of a table lies within the image and
+ * has a header hnef_tb_value can read, since probes make no checks of
+ * their own
+ *
+ * @return True if the table is sound
+ */
+static int
+hnef_tb_check_blocks( const HnefTablebase *tb, const HnefTablebaseTable *table ) {
+	const uint8_t *block;
+	uint64_t i, offset, length;
+	int bits, n, len;
+
+	for( i=0; i<table->blocks; i++ ) {
+		offset = hnef_image_get64(tb->image + table->offset + 8*i);
+		if(offset > tb->size || tb->size - offset < 2) {
+			return 0;
+		}
+		block = tb->image + offset;
+		bits = block[0];
+		n = block[1] + 1;
+		len = (i + 1 < table->blocks)? HNEF_TB_BLOCK : (int)(table->entries - i*HNEF_TB_BLOCK);
+		if(bits == 8) {
+			length = len;
+		} else if((bits == 0 || bits == 1 || bits == 2 || bits == 4) && n <= (1 << bits)) {
+			length = n + ((uint64_t)len*bits + 7)/8;
+		} else {
+			return 0;
+		}
+		if(length > tb->size - offset - 2) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/**
+ * @brief Open a tablebase file written by hnef_tablebase_save. The
+ * tables are mapped into memory rather than read, so pages are only
+ * loaded as probes touch them. The header of every block is checked
+ * here, so that probes need not check anything.
+ *
+ * @param tb The tablebase to be opened
+ *
+ * @param path The file to be opened
+ *
+ * @return True on success, false if the file could not be read or is
+ * not a tablebase of this version
+ */
+int
+hnef_tablebase_open( HnefTablebase *tb, const char *path ) {
+	HnefTablebaseTable *table;
+	HnefBitboard *plane;
+	const uint8_t *p;
+	int a, d, i, j, ok;
+
+	/* Probes land anywhere in the file */
+	memset(tb, 0, sizeof(HnefTablebase));
+	if(!hnef_image_load(path, HNEF_IMAGE_RANDOM, &(tb->image), &(tb->size), &(tb->mapped))) {
+		return 0;
+	}
+
+	p = tb->image;
+	ok = tb->size >= HNEF_TB_HEADER && !memcmp(p, HNEF_TB_MAGIC, 8) &&
+		hnef_image_get32(p + 8) == HNEF_TB_VERSION && hnef_image_get32(p + 32) == HNEF_TB_BLOCK;
+	if(ok) {
+		tb->max_attackers = hnef_image_get32(p + 20);
+		tb->max_defenders = hnef_image_get32(p + 24);
+		ok = tb->max_attackers <= HNEF_TB_MAX_PIECES && tb->max_defenders <= HNEF_TB_MAX_PIECES &&
+			tb->size >= HNEF_TB_HEADER + (size_t)(tb->max_attackers + 1)*(tb->max_defenders + 1)*HNEF_TB_ENTRY;
+	}
+	if(ok) {
+		for( i=0; i<5; i++ ) {
+			plane = (i < 4)? &(tb->types[i]) : &(tb->escapes);
+			for( j=0; j<HNEF_BITBOARD_WORDS; j++ ) {
+				plane->words[j] = hnef_image_get64(p + 40 + (i*HNEF_BITBOARD_WORDS + j)*8);
+			}
+		}
+		ok = hnef_tb_setup(tb, hnef_image_get32(p + 12), hnef_image_get32(p + 16)) &&
+			(uint32_t)tb->symmetric == hnef_image_get32(p + 28);
+	}
+
+	/* Check that every table lies within the file */
+	p += HNEF_TB_HEADER;
+	for( a=0; ok && a<=tb->max_attackers; a++ ) {
+		for( d=0; ok && d<=tb->max_defenders; d++ ) {
+			table = &(tb->tables[a][d]);
+			table->entries = hnef_image_get64(p);
+			table->blocks = hnef_image_get64(p + 8);
+			table->offset = hnef_image_get64(p + 16);
+			p += HNEF_TB_ENTRY;
+			ok = table->entries == hnef_tb_entries(tb, a, d) &&
+				table->blocks == (table->entries + HNEF_TB_BLOCK - 1) / HNEF_TB_BLOCK &&
+				table->offset <= tb->size && (table->blocks + 1)*8 <= tb->size - table->offset &&
+				hnef_image_get64(tb->image + table->offset + 8*table->blocks) <= tb->size &&
+				hnef_tb_check_blocks(tb, table);
+		}
+	}
+
+	if(!ok) {
+		hnef_tablebase_free(tb);
+	}
+	return ok;
+}
+
+/**
+ * @brief Release the memory or mapping held by a tablebase
+ *
+ * @param tb The tablebase to be released
+ */
+void
+hnef_tablebase_free( HnefTablebase *tb ) {
+	hnef_image_free(tb->image, tb->size, tb->mapped);
+	tb->image = NULL;
+	tb->size = 0;
+	tb->mapped = 0;
+}
+
+/**
+ * @brief Look up the result of a position. Cheap enough to be called
+ * at every node of a search.
+ *
+ * @param tb The tablebase to be probed
+ *
+ * @param b The position to be looked up
+ *
+ * @param distance If not NULL, receives the number of plies to the end
+ * of the game with best play, or 0 for a draw
+ *
+ * @return HNEF_TB_WIN or HNEF_TB_LOSS for the side to move,
+ * HNEF_TB_DRAW, or HNEF_TB_UNKNOWN if the tablebase does not cover the
+ * position
+ */
+int
+hnef_tablebase_probe( const HnefTablebase *tb, HnefBoard *b, int *distance ) {
+	HnefBitboard king;
+	int attackers, defenders, winner, v;
+
+	if(distance) {
+		*distance = 0;
+	}
+
+	/* Positions are indexed by the square of one defending king */
+	hnef_bitboard_and(&king, &(b->ranks[HNEF_KING]), &(b->teams[HNEF_SWEDE]));
+	if(hnef_bitboard_popcount(&(b->ranks[HNEF_KING])) != 1 || hnef_bitboard_popcount(&king) != 1) {
+		return HNEF_TB_UNKNOWN;
+	}
+	attackers = hnef_bitboard_popcount(&(b->teams[HNEF_MUSCOVITE]));
+	defenders = hnef_bitboard_popcount(&(b->teams[HNEF_SWEDE])) - 1;
+	if(attackers > tb->max_attackers || defenders > tb->max_defenders || !hnef_tb_covers(tb, b)) {
+		return HNEF_TB_UNKNOWN;
+	}
+
+	winner = hnef_board_get_winner(b);
+	if(winner != HNEF_NO_WINNER) {
+		return (winner == b->turn)? HNEF_TB_WIN : HNEF_TB_LOSS;
+	}
+
+	v = hnef_tb_value(tb, &(tb->tables[attackers][defenders]), hnef_tb_index(tb, b, attackers, defenders));
+	if(v == 0) {
+		return HNEF_TB_DRAW;
+	}
+	if(v == HNEF_TB_OVER) {
+		return HNEF_TB_UNKNOWN;
+	}
+	if(distance) {
+		*distance = v - 1;
+	}
+	return ((v - 1) & 1)? HNEF_TB_WIN : HNEF_TB_LOSS;
+}
+
+/**
+ * @brief Find the move which keeps the best result a tablebase
+ * position has: the quickest win, a draw, or the slowest loss
+ *
+ * @param tb The tablebase to be probed
+ *
+ * @param b The position. It is modified while moves are tried but
+ * restored before returning
+ *
+ * @param rays The ray table for the board's size
+ *
+ * @param move Receives the best move, if the side to move has one
+ *
+ * @param distance If not NULL, receives the number of plies to the end
+ * of the game with best play, or 0 for a draw
+ *
+ * @return The result of the position, as hnef_tablebase_probe
+ */
+int
+hnef_tablebase_best_move( const HnefTablebase *tb, HnefBoard *b, const HnefRays *rays, HnefMove *move, int *distance ) {
+	HnefMove moves[HNEF_MAX_MOVES];
+	HnefUndo undo[1];
+	HnefUndoStack stack;
+	int result, n, i, r, d, best, score;
+
+	result = hnef_tablebase_probe(tb, b, distance);
+	if(result == HNEF_TB_UNKNOWN || hnef_board_get_winner(b) != HNEF_NO_WINNER) {
+		return result;
+	}
+
+	/* Quick wins score highest, then draws, then slow losses */
+	n = hnef_board_generate_moves(b, rays, b->turn, moves, HNEF_MAX_MOVES);
+	hnef_undo_stack_init(&stack, undo, 1);
+	best = -1;
+	for( i=0; i<n; i++ ) {
+		hnef_board_make_move(b, moves[i], &stack);
+		r = hnef_tablebase_probe(tb, b, &d);
+		hnef_board_unmake_move(b, &stack);
+
+		score = (r == HNEF_TB_LOSS)? 2*HNEF_TB_MAX_DISTANCE - d : (r == HNEF_TB_DRAW)? HNEF_TB_MAX_DISTANCE : d;
+		if(score > best) {
+			best = score;
+			*move = moves[i];
+		}
+	}
+	return result;
+}
@@ -0,0 +1,90 @@
+/* libhnef/tablebase.h
+ *
+ * Copyright (C) 2016 Gary Munnelly
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+/**
+ * @file libhnef/tablebase.h
+ *
+ * @brief Macros, typedefs and function forward declarations for
+ * endgame tablebases
+ *
+ * @author Gary Munnelly
+ */
+
+#ifndef LIBHNEF_TABLEBASE_H_
+#define LIBHNEF_TABLEBASE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "move.h"
+
+#define HNEF_TB_UNKNOWN      0x00 /**< The position is not covered */
+#define HNEF_TB_DRAW         0x01 /**< Neither side can force a result */
+#define HNEF_TB_WIN          0x02 /**< The side to move wins */
+#define HNEF_TB_LOSS         0x03 /**< The side to move loses */
+
+#define HNEF_TB_MAX_PIECES   8    /**< Most attackers, or defenders besides the king */
+#define HNEF_TB_MAX_AREA     256  /**< Largest board a tablebase can cover */
+#define HNEF_TB_MAX_DISTANCE 253  /**< Longest result a tablebase can record, in plies */
+#define HNEF_TB_MAX_THREADS  256  /**< Most threads a generator may use */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Where the values of one material balance lie in a tablebase
+ */
+typedef struct HnefTablebaseTable {
+	uint64_t entries;         /**< Positions indexed */
+	uint64_t blocks;          /**< Compressed blocks holding them */
+	uint64_t offset;          /**< Offset of the block offsets in the image */
+} HnefTablebaseTable;
+
+/**
+ * @brief The exact result of every position with up to a given number
+ * of attackers and defenders beside the king on one board layout.
+ *
+ * Each material balance has its own table of one value per position
+ * and side to move. Positions are numbered by a perfect hash of the
+ * squares of the king, the attackers and the defenders, with the king
+ * confined to one eighth of the board when the layout is symmetric.
+ * The tables are stored as one image, in memory after generation or
+ * mapped from a file, and are probed without decompressing them.
+ */
+typedef struct HnefTablebase {
+	int height;               /**< Height of the board covered */
+	int width;                /**< Width of the board covered */
+	int area;                 /**< Squares on the board */
+	int max_attackers;        /**< Most attackers covered */
+	int max_defenders;        /**< Most defenders covered, not counting the king */
+	int symmetric;            /**< Set if the king is confined to one eighth of the board */
+	int kings;                /**< King squares indexed */
+	HnefBitboard types[4];    /**< Squares indexed by tile structure code */
+	HnefBitboard escapes;     /**< Escape squares */
+	int16_t king_index[HNEF_TB_MAX_AREA];     /**< Index of each king square, after king_transform */
+	uint8_t king_transform[HNEF_TB_MAX_AREA]; /**< Transform bringing each king square into the indexed ones */
+	int16_t king_square[HNEF_TB_MAX_AREA];    /**< Square of each king index */
+	int16_t map[8][HNEF_TB_MAX_AREA];         /**< Image of each square under each transform */
+	uint64_t binomial[HNEF_TB_MAX_AREA + 1][HNEF_TB_MAX_PIECES + 1]; /**< Binomial coefficients */
+	HnefTablebaseTable tables[HNEF_TB_MAX_PIECES + 1][HNEF_TB_MAX_PIECES + 1]; /**< Tables by material */
+	uint8_t *image;           /**< Header, directory and tables */
+	size_t size;              /**< Bytes in image */
+	int mapped;               /**< Set if image is mapped from a file */
+} HnefTablebase;
+
+int          hnef_tablebase_generate       ( HnefTablebase *tb, HnefBoard *layout, int attackers, int defenders, int threads );
+int          hnef_tablebase_save           ( const HnefTablebase *tb, const char *path );
+int          hnef_tablebase_open           ( HnefTablebase *tb, const char *path );
+void         hnef_tablebase_free           ( HnefTablebase *tb );
+int          hnef_tablebase_probe          ( const HnefTablebase *tb, HnefBoard *b, int *distance );
+int          hnef_tablebase_best_move      ( const HnefTablebase *tb, HnefBoard *b, const HnefRays *rays, HnefMove *move, int *distance );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBHNEF_TABLEBASE_H_ */
@@ -0,0 +1,272 @@
+/* libhnef/tensor.c
+ *
+ * Copyright (C) 2016 Gary Munnelly
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+/**
+ * @file libhnef/tensor.c
+ *
+ * @brief Code for exporting batches of boards as neural network input
+ * planes
+ *
+ * A batch of n boards of height h and width w is written as a
+ * contiguous NCHW tensor of n x HNEF_TENSOR_PLANES x h x w elements,
+ * each 1 where the plane's feature is present and 0 elsewhere. The
+ * planes are read straight from the board's bitboards. Symmetries
+ * are applied as the rows are read, reversing the bits of a row or
+ * the order of the rows, with a whole-board transpose only for the
+ * four which need one. Each row of bits is expanded several columns
+ * at a time with SSE2 or AVX2 where the compiler provides them.
+ *
+ * @author Gary Munnelly
+ */
+#include <string.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "tensor.h"
+
+/** Most elements a row expansion may write past the end of a row */
+#define HNEF_TENSOR_SPILL 15
+
+/**
+ * @brief Check that every board of a batch has the same size and that
+ * every transform suits it. Transposing symmetries need a square board.
+ */
+static int
+hnef_tensor_check( HnefBoard **boards, int n, const int *transforms ) {
+	int i;
+
+	for( i=0; i<n; i++ ) {
+		if(boards[i]->height != boards[0]->height || boards[i]->width != boards[0]->width) {
+			return 0;
+		}
+		if(transforms) {
+			if(transforms[i] < 0 || transforms[i] >= HNEF_TRANSFORM_COUNT) {
+				return 0;
+			}
+			if((transforms[i] & HNEF_TRANSFORM_TRANSPOSE) &&
+			   boards[i]->height != boards[i]->width) {
+				return 0;
+			}
+		}
+	}
+	return 1;
+}
+
+/**
+ * @brief Gather the bitboard behind each plane but the side to move.
+ * A transposing transform is applied here; the mirrors are left to
+ * hnef_tensor_row.
+ */
+static void
+hnef_tensor_planes( HnefBoard *b, int transform, HnefBitboard *planes ) {
+	int p;
+
+	planes[HNEF_TENSOR_ATTACKERS] = b->teams[HNEF_MUSCOVITE];
+	hnef_bitboard_andnot(&(planes[HNEF_TENSOR_DEFENDERS]), &(b->teams[HNEF_SWEDE]), &(b->ranks[HNEF_KING]));
+	planes[HNEF_TENSOR_KING] = b->ranks[HNEF_KING];
+	planes[HNEF_TENSOR_THRONE] = b->types[HNEF_THRONE];
+	planes[HNEF_TENSOR_ESCAPES] = b->escapes;
+
+	if(transform & HNEF_TRANSFORM_TRANSPOSE) {
+		for( p=0; p<HNEF_TENSOR_TURN; p++ ) {
+			hnef_bitboard_transpose(&(planes[p]), &(planes[p]));
+		}
+	}
+}
+
+/**
+ * @brief Get row y of a plane after mirroring it as the transform
+ * asks
+ */
+static uint32_t
+hnef_tensor_row( const HnefBitboard *plane, int transform, int y, int height, int width ) {
+	uint32_t bits;
+
+	bits = hnef_bitboard_get_row(plane, (transform & HNEF_TRANSFORM_FLIP_Y)? height - 1 - y : y);
+	if(transform & HNEF_TRANSFORM_FLIP_X) {
+		bits = hnef_reverse32(bits) >> (HNEF_BITBOARD_STRIDE - width);
+	}
+	return bits;
+}
+
+/**
+ * @brief Expand a row of bits into width floats. Whole vectors are
+ * stored, so up to HNEF_TENSOR_SPILL elements past the end of the row
+ * may be written as well.
+ */
+static void
+hnef_tensor_row_float( uint32_t bits, int width, float *row ) {
+	int x;
+#if defined(__AVX2__)
+	const __m256i lanes = _mm256_set_epi32(128, 64, 32, 16, 8, 4, 2, 1);
+	const __m256 one = _mm256_set1_ps(1.0f);
+	__m256i v;
+
+	for( x=0; x<width; x+=8 ) {
+		v = _mm256_and_si256(_mm256_set1_epi32((int)(bits >> x)), lanes);
+		v = _mm256_cmpeq_epi32(v, lanes);
+		_mm256_storeu_ps(row + x, _mm256_and_ps(_mm256_castsi256_ps(v), one));
+	}
+#elif defined(__SSE2__)
+	const __m128i lanes = _mm_set_epi32(8, 4, 2, 1);
+	const __m128 one = _mm_set1_ps(1.0f);
+	__m128i v;
+
+	for( x=0; x<width; x+=4 ) {
+		v = _mm_and_si128(_mm_set1_epi32((int)(bits >> x)), lanes);
+		v = _mm_cmpeq_epi32(v, lanes);
+		_mm_storeu_ps(row + x, _mm_and_ps(_mm_castsi128_ps(v), one));
+	}
+#else
+	for( x=0; x<width; x++ ) {
+		row[x] = (float)((bits >> x) & 1);
+	}
+#endif
+}
+
+/**
+ * @brief Expand a row of bits into width bytes. Whole vectors are
+ * stored, so up to HNEF_TENSOR_SPILL elements past the end of the row
+ * may be written as well.
+ */
+static void
+hnef_tensor_row_int8( uint32_t bits, int width, int8_t *row ) {
+	int x;
+#if defined(__SSE2__)
+	const __m128i lanes = _mm_set_epi8(-128, 64, 32, 16, 8, 4, 2, 1, -128, 64, 32, 16, 8, 4, 2, 1);
+	const __m128i one = _mm_set1_epi8(1);
+	__m128i v;
+
+	for( x=0; x<width; x+=16 ) {
+		v = _mm_unpacklo_epi64(_mm_set1_epi8((char)(bits >> x)), _mm_set1_epi8((char)(bits >> (x + 8))));
+		v = _mm_cmpeq_epi8(_mm_and_si128(v, lanes), lanes);
+		_mm_storeu_si128((__m128i*)(row + x), _mm_and_si128(v, one));
+	}
+#else
+	for( x=0; x<width; x++ ) {
+		row[x] = (int8_t)((bits >> x) & 1);
+	}
+#endif
+}
+
+/**
+ * @brief Get the number of elements a board occupies in an exported
+ * tensor
+ *
+ * @param b A board of the batch
+ *
+ * @return HNEF_TENSOR_PLANES x height x width
+ */
+int
+hnef_tensor_get_size( HnefBoard *b ) {
+	return HNEF_TENSOR_PLANES * b->height * b->width;
+}
+
+/**
+ * @brief Write a batch of boards into a float NCHW tensor
+ *
+ * @param boards The boards of the batch, all of the same size
+ *
+ * @param n The number of boards in the batch
+ *
+ * @param transforms The HNEF_TRANSFORM_* code to apply to each board,
+ * or NULL to export every board as it stands
+ *
+ * @param out Storage for n x hnef_tensor_get_size elements
+ *
+ * @return True on success, false if the boards differ in size or a
+ * transform does not suit its board
+ */
+int
+hnef_tensor_export_float( HnefBoard **boards, int n, const int *transforms, float *out ) {
+	HnefBitboard planes[HNEF_TENSOR_TURN];
+	float row[HNEF_BITBOARD_STRIDE], turn;
+	int i, p, y, k, h, w, t;
+
+	if(!hnef_tensor_check(boards, n, transforms)) {
+		return 0;
+	}
+
+	for( i=0; i<n; i++ ) {
+		h = boards[i]->height;
+		w = boards[i]->width;
+		t = transforms? transforms[i] : HNEF_TRANSFORM_IDENTITY;
+		hnef_tensor_planes(boards[i], t, planes);
+		for( p=0; p<HNEF_TENSOR_TURN; p++ ) {
+			for( y=0; y<h; y++ ) {
+				/* Spilled elements land in the plane of the side to
+				 * move, which is written last, unless it is too small
+				 * to take them */
+				if(h*w > HNEF_TENSOR_SPILL) {
+					hnef_tensor_row_float(hnef_tensor_row(&(planes[p]), t, y, h, w), w, out);
+				} else {
+					hnef_tensor_row_float(hnef_tensor_row(&(planes[p]), t, y, h, w), w, row);
+					memcpy(out, row, w * sizeof(float));
+				}
+				out += w;
+			}
+		}
+		turn = (boards[i]->turn == HNEF_SWEDE)? 1.0f : 0.0f;
+		for( k=0; k<h*w; k++ ) {
+			out[k] = turn;
+		}
+		out += h*w;
+	}
+	return 1;
+}
+
+/**
+ * @brief Write a batch of boards into an int8 NCHW tensor
+ *
+ * @param boards The boards of the batch, all of the same size
+ *
+ * @param n The number of boards in the batch
+ *
+ * @param transforms The HNEF_TRANSFORM_* code to apply to each board,
+ * or NULL to export every board as it stands
+ *
+ * @param out Storage for n x hnef_tensor_get_size elements
+ *
+ * @return True on success, false if the boards differ in size or a
+ * transform does not suit its board
+ */
+int
+hnef_tensor_export_int8( HnefBoard **boards, int n, const int *transforms, int8_t *out ) {
+	HnefBitboard planes[HNEF_TENSOR_TURN];
+	int8_t row[HNEF_BITBOARD_STRIDE];
+	int i, p, y, h, w, t;
+
+	if(!hnef_tensor_check(boards, n, transforms)) {
+		return 0;
+	}
+
+	for( i=0; i<n; i++ ) {
+		h = boards[i]->height;
+		w = boards[i]->width;
+		t = transforms? transforms[i] : HNEF_TRANSFORM_IDENTITY;
+		hnef_tensor_planes(boards[i], t, planes);
+		for( p=0; p<HNEF_TENSOR_TURN; p++ ) {
+			for( y=0; y<h; y++ ) {
+				/* Spilled elements land in the plane of the side to
+				 * move, which is written last, unless it is too small
+				 * to take them */
+				if(h*w > HNEF_TENSOR_SPILL) {
+					hnef_tensor_row_int8(hnef_tensor_row(&(planes[p]), t, y, h, w), w, out);
+				} else {
+					hnef_tensor_row_int8(hnef_tensor_row(&(planes[p]), t, y, h, w), w, row);
+					memcpy(out, row, w * sizeof(int8_t));
+				}
+				out += w;
+			}
+		}
+		memset(out, boards[i]->turn == HNEF_SWEDE, h*w);
+		out += h*w;
+	}
+	return 1;
+}
@@ -0,0 +1,43 @@
+/* libhnef/tensor.h
+ *
+ * Copyright (C) 2016 Gary Munnelly
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+/**
+ * @file libhnef/tensor.h
+ *
+ * @brief Macros and function forward declarations for exporting
+ * batches of boards as neural network input planes
+ *
+ * @author Gary Munnelly
+ */
+
+#ifndef LIBHNEF_TENSOR_H_
+#define LIBHNEF_TENSOR_H_
+
+#include <stdint.h>
+#include "board.h"
+
+#define HNEF_TENSOR_ATTACKERS 0x00 /**< Plane of attacking tokens */
+#define HNEF_TENSOR_DEFENDERS 0x01 /**< Plane of defending soldiers */
+#define HNEF_TENSOR_KING      0x02 /**< Plane of the king */
+#define HNEF_TENSOR_THRONE    0x03 /**< Plane of throne tiles */
+#define HNEF_TENSOR_ESCAPES   0x04 /**< Plane of escape tiles */
+#define HNEF_TENSOR_TURN      0x05 /**< Plane of ones if the defenders are to move */
+#define HNEF_TENSOR_PLANES    0x06 /**< Number of planes per board */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int          hnef_tensor_get_size          ( HnefBoard *b );
+int          hnef_tensor_export_float      ( HnefBoard **boards, int n, const int *transforms, float *out );
+int          hnef_tensor_export_int8       ( HnefBoard **boards, int n, const int *transforms, int8_t *out );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBHNEF_TENSOR_H_ */
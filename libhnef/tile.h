@@ -27,7 +27,7 @@
 #define HNEF_NO_ESCAPE 0x00 /**< King cannot escape via this tile */
 #define HNEF_ESCAPE    0x01 /**< King can escape via this tile */
 
-#ifdef _cplusplus
+#ifdef __cplusplus
 extern "C" {
 #endif
 
@@ -70,7 +70,7 @@ HnefToken    hnef_tile_get_token           ( HnefTile *tile );
 void         hnef_tile_set_token           ( HnefTile *tile, HnefToken token );
 void         hnef_tile_unset_token         ( HnefTile *tile );
 
-#ifdef _cplusplus
+#ifdef __cplusplus
 }
 #endif
 
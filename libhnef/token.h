@@ -25,7 +25,7 @@
 #define HNEF_SOLDIER   0x00 /**< Token is a rank and file soldier */
 #define HNEF_KING      0x01 /**< Token is a king */
 
-#ifdef _cplusplus
+#ifdef __cplusplus
 extern "C" {
 #endif
 	
@@ -46,7 +46,7 @@ void         hnef_token_set_team           ( HnefToken *t, int team );
 int          hnef_token_get_rank           ( HnefToken *t );
 void         hnef_token_set_rank           ( HnefToken *t, int rank );
 
-#ifdef _cplusplus
+#ifdef __cplusplus
 }
 #endif
 
@@ -0,0 +1,291 @@
+/* libhnef/tt.c
+ *
+ * Copyright (C) 2016 Gary Munnelly
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+/**
+ * @file libhnef/tt.c
+ *
+ * @brief Code for a lock-free transposition table shared between
+ * search threads
+ *
+ * @author Gary Munnelly
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+#include "tt.h"
+
+#define HNEF_TT_HUGE_PAGE ((size_t)2 << 20) /**< Alignment of large tables */
+
+/* Layout of a packed entry */
+#define HNEF_TT_FROM_SHIFT  0
+#define HNEF_TT_TO_SHIFT    10
+#define HNEF_TT_SCORE_SHIFT 20
+#define HNEF_TT_DEPTH_SHIFT 36
+#define HNEF_TT_BOUND_SHIFT 44
+#define HNEF_TT_AGE_SHIFT   46
+#define HNEF_TT_USED        ((uint64_t)1 << 52)
+
+#define HNEF_TT_AGE_MASK    0x3f
+
+/**
+ * @brief One slot of the table.
+ *
+ * The table is shared between threads without locks. Each entry is
+ * written as two independent 64 bit words with check holding the
+ * position key XORed with data. A reader which sees a torn write gets
+ * a check that does not match its key and treats the entry as a miss.
+ */
+typedef struct HnefTTEntry {
+	_Atomic uint64_t check;   /**< Position key XOR data */
+	_Atomic uint64_t data;    /**< Packed HnefTTData */
+} HnefTTEntry;
+
+/**
+ * @brief A group of entries filling a single 64 byte cache line. A
+ * position may be stored in any entry of the bucket its key selects.
+ */
+struct HnefTTBucket {
+	HnefTTEntry entries[HNEF_TT_BUCKET_SIZE]; /**< Entries of the bucket */
+};
+
+/**
+ * @brief Pack the fields of an entry into a single word
+ */
+static uint64_t
+hnef_tt_pack( HnefMove move, int score, int depth, int bound, int age ) {
+	if(score > INT16_MAX) {
+		score = INT16_MAX;
+	} else if(score < INT16_MIN) {
+		score = INT16_MIN;
+	}
+	if(depth < 0) {
+		depth = 0;
+	} else if(depth > 0xff) {
+		depth = 0xff;
+	}
+
+	return ((uint64_t)(move.from & 0x3ff) << HNEF_TT_FROM_SHIFT)
+		| ((uint64_t)(move.to & 0x3ff) << HNEF_TT_TO_SHIFT)
+		| ((uint64_t)(uint16_t)score << HNEF_TT_SCORE_SHIFT)
+		| ((uint64_t)depth << HNEF_TT_DEPTH_SHIFT)
+		| ((uint64_t)(bound & 0x03) << HNEF_TT_BOUND_SHIFT)
+		| ((uint64_t)(age & HNEF_TT_AGE_MASK) << HNEF_TT_AGE_SHIFT)
+		| HNEF_TT_USED;
+}
+
+/**
+ * @brief Get the depth stored in a packed entry
+ */
+static int
+hnef_tt_depth( uint64_t data ) {
+	return (data >> HNEF_TT_DEPTH_SHIFT) & 0xff;
+}
+
+/**
+ * @brief Get the age stored in a packed entry
+ */
+static int
+hnef_tt_age( uint64_t data ) {
+	return (data >> HNEF_TT_AGE_SHIFT) & HNEF_TT_AGE_MASK;
+}
+
+/**
+ * @brief Allocate a table of roughly the size passed as an argument.
+ * The number of buckets is rounded down to a power of two. Tables of
+ * 2 MB or more are aligned to, and where supported advised to use,
+ * huge pages.
+ *
+ * @param tt The table to be initialized
+ *
+ * @param megabytes The memory budget of the table
+ *
+ * @return True on success, false if the allocation fails
+ */
+int
+hnef_tt_init( HnefTT *tt, size_t megabytes ) {
+	size_t count, bytes, align;
+	void *mem;
+
+	count = 1;
+	while( count*2*sizeof(HnefTTBucket) <= (megabytes << 20) ) {
+		count *= 2;
+	}
+	bytes = count*sizeof(HnefTTBucket);
+	align = (bytes >= HNEF_TT_HUGE_PAGE)? HNEF_TT_HUGE_PAGE : sizeof(HnefTTBucket);
+
+	if(posix_memalign(&mem, align, bytes)) {
+		tt->buckets = NULL;
+		return 0;
+	}
+#if defined(HAVE_MADVISE) && defined(MADV_HUGEPAGE)
+	if(align == HNEF_TT_HUGE_PAGE) {
+		madvise(mem, bytes, MADV_HUGEPAGE);
+	}
+#endif
+
+	tt->buckets = mem;
+	tt->mask = count - 1;
+	tt->bytes = bytes;
+	tt->age = 0;
+	hnef_tt_clear(tt);
+	return 1;
+}
+
+/**
+ * @brief Release the memory held by a table
+ */
+void
+hnef_tt_free( HnefTT *tt ) {
+	free(tt->buckets);
+	tt->buckets = NULL;
+}
+
+/**
+ * @brief Empty the table. Must not be called while other threads are
+ * using it.
+ */
+void
+hnef_tt_clear( HnefTT *tt ) {
+	memset(tt->buckets, 0, tt->bytes);
+	tt->age = 0;
+}
+
+/**
+ * @brief Start a new generation. Entries written by earlier searches
+ * become the first candidates for replacement.
+ */
+void
+hnef_tt_new_search( HnefTT *tt ) {
+	tt->age = (tt->age + 1) & HNEF_TT_AGE_MASK;
+}
+
+/**
+ * @brief Look up a position in the table
+ *
+ * @param tt The table to be searched
+ *
+ * @param key The Zobrist key of the position
+ *
+ * @param data Receives the contents of the entry when one is found
+ *
+ * @return True if the position was found, false otherwise
+ */
+int
+hnef_tt_probe( HnefTT *tt, uint64_t key, HnefTTData *data ) {
+	HnefTTBucket *bucket;
+	uint64_t check, word;
+	int i;
+
+	bucket = &(tt->buckets[key & tt->mask]);
+	for( i=0; i<HNEF_TT_BUCKET_SIZE; i++ ) {
+		word = atomic_load_explicit(&(bucket->entries[i].data), memory_order_relaxed);
+		check = atomic_load_explicit(&(bucket->entries[i].check), memory_order_relaxed);
+		if(!(word & HNEF_TT_USED) || (check ^ word) != key) {
+			continue;
+		}
+
+		data->move.from = (word >> HNEF_TT_FROM_SHIFT) & 0x3ff;
+		data->move.to = (word >> HNEF_TT_TO_SHIFT) & 0x3ff;
+		data->score = (int16_t)((word >> HNEF_TT_SCORE_SHIFT) & 0xffff);
+		data->depth = hnef_tt_depth(word);
+		data->bound = (word >> HNEF_TT_BOUND_SHIFT) & 0x03;
+		return 1;
+	}
+	return 0;
+}
+
+/**
+ * @brief Store a search result in the table.
+ *
+ * An entry already holding the position is overwritten unless it was
+ * searched much deeper in the current generation. Otherwise the entry
+ * replaced is the one with the lowest depth, where every generation
+ * of age counts against an entry as much as eight plies of depth.
+ *
+ * @param tt The table to be written
+ *
+ * @param key The Zobrist key of the position
+ *
+ * @param move The best move found in the position
+ *
+ * @param score The score of the position, clamped to 16 bits
+ *
+ * @param depth The depth the position was searched to
+ *
+ * @param bound One of the HNEF_BOUND_* codes describing score
+ */
+void
+hnef_tt_store( HnefTT *tt, uint64_t key, HnefMove move, int score, int depth, int bound ) {
+	HnefTTBucket *bucket;
+	HnefTTEntry *victim;
+	uint64_t word, check;
+	int i, value, best;
+
+	bucket = &(tt->buckets[key & tt->mask]);
+	victim = NULL;
+	best = 0;
+
+	for( i=0; i<HNEF_TT_BUCKET_SIZE; i++ ) {
+		word = atomic_load_explicit(&(bucket->entries[i].data), memory_order_relaxed);
+		check = atomic_load_explicit(&(bucket->entries[i].check), memory_order_relaxed);
+
+		if((word & HNEF_TT_USED) && (check ^ word) == key) {
+			if(bound != HNEF_BOUND_EXACT && hnef_tt_age(word) == tt->age &&
+			   hnef_tt_depth(word) > depth + 2) {
+				return;
+			}
+			victim = &(bucket->entries[i]);
+			break;
+		}
+
+		value = (word & HNEF_TT_USED)?
+			hnef_tt_depth(word) - 8*((tt->age - hnef_tt_age(word)) & HNEF_TT_AGE_MASK) :
+			-1024;
+		if(!victim || value < best) {
+			victim = &(bucket->entries[i]);
+			best = value;
+		}
+	}
+
+	word = hnef_tt_pack(move, score, depth, bound, tt->age);
+	atomic_store_explicit(&(victim->check), key ^ word, memory_order_relaxed);
+	atomic_store_explicit(&(victim->data), word, memory_order_relaxed);
+}
+
+/**
+ * @brief Estimate how full the table is by sampling its first
+ * thousand entries
+ *
+ * @return The number of sampled entries written during the current
+ * generation, per thousand
+ */
+int
+hnef_tt_hashfull( HnefTT *tt ) {
+	uint64_t word;
+	size_t i, n, total;
+
+	n = 0;
+	total = (tt->mask + 1)*HNEF_TT_BUCKET_SIZE;
+	if(total > 1000) {
+		total = 1000;
+	}
+	for( i=0; i<total; i++ ) {
+		word = atomic_load_explicit(&(tt->buckets[i / HNEF_TT_BUCKET_SIZE].entries[i % HNEF_TT_BUCKET_SIZE].data),
+			memory_order_relaxed);
+		if((word & HNEF_TT_USED) && hnef_tt_age(word) == tt->age) {
+			n++;
+		}
+	}
+	return (int)(n*1000 / total);
+}
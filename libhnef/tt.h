@@ -0,0 +1,70 @@
+/* libhnef/tt.h
+ *
+ * Copyright (C) 2016 Gary Munnelly
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+/**
+ * @file libhnef/tt.h
+ *
+ * @brief Macros, typedefs and function forward declarations for the
+ * HnefTT transposition table
+ *
+ * @author Gary Munnelly
+ */
+
+#ifndef LIBHNEF_TT_H_
+#define LIBHNEF_TT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "bound.h"
+#include "move.h"
+
+#define HNEF_TT_BUCKET_SIZE 4     /**< Entries sharing one cache line */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief A group of entries filling a single 64 byte cache line, see
+ * tt.c
+ */
+typedef struct HnefTTBucket HnefTTBucket;
+
+/**
+ * @brief The unpacked contents of an entry
+ */
+typedef struct HnefTTData {
+	HnefMove move;        /**< Best move found, from == to if none */
+	int score;            /**< Score of the position */
+	int depth;            /**< Depth the position was searched to */
+	int bound;            /**< One of the HNEF_BOUND_* codes */
+} HnefTTData;
+
+/**
+ * @brief A fixed size, power of two transposition table which may be
+ * probed and written by many threads at once
+ */
+typedef struct HnefTT {
+	HnefTTBucket *buckets;    /**< Cache line aligned bucket array */
+	uint64_t mask;            /**< Number of buckets minus one */
+	size_t bytes;             /**< Size of the bucket array */
+	int age;                  /**< Generation of the current search */
+} HnefTT;
+
+int          hnef_tt_init                  ( HnefTT *tt, size_t megabytes );
+void         hnef_tt_free                  ( HnefTT *tt );
+void         hnef_tt_clear                 ( HnefTT *tt );
+void         hnef_tt_new_search            ( HnefTT *tt );
+int          hnef_tt_probe                 ( HnefTT *tt, uint64_t key, HnefTTData *data );
+void         hnef_tt_store                 ( HnefTT *tt, uint64_t key, HnefMove move, int score, int depth, int bound );
+int          hnef_tt_hashfull              ( HnefTT *tt );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBHNEF_TT_H_ */
@@ -0,0 +1,187 @@
+/* libhnef/variant.c
+ *
+ * Copyright (C) 2016 Gary Munnelly
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+/**
+ * @file libhnef/variant.c
+ *
+ * @brief Starting positions of the standard variants
+ *
+ * Each layout is a square diagram, one string per row:
+ *
+ * - '.' an empty tile
+ * - 'a' an attacker
+ * - 'd' a defender
+ * - 'k' the king
+ * - 'A' an attacker standing on a camp
+ *
+ * The centre tile of every variant is a throne. Tablut lets the king
+ * escape from any edge tile; the other variants place an escape
+ * castle in each corner.
+ *
+ * @author Gary Munnelly
+ */
+#include <string.h>
+#include "variant.h"
+
+/**
+ * @brief Description of a standard variant
+ */
+typedef struct HnefVariant {
+	const char *name;         /**< Human readable name */
+	int size;                 /**< Width and height of the board */
+	int edge_escape;          /**< True if every edge tile is an escape */
+	const char *layout[13];   /**< Starting position, one row per string */
+} HnefVariant;
+
+static const HnefVariant hnef_variants[HNEF_VARIANT_COUNT] = {
+	{ "Brandubh", 7, 0, {
+		"...a...",
+		"...a...",
+		"...d...",
+		"aadkdaa",
+		"...d...",
+		"...a...",
+		"...a...",
+	} },
+	{ "Tablut", 9, 1, {
+		"...AAA...",
+		"....A....",
+		"....d....",
+		"A...d...A",
+		"AAddkddAA",
+		"A...d...A",
+		"....d....",
+		"....A....",
+		"...AAA...",
+	} },
+	{ "Copenhagen", 11, 0, {
+		"...aaaaa...",
+		".....a.....",
+		"...........",
+		"a....d....a",
+		"a...ddd...a",
+		"aa.ddkdd.aa",
+		"a...ddd...a",
+		"a....d....a",
+		"...........",
+		".....a.....",
+		"...aaaaa...",
+	} },
+	{ "Large Copenhagen", 13, 0, {
+		"....aaaaa....",
+		"......a......",
+		".............",
+		".............",
+		"a.....d.....a",
+		"a....ddd....a",
+		"aa..ddkdd..aa",
+		"a....ddd....a",
+		"a.....d.....a",
+		".............",
+		".............",
+		"......a......",
+		"....aaaaa....",
+	} },
+};
+
+/**
+ * @brief Set up the starting position of a standard variant
+ *
+ * @param board The board to be initialized
+ *
+ * @param variant One of the HNEF_VARIANT_* codes
+ *
+ * @return True on success, false if the variant is unknown
+ */
+int
+hnef_variant_setup( HnefBoard *board, int variant ) {
+	const HnefVariant *v;
+	HnefToken token;
+	int x, y, n;
+
+	if(variant < 0 || variant >= HNEF_VARIANT_COUNT) {
+		return 0;
+	}
+	v = &(hnef_variants[variant]);
+	n = v->size;
+
+	hnef_board_init(board, n, n);
+	hnef_board_set_tile_type(board, n/2, n/2, HNEF_THRONE);
+
+	if(v->edge_escape) {
+		for( x=0; x<n; x++ ) {
+			hnef_board_set_tile_is_escape(board, x, 0, HNEF_ESCAPE);
+			hnef_board_set_tile_is_escape(board, x, n-1, HNEF_ESCAPE);
+			hnef_board_set_tile_is_escape(board, 0, x, HNEF_ESCAPE);
+			hnef_board_set_tile_is_escape(board, n-1, x, HNEF_ESCAPE);
+		}
+	} else {
+		for( y=0; y<n; y+=n-1 ) {
+			for( x=0; x<n; x+=n-1 ) {
+				hnef_board_set_tile_type(board, x, y, HNEF_CASTLE);
+				hnef_board_set_tile_is_escape(board, x, y, HNEF_ESCAPE);
+			}
+		}
+	}
+
+	for( y=0; y<n; y++ ) {
+		for( x=0; x<n; x++ ) {
+			switch(v->layout[y][x]) {
+			case 'A':
+				hnef_board_set_tile_type(board, x, y, HNEF_CAMP);
+				/* fall through */
+			case 'a':
+				hnef_token_init(&token, HNEF_MUSCOVITE, HNEF_SOLDIER);
+				hnef_board_set_token(board, x, y, token);
+				break;
+			case 'd':
+				hnef_token_init(&token, HNEF_SWEDE, HNEF_SOLDIER);
+				hnef_board_set_token(board, x, y, token);
+				break;
+			case 'k':
+				hnef_token_init(&token, HNEF_SWEDE, HNEF_KING);
+				hnef_board_set_token(board, x, y, token);
+				break;
+			default:
+				break;
+			}
+		}
+	}
+
+	hnef_board_set_turn(board, HNEF_MUSCOVITE);
+	return 1;
+}
+
+/**
+ * @brief Get the name of a standard variant
+ *
+ * @param variant One of the HNEF_VARIANT_* codes
+ *
+ * @return The name of the variant, or NULL if it is unknown
+ */
+const char*
+hnef_variant_get_name( int variant ) {
+	if(variant < 0 || variant >= HNEF_VARIANT_COUNT) {
+		return NULL;
+	}
+	return hnef_variants[variant].name;
+}
+
+/**
+ * @brief Get the width and height of the board of a standard variant
+ *
+ * @param variant One of the HNEF_VARIANT_* codes
+ *
+ * @return The size of the board, or 0 if the variant is unknown
+ */
+int
+hnef_variant_get_size( int variant ) {
+	if(variant < 0 || variant >= HNEF_VARIANT_COUNT) {
+		return 0;
+	}
+	return hnef_variants[variant].size;
+}
@@ -0,0 +1,40 @@
+/* libhnef/variant.h
+ *
+ * Copyright (C) 2016 Gary Munnelly
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+/**
+ * @file libhnef/variant.h
+ *
+ * @brief Macros and function forward declarations for setting up the
+ * starting positions of standard variants
+ *
+ * @author Gary Munnelly
+ */
+
+#ifndef LIBHNEF_VARIANT_H_
+#define LIBHNEF_VARIANT_H_
+
+#include "board.h"
+
+#define HNEF_VARIANT_BRANDUBH   0x00 /**< Brandubh, 7x7 */
+#define HNEF_VARIANT_TABLUT     0x01 /**< Tablut with camps and edge escape, 9x9 */
+#define HNEF_VARIANT_COPENHAGEN 0x02 /**< Copenhagen Hnefatafl, 11x11 */
+#define HNEF_VARIANT_LARGE      0x03 /**< Copenhagen style layout, 13x13 */
+#define HNEF_VARIANT_COUNT      0x04 /**< Number of standard variants */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int          hnef_variant_setup            ( HnefBoard *b, int variant );
+const char*  hnef_variant_get_name         ( int variant );
+int          hnef_variant_get_size         ( int variant );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBHNEF_VARIANT_H_ */
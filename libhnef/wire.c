@@ -0,0 +1,417 @@
+/* libhnef/wire.c
+ *
+ * Copyright (C) 2016 Gary Munnelly
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+/**
+ * @file libhnef/wire.c
+ *
+ * @brief Code for the compact, variable length board format
+ *
+ * The format splits a board into its layout, which is fixed for a
+ * variant and sent once, and its position, which is sent for every
+ * record. Squares are numbered y*width + x.
+ *
+ * A set of squares is written as a list: the number of squares as a
+ * varint, then the first square and the gap before each following one,
+ * less one, as varints. Varints hold seven bits per byte, low bits
+ * first, with the top bit set on every byte but the last.
+ *
+ * A layout record is the version, the height and the width, one byte
+ * each, then the lists of castle, throne, camp and escape squares.
+ *
+ * A position record starts with a byte holding the version in its low
+ * four bits, the side to move in bit 4 and the encoding in bit 5. The
+ * HNEF_WIRE_LISTS encoding follows with the lists of the Muscovites'
+ * and the Swedes' squares. The HNEF_WIRE_BITSET encoding follows with
+ * one bit per square, set where a token stands, then one bit per token
+ * in square order, set for a Swede. Both end with the list of squares
+ * holding kings. The encoder picks whichever is shorter: lists suit
+ * endgames, bitsets crowded openings.
+ *
+ * @author Gary Munnelly
+ */
+#include <string.h>
+#include "wire.h"
+
+/**
+ * @brief A bounded output buffer. Writes beyond its capacity are
+ * counted but dropped, so the length of a record can be measured by
+ * writing it to an empty buffer.
+ */
+typedef struct HnefWireWriter {
+	uint8_t *buffer;          /**< Start of the buffer */
+	size_t capacity;          /**< Bytes available */
+	size_t length;            /**< Bytes written so far */
+} HnefWireWriter;
+
+/**
+ * @brief Square numbers of a set, in ascending order
+ *
+ * @return The number of squares
+ */
+static int
+hnef_wire_cells( HnefBoard *b, const HnefBitboard *bb, int *cells ) {
+	HnefBitboard set;
+	int n, sq;
+
+	n = 0;
+	set = *bb;
+	while( !hnef_bitboard_is_empty(&set) ) {
+		sq = hnef_bitboard_first(&set);
+		hnef_bitboard_unset(&set, sq);
+		cells[n++] = HNEF_SQUARE_Y(sq)*b->width + HNEF_SQUARE_X(sq);
+	}
+	return n;
+}
+
+/**
+ * @brief Write one byte
+ */
+static void
+hnef_wire_put_byte( HnefWireWriter *w, int v ) {
+	if(w->length < w->capacity) {
+		w->buffer[w->length] = (uint8_t)v;
+	}
+	w->length++;
+}
+
+/**
+ * @brief Write a varint
+ */
+static void
+hnef_wire_put_varint( HnefWireWriter *w, unsigned v ) {
+	while( v >= 0x80 ) {
+		hnef_wire_put_byte(w, (v & 0x7f) | 0x80);
+		v >>= 7;
+	}
+	hnef_wire_put_byte(w, v);
+}
+
+/**
+ * @brief Write a set of squares as a list
+ */
+static void
+hnef_wire_put_list( HnefWireWriter *w, HnefBoard *b, const HnefBitboard *bb ) {
+	int cells[MAX_HEIGHT*MAX_WIDTH], n, i;
+
+	n = hnef_wire_cells(b, bb, cells);
+	hnef_wire_put_varint(w, n);
+	for( i=0; i<n; i++ ) {
+		hnef_wire_put_varint(w, i? cells[i] - cells[i-1] - 1 : cells[0]);
+	}
+}
+
+/**
+ * @brief Read a varint no larger than limit
+ *
+ * @return True on success, false if the buffer ends or the value is
+ * too large
+ */
+static int
+hnef_wire_get_varint( const uint8_t *buffer, size_t length, size_t *at, unsigned limit, unsigned *v ) {
+	unsigned shift;
+	uint8_t byte;
+
+	*v = 0;
+	for( shift=0; shift<=14; shift+=7 ) {
+		if(*at >= length) {
+			return 0;
+		}
+		byte = buffer[(*at)++];
+		*v |= (unsigned)(byte & 0x7f) << shift;
+		if(!(byte & 0x80)) {
+			return *v <= limit;
+		}
+	}
+	return 0;
+}
+
+/**
+ * @brief Read a list of squares below area
+ *
+ * @return The number of squares, or -1 if the list is damaged
+ */
+static int
+hnef_wire_get_list( const uint8_t *buffer, size_t length, size_t *at, int area, int *cells ) {
+	unsigned n, v;
+	int i, cell;
+
+	if(!hnef_wire_get_varint(buffer, length, at, area, &n)) {
+		return -1;
+	}
+	cell = -1;
+	for( i=0; i<(int)n; i++ ) {
+		if(!hnef_wire_get_varint(buffer, length, at, area, &v)) {
+			return -1;
+		}
+		cell += v + 1;
+		if(cell >= area) {
+			return -1;
+		}
+		cells[i] = cell;
+	}
+	return n;
+}
+
+/**
+ * @brief Write the layout of a board: its size, structures and escape
+ * tiles. Tokens and the side to move are left out.
+ *
+ * @param b The board whose layout is written
+ *
+ * @param buffer The buffer to be written
+ *
+ * @param capacity Bytes available in buffer. HNEF_WIRE_MAX_LAYOUT
+ * bytes are always enough
+ *
+ * @param length Receives the length of the record, even if it did not
+ * fit
+ *
+ * @return True on success, false if the record did not fit
+ */
+int
+hnef_board_encode_layout( HnefBoard *b, uint8_t *buffer, size_t capacity, size_t *length ) {
+	HnefWireWriter w;
+	int type;
+
+	w.buffer = buffer;
+	w.capacity = capacity;
+	w.length = 0;
+	hnef_wire_put_byte(&w, HNEF_WIRE_VERSION);
+	hnef_wire_put_byte(&w, b->height);
+	hnef_wire_put_byte(&w, b->width);
+	for( type=HNEF_CASTLE; type<=HNEF_CAMP; type++ ) {
+		hnef_wire_put_list(&w, b, &(b->types[type]));
+	}
+	hnef_wire_put_list(&w, b, &(b->escapes));
+	*length = w.length;
+	return w.length <= capacity;
+}
+
+/**
+ * @brief Read a layout written by hnef_board_encode_layout into an
+ * empty board of its size, ready for hnef_board_decode
+ *
+ * @param b The board to be initialized
+ *
+ * @param buffer The record
+ *
+ * @param length Bytes available in buffer
+ *
+ * @param used If not NULL, receives the length of the record
+ *
+ * @return True on success, false if the record is damaged, truncated
+ * or of another version
+ */
+int
+hnef_board_decode_layout( HnefBoard *b, const uint8_t *buffer, size_t length, size_t *used ) {
+	int cells[MAX_HEIGHT*MAX_WIDTH], height, width, type, n, i;
+	size_t at;
+
+	if(length < 3 || buffer[0] != HNEF_WIRE_VERSION) {
+		return 0;
+	}
+	height = buffer[1];
+	width = buffer[2];
+	if(height < 1 || height > MAX_HEIGHT || width < 1 || width > MAX_WIDTH) {
+		return 0;
+	}
+
+	hnef_board_init(b, height, width);
+	at = 3;
+	for( type=HNEF_CASTLE; type<=HNEF_CAMP + 1; type++ ) {
+		n = hnef_wire_get_list(buffer, length, &at, b->area, cells);
+		if(n < 0) {
+			return 0;
+		}
+		for( i=0; i<n; i++ ) {
+			if(type <= HNEF_CAMP) {
+				hnef_board_set_tile_type(b, cells[i] % width, cells[i] / width, type);
+			} else {
+				hnef_board_set_tile_is_escape(b, cells[i] % width, cells[i] / width, HNEF_ESCAPE);
+			}
+		}
+	}
+	if(used) {
+		*used = at;
+	}
+	return 1;
+}
+
+/**
+ * @brief Write the tokens and side to move of a board. Records are
+ * typically a fifth to a tenth of the size of hnef_board_serialize's.
+ *
+ * @param b The board whose position is written
+ *
+ * @param buffer The buffer to be written
+ *
+ * @param capacity Bytes available in buffer. HNEF_WIRE_MAX_POSITION
+ * bytes are always enough
+ *
+ * @param length Receives the length of the record, even if it did not
+ * fit
+ *
+ * @return True on success, false if the record did not fit
+ */
+int
+hnef_board_encode( HnefBoard *b, uint8_t *buffer, size_t capacity, size_t *length ) {
+	HnefWireWriter w;
+	int cells[MAX_HEIGHT*MAX_WIDTH], n, i, bits, byte, format;
+
+	/* Measure the lists, which are longer for crowded boards */
+	w.buffer = NULL;
+	w.capacity = 0;
+	w.length = 0;
+	hnef_wire_put_list(&w, b, &(b->teams[HNEF_MUSCOVITE]));
+	hnef_wire_put_list(&w, b, &(b->teams[HNEF_SWEDE]));
+	n = hnef_bitboard_popcount(&(b->occupied));
+	format = (w.length > (size_t)(b->area + 7)/8 + (n + 7)/8)? HNEF_WIRE_BITSET : HNEF_WIRE_LISTS;
+
+	w.buffer = buffer;
+	w.capacity = capacity;
+	w.length = 0;
+	hnef_wire_put_byte(&w, HNEF_WIRE_VERSION | (b->turn << 4) | (format << 5));
+	if(format == HNEF_WIRE_LISTS) {
+		hnef_wire_put_list(&w, b, &(b->teams[HNEF_MUSCOVITE]));
+		hnef_wire_put_list(&w, b, &(b->teams[HNEF_SWEDE]));
+	} else {
+		n = hnef_wire_cells(b, &(b->occupied), cells);
+		byte = 0;
+		bits = 0;
+		for( i=0; i<b->area; i++ ) {
+			byte |= hnef_board_get_tile_is_occupied(b, i % b->width, i / b->width) << (bits++);
+			if(bits == 8 || i == b->area - 1) {
+				hnef_wire_put_byte(&w, byte);
+				byte = 0;
+				bits = 0;
+			}
+		}
+		for( i=0; i<n; i++ ) {
+			byte |= (hnef_board_get_token_team(b, cells[i] % b->width, cells[i] / b->width) == HNEF_SWEDE) << (bits++);
+			if(bits == 8 || i == n - 1) {
+				hnef_wire_put_byte(&w, byte);
+				byte = 0;
+				bits = 0;
+			}
+		}
+	}
+	hnef_wire_put_list(&w, b, &(b->ranks[HNEF_KING]));
+	*length = w.length;
+	return w.length <= capacity;
+}
+
+/**
+ * @brief Read a position written by hnef_board_encode onto a board of
+ * the same layout, replacing its tokens and side to move
+ *
+ * @param b A board holding the layout, from hnef_board_decode_layout
+ * or a variant. It is left unchanged if the record is refused
+ *
+ * @param buffer The record
+ *
+ * @param length Bytes available in buffer
+ *
+ * @param used If not NULL, receives the length of the record
+ *
+ * @return True on success, false if the record is damaged, truncated,
+ * of another version or does not fit the board
+ */
+int
+hnef_board_decode( HnefBoard *b, const uint8_t *buffer, size_t length, size_t *used ) {
+	int cells[2][MAX_HEIGHT*MAX_WIDTH], kings[MAX_HEIGHT*MAX_WIDTH];
+	int8_t team[MAX_HEIGHT*MAX_WIDTH];
+	HnefBitboard occupied;
+	HnefToken token;
+	int n[2], k, t, i, c, sq, format, turn;
+	size_t at, bytes;
+
+	if(length < 1 || (buffer[0] & 0x0f) != HNEF_WIRE_VERSION || (buffer[0] & 0xc0)) {
+		return 0;
+	}
+	turn = (buffer[0] >> 4) & 0x01;
+	format = (buffer[0] >> 5) & 0x01;
+	at = 1;
+
+	/* Gather the tokens before touching the board */
+	memset(team, -1, b->area);
+	if(format == HNEF_WIRE_LISTS) {
+		for( t=0; t<2; t++ ) {
+			n[t] = hnef_wire_get_list(buffer, length, &at, b->area, cells[t]);
+			if(n[t] < 0) {
+				return 0;
+			}
+			for( i=0; i<n[t]; i++ ) {
+				if(team[cells[t][i]] >= 0) {
+					return 0;
+				}
+				team[cells[t][i]] = t;
+			}
+		}
+	} else {
+		bytes = (b->area + 7)/8;
+		if(length - at < bytes) {
+			return 0;
+		}
+		n[0] = n[1] = 0;
+		for( i=0; i<b->area; i++ ) {
+			if(buffer[at + i/8] & (1 << (i & 7))) {
+				cells[0][n[0]++] = i;
+			}
+		}
+		if((b->area & 7) && (buffer[at + bytes - 1] >> (b->area & 7))) {
+			return 0;
+		}
+		at += bytes;
+		bytes = (n[0] + 7)/8;
+		if(length - at < bytes) {
+			return 0;
+		}
+		k = n[0];
+		n[0] = 0;
+		for( i=0; i<k; i++ ) {
+			t = (buffer[at + i/8] >> (i & 7)) & 0x01;
+			team[cells[0][i]] = t;
+			cells[t][n[t]++] = cells[0][i];
+		}
+		if((k & 7) && (buffer[at + bytes - 1] >> (k & 7))) {
+			return 0;
+		}
+		at += bytes;
+	}
+	k = hnef_wire_get_list(buffer, length, &at, b->area, kings);
+	if(k < 0) {
+		return 0;
+	}
+	for( i=0; i<k; i++ ) {
+		if(team[kings[i]] < 0) {
+			return 0;
+		}
+	}
+
+	occupied = b->occupied;
+	while( !hnef_bitboard_is_empty(&occupied) ) {
+		sq = hnef_bitboard_first(&occupied);
+		hnef_bitboard_unset(&occupied, sq);
+		hnef_board_unset_token(b, HNEF_SQUARE_X(sq), HNEF_SQUARE_Y(sq));
+	}
+	for( t=0; t<2; t++ ) {
+		hnef_token_init(&token, t, HNEF_SOLDIER);
+		for( i=0; i<n[t]; i++ ) {
+			hnef_board_set_token(b, cells[t][i] % b->width, cells[t][i] / b->width, token);
+		}
+	}
+	for( i=0; i<k; i++ ) {
+		c = kings[i];
+		hnef_token_init(&token, team[c], HNEF_KING);
+		hnef_board_set_token(b, c % b->width, c / b->width, token);
+	}
+	hnef_board_set_turn(b, turn);
+	if(used) {
+		*used = at;
+	}
+	return 1;
+}
@@ -0,0 +1,48 @@
+/* libhnef/wire.h
+ *
+ * Copyright (C) 2016 Gary Munnelly
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+/**
+ * @file libhnef/wire.h
+ *
+ * @brief Macros and function forward declarations for the compact,
+ * variable length board format
+ *
+ * @author Gary Munnelly
+ */
+
+#ifndef LIBHNEF_WIRE_H_
+#define LIBHNEF_WIRE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "board.h"
+
+#define HNEF_WIRE_VERSION 1         /**< Version written in every record */
+
+#define HNEF_WIRE_LISTS   0x00      /**< Pieces as lists of square gaps */
+#define HNEF_WIRE_BITSET  0x01      /**< Pieces as an occupancy bitset and team bits */
+
+/** Most bytes a position record of the given size can take */
+#define HNEF_WIRE_MAX_POSITION(h, w) ((size_t)(4 + 2*(((h)*(w) + 7)/8) + 2*(h)*(w)))
+
+/** Most bytes a layout record of the given size can take */
+#define HNEF_WIRE_MAX_LAYOUT(h, w)   ((size_t)(11 + 4*2*(h)*(w)))
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int          hnef_board_encode_layout      ( HnefBoard *b, uint8_t *buffer, size_t capacity, size_t *length );
+int          hnef_board_decode_layout      ( HnefBoard *b, const uint8_t *buffer, size_t length, size_t *used );
+int          hnef_board_encode             ( HnefBoard *b, uint8_t *buffer, size_t capacity, size_t *length );
+int          hnef_board_decode             ( HnefBoard *b, const uint8_t *buffer, size_t length, size_t *used );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBHNEF_WIRE_H_ */
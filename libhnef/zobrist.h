@@ -0,0 +1,94 @@
+/* libhnef/zobrist.h
+ *
+ * Copyright (C) 2016 Gary Munnelly
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+/**
+ * @file libhnef/zobrist.h
+ *
+ * @brief Zobrist keys for every feature of a board position
+ *
+ * A position's key is the XOR of the keys of its features: its
+ * dimensions, the structure and escape flag of each tile, each token
+ * and the side to move. Rather than storing a table of random numbers
+ * the key of each feature is derived by passing the feature's index
+ * through a 64 bit mixing function, which needs no initialization
+ * and is safe to use from any thread.
+ *
+ * @author Gary Munnelly
+ */
+
+#ifndef LIBHNEF_ZOBRIST_H_
+#define LIBHNEF_ZOBRIST_H_
+
+#include <stdint.h>
+
+#define HNEF_ZOBRIST_TOKEN  0x0000 /**< Feature class of tokens */
+#define HNEF_ZOBRIST_TYPE   0x2000 /**< Feature class of tile structures */
+#define HNEF_ZOBRIST_ESCAPE 0x4000 /**< Feature class of escape tiles */
+#define HNEF_ZOBRIST_TURN   0x6000 /**< Feature class of the side to move */
+#define HNEF_ZOBRIST_SIZE   0x8000 /**< Feature class of board dimensions */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Derive the key of a feature from its index
+ */
+static inline uint64_t
+hnef_zobrist_mix( uint64_t z ) {
+	z = (z + 1) * 0x9e3779b97f4a7c15ULL;
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+/**
+ * @brief Key of a token of the given team and rank standing on sq
+ */
+static inline uint64_t
+hnef_zobrist_token( int sq, int team, int rank ) {
+	return hnef_zobrist_mix(HNEF_ZOBRIST_TOKEN | (sq << 2) | ((team & 1) << 1) | (rank & 1));
+}
+
+/**
+ * @brief Key of a structure of the given type built on sq. Tiles
+ * with no structure contribute nothing.
+ */
+static inline uint64_t
+hnef_zobrist_type( int sq, int type ) {
+	return type? hnef_zobrist_mix(HNEF_ZOBRIST_TYPE | (sq << 2) | (type & 3)) : 0;
+}
+
+/**
+ * @brief Key of an escape tile at sq
+ */
+static inline uint64_t
+hnef_zobrist_escape( int sq ) {
+	return hnef_zobrist_mix(HNEF_ZOBRIST_ESCAPE | sq);
+}
+
+/**
+ * @brief Key of the side to move. The attackers contribute nothing.
+ */
+static inline uint64_t
+hnef_zobrist_turn( int team ) {
+	return team? hnef_zobrist_mix(HNEF_ZOBRIST_TURN) : 0;
+}
+
+/**
+ * @brief Key of the board's dimensions
+ */
+static inline uint64_t
+hnef_zobrist_size( int height, int width ) {
+	return hnef_zobrist_mix(HNEF_ZOBRIST_SIZE | (height << 6) | width);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBHNEF_ZOBRIST_H_ */
@@ -0,0 +1,338 @@
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "../libhnef/archive.h"
+#include "../libhnef/replay.h"
+#include "../libhnef/rules.h"
+#include "../libhnef/variant.h"
+#include "random_game.h"
+
+#define GAMES     600
+#define MAX_PLIES 120
+
+static uint64_t keys[GAMES];
+static uint64_t plies[GAMES];
+
+/* Write each move of a game to the writer passed as data */
+static int
+write_move( HnefBoard *b, int ply, const HnefMove *move, void *data ) {
+	(void)b;
+	(void)ply;
+	if(move) {
+		ck_assert(hnef_archive_writer_move(data, *move));
+	}
+	return 1;
+}
+
+/* Write random games of each variant, noting how each one ends */
+static void
+write_games( HnefArchiveWriter *w, int games ) {
+	HnefBoard b;
+	HnefRules rules;
+	HnefRuleTables tables;
+	HnefRays rays;
+	uint64_t rng = 31;
+	int g, variant, preset;
+
+	for( g=0; g<games; g++ ) {
+		variant = g % HNEF_VARIANT_COUNT;
+		preset = (variant == HNEF_VARIANT_COPENHAGEN)? HNEF_RULES_COPENHAGEN : HNEF_RULES_DEFAULT;
+		hnef_variant_setup(&b, variant);
+		hnef_rays_init(&rays, b.height, b.width);
+		hnef_rules_init(&rules, preset);
+		hnef_rules_compile(&tables, &rules, &b);
+		ck_assert(hnef_archive_writer_begin(w, &b, preset));
+
+		plies[g] = random_game(&b, &tables, &rays, &rng, g % MAX_PLIES, NULL, write_move, w);
+		keys[g] = b.key;
+		ck_assert(hnef_archive_writer_end(w, hnef_rules_get_winner(&tables, &b)));
+	}
+}
+
+/* Read one shard, checking each game against the one written. The
+ * shard is expected to start with game *g, which is advanced past it. */
+static void
+read_shard( const HnefArchive *a, int shard, int shards, int *g ) {
+	HnefArchiveCursor c;
+	HnefArchiveGame game;
+	HnefBoard b;
+	HnefMove move;
+	size_t at;
+	int n;
+
+	hnef_archive_cursor_init(&c, a, shard, shards);
+	for( ; hnef_archive_next(&c, &game); (*g)++ ) {
+		ck_assert_int_lt(*g, GAMES);
+		ck_assert(game.plies == plies[*g]);
+		ck_assert_int_eq(game.rules, (*g % HNEF_VARIANT_COUNT == HNEF_VARIANT_COPENHAGEN)?
+				 HNEF_RULES_COPENHAGEN : HNEF_RULES_DEFAULT);
+		ck_assert(hnef_archive_game_replay(&game, &b, game.plies));
+		ck_assert(b.key == keys[*g]);
+		ck_assert(!hnef_archive_game_replay(&game, &b, game.plies + 1));
+
+		/* Every move can be read one at a time as well */
+		at = 0;
+		for( n=0; hnef_archive_game_move(&game, &at, &move); n++ ) {
+		}
+		ck_assert_int_eq(n, game.plies);
+		ck_assert_int_eq(at, game.moves_length);
+	}
+}
+
+START_TEST (test_archive_shards)
+{
+	HnefArchiveWriter w;
+	HnefArchive a;
+	HnefBoard b;
+	char path[] = "/tmp/check_archiveXXXXXX";
+	int fd, shards, shard, g;
+
+	fd = mkstemp(path);
+	ck_assert_int_ge(fd, 0);
+	close(fd);
+
+	ck_assert(hnef_archive_writer_open(&w, path));
+	write_games(&w, GAMES);
+
+	/* Bad moves and rule sets are refused */
+	hnef_variant_setup(&b, HNEF_VARIANT_BRANDUBH);
+	ck_assert(!hnef_archive_writer_move(&w, (HnefMove){ 0, 1 }));
+	ck_assert(!hnef_archive_writer_begin(&w, &b, 99));
+	ck_assert(hnef_archive_writer_begin(&w, &b, HNEF_RULES_DEFAULT));
+	ck_assert(!hnef_archive_writer_begin(&w, &b, HNEF_RULES_DEFAULT));
+	ck_assert(!hnef_archive_writer_move(&w, (HnefMove){ HNEF_SQUARE(0, 0), HNEF_SQUARE(1, 1) }));
+	ck_assert(!hnef_archive_writer_move(&w, (HnefMove){ HNEF_SQUARE(0, 0), HNEF_SQUARE(7, 0) }));
+
+	/* A game left in progress is dropped */
+	ck_assert(hnef_archive_writer_close(&w));
+	ck_assert(!hnef_archive_writer_close(&w));
+
+	ck_assert(hnef_archive_open(&a, path));
+	ck_assert(a.index != NULL);
+	ck_assert(a.count == GAMES);
+
+	/* However the games are split, each is read once and in order */
+	for( shards=1; shards<=5; shards++ ) {
+		g = 0;
+		for( shard=0; shard<shards; shard++ ) {
+			read_shard(&a, shard, shards, &g);
+		}
+		ck_assert_int_eq(g, GAMES);
+	}
+	g = 0;
+	read_shard(&a, 3, 3, &g);
+	ck_assert_int_eq(g, 0);
+	hnef_archive_close(&a);
+	remove(path);
+}
+END_TEST
+
+START_TEST (test_archive_unclosed)
+{
+	HnefArchiveWriter w;
+	HnefArchive a;
+	FILE *f;
+	char path[] = "/tmp/check_archiveXXXXXX";
+	int fd, g;
+
+	fd = mkstemp(path);
+	ck_assert_int_ge(fd, 0);
+	close(fd);
+
+	/* An archive still being written reads from the start */
+	ck_assert(hnef_archive_writer_open(&w, path));
+	write_games(&w, 40);
+	fflush(w.file);
+	ck_assert(hnef_archive_open(&a, path));
+	ck_assert(a.index == NULL);
+	g = 0;
+	read_shard(&a, 0, 2, &g);
+	ck_assert_int_eq(g, 40);
+	g = 0;
+	read_shard(&a, 1, 2, &g);
+	ck_assert_int_eq(g, 0);
+	hnef_archive_close(&a);
+	ck_assert(hnef_archive_writer_close(&w));
+
+	/* A game cut short ends the scan */
+	ck_assert(truncate(path, 200) == 0);
+	ck_assert(hnef_archive_open(&a, path));
+	g = 0;
+	read_shard(&a, 0, 1, &g);
+	ck_assert_int_lt(g, 40);
+	hnef_archive_close(&a);
+
+	f = fopen(path, "wb");
+	ck_assert(f != NULL);
+	fputs("HNEFGAX\n", f);
+	fclose(f);
+	ck_assert(!hnef_archive_open(&a, path));
+	remove(path);
+	ck_assert(!hnef_archive_open(&a, path));
+}
+END_TEST
+
+START_TEST (test_archive_damaged)
+{
+	HnefArchive a;
+	HnefArchiveCursor c;
+	HnefArchiveGame game;
+	FILE *f;
+	char path[] = "/tmp/check_archiveXXXXXX";
+	/* One game of one move on a board of width 0: rules, winner, a
+	 * three byte layout, an empty position, the plies and the move */
+	const uint8_t record[] = { 10, 0, 1, 3, 0, 7, 0, 0, 1, 0 };
+	uint8_t header[16];
+	HnefMove move;
+	size_t at;
+	int fd;
+
+	fd = mkstemp(path);
+	ck_assert_int_ge(fd, 0);
+	close(fd);
+
+	memset(header, 0, sizeof(header));
+	memcpy(header, "HNEFGAM\n", 8);
+	header[8] = 1;
+	f = fopen(path, "wb");
+	ck_assert(f != NULL);
+	fwrite(header, 1, sizeof(header), f);
+	fwrite(record, 1, sizeof(record), f);
+	fclose(f);
+
+	/* A board with no squares is refused rather than decoded */
+	ck_assert(hnef_archive_open(&a, path));
+	hnef_archive_cursor_init(&c, &a, 0, 1);
+	ck_assert(!hnef_archive_next(&c, &game));
+	hnef_archive_close(&a);
+	remove(path);
+
+	memset(&game, 0, sizeof(game));
+	game.moves = record;
+	game.moves_length = sizeof(record);
+	at = 0;
+	ck_assert(!hnef_archive_game_move(&game, &at, &move));
+}
+END_TEST
+
+START_TEST (test_archive_illegal)
+{
+	HnefArchiveWriter w;
+	HnefArchive a;
+	HnefArchiveCursor c;
+	HnefArchiveGame game;
+	HnefReplay r;
+	HnefBoard b;
+	char path[] = "/tmp/check_archiveXXXXXX";
+	/* A move from an empty square and a defender moving first, both of
+	 * which the writer takes as it only checks the squares are in range */
+	const HnefMove moves[] = {
+		{ HNEF_SQUARE(1, 0), HNEF_SQUARE(2, 0) },
+		{ HNEF_SQUARE(3, 2), HNEF_SQUARE(2, 2) }
+	};
+	int fd, i;
+
+	fd = mkstemp(path);
+	ck_assert_int_ge(fd, 0);
+	close(fd);
+
+	ck_assert(hnef_archive_writer_open(&w, path));
+	for( i=0; i<2; i++ ) {
+		hnef_variant_setup(&b, HNEF_VARIANT_BRANDUBH);
+		ck_assert(hnef_archive_writer_begin(&w, &b, HNEF_RULES_DEFAULT));
+		ck_assert(hnef_archive_writer_move(&w, moves[i]));
+		ck_assert(hnef_archive_writer_end(&w, HNEF_NO_WINNER));
+	}
+	ck_assert(hnef_archive_writer_close(&w));
+
+	/* Such moves are refused before they touch the position */
+	ck_assert(hnef_archive_open(&a, path));
+	hnef_archive_cursor_init(&c, &a, 0, 1);
+	for( i=0; hnef_archive_next(&c, &game); i++ ) {
+		ck_assert(game.plies == 1);
+		ck_assert(hnef_archive_game_replay(&game, &b, 0));
+		ck_assert(!hnef_archive_game_replay(&game, &b, 1));
+		ck_assert(!hnef_replay_init_from_game(&r, &game, 4));
+	}
+	ck_assert_int_eq(i, 2);
+	hnef_archive_close(&a);
+	remove(path);
+}
+END_TEST
+
+START_TEST (test_archive_decided)
+{
+	HnefArchiveWriter w;
+	HnefArchive a;
+	HnefArchiveCursor c;
+	HnefArchiveGame game;
+	HnefReplay r;
+	HnefBoard b;
+	HnefRays rays;
+	char path[] = "/tmp/check_archiveXXXXXX";
+	/* Legal in itself, but made after the attackers have won */
+	const HnefMove move = { HNEF_SQUARE(3, 0), HNEF_SQUARE(2, 0) };
+	int fd;
+
+	fd = mkstemp(path);
+	ck_assert_int_ge(fd, 0);
+	close(fd);
+
+	/* A game which starts without its king is already decided */
+	ck_assert(hnef_archive_writer_open(&w, path));
+	hnef_variant_setup(&b, HNEF_VARIANT_BRANDUBH);
+	hnef_board_unset_token(&b, 3, 3);
+	ck_assert(hnef_archive_writer_begin(&w, &b, HNEF_RULES_DEFAULT));
+	ck_assert(hnef_archive_writer_move(&w, move));
+	ck_assert(hnef_archive_writer_end(&w, HNEF_MUSCOVITE));
+	ck_assert(hnef_archive_writer_close(&w));
+
+	hnef_rays_init(&rays, 7, 7);
+	ck_assert(hnef_archive_open(&a, path));
+	hnef_archive_cursor_init(&c, &a, 0, 1);
+	ck_assert(hnef_archive_next(&c, &game));
+	ck_assert(hnef_archive_game_replay(&game, &b, 0));
+	ck_assert(hnef_board_is_legal_move(&b, &rays, b.turn, move));
+	ck_assert(!hnef_archive_game_replay(&game, &b, 1));
+	ck_assert(!hnef_replay_init_from_game(&r, &game, 4));
+	hnef_archive_close(&a);
+	remove(path);
+}
+END_TEST
+
+Suite*
+hnef_suite(void) {
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create("Hnefatafl Game Archive");
+	tc_core = tcase_create("Core");
+
+	tcase_set_timeout(tc_core, 60);
+	tcase_add_test(tc_core, test_archive_shards);
+	tcase_add_test(tc_core, test_archive_unclosed);
+	tcase_add_test(tc_core, test_archive_damaged);
+	tcase_add_test(tc_core, test_archive_illegal);
+	tcase_add_test(tc_core, test_archive_decided);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+}
+
+int
+main(void) {
+	int number_failed;
+	Suite *s;
+	SRunner *sr;
+
+	s = hnef_suite();
+	sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,172 @@
+#include <check.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "../libhnef/batch.h"
+#include "../libhnef/variant.h"
+#include "random_game.h"
+
+#define GAMES 37
+
+/* Enemy tokens some move of the side to move would capture, found by
+ * trying every move */
+static int
+slow_captures( HnefBoard *b, const HnefRays *rays ) {
+	HnefMove moves[HNEF_MAX_MOVES];
+	HnefUndo records[1];
+	HnefUndoStack stack;
+	HnefBitboard before, after, taken;
+	int i, n, enemy;
+
+	hnef_bitboard_clear(&taken);
+	enemy = !b->turn;
+	before = b->teams[enemy];
+	n = hnef_board_generate_moves(b, rays, b->turn, moves, HNEF_MAX_MOVES);
+	for( i=0; i<n; i++ ) {
+		hnef_undo_stack_init(&stack, records, 1);
+		hnef_board_make_move(b, moves[i], &stack);
+		hnef_bitboard_andnot(&after, &before, &(b->teams[enemy]));
+		hnef_bitboard_or(&taken, &taken, &after);
+		hnef_board_unmake_move(b, &stack);
+	}
+	return hnef_bitboard_popcount(&taken);
+}
+
+START_TEST (test_batch_random)
+{
+	static HnefBoard boards[GAMES];
+	HnefBoardBatch batch;
+	HnefBoard start, got;
+	HnefRays rays;
+	HnefMove moves[HNEF_MAX_MOVES];
+	HnefUndo records[1];
+	HnefUndoStack stack;
+	int counts[GAMES], captures[GAMES], winners[GAMES];
+	uint64_t rng = 11;
+	int variant, isa, ply, game, n, m, c, done, threats;
+
+	for( variant=0; variant<HNEF_VARIANT_COUNT; variant++ ) {
+		hnef_variant_setup(&start, variant);
+		hnef_rays_init(&rays, start.height, start.width);
+
+		for( isa=HNEF_BATCH_SCALAR; isa<=hnef_board_batch_get_best_isa(); isa++ ) {
+			ck_assert(hnef_board_batch_init(&batch, &start, GAMES));
+			ck_assert(hnef_board_batch_set_isa(&batch, isa));
+			for( game=0; game<GAMES; game++ ) {
+				boards[game] = start;
+			}
+			threats = 0;
+
+			/* Play random games side by side, comparing the batch with
+			 * the boards after every move */
+			for( ply=0; ply<200; ply++ ) {
+				hnef_board_batch_count_moves(&batch, counts);
+				hnef_board_batch_count_captures(&batch, captures);
+				hnef_board_batch_get_winners(&batch, winners);
+
+				done = 1;
+				for( game=0; game<GAMES; game++ ) {
+					hnef_board_batch_get(&batch, game, &got);
+					ck_assert_int_eq(got.key, boards[game].key);
+					ck_assert_int_eq(winners[game], hnef_board_get_winner(&boards[game]));
+
+					n = hnef_board_generate_moves(&boards[game], &rays, boards[game].turn, moves, HNEF_MAX_MOVES);
+					ck_assert_int_eq(counts[game], n);
+					ck_assert_int_eq(captures[game], slow_captures(&boards[game], &rays));
+					threats += captures[game];
+
+					if(winners[game] != HNEF_NO_WINNER || n == 0) {
+						continue;
+					}
+					done = 0;
+					m = (int)(random_next(&rng) % n);
+					hnef_undo_stack_init(&stack, records, 1);
+					c = hnef_board_make_move(&boards[game], moves[m], &stack);
+					ck_assert_int_eq(hnef_board_batch_make_move(&batch, game, moves[m]), c);
+				}
+				if(done) {
+					break;
+				}
+			}
+			ck_assert_int_gt(threats, 0);
+			hnef_board_batch_free(&batch);
+		}
+	}
+}
+END_TEST
+
+START_TEST (test_batch_set)
+{
+	HnefBoardBatch batch;
+	HnefBoard a, b;
+	HnefRays rays;
+	HnefMove moves[HNEF_MAX_MOVES];
+	int winners[3];
+
+	hnef_variant_setup(&a, HNEF_VARIANT_BRANDUBH);
+	ck_assert(hnef_board_batch_init(&batch, &a, 3));
+	ck_assert(!hnef_board_batch_set_isa(&batch, HNEF_BATCH_AVX512 + 1));
+
+	/* Boards of another size or structure are refused */
+	hnef_variant_setup(&b, HNEF_VARIANT_TABLUT);
+	ck_assert(!hnef_board_batch_set(&batch, 1, &b));
+	b = a;
+	hnef_board_set_tile_type(&b, 1, 1, HNEF_CAMP);
+	ck_assert(!hnef_board_batch_set(&batch, 1, &b));
+
+	/* So are games outside the batch */
+	ck_assert(!hnef_board_batch_set(&batch, -1, &a));
+	ck_assert(!hnef_board_batch_set(&batch, 3, &a));
+	hnef_rays_init(&rays, a.height, a.width);
+	ck_assert_int_gt(hnef_board_generate_moves(&a, &rays, a.turn, moves, HNEF_MAX_MOVES), 0);
+	ck_assert_int_eq(hnef_board_batch_make_move(&batch, -1, moves[0]), 0);
+	ck_assert_int_eq(hnef_board_batch_make_move(&batch, 3, moves[0]), 0);
+	hnef_board_batch_get(&batch, 0, &b);
+	ck_assert_int_eq(b.key, a.key);
+
+	/* Without its king a game is lost, with the king on a corner won */
+	b = a;
+	hnef_board_unset_token(&b, 3, 3);
+	ck_assert(hnef_board_batch_set(&batch, 1, &b));
+	hnef_board_set_token(&b, 0, 0, hnef_board_get_token(&a, 3, 3));
+	ck_assert(hnef_board_batch_set(&batch, 2, &b));
+	hnef_board_batch_get_winners(&batch, winners);
+	ck_assert_int_eq(winners[0], HNEF_NO_WINNER);
+	ck_assert_int_eq(winners[1], HNEF_MUSCOVITE);
+	ck_assert_int_eq(winners[2], HNEF_SWEDE);
+
+	hnef_board_batch_free(&batch);
+}
+END_TEST
+
+Suite*
+hnef_suite(void) {
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create("Hnefatafl Batch");
+	tc_core = tcase_create("Core");
+	tcase_set_timeout(tc_core, 60);
+
+	tcase_add_test(tc_core, test_batch_random);
+	tcase_add_test(tc_core, test_batch_set);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+}
+
+int
+main(void) {
+	int number_failed;
+	Suite *s;
+	SRunner *sr;
+
+	s = hnef_suite();
+	sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
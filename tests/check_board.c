@@ -88,6 +88,127 @@ START_TEST(test_board) {
 }
 END_TEST
 
+START_TEST(test_board_bitboards) {
+	HnefBoard b1, b2;
+	HnefToken tok;
+	uint8_t s[11*11+2] = {0};
+	int n=11;
+
+	hnef_board_init( &b1, n, n );
+	ck_assert_int_eq(hnef_bitboard_popcount(hnef_board_get_type_mask(&b1, HNEF_EMPTY)), n*n);
+	ck_assert(hnef_bitboard_is_empty(hnef_board_get_occupied(&b1)));
+
+	/* Structures are mirrored into the type and escape masks */
+	hnef_board_set_tile_type(&b1, n/2, n/2, HNEF_THRONE);
+	hnef_board_set_tile_is_escape(&b1, 0, 0, HNEF_ESCAPE);
+	ck_assert(hnef_bitboard_test(hnef_board_get_type_mask(&b1, HNEF_THRONE), HNEF_SQUARE(n/2, n/2)));
+	ck_assert(!hnef_bitboard_test(hnef_board_get_type_mask(&b1, HNEF_EMPTY), HNEF_SQUARE(n/2, n/2)));
+	ck_assert(hnef_bitboard_test(hnef_board_get_escape_mask(&b1), HNEF_SQUARE(0, 0)));
+
+	/* Tokens are mirrored into the team and rank masks */
+	hnef_token_init(&tok, HNEF_SWEDE, HNEF_KING);
+	hnef_board_set_token(&b1, n/2, n/2, tok);
+	hnef_token_init(&tok, HNEF_MUSCOVITE, HNEF_SOLDIER);
+	hnef_board_set_token(&b1, 3, 0, tok);
+	hnef_board_set_token(&b1, 3, 7, tok);
+
+	ck_assert_int_eq(hnef_board_count_team(&b1, HNEF_SWEDE), 1);
+	ck_assert_int_eq(hnef_board_count_team(&b1, HNEF_MUSCOVITE), 2);
+	ck_assert_int_eq(hnef_board_count_rank(&b1, HNEF_KING), 1);
+	ck_assert(hnef_board_get_row_is_occupied(&b1, 7));
+	ck_assert(!hnef_board_get_row_is_occupied(&b1, 6));
+	ck_assert(hnef_board_get_column_is_occupied(&b1, 3));
+	ck_assert(!hnef_board_get_column_is_occupied(&b1, 4));
+
+	/* Replacing a token clears the bits of the old one */
+	hnef_token_init(&tok, HNEF_SWEDE, HNEF_SOLDIER);
+	hnef_board_set_token(&b1, 3, 7, tok);
+	ck_assert_int_eq(hnef_board_count_team(&b1, HNEF_MUSCOVITE), 1);
+	ck_assert_int_eq(hnef_board_count_team(&b1, HNEF_SWEDE), 2);
+
+	hnef_board_unset_token(&b1, 3, 7);
+	ck_assert(!hnef_board_get_tile_is_occupied(&b1, 3, 7));
+	ck_assert(!hnef_board_get_row_is_occupied(&b1, 7));
+	ck_assert_int_eq(hnef_board_count_team(&b1, HNEF_SWEDE), 1);
+
+	/* Deserialized boards rebuild their masks */
+	hnef_board_serialize(&b1, s);
+	hnef_board_deserialize(&b2, s);
+	ck_assert_int_eq(hnef_board_count_team(&b2, HNEF_MUSCOVITE), 1);
+	ck_assert_int_eq(hnef_board_count_rank(&b2, HNEF_KING), 1);
+	ck_assert(hnef_bitboard_test(hnef_board_get_type_mask(&b2, HNEF_THRONE), HNEF_SQUARE(n/2, n/2)));
+	ck_assert(hnef_bitboard_test(hnef_board_get_escape_mask(&b2), HNEF_SQUARE(0, 0)));
+}
+END_TEST
+
+START_TEST(test_board_zobrist) {
+	HnefBoard b1, b2;
+	HnefTile t;
+	HnefToken tok;
+	uint8_t s[9*9+2] = {0};
+	uint64_t empty;
+	int n=9, i, x, y;
+
+	hnef_board_init( &b1, n, n );
+	empty = hnef_board_get_key(&b1);
+	ck_assert(hnef_board_get_key(&b1) == hnef_board_compute_key(&b1));
+
+	/* Random edits keep the incremental key equal to a full recompute */
+	srand(3);
+	for(i=0; i<2000; i++) {
+		x = rand()%n;
+		y = rand()%n;
+		switch(rand()%6) {
+		case 0:
+			hnef_token_init(&tok, rand()%2, rand()%2);
+			hnef_board_set_token(&b1, x, y, tok);
+			break;
+		case 1:
+			hnef_board_unset_token(&b1, x, y);
+			break;
+		case 2:
+			hnef_board_set_tile_type(&b1, x, y, rand()%4);
+			break;
+		case 3:
+			hnef_board_set_tile_is_escape(&b1, x, y, rand()%2);
+			break;
+		case 4:
+			hnef_tile_init(&t, rand()%4, rand()%2);
+			if(rand()%2) {
+				hnef_token_init(&tok, rand()%2, rand()%2);
+				hnef_tile_set_token(&t, tok);
+			}
+			hnef_board_set_tile(&b1, x, y, t);
+			break;
+		default:
+			hnef_board_set_turn(&b1, rand()%2);
+			break;
+		}
+		ck_assert(hnef_board_get_key(&b1) == hnef_board_compute_key(&b1));
+	}
+
+	/* The side to move changes the key */
+	hnef_board_set_turn(&b1, HNEF_MUSCOVITE);
+	hnef_board_serialize(&b1, s);
+	hnef_board_deserialize(&b2, s);
+	ck_assert(hnef_board_get_key(&b1) == hnef_board_get_key(&b2));
+	hnef_board_set_turn(&b2, HNEF_SWEDE);
+	ck_assert(hnef_board_get_key(&b1) != hnef_board_get_key(&b2));
+	ck_assert(hnef_board_get_key(&b2) == hnef_board_compute_key(&b2));
+
+	/* Clearing the board returns to the empty key */
+	hnef_board_set_turn(&b1, HNEF_MUSCOVITE);
+	for(x=0; x<n; x++) {
+		for(y=0; y<n; y++) {
+			hnef_board_unset_token(&b1, x, y);
+			hnef_board_set_tile_type(&b1, x, y, HNEF_EMPTY);
+			hnef_board_set_tile_is_escape(&b1, x, y, HNEF_NO_ESCAPE);
+		}
+	}
+	ck_assert(hnef_board_get_key(&b1) == empty);
+}
+END_TEST
+
 Suite *
 hnef_suite(void) {
 	Suite *s;
@@ -98,6 +219,8 @@ hnef_suite(void) {
 	tc_core = tcase_create("Core");
 	
 	tcase_add_test(tc_core, test_board);
+	tcase_add_test(tc_core, test_board_bitboards);
+	tcase_add_test(tc_core, test_board_zobrist);
 	
 	suite_add_tcase(s, tc_core);
 
@@ -0,0 +1,129 @@
+#include <check.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "../libhnef/board.hpp"
+#include "../libhnef/variant.h"
+#include "../libhnef/perft.h"
+
+/* Play the same random game on both boards, comparing every ply */
+template <int N>
+static void
+compare_variant( int variant ) {
+	hnef::Board<N, N> fast, layout;
+	HnefBoard board, copy;
+	HnefRays rays;
+	HnefMove moves[HNEF_MAX_MOVES], fast_moves[HNEF_MAX_MOVES];
+	HnefUndo records[256], undo[256];
+	HnefUndoStack stack;
+	uint64_t rng = 0x9e3779b97f4a7c15ULL;
+	int i, n, ply;
+
+	hnef_variant_setup(&board, variant);
+	hnef_rays_init(&rays, N, N);
+	hnef_undo_stack_init(&stack, records, 256);
+	ck_assert(fast.load(&board));
+	ck_assert(fast.get_key() == hnef_board_get_key(&board));
+
+	/* The compile-time masks give the variant's thrones, castles and
+	 * escapes, all variants with edge escapes having an escape in row 1 */
+	layout.set_standard_structures(fast.get_escape_mask()[1] != 0);
+	for( i=0; i<N; i++ ) {
+		ck_assert_int_eq(layout.get_type_mask(HNEF_THRONE)[i], fast.get_type_mask(HNEF_THRONE)[i]);
+		ck_assert_int_eq(layout.get_type_mask(HNEF_CASTLE)[i], fast.get_type_mask(HNEF_CASTLE)[i]);
+		ck_assert_int_eq(layout.get_escape_mask()[i], fast.get_escape_mask()[i]);
+	}
+
+	for( ply=0; ply<256 && hnef_board_get_winner(&board) == HNEF_NO_WINNER; ply++ ) {
+		n = hnef_board_generate_moves(&board, &rays, board.turn, moves, HNEF_MAX_MOVES);
+		ck_assert_int_eq(fast.generate_moves(fast.get_turn(), fast_moves, HNEF_MAX_MOVES), n);
+		for( i=0; i<n; i++ ) {
+			ck_assert_int_eq(fast_moves[i].from, moves[i].from);
+			ck_assert_int_eq(fast_moves[i].to, moves[i].to);
+		}
+		if(n == 0) {
+			break;
+		}
+
+		rng ^= rng >> 12;
+		rng ^= rng << 25;
+		rng ^= rng >> 27;
+		i = (int)((rng * 0x2545f4914f6cdd1dULL) >> 33) % n;
+		ck_assert_int_eq(fast.make_move(moves[i], &(undo[ply])),
+		                 hnef_board_make_move(&board, moves[i], &stack));
+		ck_assert(fast.get_key() == hnef_board_get_key(&board));
+		ck_assert_int_eq(fast.count_team(HNEF_MUSCOVITE), hnef_board_count_team(&board, HNEF_MUSCOVITE));
+		ck_assert_int_eq(fast.count_team(HNEF_SWEDE), hnef_board_count_team(&board, HNEF_SWEDE));
+	}
+	ck_assert_int_eq(fast.get_winner(), hnef_board_get_winner(&board));
+
+	fast.store(&copy);
+	ck_assert(hnef_board_get_key(&copy) == hnef_board_get_key(&board));
+
+	while( ply > 0 ) {
+		fast.unmake_move(undo[--ply]);
+		hnef_board_unmake_move(&board, &stack);
+		ck_assert(fast.get_key() == hnef_board_get_key(&board));
+	}
+
+	ck_assert(hnef::perft(fast, 3) == hnef_perft(&board, &rays, 3));
+}
+
+START_TEST (test_board_template)
+{
+	typedef hnef::Board11 B;
+	static_assert(B::all_mask[0] == 0x7ffu && B::all_mask[10] == 0x7ffu, "board mask");
+	static_assert(B::corner_mask[0] == 0x401u, "corner mask");
+	static_assert(B::throne_mask[5] == 0x20u, "throne mask");
+	static_assert(B::edge_mask[3] == 0x401u && B::edge_mask[10] == 0x7ffu, "edge mask");
+	HnefBoard board;
+	B fast;
+
+	/* A board of the wrong size is refused */
+	hnef_variant_setup(&board, HNEF_VARIANT_BRANDUBH);
+	ck_assert(!fast.load(&board));
+
+	fast.set_type(5, 5, HNEF_THRONE);
+	fast.set_escape(0, 0, true);
+	fast.set_token(5, 5, HNEF_SWEDE, HNEF_KING);
+	fast.set_turn(HNEF_SWEDE);
+	fast.store(&board);
+	ck_assert(hnef_board_get_key(&board) == fast.get_key());
+	ck_assert(hnef_board_compute_key(&board) == fast.get_key());
+	ck_assert_int_eq(hnef_board_get_token_rank(&board, 5, 5), HNEF_KING);
+	ck_assert_int_eq(fast.get_type(5, 5), HNEF_THRONE);
+
+	compare_variant<7>(HNEF_VARIANT_BRANDUBH);
+	compare_variant<9>(HNEF_VARIANT_TABLUT);
+	compare_variant<11>(HNEF_VARIANT_COPENHAGEN);
+	compare_variant<13>(HNEF_VARIANT_LARGE);
+}
+END_TEST
+
+Suite*
+hnef_suite(void) {
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create("Hnefatafl Board Template");
+	tc_core = tcase_create("Core");
+
+	tcase_add_test(tc_core, test_board_template);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+}
+
+int
+main(void) {
+	int number_failed;
+	Suite *s;
+	SRunner *sr;
+
+	s = hnef_suite();
+	sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,256 @@
+#include <check.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../libhnef/cow.h"
+#include "../libhnef/rules.h"
+#include "../libhnef/variant.h"
+#include "random_game.h"
+
+#define MAX_PLIES 200
+#define THREADS   4
+
+static HnefCowBoard history[MAX_PLIES + 1];
+static uint64_t keys[MAX_PLIES + 1];
+static HnefCowBoard branches[THREADS];
+
+/* Whether row y holds the same tiles on two boards */
+static int
+same_row( const HnefCowBoard *a, const HnefCowBoard *b, int y, int width ) {
+	HnefTile s, t;
+	int x;
+
+	for( x=0; x<width; x++ ) {
+		hnef_cow_board_get_tile(a, x, y, &s);
+		hnef_cow_board_get_tile(b, x, y, &t);
+		if(hnef_tile_serialize(&s) != hnef_tile_serialize(&t)) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/* Snapshot each position after the first, counting the rows copied
+ * in the int passed as data */
+static int
+snapshot_ply( HnefBoard *b, int ply, const HnefMove *move, void *data ) {
+	int y, shared;
+
+	(void)move;
+	if(ply == 0) {
+		return 1;
+	}
+	hnef_cow_board_snapshot(&history[ply], &history[ply - 1]);
+	ck_assert(history[ply].node == history[ply - 1].node);
+	ck_assert(hnef_cow_board_update(&history[ply], b));
+	ck_assert(hnef_cow_board_get_key(&history[ply]) == b->key);
+	keys[ply] = b->key;
+
+	/* Rows are copied exactly when they change */
+	for( y=0; y<b->height; y++ ) {
+		shared = hnef_cow_board_shares_row(&history[ply - 1], &history[ply], y);
+		ck_assert_int_eq(shared, same_row(&history[ply - 1], &history[ply], y, b->width));
+		*(int*)data += !shared;
+	}
+	return 1;
+}
+
+START_TEST (test_cow_history)
+{
+	HnefBoard b, got;
+	HnefRules rules;
+	HnefRuleTables tables;
+	HnefRays rays;
+	uint8_t want[2 + MAX_HEIGHT*MAX_WIDTH], have[2 + MAX_HEIGHT*MAX_WIDTH];
+	uint64_t rng = 11;
+	int variant, preset, plies, ply, copied;
+
+	for( variant=0; variant<HNEF_VARIANT_COUNT; variant++ ) {
+		preset = (variant == HNEF_VARIANT_COPENHAGEN)? HNEF_RULES_COPENHAGEN : HNEF_RULES_DEFAULT;
+		hnef_variant_setup(&b, variant);
+		hnef_rays_init(&rays, b.height, b.width);
+		hnef_rules_init(&rules, preset);
+		hnef_rules_compile(&tables, &rules, &b);
+		ck_assert(hnef_cow_board_init(&history[0], &b));
+		keys[0] = b.key;
+
+		/* Keep a snapshot of every position of a random game */
+		copied = 0;
+		plies = random_game(&b, &tables, &rays, &rng, MAX_PLIES, NULL, snapshot_ply, &copied);
+		ck_assert_int_lt(copied, 4*plies + 1);
+
+		/* Every snapshot still holds its own position */
+		for( ply=plies; ply>=0; ply-- ) {
+			ck_assert_int_eq(hnef_cow_board_get_turn(&history[ply]), (hnef_cow_board_get_turn(&history[0]) + ply) & 1);
+			hnef_cow_board_get(&history[ply], &got);
+			ck_assert(got.key == keys[ply]);
+			ck_assert(hnef_board_compute_key(&got) == keys[ply]);
+		}
+		hnef_cow_board_get(&history[plies], &got);
+		hnef_board_serialize(&got, have);
+		hnef_board_serialize(&b, want);
+		ck_assert(memcmp(have, want, 2 + b.height*b.width) == 0);
+
+		for( ply=0; ply<=plies; ply++ ) {
+			hnef_cow_board_free(&history[ply]);
+		}
+	}
+}
+END_TEST
+
+START_TEST (test_cow_branch)
+{
+	HnefBoard b, got;
+	HnefCowBoard trunk, branch, other;
+	HnefTile tile;
+	HnefToken token;
+	uint64_t key;
+
+	hnef_variant_setup(&b, HNEF_VARIANT_BRANDUBH);
+	ck_assert(hnef_cow_board_init(&trunk, &b));
+	key = hnef_cow_board_get_key(&trunk);
+
+	/* Changing a branch leaves the board it came from alone */
+	hnef_cow_board_snapshot(&branch, &trunk);
+	ck_assert(hnef_cow_board_is_shared(&trunk));
+	hnef_cow_board_get_tile(&branch, 0, 0, &tile);
+	ck_assert(!tile.is_occupied);
+	hnef_token_init(&token, HNEF_MUSCOVITE, HNEF_SOLDIER);
+	hnef_tile_set_token(&tile, token);
+	ck_assert(hnef_cow_board_set_tile(&branch, 0, 0, tile));
+	ck_assert(hnef_cow_board_set_turn(&branch, HNEF_SWEDE));
+	ck_assert(branch.node != trunk.node);
+	ck_assert(!hnef_cow_board_is_shared(&trunk));
+	ck_assert(!hnef_cow_board_shares_row(&branch, &trunk, 0));
+	ck_assert(hnef_cow_board_shares_row(&branch, &trunk, 1));
+	ck_assert(hnef_cow_board_get_key(&trunk) == key);
+
+	/* Keys match those of a board changed the same way */
+	hnef_board_set_token(&b, 0, 0, token);
+	hnef_board_set_turn(&b, HNEF_SWEDE);
+	ck_assert(hnef_cow_board_get_key(&branch) == b.key);
+	hnef_cow_board_get(&branch, &got);
+	ck_assert(got.key == b.key);
+	ck_assert_int_eq(hnef_board_get_token_team(&got, 0, 0), HNEF_MUSCOVITE);
+	hnef_cow_board_get_tile(&trunk, 0, 0, &tile);
+	ck_assert(!tile.is_occupied);
+
+	/* Undoing the change by hand gives the original key back */
+	hnef_cow_board_snapshot(&other, &branch);
+	hnef_tile_unset_token(&tile);
+	ck_assert(hnef_cow_board_set_tile(&other, 0, 0, tile));
+	ck_assert(hnef_cow_board_set_turn(&other, HNEF_MUSCOVITE));
+	ck_assert(hnef_cow_board_get_key(&other) == key);
+	ck_assert(hnef_cow_board_get_key(&branch) == b.key);
+
+	/* Boards of another size are refused */
+	hnef_variant_setup(&b, HNEF_VARIANT_TABLUT);
+	ck_assert(!hnef_cow_board_update(&other, &b));
+
+	hnef_cow_board_free(&trunk);
+	hnef_cow_board_free(&branch);
+	hnef_cow_board_free(&other);
+}
+END_TEST
+
+/* Change a snapshot of a shared board many times over, setting the
+ * board to the thread's own change at the end */
+static void*
+change_branch( void *data ) {
+	HnefCowBoard *branch, other;
+	HnefTile tile;
+	HnefToken token;
+	int i, x;
+
+	branch = data;
+	x = (int)(branch - branches);
+	hnef_token_init(&token, HNEF_SWEDE, HNEF_KING);
+	for( i=0; i<2000; i++ ) {
+		hnef_cow_board_snapshot(&other, branch);
+		hnef_cow_board_get_tile(&other, x, i % 7, &tile);
+		hnef_tile_set_token(&tile, token);
+		if(!hnef_cow_board_set_tile(&other, x, i % 7, tile)) {
+			return NULL;
+		}
+		hnef_cow_board_free(&other);
+	}
+	hnef_cow_board_get_tile(branch, x, 0, &tile);
+	hnef_tile_set_token(&tile, token);
+	return hnef_cow_board_set_tile(branch, x, 0, tile)? branch : NULL;
+}
+
+START_TEST (test_cow_threads)
+{
+	HnefBoard b;
+	HnefCowBoard trunk, kept;
+	HnefTile tile;
+	pthread_t threads[THREADS];
+	void *result;
+	uint64_t key;
+	int i;
+
+	hnef_variant_setup(&b, HNEF_VARIANT_BRANDUBH);
+	ck_assert(hnef_cow_board_init(&trunk, &b));
+	key = hnef_cow_board_get_key(&trunk);
+	hnef_cow_board_snapshot(&kept, &trunk);
+
+	/* Threads copy and let go of the shared node and rows at once,
+	 * while the board they came from is released */
+	for( i=0; i<THREADS; i++ ) {
+		hnef_cow_board_snapshot(&branches[i], &trunk);
+	}
+	for( i=0; i<THREADS; i++ ) {
+		ck_assert_int_eq(pthread_create(&threads[i], NULL, change_branch, &branches[i]), 0);
+	}
+	hnef_cow_board_free(&trunk);
+	for( i=0; i<THREADS; i++ ) {
+		pthread_join(threads[i], &result);
+		ck_assert(result == &branches[i]);
+		hnef_cow_board_get_tile(&branches[i], i, 0, &tile);
+		ck_assert_int_eq(tile.token.rank, HNEF_KING);
+		ck_assert(hnef_cow_board_get_key(&branches[i]) != key);
+		hnef_cow_board_free(&branches[i]);
+	}
+
+	/* The snapshot taken first is untouched */
+	ck_assert(hnef_cow_board_get_key(&kept) == key);
+	ck_assert(!hnef_cow_board_is_shared(&kept));
+	for( i=0; i<THREADS; i++ ) {
+		hnef_cow_board_get_tile(&kept, i, 0, &tile);
+		ck_assert(!tile.is_occupied || tile.token.rank != HNEF_KING);
+	}
+	hnef_cow_board_free(&kept);
+}
+END_TEST
+
+Suite*
+hnef_suite(void) {
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create("Hnefatafl Copy-on-Write Board");
+	tc_core = tcase_create("Core");
+
+	tcase_add_test(tc_core, test_cow_history);
+	tcase_add_test(tc_core, test_cow_branch);
+	tcase_add_test(tc_core, test_cow_threads);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+}
+
+int
+main(void) {
+	int number_failed;
+	Suite *s;
+	SRunner *sr;
+
+	s = hnef_suite();
+	sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,237 @@
+#include <check.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "../libhnef/escape.h"
+#include "../libhnef/move.h"
+#include "../libhnef/variant.h"
+#include "random_game.h"
+
+/* Reference answers found by walking the board one tile at a time */
+static int
+open_tile( HnefBoard *b, int x, int y ) {
+	if(x < 0 || y < 0 || x >= b->width || y >= b->height) {
+		return 0;
+	}
+	if(hnef_board_get_tile_type(b, x, y) == HNEF_CAMP) {
+		return 0;
+	}
+	return !hnef_board_get_tile_is_occupied(b, x, y) ||
+		hnef_board_get_token_rank(b, x, y) == HNEF_KING;
+}
+
+static int
+slow_distance( HnefBoard *b ) {
+	static const int dx[4] = { 0, 1, 0, -1 }, dy[4] = { -1, 0, 1, 0 };
+	int dist[32*32], queue[32*32], head, tail, sq, x, y, d, nx, ny;
+
+	memset(dist, -1, sizeof(dist));
+	head = tail = 0;
+	for( y=0; y<b->height; y++ ) {
+		for( x=0; x<b->width; x++ ) {
+			if(hnef_board_get_tile_is_occupied(b, x, y) &&
+			   hnef_board_get_token_rank(b, x, y) == HNEF_KING) {
+				dist[y*32+x] = 0;
+				queue[tail++] = y*32+x;
+			}
+		}
+	}
+	while( head < tail ) {
+		sq = queue[head++];
+		x = sq % 32;
+		y = sq / 32;
+		if(hnef_board_get_tile_is_escape(b, x, y)) {
+			return dist[sq];
+		}
+		for( d=0; d<4; d++ ) {
+			nx = x + dx[d];
+			ny = y + dy[d];
+			while( open_tile(b, nx, ny) ) {
+				if(dist[ny*32+nx] < 0) {
+					dist[ny*32+nx] = dist[sq] + 1;
+					queue[tail++] = ny*32+nx;
+				}
+				nx += dx[d];
+				ny += dy[d];
+			}
+		}
+	}
+	return HNEF_ESCAPE_UNREACHABLE;
+}
+
+static int
+slow_ringed( HnefBoard *b ) {
+	static const int dx[4] = { 0, 1, 0, -1 }, dy[4] = { -1, 0, 1, 0 };
+	int seen[32*32], queue[32*32], head, tail, sq, x, y, d, nx, ny;
+
+	memset(seen, 0, sizeof(seen));
+	head = tail = 0;
+	for( y=0; y<b->height; y++ ) {
+		for( x=0; x<b->width; x++ ) {
+			if(hnef_board_get_tile_is_occupied(b, x, y) &&
+			   hnef_board_get_token_rank(b, x, y) == HNEF_KING) {
+				seen[y*32+x] = 1;
+				queue[tail++] = y*32+x;
+			}
+		}
+	}
+	if(tail == 0) {
+		return 0;
+	}
+	while( head < tail ) {
+		sq = queue[head++];
+		x = sq % 32;
+		y = sq / 32;
+		if(x == 0 || y == 0 || x == b->width - 1 || y == b->height - 1) {
+			return 0;
+		}
+		for( d=0; d<4; d++ ) {
+			nx = x + dx[d];
+			ny = y + dy[d];
+			if(!seen[ny*32+nx] && !(hnef_board_get_tile_is_occupied(b, nx, ny) &&
+			   hnef_board_get_token_team(b, nx, ny) == HNEF_MUSCOVITE)) {
+				seen[ny*32+nx] = 1;
+				queue[tail++] = ny*32+nx;
+			}
+		}
+	}
+	return 1;
+}
+
+/* Compare the checks with the reference answers on every position */
+static int
+check_position( HnefBoard *b, int ply, const HnefMove *move, void *data ) {
+	int dist;
+
+	(void)ply;
+	(void)move;
+	(void)data;
+	dist = slow_distance(b);
+	ck_assert_int_eq(hnef_board_king_escape_distance(b, NULL, 64), dist);
+	if(dist != 0) {
+		ck_assert_int_eq(hnef_board_king_escapes_in_one(b, NULL) > 0, dist == 1);
+	}
+	ck_assert_int_eq(hnef_board_king_is_ringed(b), slow_ringed(b));
+	return 1;
+}
+
+START_TEST (test_escape_random)
+{
+	HnefBoard b;
+	HnefRays rays;
+	uint64_t rng = 99;
+	int game;
+
+	for( game=0; game<40; game++ ) {
+		hnef_variant_setup(&b, game % HNEF_VARIANT_COUNT);
+		hnef_rays_init(&rays, b.height, b.width);
+		random_game(&b, NULL, &rays, &rng, 400, NULL, check_position, NULL);
+	}
+}
+END_TEST
+
+START_TEST (test_escape_simple)
+{
+	HnefBoard b;
+	HnefBitboard edge;
+	HnefToken tok;
+	int i;
+
+	hnef_board_init(&b, 7, 7);
+	ck_assert_int_eq(hnef_board_king_escape_distance(&b, NULL, 8), HNEF_ESCAPE_UNREACHABLE);
+	ck_assert(!hnef_board_king_is_ringed(&b));
+
+	hnef_board_set_tile_is_escape(&b, 0, 0, HNEF_ESCAPE);
+	hnef_board_set_tile_is_escape(&b, 6, 6, HNEF_ESCAPE);
+	hnef_token_init(&tok, HNEF_SWEDE, HNEF_KING);
+	hnef_board_set_token(&b, 3, 3, tok);
+	ck_assert_int_eq(hnef_board_king_escapes_in_one(&b, NULL), 0);
+	ck_assert_int_eq(hnef_board_king_escape_distance(&b, NULL, 8), 2);
+	ck_assert_int_eq(hnef_board_king_escape_distance(&b, NULL, 1), HNEF_ESCAPE_UNREACHABLE);
+
+	/* Two escapes on an open edge, one of them behind a camp */
+	hnef_bitboard_clear(&edge);
+	for( i=0; i<7; i++ ) {
+		hnef_bitboard_set(&edge, HNEF_SQUARE(i, 0));
+	}
+	ck_assert_int_eq(hnef_board_king_escapes_in_one(&b, &edge), 1);
+	hnef_board_set_tile_type(&b, 3, 1, HNEF_CAMP);
+	ck_assert_int_eq(hnef_board_king_escapes_in_one(&b, &edge), 0);
+	ck_assert_int_eq(hnef_board_king_escape_distance(&b, &edge, 8), 2);
+
+	/* A diamond of attackers closes a ring, a gap opens it */
+	hnef_token_init(&tok, HNEF_MUSCOVITE, HNEF_SOLDIER);
+	hnef_board_set_token(&b, 3, 1, tok);
+	hnef_board_set_token(&b, 2, 2, tok);
+	hnef_board_set_token(&b, 4, 2, tok);
+	hnef_board_set_token(&b, 1, 3, tok);
+	hnef_board_set_token(&b, 5, 3, tok);
+	hnef_board_set_token(&b, 2, 4, tok);
+	hnef_board_set_token(&b, 4, 4, tok);
+	hnef_board_set_token(&b, 3, 5, tok);
+	ck_assert(hnef_board_king_is_ringed(&b));
+	ck_assert_int_eq(hnef_board_king_escape_distance(&b, NULL, 8), HNEF_ESCAPE_UNREACHABLE);
+	hnef_board_unset_token(&b, 4, 4);
+	ck_assert(!hnef_board_king_is_ringed(&b));
+}
+END_TEST
+
+START_TEST(test_escape_slide_fill) {
+	HnefBitboard src, empty, reach;
+	int y;
+
+	/* A token below every empty square still slides north into them */
+	hnef_bitboard_clear(&src);
+	hnef_bitboard_set(&src, HNEF_SQUARE(3, 6));
+	hnef_bitboard_fill(&empty, 6, 7);
+	hnef_bitboard_slide_fill(&reach, &src, &empty);
+	ck_assert_int_eq(hnef_bitboard_popcount(&reach), 6);
+	for( y=0; y<6; y++ ) {
+		ck_assert(hnef_bitboard_test(&reach, HNEF_SQUARE(3, y)));
+	}
+
+	/* Likewise from the last row a bitboard holds */
+	hnef_bitboard_clear(&src);
+	hnef_bitboard_set(&src, HNEF_SQUARE(0, HNEF_BITBOARD_ROWS - 1));
+	hnef_bitboard_fill(&empty, HNEF_BITBOARD_ROWS - 1, 1);
+	hnef_bitboard_slide_fill(&src, &src, &empty);
+	ck_assert_int_eq(hnef_bitboard_popcount(&src), HNEF_BITBOARD_ROWS - 1);
+
+	/* Nothing moves without empty squares */
+	hnef_bitboard_clear(&empty);
+	hnef_bitboard_set(&src, HNEF_SQUARE(4, 4));
+	hnef_bitboard_slide_fill(&reach, &src, &empty);
+	ck_assert(hnef_bitboard_is_empty(&reach));
+}
+END_TEST
+
+Suite*
+hnef_suite(void) {
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create("Hnefatafl Escape");
+	tc_core = tcase_create("Core");
+
+	tcase_add_test(tc_core, test_escape_random);
+	tcase_add_test(tc_core, test_escape_simple);
+	tcase_add_test(tc_core, test_escape_slide_fill);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+}
+
+int
+main(void) {
+	int number_failed;
+	Suite *s;
+	SRunner *sr;
+
+	s = hnef_suite();
+	sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
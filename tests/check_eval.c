@@ -0,0 +1,166 @@
+#include <check.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "../libhnef/eval.h"
+#include "../libhnef/escape.h"
+#include "../libhnef/move.h"
+#include "../libhnef/variant.h"
+#include "random_game.h"
+
+static void
+assert_features_eq( const HnefEvalFeatures *a, const HnefEvalFeatures *b ) {
+	ck_assert_int_eq(a->material[0], b->material[0]);
+	ck_assert_int_eq(a->material[1], b->material[1]);
+	ck_assert_int_eq(a->psq[0], b->psq[0]);
+	ck_assert_int_eq(a->psq[1], b->psq[1]);
+	ck_assert_int_eq(a->corner_guards, b->corner_guards);
+	ck_assert_int_eq(a->king_mobility, b->king_mobility);
+	ck_assert_int_eq(a->king_distance, b->king_distance);
+}
+
+/* Compare the incremental features with a full count */
+static int
+check_features( HnefBoard *b, int ply, const HnefMove *move, void *data ) {
+	HnefEvalFeatures fast, slow;
+
+	(void)ply;
+	(void)move;
+	(void)data;
+	hnef_eval_get_features(b, &fast);
+	hnef_eval_compute_features(b, &slow);
+	assert_features_eq(&fast, &slow);
+	ck_assert_int_eq(hnef_eval_score(&fast), hnef_eval_score(&slow));
+	ck_assert_int_eq(fast.king_distance,
+		hnef_board_king_escape_distance(b, NULL, HNEF_EVAL_ESCAPE_DEPTH));
+	return 1;
+}
+
+START_TEST (test_eval_incremental)
+{
+	HnefBoard b;
+	HnefRays rays;
+	HnefUndo records[300];
+	HnefUndoStack stack;
+	HnefEvalFeatures fast, start;
+	HnefEvalAccumulator acc;
+	uint64_t rng = 7;
+	int game;
+
+	for( game=0; game<40; game++ ) {
+		hnef_variant_setup(&b, game % HNEF_VARIANT_COUNT);
+		hnef_rays_init(&rays, b.height, b.width);
+		hnef_undo_stack_init(&stack, records, 300);
+		hnef_eval_track(&b, &acc);
+		hnef_eval_get_features(&b, &start);
+
+		random_game(&b, NULL, &rays, &rng, 300, &stack, check_features, NULL);
+
+		/* Unmaking every move, captures included, restores the
+		 * accumulators of the starting position */
+		while( hnef_board_unmake_move(&b, &stack) );
+		hnef_eval_get_features(&b, &fast);
+		assert_features_eq(&fast, &start);
+	}
+}
+END_TEST
+
+START_TEST (test_eval_simple)
+{
+	HnefBoard b, copy;
+	HnefEvalAccumulator acc, copy_acc;
+	HnefToken tok;
+	HnefEvalFeatures f;
+	int score;
+
+	hnef_variant_setup(&b, HNEF_VARIANT_BRANDUBH);
+	hnef_eval_get_features(&b, &f);
+	ck_assert_int_eq(f.material[HNEF_MUSCOVITE], 8*HNEF_EVAL_ATTACKER);
+	ck_assert_int_eq(f.material[HNEF_SWEDE], 4*HNEF_EVAL_DEFENDER);
+	ck_assert_int_eq(f.king_mobility, 0);
+	ck_assert_int_eq(f.corner_guards, 0);
+
+	/* The score is from the side to move's point of view */
+	score = hnef_eval_evaluate(&b, NULL);
+	hnef_board_set_turn(&b, HNEF_SWEDE);
+	ck_assert_int_eq(hnef_eval_evaluate(&b, NULL), -score);
+
+	/* A lone king one move from a corner is worth more than one
+	 * boxed in by guards */
+	hnef_board_init(&b, 7, 7);
+	hnef_board_set_tile_type(&b, 0, 0, HNEF_CASTLE);
+	hnef_board_set_tile_is_escape(&b, 0, 0, HNEF_ESCAPE);
+	hnef_token_init(&tok, HNEF_SWEDE, HNEF_KING);
+	hnef_board_set_token(&b, 0, 3, tok);
+	hnef_eval_get_features(&b, &f);
+	ck_assert_int_eq(f.king_distance, 1);
+	ck_assert_int_eq(f.king_mobility, 12);
+	score = hnef_eval_score(&f);
+
+	hnef_token_init(&tok, HNEF_MUSCOVITE, HNEF_SOLDIER);
+	hnef_board_set_token(&b, 0, 1, tok);
+	hnef_board_set_token(&b, 1, 0, tok);
+	hnef_eval_get_features(&b, &f);
+	ck_assert_int_eq(f.corner_guards, 2);
+	ck_assert_int_eq(f.king_distance, HNEF_ESCAPE_UNREACHABLE);
+	ck_assert_int_lt(hnef_eval_score(&f), score);
+
+	/* Removing a token takes back exactly what it added */
+	hnef_eval_track(&b, &acc);
+	hnef_board_unset_token(&b, 0, 1);
+	hnef_board_unset_token(&b, 1, 0);
+	hnef_eval_get_features(&b, &f);
+	ck_assert_int_eq(hnef_eval_score(&f), score);
+
+	/* Boards made again are no longer tracked, but score the same */
+	hnef_board_init(&b, 7, 7);
+	ck_assert(b.watcher == NULL);
+	hnef_variant_setup(&b, HNEF_VARIANT_BRANDUBH);
+	ck_assert_int_eq(acc.material[HNEF_MUSCOVITE], 0);
+	hnef_eval_get_features(&b, &f);
+	ck_assert_int_eq(f.material[HNEF_MUSCOVITE], 8*HNEF_EVAL_ATTACKER);
+
+	/* A copy is untracked, and tracked with an accumulator of its
+	 * own leaves the original's alone */
+	hnef_eval_track(&b, &acc);
+	hnef_board_copy(&copy, &b);
+	ck_assert(copy.watcher == NULL && copy.watcher_data == NULL);
+	ck_assert(b.watcher_data == &acc);
+	hnef_board_unset_token(&copy, 3, 6);
+	ck_assert_int_eq(acc.material[HNEF_MUSCOVITE], 8*HNEF_EVAL_ATTACKER);
+	hnef_eval_track(&copy, &copy_acc);
+	hnef_board_unset_token(&copy, 3, 0);
+	ck_assert_int_eq(copy_acc.material[HNEF_MUSCOVITE], 6*HNEF_EVAL_ATTACKER);
+	ck_assert_int_eq(acc.material[HNEF_MUSCOVITE], 8*HNEF_EVAL_ATTACKER);
+}
+END_TEST
+
+Suite*
+hnef_suite(void) {
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create("Hnefatafl Eval");
+	tc_core = tcase_create("Core");
+
+	tcase_add_test(tc_core, test_eval_incremental);
+	tcase_add_test(tc_core, test_eval_simple);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+}
+
+int
+main(void) {
+	int number_failed;
+	Suite *s;
+	SRunner *sr;
+
+	s = hnef_suite();
+	sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,139 @@
+#include <check.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "../libhnef/mcts.h"
+
+/* Always plays the first legal move */
+static int
+policy_first( HnefBoard *board, const HnefMove *moves, int n, uint64_t *rng, void *data ) {
+	(void)board;
+	(void)moves;
+	(void)n;
+	(void)rng;
+	(*(int*)data)++;
+	return 0;
+}
+
+START_TEST(test_mcts) {
+	HnefBoard b;
+	HnefToken tok;
+	HnefMcts tree;
+	HnefMctsStats stats;
+	HnefMove m;
+	uint32_t visits;
+	int i, j, calls;
+
+	/* 7x7 board with escape castles. The king can reach the corner at
+	 * (0,0) now, but the attackers can shut that route next turn */
+	hnef_board_init(&b, 7, 7);
+	hnef_board_set_tile_type(&b, 3, 3, HNEF_THRONE);
+	for(i=0; i<7; i+=6) {
+		for(j=0; j<7; j+=6) {
+			hnef_board_set_tile_type(&b, i, j, HNEF_CASTLE);
+			hnef_board_set_tile_is_escape(&b, i, j, HNEF_ESCAPE);
+		}
+	}
+	hnef_token_init(&tok, HNEF_SWEDE, HNEF_KING);
+	hnef_board_set_token(&b, 0, 3, tok);
+	hnef_token_init(&tok, HNEF_SWEDE, HNEF_SOLDIER);
+	hnef_board_set_token(&b, 3, 1, tok);
+	hnef_board_set_token(&b, 0, 5, tok);
+	hnef_token_init(&tok, HNEF_MUSCOVITE, HNEF_SOLDIER);
+	hnef_board_set_token(&b, 1, 1, tok);
+	hnef_board_set_token(&b, 4, 4, tok);
+	hnef_board_set_token(&b, 5, 2, tok);
+	hnef_board_set_token(&b, 2, 5, tok);
+	hnef_board_set_turn(&b, HNEF_SWEDE);
+
+	ck_assert(hnef_mcts_init(&tree, &b, 200000));
+	ck_assert(!hnef_mcts_best_move(&tree, &m));
+	ck_assert(!hnef_mcts_search(&tree, 1, 0, 0, &stats));
+
+	/* Exactly the requested number of playouts is run */
+	ck_assert(hnef_mcts_search(&tree, 4, 20000, 0, &stats));
+	ck_assert_int_eq(stats.playouts, 20000);
+	ck_assert_int_eq(hnef_mcts_get_root_visits(&tree), 20000);
+	ck_assert(stats.playouts_per_second > 0);
+
+	ck_assert(hnef_mcts_best_move(&tree, &m));
+	ck_assert_int_eq(m.from, HNEF_SQUARE(0, 3));
+	ck_assert_int_eq(m.to, HNEF_SQUARE(0, 0));
+
+	/* Advancing keeps the explored subtree */
+	m.from = HNEF_SQUARE(3, 1);
+	m.to = HNEF_SQUARE(3, 0);
+	ck_assert(hnef_mcts_advance(&tree, m));
+	visits = hnef_mcts_get_root_visits(&tree);
+	ck_assert_int_gt(visits, 0);
+	ck_assert_int_lt(hnef_mcts_get_size(&tree), 200000);
+	ck_assert_int_eq(hnef_board_get_turn(&tree.board), HNEF_MUSCOVITE);
+	ck_assert_int_eq(hnef_board_get_token_team(&tree.board, 3, 0), HNEF_SWEDE);
+
+	ck_assert(hnef_mcts_search(&tree, 2, 1000, 0, NULL));
+	ck_assert_int_eq(hnef_mcts_get_root_visits(&tree), visits + 1000);
+
+	/* An unexplored move starts a fresh tree */
+	ck_assert(hnef_mcts_best_move(&tree, &m));
+	ck_assert(hnef_mcts_advance(&tree, m) || hnef_mcts_get_size(&tree) == 1);
+
+	/* Custom playout policies are used. Start from the original
+	 * position, which still has undecided lines to play out */
+	hnef_mcts_free(&tree);
+	ck_assert(hnef_mcts_init(&tree, &b, 200000));
+	calls = 0;
+	hnef_mcts_set_policy(&tree, policy_first, &calls);
+	ck_assert(hnef_mcts_search(&tree, 1, 100, 0, NULL));
+	ck_assert_int_gt(calls, 0);
+
+	/* Time limited searches stop on their own */
+	hnef_mcts_set_policy(&tree, NULL, NULL);
+	ck_assert(hnef_mcts_search(&tree, 2, 0, 30, &stats));
+	ck_assert_int_ge(stats.milliseconds, 30);
+
+	hnef_mcts_free(&tree);
+
+	/* A full arena keeps its size and searches go on from the leaves */
+	ck_assert(hnef_mcts_init(&tree, &b, 64));
+	ck_assert(hnef_mcts_search(&tree, 4, 5000, 0, &stats));
+	ck_assert_int_eq(stats.playouts, 5000);
+	ck_assert_int_le(hnef_mcts_get_size(&tree), 64);
+	ck_assert(hnef_mcts_search(&tree, 4, 5000, 0, NULL));
+	ck_assert_int_eq(hnef_mcts_get_root_visits(&tree), 10000);
+	ck_assert_int_le(hnef_mcts_get_size(&tree), 64);
+	ck_assert(hnef_mcts_best_move(&tree, &m));
+	hnef_mcts_free(&tree);
+}
+END_TEST
+
+Suite *
+hnef_suite(void) {
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create("Hnefatafl MCTS");
+
+	tc_core = tcase_create("Core");
+	tcase_set_timeout(tc_core, 30);
+
+	tcase_add_test(tc_core, test_mcts);
+	
+	suite_add_tcase(s, tc_core);
+
+	return s;	
+}
+
+int
+main(void) {
+	int nfailed;
+	Suite *s;
+	SRunner *sr;
+	
+	s = hnef_suite();
+	sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_NORMAL);
+	nfailed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+	
+	return (nfailed == 0)? EXIT_SUCCESS : EXIT_FAILURE;
+}
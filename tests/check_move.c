@@ -0,0 +1,322 @@
+#include <check.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "../libhnef/move.h"
+
+/* Reference generator walking the board one tile at a time */
+static int
+may_enter( HnefBoard *b, int fx, int fy, int x, int y, int *stop ) {
+	int type, king, camper;
+
+	type = hnef_board_get_tile_type(b, x, y);
+	king = hnef_board_get_token_rank(b, fx, fy) == HNEF_KING;
+	camper = !king && hnef_board_get_tile_type(b, fx, fy) == HNEF_CAMP;
+
+	*stop = 1;
+	if(hnef_board_get_tile_is_occupied(b, x, y)) {
+		return 0;
+	}
+	if(type == HNEF_CAMP && !camper) {
+		return 0;
+	}
+	if((type == HNEF_THRONE || type == HNEF_CASTLE) && !king) {
+		*stop = 0;
+	}
+	return 1;
+}
+
+static int
+slow_count( HnefBoard *b, int team ) {
+	static const int dx[4] = { 1, -1, 0, 0 };
+	static const int dy[4] = { 0, 0, 1, -1 };
+	int x, y, d, cx, cy, n, stop;
+
+	n = 0;
+	for(y=0; y<b->height; y++) {
+		for(x=0; x<b->width; x++) {
+			if(!hnef_board_get_tile_is_occupied(b, x, y) ||
+			   hnef_board_get_token_team(b, x, y) != team) {
+				continue;
+			}
+			for(d=0; d<4; d++) {
+				cx = x + dx[d];
+				cy = y + dy[d];
+				while(cx >= 0 && cy >= 0 && cx < b->width && cy < b->height &&
+				      may_enter(b, x, y, cx, cy, &stop)) {
+					n += stop;
+					cx += dx[d];
+					cy += dy[d];
+				}
+			}
+		}
+	}
+	return n;
+}
+
+START_TEST(test_move_generation) {
+	HnefBoard b;
+	HnefRays rays;
+	HnefToken tok;
+	HnefMove moves[HNEF_MAX_MOVES], m;
+	char generated[HNEF_SQUARE(0, 11)];
+	int n=11, i, j, k, count, x, y;
+
+	hnef_rays_init(&rays, n, n);
+	srand(7);
+
+	for(k=0; k<200; k++) {
+		hnef_board_init(&b, n, n);
+		hnef_board_set_tile_type(&b, n/2, n/2, HNEF_THRONE);
+		hnef_board_set_tile_type(&b, 0, 0, HNEF_CASTLE);
+		hnef_board_set_tile_type(&b, n-1, n-1, HNEF_CASTLE);
+		for(i=3; i<8; i++) {
+			hnef_board_set_tile_type(&b, i, 0, HNEF_CAMP);
+		}
+
+		hnef_token_init(&tok, HNEF_SWEDE, HNEF_KING);
+		hnef_board_set_token(&b, rand()%n, rand()%n, tok);
+		for(i=0; i<30; i++) {
+			hnef_token_init(&tok, rand()%2, HNEF_SOLDIER);
+			x = rand()%n;
+			y = rand()%n;
+			if(!hnef_board_get_tile_is_occupied(&b, x, y)) {
+				hnef_board_set_token(&b, x, y, tok);
+			}
+		}
+
+		for(j=0; j<2; j++) {
+			count = hnef_board_generate_moves(&b, &rays, j, moves, HNEF_MAX_MOVES);
+			ck_assert_int_eq(count, slow_count(&b, j));
+			for(i=0; i<count; i++) {
+				ck_assert(hnef_board_is_legal_move(&b, &rays, j, moves[i]));
+				ck_assert(!hnef_board_is_legal_move(&b, &rays, !j, moves[i]));
+			}
+
+			/* Every other move along a token's lines is refused */
+			for(m.from=0; m.from<HNEF_SQUARE(0, n); m.from++) {
+				if(HNEF_SQUARE_X(m.from) >= n || !hnef_bitboard_test(&(b.teams[j]), m.from)) {
+					continue;
+				}
+				memset(generated, 0, sizeof(generated));
+				for(i=0; i<count; i++) {
+					if(moves[i].from == m.from) {
+						generated[moves[i].to] = 1;
+					}
+				}
+				for(i=0; i<n; i++) {
+					m.to = HNEF_SQUARE(i, HNEF_SQUARE_Y(m.from));
+					ck_assert_int_eq(hnef_board_is_legal_move(&b, &rays, j, m), generated[m.to]);
+					m.to = HNEF_SQUARE(HNEF_SQUARE_X(m.from), i);
+					ck_assert_int_eq(hnef_board_is_legal_move(&b, &rays, j, m), generated[m.to]);
+				}
+			}
+		}
+	}
+
+	/* Generation never overruns the buffer */
+	ck_assert_int_eq(hnef_board_generate_moves(&b, &rays, HNEF_MUSCOVITE, moves, 3), 3);
+}
+END_TEST
+
+START_TEST(test_move_blocking) {
+	HnefBoard b;
+	HnefRays rays;
+	HnefToken tok;
+	HnefMove moves[HNEF_MAX_MOVES], m;
+	int n=7;
+
+	hnef_rays_init(&rays, n, n);
+	hnef_board_init(&b, n, n);
+	hnef_board_set_tile_type(&b, 3, 3, HNEF_THRONE);
+
+	/* A lone soldier in the corner of the board */
+	hnef_token_init(&tok, HNEF_MUSCOVITE, HNEF_SOLDIER);
+	hnef_board_set_token(&b, 0, 3, tok);
+	ck_assert_int_eq(hnef_board_generate_moves(&b, &rays, HNEF_MUSCOVITE, moves, HNEF_MAX_MOVES), 11);
+
+	/* It may cross the empty throne but not stop on it */
+	m.from = HNEF_SQUARE(0, 3);
+	m.to = HNEF_SQUARE(3, 3);
+	ck_assert(!hnef_board_is_legal_move(&b, &rays, HNEF_MUSCOVITE, m));
+	m.to = HNEF_SQUARE(5, 3);
+	ck_assert(hnef_board_is_legal_move(&b, &rays, HNEF_MUSCOVITE, m));
+
+	/* Diagonal moves are never legal */
+	m.to = HNEF_SQUARE(1, 2);
+	ck_assert(!hnef_board_is_legal_move(&b, &rays, HNEF_MUSCOVITE, m));
+
+	/* A blocker stops the slide */
+	hnef_board_set_token(&b, 2, 3, tok);
+	m.to = HNEF_SQUARE(5, 3);
+	ck_assert(!hnef_board_is_legal_move(&b, &rays, HNEF_MUSCOVITE, m));
+}
+END_TEST
+
+START_TEST(test_move_large_board) {
+	HnefBoard b;
+	HnefRays rays;
+	HnefToken tok;
+	HnefMove moves[HNEF_MAX_MOVES];
+	int n=32, i;
+
+	hnef_rays_init(&rays, n, n);
+	hnef_board_init(&b, n, n);
+
+	/* A soldier on every square of the diagonal reaches the whole of
+	 * its row and column, far more moves than a 13x13 board allows */
+	hnef_token_init(&tok, HNEF_MUSCOVITE, HNEF_SOLDIER);
+	for( i=0; i<n; i++ ) {
+		hnef_board_set_token(&b, i, i, tok);
+	}
+	ck_assert_int_eq(hnef_board_generate_moves(&b, &rays, HNEF_MUSCOVITE, moves, HNEF_MAX_MOVES), n*2*(n - 1));
+	for( i=0; i<n*2*(n - 1); i++ ) {
+		ck_assert(hnef_board_is_legal_move(&b, &rays, HNEF_MUSCOVITE, moves[i]));
+	}
+}
+END_TEST
+
+START_TEST(test_make_unmake) {
+	HnefBoard b, start;
+	HnefRays rays;
+	HnefToken tok;
+	HnefMove moves[HNEF_MAX_MOVES], m;
+	HnefUndo records[64];
+	HnefUndoStack stack;
+	uint8_t s1[7*7+2], s2[7*7+2];
+	int n=7, i, k, count, team, captures;
+
+	hnef_rays_init(&rays, n, n);
+	hnef_undo_stack_init(&stack, records, 64);
+
+	/* Custodial capture against a friendly token */
+	hnef_board_init(&b, n, n);
+	hnef_token_init(&tok, HNEF_MUSCOVITE, HNEF_SOLDIER);
+	hnef_board_set_token(&b, 1, 1, tok);
+	hnef_board_set_token(&b, 4, 2, tok);
+	hnef_token_init(&tok, HNEF_SWEDE, HNEF_SOLDIER);
+	hnef_board_set_token(&b, 2, 1, tok);
+	m.from = HNEF_SQUARE(4, 2);
+	m.to = HNEF_SQUARE(3, 2);
+	ck_assert_int_eq(hnef_board_make_move(&b, m, &stack), 0);
+	m.from = HNEF_SQUARE(3, 2);
+	m.to = HNEF_SQUARE(3, 1);
+	ck_assert_int_eq(hnef_board_make_move(&b, m, &stack), 1);
+	ck_assert(!hnef_board_get_tile_is_occupied(&b, 2, 1));
+	ck_assert_int_eq(hnef_board_count_team(&b, HNEF_SWEDE), 0);
+	ck_assert(hnef_board_unmake_move(&b, &stack));
+	ck_assert(hnef_board_get_tile_is_occupied(&b, 2, 1));
+	ck_assert_int_eq(hnef_board_get_token_team(&b, 2, 1), HNEF_SWEDE);
+
+	/* Capture against an empty hostile castle, king enclosure */
+	hnef_board_init(&b, n, n);
+	hnef_board_set_tile_type(&b, 0, 0, HNEF_CASTLE);
+	hnef_board_set_tile_is_escape(&b, 0, 0, HNEF_ESCAPE);
+	hnef_token_init(&tok, HNEF_SWEDE, HNEF_SOLDIER);
+	hnef_board_set_token(&b, 1, 0, tok);
+	hnef_token_init(&tok, HNEF_MUSCOVITE, HNEF_SOLDIER);
+	hnef_board_set_token(&b, 2, 3, tok);
+	m.from = HNEF_SQUARE(2, 3);
+	m.to = HNEF_SQUARE(2, 0);
+	ck_assert_int_eq(hnef_board_make_move(&b, m, &stack), 1);
+	ck_assert_int_eq(hnef_board_get_winner(&b), HNEF_MUSCOVITE);
+
+	hnef_token_init(&tok, HNEF_SWEDE, HNEF_KING);
+	hnef_board_set_token(&b, 3, 3, tok);
+	ck_assert_int_eq(hnef_board_get_winner(&b), HNEF_NO_WINNER);
+	hnef_token_init(&tok, HNEF_MUSCOVITE, HNEF_SOLDIER);
+	hnef_board_set_token(&b, 3, 2, tok);
+	hnef_board_set_token(&b, 2, 3, tok);
+	hnef_board_set_token(&b, 4, 3, tok);
+	hnef_board_set_token(&b, 3, 6, tok);
+	m.from = HNEF_SQUARE(3, 6);
+	m.to = HNEF_SQUARE(3, 4);
+	ck_assert_int_eq(hnef_board_make_move(&b, m, &stack), 1);
+	ck_assert_int_eq(hnef_board_get_winner(&b), HNEF_MUSCOVITE);
+	ck_assert(hnef_board_unmake_move(&b, &stack));
+	ck_assert_int_eq(hnef_board_get_token_rank(&b, 3, 3), HNEF_KING);
+	ck_assert_int_eq(hnef_board_get_winner(&b), HNEF_NO_WINNER);
+
+	/* Random games unwind to the exact starting position */
+	srand(11);
+	for(k=0; k<50; k++) {
+		hnef_board_init(&start, n, n);
+		hnef_board_set_tile_type(&start, 3, 3, HNEF_THRONE);
+		hnef_board_set_tile_type(&start, 0, 0, HNEF_CASTLE);
+		hnef_board_set_tile_type(&start, 6, 6, HNEF_CASTLE);
+		hnef_token_init(&tok, HNEF_SWEDE, HNEF_KING);
+		hnef_board_set_token(&start, 3, 3, tok);
+		for(i=0; i<16; i++) {
+			hnef_token_init(&tok, i%2, HNEF_SOLDIER);
+			if(!hnef_board_get_tile_is_occupied(&start, i%7, (i*3)%7) &&
+			   hnef_board_get_tile_type(&start, i%7, (i*3)%7) == HNEF_EMPTY) {
+				hnef_board_set_token(&start, i%7, (i*3)%7, tok);
+			}
+		}
+
+		b = start;
+		hnef_undo_stack_init(&stack, records, 64);
+		captures = 0;
+		team = HNEF_MUSCOVITE;
+		for(i=0; i<60 && hnef_board_get_winner(&b) == HNEF_NO_WINNER; i++) {
+			count = hnef_board_generate_moves(&b, &rays, team, moves, HNEF_MAX_MOVES);
+			if(count == 0) {
+				break;
+			}
+			captures += hnef_board_make_move(&b, moves[rand()%count], &stack);
+			team = !team;
+			ck_assert_int_eq(hnef_board_get_turn(&b), team);
+			ck_assert(hnef_board_get_key(&b) == hnef_board_compute_key(&b));
+		}
+		ck_assert_int_eq(hnef_board_count_team(&b, 0) + hnef_board_count_team(&b, 1) + captures,
+		                 hnef_board_count_team(&start, 0) + hnef_board_count_team(&start, 1));
+
+		while(hnef_board_unmake_move(&b, &stack));
+		hnef_board_serialize(&b, s1);
+		hnef_board_serialize(&start, s2);
+		ck_assert(memcmp(s1, s2, sizeof(s1)) == 0);
+		ck_assert(memcmp(&b.occupied, &start.occupied, sizeof(HnefBitboard)) == 0);
+		ck_assert(memcmp(&b.ranks, &start.ranks, sizeof(b.ranks)) == 0);
+		ck_assert(hnef_board_get_key(&b) == hnef_board_get_key(&start));
+	}
+
+	/* A full stack refuses further moves */
+	hnef_undo_stack_init(&stack, records, 0);
+	ck_assert_int_eq(hnef_board_make_move(&b, moves[0], &stack), -1);
+}
+END_TEST
+
+Suite *
+hnef_suite(void) {
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create("Hnefatafl Move");
+
+	tc_core = tcase_create("Core");
+
+	tcase_add_test(tc_core, test_move_generation);
+	tcase_add_test(tc_core, test_move_blocking);
+	tcase_add_test(tc_core, test_move_large_board);
+	tcase_add_test(tc_core, test_make_unmake);
+	
+	suite_add_tcase(s, tc_core);
+
+	return s;	
+}
+
+int
+main(void) {
+	int nfailed;
+	Suite *s;
+	SRunner *sr;
+	
+	s = hnef_suite();
+	sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_NORMAL);
+	nfailed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+	
+	return (nfailed == 0)? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,194 @@
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../libhnef/notation.h"
+#include "../libhnef/variant.h"
+#include "random_game.h"
+
+#define MAX_PLIES 150
+
+static char text[MAX_PLIES * 16];
+
+/* Play a random game of a variant, noting its moves and final key */
+static void
+play_game( int variant, const HnefRuleTables *tables, const HnefRays *rays, uint64_t seed,
+	   HnefMove *played, int *plies, uint64_t *key ) {
+	HnefBoard b;
+	uint64_t rng = seed;
+
+	hnef_variant_setup(&b, variant);
+	*plies = random_game(&b, tables, rays, &rng, MAX_PLIES, NULL, random_record, played);
+	*key = b.key;
+}
+
+START_TEST (test_notation_move)
+{
+	HnefBoard b;
+	HnefRays rays;
+	HnefMove move;
+	char buffer[HNEF_NOTATION_MAX_MOVE];
+	size_t length;
+
+	hnef_variant_setup(&b, HNEF_VARIANT_COPENHAGEN);
+	hnef_rays_init(&rays, b.height, b.width);
+
+	/* Muscovites open: the attacker on d1 may move up the d file */
+	ck_assert_int_eq(b.turn, HNEF_MUSCOVITE);
+	ck_assert_int_eq(hnef_board_get_token_team(&b, 3, 10), HNEF_MUSCOVITE);
+	ck_assert(hnef_notation_parse_move(&b, &rays, "d1-d5", 5, &move));
+	ck_assert_int_eq(move.from, HNEF_SQUARE(3, 10));
+	ck_assert_int_eq(move.to, HNEF_SQUARE(3, 6));
+	ck_assert(hnef_notation_parse_move(&b, &rays, "D1D5", 4, &move));
+	ck_assert(hnef_notation_parse_move(&b, &rays, "d1-d5xd6xe5", 11, &move));
+	ck_assert(hnef_notation_write_move(&b, move, buffer, sizeof(buffer), &length));
+	ck_assert_int_eq(length, 5);
+	ck_assert(memcmp(buffer, "d1-d5", 5) == 0);
+	ck_assert(!hnef_notation_write_move(&b, move, buffer, 4, &length));
+
+	/* Two digit ranks */
+	ck_assert(hnef_notation_parse_move(&b, &rays, "d11-d8", 6, &move));
+	ck_assert_int_eq(move.from, HNEF_SQUARE(3, 0));
+	ck_assert(hnef_notation_write_move(&b, move, buffer, sizeof(buffer), &length));
+	ck_assert_int_eq(length, 6);
+	ck_assert(memcmp(buffer, "d11-d8", 6) == 0);
+
+	/* Malformed, off the board, or illegal */
+	ck_assert(!hnef_notation_parse_move(&b, &rays, "d1-d", 4, &move));
+	ck_assert(!hnef_notation_parse_move(&b, &rays, "d0-d5", 5, &move));
+	ck_assert(!hnef_notation_parse_move(&b, &rays, "d01-d5", 6, &move));
+	ck_assert(!hnef_notation_parse_move(&b, &rays, "l1-l5", 5, &move));
+	ck_assert(!hnef_notation_parse_move(&b, &rays, "d12-d5", 6, &move));
+	ck_assert(!hnef_notation_parse_move(&b, &rays, "d1-d5x", 6, &move));
+	ck_assert(!hnef_notation_parse_move(&b, &rays, "d1-d5+", 6, &move));
+	ck_assert(!hnef_notation_parse_move(&b, &rays, "d1-e2", 5, &move));
+	ck_assert(!hnef_notation_parse_move(&b, &rays, "a1-a2", 5, &move));
+	ck_assert(!hnef_notation_parse_move(&b, &rays, "f6-f7", 5, &move));
+	ck_assert(!hnef_notation_parse_move(&b, &rays, "d1-d1", 5, &move));
+}
+END_TEST
+
+START_TEST (test_notation_game)
+{
+	HnefBoard b;
+	HnefRules rules;
+	HnefRuleTables tables;
+	HnefRays rays;
+	HnefMove played[MAX_PLIES], moves[MAX_PLIES];
+	uint64_t key;
+	size_t length, count;
+	int variant, preset, plies, i;
+
+	for( variant=0; variant<HNEF_VARIANT_COUNT; variant++ ) {
+		preset = (variant == HNEF_VARIANT_COPENHAGEN)? HNEF_RULES_COPENHAGEN : HNEF_RULES_DEFAULT;
+		hnef_variant_setup(&b, variant);
+		hnef_rays_init(&rays, b.height, b.width);
+		hnef_rules_init(&rules, preset);
+		hnef_rules_compile(&tables, &rules, &b);
+		play_game(variant, &tables, &rays, 7 + variant, played, &plies, &key);
+
+		/* Written games read back to the same moves and position */
+		ck_assert(hnef_notation_write_game(&b, played, plies, text, sizeof(text), &length));
+		ck_assert(memcmp(text, "1. ", 3) == 0);
+		ck_assert(!hnef_notation_write_game(&b, played, plies, text, length - 1, &length));
+		ck_assert(hnef_notation_write_game(&b, played, plies, text, sizeof(text), &length));
+		ck_assert(hnef_notation_parse_game(&tables, &rays, &b, text, length, moves, MAX_PLIES, &count));
+		ck_assert_int_eq(count, plies);
+		ck_assert(b.key == key);
+		for( i=0; i<plies; i++ ) {
+			ck_assert_int_eq(moves[i].from, played[i].from);
+			ck_assert_int_eq(moves[i].to, played[i].to);
+		}
+
+		/* Too little room for the moves */
+		hnef_variant_setup(&b, variant);
+		ck_assert(!hnef_notation_parse_game(&tables, &rays, &b, text, length, moves, plies / 2, &count));
+		ck_assert_int_eq(count, plies / 2);
+	}
+
+	/* Numbers and white space in any form, and a bad third move */
+	hnef_variant_setup(&b, HNEF_VARIANT_COPENHAGEN);
+	hnef_rays_init(&rays, b.height, b.width);
+	hnef_rules_init(&rules, HNEF_RULES_COPENHAGEN);
+	hnef_rules_compile(&tables, &rules, &b);
+	strcpy(text, "\t1.d1-d5   f4c4\r\n 2... d5-d4");
+	ck_assert(hnef_notation_parse_game(&tables, &rays, &b, text, strlen(text), moves, MAX_PLIES, &count));
+	ck_assert_int_eq(count, 3);
+	hnef_variant_setup(&b, HNEF_VARIANT_COPENHAGEN);
+	strcpy(text, "1. d1-d5 f4-c4 2. d5-d6 c4-c3");
+	ck_assert(!hnef_notation_parse_game(&tables, &rays, &b, text, strlen(text), moves, MAX_PLIES, &count));
+	ck_assert_int_eq(count, 2);
+	ck_assert_int_eq(b.turn, HNEF_MUSCOVITE);
+	hnef_variant_setup(&b, HNEF_VARIANT_COPENHAGEN);
+	ck_assert(hnef_notation_parse_game(&tables, &rays, &b, "  ", 2, moves, MAX_PLIES, &count));
+	ck_assert_int_eq(count, 0);
+
+	/* No moves once the game is won: without their king the Swedes
+	 * have lost */
+	hnef_variant_setup(&b, HNEF_VARIANT_COPENHAGEN);
+	hnef_board_unset_token(&b, 5, 5);
+	ck_assert_int_eq(hnef_rules_get_winner(&tables, &b), HNEF_MUSCOVITE);
+	ck_assert(!hnef_notation_parse_game(&tables, &rays, &b, "1. d1-d5", 8, moves, MAX_PLIES, &count));
+	ck_assert_int_eq(count, 0);
+	ck_assert_int_eq(b.turn, HNEF_MUSCOVITE);
+}
+END_TEST
+
+START_TEST (test_notation_lines)
+{
+	static const char *games[] = { "1. d1-d5", "1. a4-c4 f4-e4 2. d1-d5", "k7-i7" };
+	const char *game;
+	size_t at, length;
+	int i, n;
+
+	/* Games longer than one vector, blank lines and no final newline */
+	text[0] = '\0';
+	for( i=0; i<40; i++ ) {
+		strcat(text, games[i % 3]);
+		strcat(text, (i % 5 == 0)? "\r\n\n  \n" : "\n");
+	}
+	strcat(text, games[40 % 3]);
+
+	at = 0;
+	for( n=0; hnef_notation_next_game(text, strlen(text), &at, &game, &length); n++ ) {
+		ck_assert_int_le(n, 40);
+		ck_assert_int_eq(length, strlen(games[n % 3]));
+		ck_assert(memcmp(game, games[n % 3], length) == 0);
+	}
+	ck_assert_int_eq(n, 41);
+	ck_assert_int_eq(at, strlen(text));
+	ck_assert(!hnef_notation_next_game(text, strlen(text), &at, &game, &length));
+}
+END_TEST
+
+Suite*
+hnef_suite(void) {
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create("Hnefatafl Notation");
+	tc_core = tcase_create("Core");
+
+	tcase_add_test(tc_core, test_notation_move);
+	tcase_add_test(tc_core, test_notation_game);
+	tcase_add_test(tc_core, test_notation_lines);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+}
+
+int
+main(void) {
+	int number_failed;
+	Suite *s;
+	SRunner *sr;
+
+	s = hnef_suite();
+	sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
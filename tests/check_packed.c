@@ -0,0 +1,99 @@
+#include <check.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "../libhnef/packed.h"
+
+START_TEST(test_packed) {
+	HnefBoard b1, b2;
+	HnefToken tok;
+	uint8_t storage[HNEF_PACKED_BOARD_SIZE(11, 11)];
+	uint8_t s1[11*11+2], s2[11*11+2];
+	HnefPackedBoard *p;
+	int n=11, i, j;
+
+	p = hnef_packed_board_init((HnefPackedBoard*)storage, n, n);
+	ck_assert_int_eq(hnef_packed_board_get_height(p), n);
+	ck_assert_int_eq(hnef_packed_board_get_width(p), n);
+	ck_assert_int_eq(hnef_packed_board_get_area(p), n*n);
+	ck_assert_int_eq(hnef_packed_board_size(n, n), 123);
+
+	/* Build the same position on a regular and a packed board */
+	hnef_board_init(&b1, n, n);
+	hnef_board_set_tile_type(&b1, n/2, n/2, HNEF_THRONE);
+	hnef_packed_board_set_tile_type(p, n/2, n/2, HNEF_THRONE);
+	hnef_board_set_tile_type(&b1, 0, 0, HNEF_CASTLE);
+	hnef_board_set_tile_is_escape(&b1, 0, 0, HNEF_ESCAPE);
+	hnef_packed_board_set_tile_type(p, 0, 0, HNEF_CASTLE);
+	hnef_packed_board_set_tile_is_escape(p, 0, 0, HNEF_ESCAPE);
+
+	hnef_token_init(&tok, HNEF_SWEDE, HNEF_KING);
+	hnef_board_set_token(&b1, n/2, n/2, tok);
+	hnef_packed_board_set_token(p, n/2, n/2, tok);
+	hnef_token_init(&tok, HNEF_MUSCOVITE, HNEF_SOLDIER);
+	hnef_board_set_token(&b1, 3, 0, tok);
+	hnef_packed_board_set_token(p, 3, 0, tok);
+	hnef_board_set_token(&b1, 4, 0, tok);
+	hnef_packed_board_set_token(p, 4, 0, tok);
+	hnef_board_unset_token(&b1, 4, 0);
+	hnef_packed_board_unset_token(p, 4, 0);
+
+	for(i=0; i<n; i++) {
+		for(j=0; j<n; j++) {
+			ck_assert_int_eq(hnef_board_get_tile_type(&b1, i, j), hnef_packed_board_get_tile_type(p, i, j));
+			ck_assert_int_eq(hnef_board_get_tile_is_escape(&b1, i, j), hnef_packed_board_get_tile_is_escape(p, i, j));
+			ck_assert_int_eq(hnef_board_get_tile_is_occupied(&b1, i, j), hnef_packed_board_get_tile_is_occupied(p, i, j));
+			if(hnef_board_get_tile_is_occupied(&b1, i, j)) {
+				ck_assert_int_eq(hnef_board_get_token_team(&b1, i, j), hnef_packed_board_get_token_team(p, i, j));
+				ck_assert_int_eq(hnef_board_get_token_rank(&b1, i, j), hnef_packed_board_get_token_rank(p, i, j));
+			}
+		}
+	}
+
+	/* The packed board is its own serialization */
+	hnef_board_serialize(&b1, s1);
+	hnef_packed_board_serialize(p, s2);
+	ck_assert(memcmp(s1, s2, sizeof(s1)) == 0);
+
+	ck_assert(hnef_packed_board_deserialize(p, s1));
+	hnef_packed_board_to_board(p, &b2);
+	ck_assert_int_eq(hnef_board_count_rank(&b2, HNEF_KING), 1);
+	ck_assert_int_eq(hnef_board_count_team(&b2, HNEF_MUSCOVITE), 1);
+
+	/* Malformed buffers are rejected */
+	s1[5] = 0;
+	ck_assert(!hnef_packed_board_deserialize(p, s1));
+}
+END_TEST
+
+Suite *
+hnef_suite(void) {
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create("Hnefatafl Packed Board");
+
+	tc_core = tcase_create("Core");
+
+	tcase_add_test(tc_core, test_packed);
+	
+	suite_add_tcase(s, tc_core);
+
+	return s;	
+}
+
+int
+main(void) {
+	int nfailed;
+	Suite *s;
+	SRunner *sr;
+	
+	s = hnef_suite();
+	sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_NORMAL);
+	nfailed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+	
+	return (nfailed == 0)? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,204 @@
+#include <check.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../libhnef/pool.h"
+#include "../libhnef/variant.h"
+
+/* Record the calling thread's pool and take a board from it */
+static void*
+take_local( void *arg ) {
+	HnefBoardPool **p = arg;
+
+	*p = hnef_board_pool_local();
+	if(*p) {
+		hnef_board_pool_acquire(*p, 7, 7);
+	}
+	return NULL;
+}
+
+START_TEST (test_board_new)
+{
+	HnefBoard *b, fresh;
+
+	b = hnef_board_new(11, 9);
+	ck_assert(b != NULL);
+	hnef_board_init(&fresh, 11, 9);
+	ck_assert_int_eq(b->height, 11);
+	ck_assert_int_eq(b->width, 9);
+	ck_assert(b->key == fresh.key);
+	hnef_board_free(b);
+	hnef_board_free(NULL);
+
+	ck_assert(hnef_board_new(0, 7) == NULL);
+	ck_assert(hnef_board_new(7, MAX_WIDTH + 1) == NULL);
+}
+END_TEST
+
+START_TEST (test_pool)
+{
+	HnefBoardPool p;
+	HnefBoardPoolStats stats;
+	HnefBoard *boards[40], *b, fresh;
+	uint8_t got[2 + 49], want[2 + 49];
+	int i;
+
+	hnef_board_pool_init(&p, 0);
+	for( i=0; i<40; i++ ) {
+		boards[i] = hnef_board_pool_acquire(&p, 11, 11);
+		ck_assert(boards[i] != NULL);
+	}
+	hnef_board_pool_get_stats(&p, &stats);
+	ck_assert_int_eq(stats.live, 40);
+	ck_assert_int_eq(stats.peak, 40);
+	ck_assert_int_eq(stats.bytes, 3*sizeof(HnefBoardSlab));
+
+	/* A dirty board comes back clean and the memory is reused */
+	hnef_variant_setup(boards[5], HNEF_VARIANT_TABLUT);
+	b = boards[5];
+	hnef_board_pool_release(&p, b);
+	boards[5] = hnef_board_pool_acquire(&p, 7, 7);
+	ck_assert(boards[5] == b);
+	hnef_board_init(&fresh, 7, 7);
+	ck_assert(b->key == fresh.key);
+	hnef_board_serialize(b, got);
+	hnef_board_serialize(&fresh, want);
+	ck_assert(memcmp(got, want, 2 + 49) == 0);
+
+	for( i=0; i<30; i++ ) {
+		hnef_board_pool_release(&p, boards[i]);
+	}
+	hnef_board_pool_release(&p, NULL);
+	hnef_board_pool_get_stats(&p, &stats);
+	ck_assert_int_eq(stats.live, 10);
+	ck_assert_int_eq(stats.peak, 40);
+	ck_assert(hnef_board_pool_acquire(&p, 0, 11) == NULL);
+
+	/* Trimming waits until nothing is live, reset frees everything */
+	hnef_board_pool_trim(&p);
+	hnef_board_pool_get_stats(&p, &stats);
+	ck_assert_int_eq(stats.bytes, 3*sizeof(HnefBoardSlab));
+	hnef_board_pool_reset(&p);
+	hnef_board_pool_get_stats(&p, &stats);
+	ck_assert_int_eq(stats.live, 0);
+	for( i=0; i<48; i++ ) {
+		ck_assert(hnef_board_pool_acquire(&p, 9, 9) != NULL);
+	}
+	hnef_board_pool_get_stats(&p, &stats);
+	ck_assert_int_eq(stats.bytes, 3*sizeof(HnefBoardSlab));
+	hnef_board_pool_reset(&p);
+	hnef_board_pool_trim(&p);
+	hnef_board_pool_get_stats(&p, &stats);
+	ck_assert_int_eq(stats.bytes, 0);
+	ck_assert_int_eq(stats.peak, 48);
+	hnef_board_pool_free(&p);
+
+	/* A limit bounds the boards live at once */
+	hnef_board_pool_init(&p, 2);
+	boards[0] = hnef_board_pool_acquire(&p, 7, 7);
+	boards[1] = hnef_board_pool_acquire(&p, 7, 7);
+	ck_assert(boards[1] != NULL);
+	ck_assert(hnef_board_pool_acquire(&p, 7, 7) == NULL);
+	hnef_board_pool_release(&p, boards[0]);
+	ck_assert(hnef_board_pool_acquire(&p, 7, 7) == boards[0]);
+	hnef_board_pool_free(&p);
+}
+END_TEST
+
+START_TEST (test_pool_local)
+{
+	HnefBoardPool *mine, *theirs[2];
+	pthread_t threads[2];
+	int i;
+
+	mine = hnef_board_pool_local();
+	ck_assert(mine != NULL);
+	ck_assert(hnef_board_pool_local() == mine);
+
+	/* Each thread has its own pool, freed as the thread exits */
+	for( i=0; i<2; i++ ) {
+		ck_assert_int_eq(pthread_create(&threads[i], NULL, take_local, &theirs[i]), 0);
+	}
+	for( i=0; i<2; i++ ) {
+		pthread_join(threads[i], NULL);
+		ck_assert(theirs[i] != NULL);
+		ck_assert(theirs[i] != mine);
+	}
+	ck_assert(hnef_board_pool_acquire(mine, 11, 11) != NULL);
+	ck_assert_int_eq(mine->stats.live, 1);
+	hnef_board_pool_reset(mine);
+}
+END_TEST
+
+START_TEST (test_arena)
+{
+	HnefBoardArena a;
+	HnefBoardPoolStats stats;
+	HnefBoard *first, *b;
+	size_t mark;
+	int i;
+
+	ck_assert(hnef_board_arena_init(&a, 8));
+	first = hnef_board_arena_alloc(&a, 11, 11);
+	ck_assert(first != NULL);
+	mark = hnef_board_arena_mark(&a);
+	for( i=1; i<8; i++ ) {
+		ck_assert(hnef_board_arena_alloc(&a, 11, 11) == first + i);
+	}
+	ck_assert(hnef_board_arena_alloc(&a, 11, 11) == NULL);
+	hnef_board_arena_get_stats(&a, &stats);
+	ck_assert_int_eq(stats.live, 8);
+	ck_assert_int_eq(stats.peak, 8);
+	ck_assert_int_eq(stats.bytes, 8*sizeof(HnefBoard));
+
+	/* Boards after a mark are given back together */
+	hnef_board_arena_reset(&a, mark);
+	b = hnef_board_arena_alloc(&a, 7, 7);
+	ck_assert(b == first + 1);
+	ck_assert_int_eq(b->height, 7);
+	hnef_board_arena_reset(&a, 0);
+	ck_assert(hnef_board_arena_alloc(&a, 7, 7) == first);
+	ck_assert(hnef_board_arena_alloc(&a, 7, 33) == NULL);
+	hnef_board_arena_get_stats(&a, &stats);
+	ck_assert_int_eq(stats.live, 1);
+	ck_assert_int_eq(stats.peak, 8);
+	hnef_board_arena_free(&a);
+
+	ck_assert(hnef_board_arena_init(&a, 0));
+	ck_assert(hnef_board_arena_alloc(&a, 7, 7) == NULL);
+	hnef_board_arena_free(&a);
+}
+END_TEST
+
+Suite*
+hnef_suite(void) {
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create("Hnefatafl Board Pool");
+	tc_core = tcase_create("Core");
+
+	tcase_add_test(tc_core, test_board_new);
+	tcase_add_test(tc_core, test_pool);
+	tcase_add_test(tc_core, test_pool_local);
+	tcase_add_test(tc_core, test_arena);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+}
+
+int
+main(void) {
+	int number_failed;
+	Suite *s;
+	SRunner *sr;
+
+	s = hnef_suite();
+	sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,207 @@
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "../libhnef/posdb.h"
+#include "../libhnef/variant.h"
+#include "random_game.h"
+
+#define POSITIONS 3000
+
+/* Positions from random Tablut games, restarted when a game ends */
+static void
+collect( HnefBoard *boards, int count ) {
+	HnefBoard b;
+	HnefRays rays;
+	uint64_t rng = 17;
+	int i;
+
+	hnef_variant_setup(&b, HNEF_VARIANT_TABLUT);
+	hnef_rays_init(&rays, b.height, b.width);
+	for( i=0; i<count; i++ ) {
+		if(!random_game(&b, NULL, &rays, &rng, 1, NULL, NULL, NULL)) {
+			hnef_variant_setup(&b, HNEF_VARIANT_TABLUT);
+			random_game(&b, NULL, &rays, &rng, 1, NULL, NULL, NULL);
+		}
+		boards[i] = b;
+	}
+}
+
+/* An entry which can be told apart from those of other positions */
+static void
+make_entry( HnefPosDBEntry *entry, int i ) {
+	entry->move.from = i % 1024;
+	entry->move.to = (i * 7) % 1024;
+	entry->score = i*37 - 50000;
+	entry->depth = i % 300;
+	entry->bound = HNEF_BOUND_EXACT - (i % 3);
+}
+
+/* Write the positions to a fresh temporary file */
+static void
+write_db( char *path, HnefBoard *boards, int count ) {
+	HnefPosDBWriter w;
+	HnefPosDBEntry entry;
+	int fd, i;
+
+	fd = mkstemp(path);
+	ck_assert_int_ge(fd, 0);
+	close(fd);
+
+	ck_assert(hnef_posdb_writer_open(&w, path, 9, 9));
+	for( i=0; i<count; i++ ) {
+		make_entry(&entry, i);
+		ck_assert(hnef_posdb_writer_add(&w, &boards[i], &entry));
+	}
+	ck_assert(hnef_posdb_writer_close(&w));
+}
+
+START_TEST (test_posdb_lookup)
+{
+	HnefPosDB db;
+	HnefPosDBEntry entry, expected;
+	HnefBoard *boards, b;
+	char path[] = "/tmp/check_posdbXXXXXX";
+	int64_t record;
+	int i, j, last;
+
+	boards = malloc(POSITIONS*sizeof(HnefBoard));
+	ck_assert(boards != NULL);
+	collect(boards, POSITIONS);
+	write_db(path, boards, POSITIONS);
+
+	ck_assert(hnef_posdb_open(&db, path));
+	ck_assert(db.count == POSITIONS);
+	ck_assert_int_eq(db.height, 9);
+	ck_assert_int_eq(db.width, 9);
+	for( i=0; i<POSITIONS; i++ ) {
+		/* Random games revisit positions: the last visit wins */
+		last = i;
+		for( j=i+1; j<POSITIONS; j++ ) {
+			if(boards[j].key == boards[i].key) {
+				last = j;
+			}
+		}
+		make_entry(&expected, last);
+
+		record = hnef_posdb_find(&db, boards[i].key);
+		ck_assert(record == last);
+		ck_assert(hnef_posdb_get_key(&db, record) == boards[i].key);
+		ck_assert(hnef_posdb_probe(&db, &boards[i], &entry));
+		ck_assert(memcmp(&entry, &expected, sizeof(entry)) == 0);
+
+		ck_assert(hnef_posdb_get_board(&db, record, &b));
+		ck_assert(b.key == boards[i].key);
+		ck_assert_int_eq(b.turn, boards[i].turn);
+		ck_assert(memcmp(&(b.occupied), &(boards[i].occupied), sizeof(HnefBitboard)) == 0);
+		ck_assert(memcmp(&(b.teams), &(boards[i].teams), sizeof(b.teams)) == 0);
+	}
+
+	/* Unknown keys and positions are not found */
+	hnef_variant_setup(&b, HNEF_VARIANT_TABLUT);
+	hnef_board_set_turn(&b, HNEF_SWEDE);
+	ck_assert(hnef_posdb_find(&db, b.key) == HNEF_POSDB_NOT_FOUND);
+	ck_assert(!hnef_posdb_probe(&db, &b, &entry));
+	hnef_variant_setup(&b, HNEF_VARIANT_BRANDUBH);
+	ck_assert(!hnef_posdb_probe(&db, &b, &entry));
+	ck_assert(hnef_posdb_find(&db, boards[0].key ^ 1) == HNEF_POSDB_NOT_FOUND);
+
+	hnef_posdb_close(&db);
+	ck_assert(db.image == NULL);
+	ck_assert(hnef_posdb_find(&db, boards[0].key) == HNEF_POSDB_NOT_FOUND);
+	remove(path);
+	free(boards);
+}
+END_TEST
+
+START_TEST (test_posdb_files)
+{
+	HnefPosDBWriter w;
+	HnefPosDB db, other;
+	HnefPosDBEntry entry;
+	HnefBoard b;
+	FILE *f;
+	char path[] = "/tmp/check_posdbXXXXXX";
+	uint8_t header[64];
+
+	/* An empty database opens and finds nothing */
+	write_db(path, NULL, 0);
+	ck_assert(hnef_posdb_open(&db, path));
+	ck_assert(db.count == 0);
+	hnef_variant_setup(&b, HNEF_VARIANT_TABLUT);
+	ck_assert(hnef_posdb_find(&db, b.key) == HNEF_POSDB_NOT_FOUND);
+
+	/* Any number of readers may share the file */
+	ck_assert(hnef_posdb_open(&other, path));
+	hnef_posdb_close(&other);
+	hnef_posdb_close(&db);
+
+	/* The writer refuses positions of another size */
+	ck_assert(!hnef_posdb_writer_open(&w, path, 0, 9));
+	ck_assert(!hnef_posdb_writer_open(&w, path, 9, MAX_WIDTH + 1));
+	ck_assert(hnef_posdb_writer_open(&w, path, 7, 7));
+	make_entry(&entry, 0);
+	ck_assert(!hnef_posdb_writer_add(&w, &b, &entry));
+	ck_assert(hnef_posdb_writer_close(&w));
+	ck_assert(!hnef_posdb_writer_close(&w));
+
+	/* An index so large that its size wraps around is refused */
+	f = fopen(path, "rb");
+	ck_assert(f != NULL);
+	ck_assert(fread(header, 1, sizeof(header), f) == sizeof(header));
+	fclose(f);
+	memset(header + 32, 0, 8);
+	header[39] = 0x40;
+	f = fopen(path, "wb");
+	ck_assert(f != NULL);
+	fwrite(header, 1, sizeof(header), f);
+	fclose(f);
+	ck_assert(!hnef_posdb_open(&db, path));
+
+	/* Damaged and truncated files are refused */
+	f = fopen(path, "r+b");
+	ck_assert(f != NULL);
+	fputc('X', f);
+	fclose(f);
+	ck_assert(!hnef_posdb_open(&db, path));
+	f = fopen(path, "wb");
+	ck_assert(f != NULL);
+	fputs("HNEFPDB\n", f);
+	fclose(f);
+	ck_assert(!hnef_posdb_open(&db, path));
+	remove(path);
+	ck_assert(!hnef_posdb_open(&db, path));
+}
+END_TEST
+
+Suite*
+hnef_suite(void) {
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create("Hnefatafl Position Database");
+	tc_core = tcase_create("Core");
+
+	tcase_add_test(tc_core, test_posdb_lookup);
+	tcase_add_test(tc_core, test_posdb_files);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+}
+
+int
+main(void) {
+	int number_failed;
+	Suite *s;
+	SRunner *sr;
+
+	s = hnef_suite();
+	sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,185 @@
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "../libhnef/replay.h"
+#include "../libhnef/eval.h"
+#include "../libhnef/variant.h"
+#include "random_game.h"
+
+#define MAX_PLIES 200
+
+static uint64_t keys[MAX_PLIES + 1];
+static int turns[MAX_PLIES + 1];
+static HnefReplay replay;
+
+/* Note the key and side to move of a position and push its move */
+static int
+record_ply( HnefBoard *b, int ply, const HnefMove *move, void *data ) {
+	keys[ply] = b->key;
+	turns[ply] = b->turn;
+	if(move) {
+		ck_assert(hnef_replay_push(data, *move));
+	}
+	return 1;
+}
+
+/* Play a random game of a variant into the replay, noting the key and
+ * side to move of every position. Returns the number of plies played
+ * through *plies. */
+static void
+play_game( HnefReplay *r, int variant, int preset, int interval, uint64_t seed, int *plies ) {
+	HnefBoard b;
+	HnefRules rules;
+	HnefRuleTables tables;
+	HnefRays rays;
+	uint64_t rng = seed;
+
+	hnef_variant_setup(&b, variant);
+	hnef_rays_init(&rays, b.height, b.width);
+	hnef_rules_init(&rules, preset);
+	hnef_rules_compile(&tables, &rules, &b);
+	ck_assert(hnef_replay_init(r, &b, preset, interval));
+	*plies = random_game(&b, &tables, &rays, &rng, MAX_PLIES, NULL, record_ply, r);
+}
+
+START_TEST (test_replay_seek)
+{
+	static const int intervals[] = { 1, 3, 16, 1000 };
+	HnefBoard b;
+	int variant, preset, i, ply, plies;
+
+	for( variant=0; variant<HNEF_VARIANT_COUNT; variant++ ) {
+		preset = (variant == HNEF_VARIANT_COPENHAGEN)? HNEF_RULES_COPENHAGEN : HNEF_RULES_DEFAULT;
+		for( i=0; i<4; i++ ) {
+			play_game(&replay, variant, preset, intervals[i], 17 + variant, &plies);
+			ck_assert(replay.plies == (uint64_t)plies);
+
+			/* Every position can be reached, in any order */
+			for( ply=plies; ply>=0; ply-- ) {
+				ck_assert(hnef_replay_seek(&replay, ply, &b));
+				ck_assert(b.key == keys[ply]);
+				ck_assert_int_eq(b.turn, turns[ply]);
+				ck_assert(b.key == hnef_board_compute_key(&b));
+			}
+			ck_assert(!hnef_replay_seek(&replay, plies + 1, &b));
+			ck_assert(hnef_replay_bytes(&replay) > 0);
+			hnef_replay_free(&replay);
+		}
+	}
+
+	/* Bad intervals and rule sets are refused */
+	hnef_variant_setup(&b, HNEF_VARIANT_BRANDUBH);
+	ck_assert(!hnef_replay_init(&replay, &b, HNEF_RULES_DEFAULT, 0));
+	ck_assert(!hnef_replay_init(&replay, &b, 99, 8));
+}
+END_TEST
+
+START_TEST (test_replay_archive)
+{
+	HnefArchiveWriter w;
+	HnefArchive a;
+	HnefArchiveCursor c;
+	HnefArchiveGame game;
+	HnefBoard b;
+	char path[] = "/tmp/check_replayXXXXXX";
+	int fd, ply, plies;
+
+	fd = mkstemp(path);
+	ck_assert_int_ge(fd, 0);
+	close(fd);
+
+	/* Record a game with the archive and rebuild its replay */
+	play_game(&replay, HNEF_VARIANT_COPENHAGEN, HNEF_RULES_COPENHAGEN, 1, 5, &plies);
+	ck_assert(hnef_replay_seek(&replay, 0, &b));
+	ck_assert(hnef_archive_writer_open(&w, path));
+	ck_assert(hnef_archive_writer_begin(&w, &b, HNEF_RULES_COPENHAGEN));
+	for( ply=0; ply<plies; ply++ ) {
+		ck_assert(hnef_archive_writer_move(&w, replay.moves[ply]));
+	}
+	ck_assert(hnef_archive_writer_end(&w, HNEF_NO_WINNER));
+	ck_assert(hnef_archive_writer_close(&w));
+	hnef_replay_free(&replay);
+
+	ck_assert(hnef_archive_open(&a, path));
+	hnef_archive_cursor_init(&c, &a, 0, 1);
+	ck_assert(hnef_archive_next(&c, &game));
+	ck_assert(hnef_replay_init_from_game(&replay, &game, 10));
+	ck_assert(replay.plies == (uint64_t)plies);
+	for( ply=0; ply<=plies; ply++ ) {
+		ck_assert(hnef_replay_seek(&replay, ply, &b));
+		ck_assert(b.key == keys[ply]);
+	}
+	hnef_replay_free(&replay);
+	hnef_archive_close(&a);
+	remove(path);
+}
+END_TEST
+
+START_TEST (test_replay_tracked)
+{
+	HnefBoard b, game;
+	HnefRays rays;
+	HnefMove moves[6];
+	HnefEvalAccumulator acc;
+	HnefEvalFeatures fast, slow;
+	uint64_t rng = 3;
+	int ply, plies;
+
+	/* Moves pushed on a replay leave the starting board's sums alone */
+	hnef_variant_setup(&b, HNEF_VARIANT_COPENHAGEN);
+	hnef_eval_track(&b, &acc);
+	hnef_rays_init(&rays, b.height, b.width);
+	hnef_board_copy(&game, &b);
+	plies = random_game(&game, NULL, &rays, &rng, 6, NULL, random_record, moves);
+	ck_assert_int_eq(plies, 6);
+
+	ck_assert(hnef_replay_init(&replay, &b, HNEF_RULES_DEFAULT, 4));
+	for( ply=0; ply<plies; ply++ ) {
+		ck_assert(hnef_replay_push(&replay, moves[ply]));
+	}
+	hnef_eval_get_features(&b, &fast);
+	hnef_eval_compute_features(&b, &slow);
+	ck_assert(memcmp(&fast, &slow, sizeof(fast)) == 0);
+
+	/* Nor does the board a position is sought into share them */
+	ck_assert(hnef_replay_seek(&replay, plies, &game));
+	ck_assert(game.watcher == NULL && game.watcher_data == NULL);
+	ck_assert(game.key == replay.last.key);
+	hnef_replay_free(&replay);
+}
+END_TEST
+
+Suite*
+hnef_suite(void) {
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create("Hnefatafl Game Replay");
+	tc_core = tcase_create("Core");
+
+	tcase_set_timeout(tc_core, 60);
+	tcase_add_test(tc_core, test_replay_seek);
+	tcase_add_test(tc_core, test_replay_archive);
+	tcase_add_test(tc_core, test_replay_tracked);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+}
+
+int
+main(void) {
+	int number_failed;
+	Suite *s;
+	SRunner *sr;
+
+	s = hnef_suite();
+	sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,286 @@
+#include <check.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "../libhnef/rules.h"
+#include "../libhnef/variant.h"
+#include "random_game.h"
+
+static void
+place( HnefBoard *b, int x, int y, int team, int rank ) {
+	HnefToken tok;
+	hnef_token_init(&tok, team, rank);
+	hnef_board_set_token(b, x, y, tok);
+}
+
+static HnefMove
+move( int fx, int fy, int tx, int ty ) {
+	HnefMove m;
+	m.from = HNEF_SQUARE(fx, fy);
+	m.to = HNEF_SQUARE(tx, ty);
+	return m;
+}
+
+/* The default preset plays exactly like hnef_board_make_move */
+START_TEST (test_rules_default)
+{
+	HnefBoard a, b;
+	HnefRules rules;
+	HnefRuleTables t;
+	HnefRays rays;
+	HnefMove moves[HNEF_MAX_MOVES];
+	HnefUndo ra[512], rb[512];
+	HnefUndoStack sa, sb;
+	uint64_t rng = 12345;
+	int game, ply, n;
+
+	ck_assert(hnef_rules_init(&rules, HNEF_RULES_DEFAULT));
+	ck_assert(!hnef_rules_init(&rules, 99));
+	hnef_rules_init(&rules, HNEF_RULES_DEFAULT);
+
+	for( game=0; game<20; game++ ) {
+		hnef_variant_setup(&a, game % HNEF_VARIANT_COUNT);
+		b = a;
+		ck_assert(hnef_rules_compile(&t, &rules, &a));
+		hnef_rays_init(&rays, a.height, a.width);
+		hnef_undo_stack_init(&sa, ra, 512);
+		hnef_undo_stack_init(&sb, rb, 512);
+
+		for( ply=0; ply<512 && hnef_board_get_winner(&a) == HNEF_NO_WINNER; ply++ ) {
+			ck_assert_int_eq(hnef_rules_get_winner(&t, &a), HNEF_NO_WINNER);
+			n = hnef_board_generate_moves(&a, &rays, a.turn, moves, HNEF_MAX_MOVES);
+			if(n == 0) {
+				break;
+			}
+			n = (int)(random_next(&rng) % n);
+			ck_assert_int_eq(hnef_rules_make_move(&t, &a, moves[n], &sa),
+			                 hnef_board_make_move(&b, moves[n], &sb));
+			ck_assert(hnef_board_get_key(&a) == hnef_board_get_key(&b));
+		}
+		ck_assert_int_eq(hnef_rules_get_winner(&t, &a), hnef_board_get_winner(&b));
+
+		while( sa.size > 0 ) {
+			ck_assert(hnef_board_unmake_move(&a, &sa));
+		}
+		ck_assert(hnef_board_get_key(&a) == hnef_board_compute_key(&a));
+	}
+}
+END_TEST
+
+START_TEST (test_rules_king)
+{
+	HnefBoard b;
+	HnefRules rules;
+	HnefRuleTables t;
+	HnefUndo records[8];
+	HnefUndoStack stack;
+
+	hnef_undo_stack_init(&stack, records, 8);
+	hnef_board_init(&b, 7, 7);
+	hnef_board_set_tile_type(&b, 3, 3, HNEF_THRONE);
+	place(&b, 1, 1, HNEF_SWEDE, HNEF_KING);
+	place(&b, 2, 1, HNEF_MUSCOVITE, HNEF_SOLDIER);
+	place(&b, 3, 0, HNEF_SWEDE, HNEF_SOLDIER);
+
+	/* An unarmed king neither captures nor acts as an anvil */
+	hnef_rules_init(&rules, HNEF_RULES_DEFAULT);
+	rules.king_armed = 0;
+	ck_assert(hnef_rules_compile(&t, &rules, &b));
+	ck_assert_int_eq(hnef_rules_make_move(&t, &b, move(3, 0, 3, 1), &stack), 0);
+	hnef_board_unmake_move(&b, &stack);
+
+	rules.king_armed = 1;
+	hnef_rules_compile(&t, &rules, &b);
+	ck_assert_int_eq(hnef_rules_make_move(&t, &b, move(3, 0, 3, 1), &stack), 1);
+	ck_assert(!hnef_board_get_tile_is_occupied(&b, 2, 1));
+	hnef_board_unmake_move(&b, &stack);
+	ck_assert(hnef_board_get_tile_is_occupied(&b, 2, 1));
+
+	/* A two sided king is taken like a soldier */
+	hnef_board_unset_token(&b, 3, 0);
+	hnef_board_unset_token(&b, 2, 1);
+	place(&b, 0, 1, HNEF_MUSCOVITE, HNEF_SOLDIER);
+	place(&b, 2, 3, HNEF_MUSCOVITE, HNEF_SOLDIER);
+	ck_assert(hnef_rules_make_move(&t, &b, move(2, 3, 2, 1), &stack) == 0);
+	hnef_board_unmake_move(&b, &stack);
+	rules.king_sides = 2;
+	hnef_rules_compile(&t, &rules, &b);
+	ck_assert_int_eq(hnef_rules_make_move(&t, &b, move(2, 3, 2, 1), &stack), 1);
+	ck_assert_int_eq(hnef_rules_get_winner(&t, &b), HNEF_MUSCOVITE);
+	hnef_board_unmake_move(&b, &stack);
+	ck_assert_int_eq(hnef_board_get_token_rank(&b, 1, 1), HNEF_KING);
+
+	/* Escape rules */
+	rules.escape = HNEF_ESCAPE_EDGE;
+	hnef_rules_compile(&t, &rules, &b);
+	ck_assert_int_eq(hnef_rules_get_winner(&t, &b), HNEF_NO_WINNER);
+	hnef_rules_make_move(&t, &b, move(1, 1, 1, 0), &stack);
+	ck_assert_int_eq(hnef_rules_get_winner(&t, &b), HNEF_SWEDE);
+	rules.escape = HNEF_ESCAPE_CORNER;
+	hnef_rules_compile(&t, &rules, &b);
+	ck_assert_int_eq(hnef_rules_get_winner(&t, &b), HNEF_NO_WINNER);
+
+	rules.king_sides = 3;
+	ck_assert(!hnef_rules_compile(&t, &rules, &b));
+}
+END_TEST
+
+START_TEST (test_rules_hostility)
+{
+	HnefBoard b;
+	HnefRules rules;
+	HnefRuleTables t;
+	HnefUndo records[8];
+	HnefUndoStack stack;
+
+	hnef_undo_stack_init(&stack, records, 8);
+	hnef_board_init(&b, 7, 7);
+	hnef_board_set_tile_type(&b, 3, 3, HNEF_THRONE);
+	place(&b, 3, 2, HNEF_SWEDE, HNEF_SOLDIER);
+	place(&b, 5, 1, HNEF_MUSCOVITE, HNEF_SOLDIER);
+
+	/* The empty throne is hostile to defenders only */
+	hnef_rules_init(&rules, HNEF_RULES_FETLAR);
+	rules.hostile_throne = HNEF_HOSTILE_TO(HNEF_MUSCOVITE);
+	hnef_rules_compile(&t, &rules, &b);
+	ck_assert_int_eq(hnef_rules_make_move(&t, &b, move(5, 1, 3, 1), &stack), 0);
+	hnef_board_unmake_move(&b, &stack);
+
+	rules.hostile_throne = HNEF_HOSTILE_TO(HNEF_SWEDE);
+	hnef_rules_compile(&t, &rules, &b);
+	ck_assert_int_eq(hnef_rules_make_move(&t, &b, move(5, 1, 3, 1), &stack), 1);
+	hnef_board_unmake_move(&b, &stack);
+	ck_assert(hnef_board_get_key(&b) == hnef_board_compute_key(&b));
+}
+END_TEST
+
+START_TEST (test_rules_shieldwall)
+{
+	HnefBoard b, copy;
+	HnefRules rules;
+	HnefRuleTables t;
+	HnefUndo records[8];
+	HnefUndoStack stack;
+	int x, y;
+
+	hnef_undo_stack_init(&stack, records, 8);
+	hnef_variant_setup(&b, HNEF_VARIANT_COPENHAGEN);
+	for( y=0; y<11; y++ ) {
+		for( x=0; x<11; x++ ) {
+			if(hnef_board_get_tile_is_occupied(&b, x, y)) {
+				hnef_board_unset_token(&b, x, y);
+			}
+		}
+	}
+
+	/* Defenders at (3..5,10) against the south edge, each faced by an
+	 * attacker, closed to the west by an attacker at (2,10) */
+	place(&b, 3, 10, HNEF_SWEDE, HNEF_SOLDIER);
+	place(&b, 4, 10, HNEF_SWEDE, HNEF_KING);
+	place(&b, 5, 10, HNEF_SWEDE, HNEF_SOLDIER);
+	place(&b, 3, 9, HNEF_MUSCOVITE, HNEF_SOLDIER);
+	place(&b, 4, 9, HNEF_MUSCOVITE, HNEF_SOLDIER);
+	place(&b, 5, 9, HNEF_MUSCOVITE, HNEF_SOLDIER);
+	place(&b, 2, 10, HNEF_MUSCOVITE, HNEF_SOLDIER);
+	place(&b, 8, 8, HNEF_MUSCOVITE, HNEF_SOLDIER);
+	copy = b;
+
+	hnef_rules_init(&rules, HNEF_RULES_FETLAR);
+	hnef_rules_compile(&t, &rules, &b);
+	ck_assert_int_eq(hnef_rules_make_move(&t, &b, move(8, 8, 8, 10), &stack), 0);
+	hnef_board_unmake_move(&b, &stack);
+	ck_assert_int_eq(hnef_rules_make_move(&t, &b, move(8, 8, 6, 8), &stack), 0);
+	hnef_board_unmake_move(&b, &stack);
+
+	/* Closing the east end takes both soldiers but not the king */
+	hnef_rules_init(&rules, HNEF_RULES_COPENHAGEN);
+	hnef_rules_compile(&t, &rules, &b);
+	place(&b, 6, 8, HNEF_MUSCOVITE, HNEF_SOLDIER);
+	hnef_board_unset_token(&b, 8, 8);
+	copy = b;
+	ck_assert_int_eq(hnef_rules_make_move(&t, &b, move(6, 8, 6, 10), &stack), 2);
+	ck_assert(!hnef_board_get_tile_is_occupied(&b, 3, 10));
+	ck_assert(!hnef_board_get_tile_is_occupied(&b, 5, 10));
+	ck_assert_int_eq(hnef_board_get_token_rank(&b, 4, 10), HNEF_KING);
+	ck_assert_int_eq(stack.records[0].wall_edge, 3);
+
+	hnef_board_unmake_move(&b, &stack);
+	ck_assert(hnef_board_get_key(&b) == hnef_board_get_key(&copy));
+	ck_assert_int_eq(hnef_board_get_token_team(&b, 5, 10), HNEF_SWEDE);
+
+	/* A gap in the attackers facing the row saves it */
+	hnef_board_unset_token(&b, 4, 9);
+	ck_assert_int_eq(hnef_rules_make_move(&t, &b, move(6, 8, 6, 10), &stack), 0);
+}
+END_TEST
+
+START_TEST (test_rules_encirclement)
+{
+	HnefBoard b;
+	HnefRules rules;
+	HnefRuleTables t;
+	int x, y;
+
+	hnef_board_init(&b, 9, 9);
+	hnef_rules_init(&rules, HNEF_RULES_COPENHAGEN);
+	hnef_rules_compile(&t, &rules, &b);
+	ck_assert(!hnef_rules_is_encircled(&t, &b));
+
+	/* A ring of attackers around the 3x3 centre */
+	for( y=2; y<=6; y++ ) {
+		for( x=2; x<=6; x++ ) {
+			if(x == 2 || x == 6 || y == 2 || y == 6) {
+				place(&b, x, y, HNEF_MUSCOVITE, HNEF_SOLDIER);
+			}
+		}
+	}
+	place(&b, 4, 4, HNEF_SWEDE, HNEF_KING);
+	place(&b, 3, 3, HNEF_SWEDE, HNEF_SOLDIER);
+	ck_assert(hnef_rules_is_encircled(&t, &b));
+	ck_assert_int_eq(hnef_rules_get_winner(&t, &b), HNEF_MUSCOVITE);
+
+	/* A diagonal gap does not open the ring, a straight one does */
+	hnef_board_unset_token(&b, 2, 2);
+	ck_assert(hnef_rules_is_encircled(&t, &b));
+	hnef_board_unset_token(&b, 4, 2);
+	ck_assert(!hnef_rules_is_encircled(&t, &b));
+	ck_assert_int_eq(hnef_rules_get_winner(&t, &b), HNEF_NO_WINNER);
+
+	/* A defender outside the ring also breaks it */
+	place(&b, 4, 2, HNEF_MUSCOVITE, HNEF_SOLDIER);
+	place(&b, 8, 0, HNEF_SWEDE, HNEF_SOLDIER);
+	ck_assert(!hnef_rules_is_encircled(&t, &b));
+}
+END_TEST
+
+Suite*
+hnef_suite(void) {
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create("Hnefatafl Rules");
+	tc_core = tcase_create("Core");
+
+	tcase_add_test(tc_core, test_rules_default);
+	tcase_add_test(tc_core, test_rules_king);
+	tcase_add_test(tc_core, test_rules_hostility);
+	tcase_add_test(tc_core, test_rules_shieldwall);
+	tcase_add_test(tc_core, test_rules_encirclement);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+}
+
+int
+main(void) {
+	int number_failed;
+	Suite *s;
+	SRunner *sr;
+
+	s = hnef_suite();
+	sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
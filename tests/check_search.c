@@ -0,0 +1,144 @@
+#include <check.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "../libhnef/search.h"
+
+/* 7x7 board with castles in the corners and a throne in the middle */
+static void
+setup( HnefBoard *b ) {
+	int i, j;
+
+	hnef_board_init(b, 7, 7);
+	hnef_board_set_tile_type(b, 3, 3, HNEF_THRONE);
+	for(i=0; i<7; i+=6) {
+		for(j=0; j<7; j+=6) {
+			hnef_board_set_tile_type(b, i, j, HNEF_CASTLE);
+			hnef_board_set_tile_is_escape(b, i, j, HNEF_ESCAPE);
+		}
+	}
+}
+
+START_TEST(test_search_escape) {
+	HnefBoard b;
+	HnefTT tt;
+	HnefToken tok;
+	HnefSearchLimits limits;
+	HnefSearchResult result;
+	int threads;
+
+	ck_assert(hnef_tt_init(&tt, 4));
+
+	/* The king has a clear run to the corner */
+	setup(&b);
+	hnef_token_init(&tok, HNEF_SWEDE, HNEF_KING);
+	hnef_board_set_token(&b, 0, 3, tok);
+	hnef_token_init(&tok, HNEF_MUSCOVITE, HNEF_SOLDIER);
+	hnef_board_set_token(&b, 4, 4, tok);
+	hnef_board_set_token(&b, 5, 2, tok);
+	hnef_board_set_turn(&b, HNEF_SWEDE);
+
+	for(threads=1; threads<=4; threads*=2) {
+		hnef_tt_clear(&tt);
+		hnef_search_limits_init(&limits);
+		limits.depth = 4;
+		limits.threads = threads;
+		ck_assert(hnef_search(&b, &tt, &limits, &result));
+		ck_assert_int_eq(result.depth, 4);
+		ck_assert_int_ge(result.score, HNEF_SCORE_MATE);
+		ck_assert_int_eq(result.best.from, HNEF_SQUARE(0, 3));
+		ck_assert(result.best.to == HNEF_SQUARE(0, 0) || result.best.to == HNEF_SQUARE(0, 6));
+		ck_assert_int_ge(result.pv_length, 1);
+		ck_assert_int_gt(result.nodes, 0);
+	}
+
+	/* With the attackers to move the corner run cannot be stopped
+	 * from both sides at once */
+	hnef_board_set_turn(&b, HNEF_MUSCOVITE);
+	limits.threads = 2;
+	ck_assert(hnef_search(&b, &tt, &limits, &result));
+	ck_assert_int_le(result.score, -HNEF_SCORE_MATE);
+
+	/* A finished game has nothing to search */
+	hnef_board_unset_token(&b, 0, 3);
+	ck_assert(!hnef_search(&b, &tt, &limits, &result));
+
+	hnef_tt_free(&tt);
+}
+END_TEST
+
+START_TEST(test_search_capture) {
+	HnefBoard b;
+	HnefTT tt;
+	HnefToken tok;
+	HnefSearchLimits limits;
+	HnefSearchResult result;
+
+	ck_assert(hnef_tt_init(&tt, 1));
+
+	/* A defender can be taken against the castle at (0,0) */
+	setup(&b);
+	hnef_token_init(&tok, HNEF_SWEDE, HNEF_KING);
+	hnef_board_set_token(&b, 3, 3, tok);
+	hnef_token_init(&tok, HNEF_SWEDE, HNEF_SOLDIER);
+	hnef_board_set_token(&b, 1, 0, tok);
+	hnef_board_set_token(&b, 3, 2, tok);
+	hnef_board_set_token(&b, 3, 4, tok);
+	hnef_board_set_token(&b, 2, 3, tok);
+	hnef_board_set_token(&b, 4, 3, tok);
+	hnef_token_init(&tok, HNEF_MUSCOVITE, HNEF_SOLDIER);
+	hnef_board_set_token(&b, 2, 5, tok);
+	hnef_board_set_token(&b, 5, 0, tok);
+	hnef_board_set_token(&b, 1, 5, tok);
+	hnef_board_set_token(&b, 5, 5, tok);
+
+	hnef_search_limits_init(&limits);
+	limits.depth = 1;
+	limits.threads = 1;
+	ck_assert(hnef_search(&b, &tt, &limits, &result));
+	ck_assert_int_eq(result.best.to, HNEF_SQUARE(2, 0));
+
+	/* A time limit still returns a completed iteration */
+	limits.depth = HNEF_MAX_PLY;
+	limits.milliseconds = 50;
+	limits.threads = 3;
+	ck_assert(hnef_search(&b, &tt, &limits, &result));
+	ck_assert_int_ge(result.depth, 1);
+	ck_assert_int_lt(result.depth, HNEF_MAX_PLY);
+
+	hnef_tt_free(&tt);
+}
+END_TEST
+
+Suite *
+hnef_suite(void) {
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create("Hnefatafl Search");
+
+	tc_core = tcase_create("Core");
+	tcase_set_timeout(tc_core, 30);
+
+	tcase_add_test(tc_core, test_search_escape);
+	tcase_add_test(tc_core, test_search_capture);
+	
+	suite_add_tcase(s, tc_core);
+
+	return s;	
+}
+
+int
+main(void) {
+	int nfailed;
+	Suite *s;
+	SRunner *sr;
+	
+	s = hnef_suite();
+	sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_NORMAL);
+	nfailed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+	
+	return (nfailed == 0)? EXIT_SUCCESS : EXIT_FAILURE;
+}
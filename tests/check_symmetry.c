@@ -0,0 +1,275 @@
+#include <check.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "../libhnef/symmetry.h"
+#include "../libhnef/eval.h"
+#include "../libhnef/variant.h"
+#include "random_game.h"
+
+#define POSITIONS 12
+
+/* Two boards hold the same position, tiles and masks alike */
+static void
+assert_same_board( HnefBoard *a, HnefBoard *b ) {
+	int x, y, i;
+
+	ck_assert_int_eq(a->height, b->height);
+	ck_assert_int_eq(a->width, b->width);
+	ck_assert_int_eq(a->turn, b->turn);
+	ck_assert(a->key == b->key);
+	ck_assert(memcmp(&(a->occupied), &(b->occupied), sizeof(HnefBitboard)) == 0);
+	for( i=0; i<2; i++ ) {
+		ck_assert(memcmp(&(a->teams[i]), &(b->teams[i]), sizeof(HnefBitboard)) == 0);
+		ck_assert(memcmp(&(a->ranks[i]), &(b->ranks[i]), sizeof(HnefBitboard)) == 0);
+	}
+	for( i=0; i<4; i++ ) {
+		ck_assert(memcmp(&(a->types[i]), &(b->types[i]), sizeof(HnefBitboard)) == 0);
+	}
+	ck_assert(memcmp(&(a->escapes), &(b->escapes), sizeof(HnefBitboard)) == 0);
+	for( y=0; y<a->height; y++ ) {
+		for( x=0; x<a->width; x++ ) {
+			ck_assert_int_eq(hnef_board_get_tile_type(a, x, y), hnef_board_get_tile_type(b, x, y));
+			ck_assert_int_eq(hnef_board_get_tile_is_escape(a, x, y), hnef_board_get_tile_is_escape(b, x, y));
+			ck_assert_int_eq(hnef_board_get_tile_is_occupied(a, x, y), hnef_board_get_tile_is_occupied(b, x, y));
+			if(hnef_board_get_tile_is_occupied(a, x, y)) {
+				ck_assert_int_eq(hnef_board_get_token_team(a, x, y), hnef_board_get_token_team(b, x, y));
+				ck_assert_int_eq(hnef_board_get_token_rank(a, x, y), hnef_board_get_token_rank(b, x, y));
+			}
+		}
+	}
+}
+
+/* Check every image of a position against the position itself */
+static void
+check_position( HnefBoard *b ) {
+	HnefBoard image, back, canon, other;
+	HnefEvalAccumulator acc;
+	HnefEvalFeatures f, g;
+	HnefRays rays, image_rays;
+	HnefMove moves[HNEF_MAX_MOVES], image_moves[HNEF_MAX_MOVES], m;
+	uint64_t key;
+	int t, u, n, k, i, j, x, y, sq, found;
+
+	key = hnef_board_canonicalize(&canon, b, &u);
+	ck_assert(key == canon.key);
+	ck_assert(key == hnef_board_compute_key(&canon));
+	ck_assert(hnef_board_transform(&other, b, u));
+	assert_same_board(&canon, &other);
+	ck_assert(hnef_board_canonicalize(NULL, b, NULL) == key);
+
+	hnef_rays_init(&rays, b->height, b->width);
+	n = hnef_board_generate_moves(b, &rays, b->turn, moves, HNEF_MAX_MOVES);
+
+	for( t=0; t<HNEF_TRANSFORM_COUNT; t++ ) {
+		if(!hnef_symmetry_is_valid(b, t)) {
+			ck_assert(!hnef_board_transform(&image, b, t));
+			continue;
+		}
+		ck_assert(hnef_board_transform(&image, b, t));
+		ck_assert(image.key == hnef_board_compute_key(&image));
+
+		/* Each tile lands where hnef_symmetry_square says */
+		for( y=0; y<b->height; y++ ) {
+			for( x=0; x<b->width; x++ ) {
+				sq = hnef_symmetry_square(HNEF_SQUARE(x, y), t, b->height, b->width);
+				ck_assert_int_eq(hnef_board_get_tile_type(b, x, y),
+						 hnef_board_get_tile_type(&image, HNEF_SQUARE_X(sq), HNEF_SQUARE_Y(sq)));
+				ck_assert_int_eq(hnef_board_get_tile_is_escape(b, x, y),
+						 hnef_board_get_tile_is_escape(&image, HNEF_SQUARE_X(sq), HNEF_SQUARE_Y(sq)));
+				ck_assert_int_eq(hnef_board_get_tile_is_occupied(b, x, y),
+						 hnef_board_get_tile_is_occupied(&image, HNEF_SQUARE_X(sq), HNEF_SQUARE_Y(sq)));
+			}
+		}
+
+		/* A separate image does not share the position's watcher */
+		ck_assert(image.watcher == NULL && image.watcher_data == NULL);
+
+		/* Every image shares the canonical orientation */
+		ck_assert(hnef_board_canonicalize(&other, &image, NULL) == key);
+		assert_same_board(&canon, &other);
+
+		/* The inverse restores the position, in place, and a board
+		 * transformed in place stays tracked */
+		hnef_board_copy(&back, &image);
+		hnef_eval_track(&back, &acc);
+		ck_assert(hnef_board_transform(&back, &back, hnef_symmetry_inverse(t)));
+		assert_same_board(&back, b);
+		ck_assert(back.watcher_data == &acc);
+		hnef_eval_get_features(&back, &f);
+		hnef_eval_compute_features(&back, &g);
+		ck_assert(memcmp(&f, &g, sizeof(f)) == 0);
+
+		/* Moves carry over one for one */
+		hnef_rays_init(&image_rays, image.height, image.width);
+		k = hnef_board_generate_moves(&image, &image_rays, image.turn, image_moves, HNEF_MAX_MOVES);
+		ck_assert_int_eq(n, k);
+		for( i=0; i<n; i++ ) {
+			m = hnef_symmetry_move(moves[i], t, b->height, b->width);
+			found = 0;
+			for( j=0; j<k; j++ ) {
+				found |= image_moves[j].from == m.from && image_moves[j].to == m.to;
+			}
+			ck_assert(found);
+		}
+	}
+}
+
+START_TEST (test_symmetry_variants)
+{
+	HnefBoard b;
+	HnefRays rays;
+	HnefEvalAccumulator acc;
+	uint64_t rng = 11;
+	int variant, i;
+
+	for( variant=0; variant<HNEF_VARIANT_COUNT; variant++ ) {
+		for( i=0; i<POSITIONS; i++ ) {
+			hnef_variant_setup(&b, variant);
+			hnef_eval_track(&b, &acc);
+			hnef_rays_init(&rays, b.height, b.width);
+			random_game(&b, NULL, &rays, &rng, i*5, NULL, NULL, NULL);
+			check_position(&b);
+		}
+	}
+}
+END_TEST
+
+START_TEST (test_symmetry_tracked)
+{
+	HnefBoard b, canon;
+	HnefEvalAccumulator acc;
+	HnefEvalFeatures f, g;
+	int sq, i;
+
+	/* Changing the canonical copy leaves the tracked original alone */
+	hnef_variant_setup(&b, HNEF_VARIANT_COPENHAGEN);
+	hnef_eval_track(&b, &acc);
+	hnef_board_canonicalize(&canon, &b, NULL);
+	ck_assert(canon.watcher == NULL && canon.watcher_data == NULL);
+	for( i=0; i<2; i++ ) {
+		sq = hnef_bitboard_first(&(canon.teams[HNEF_MUSCOVITE]));
+		hnef_board_unset_token(&canon, HNEF_SQUARE_X(sq), HNEF_SQUARE_Y(sq));
+	}
+	hnef_eval_get_features(&b, &f);
+	hnef_eval_compute_features(&b, &g);
+	ck_assert(memcmp(&f, &g, sizeof(f)) == 0);
+}
+END_TEST
+
+START_TEST (test_symmetry_rectangle)
+{
+	HnefBoard b, c;
+	HnefToken t;
+	int transform;
+
+	/* A lopsided 5x7 position with every kind of tile */
+	hnef_board_init(&b, 5, 7);
+	hnef_board_set_tile_type(&b, 3, 2, HNEF_THRONE);
+	hnef_board_set_tile_type(&b, 0, 0, HNEF_CASTLE);
+	hnef_board_set_tile_type(&b, 6, 1, HNEF_CAMP);
+	hnef_board_set_tile_is_escape(&b, 6, 4, HNEF_ESCAPE);
+	hnef_token_init(&t, HNEF_SWEDE, HNEF_KING);
+	hnef_board_set_token(&b, 3, 2, t);
+	hnef_token_init(&t, HNEF_MUSCOVITE, HNEF_SOLDIER);
+	hnef_board_set_token(&b, 1, 0, t);
+	hnef_board_set_token(&b, 5, 3, t);
+	hnef_token_init(&t, HNEF_SWEDE, HNEF_SOLDIER);
+	hnef_board_set_token(&b, 2, 4, t);
+	hnef_board_set_turn(&b, HNEF_SWEDE);
+	check_position(&b);
+
+	/* Only the mirrors suit a board which is not square */
+	ck_assert(!hnef_symmetry_is_valid(&b, HNEF_TRANSFORM_TRANSPOSE));
+	ck_assert(!hnef_symmetry_is_valid(&b, HNEF_TRANSFORM_COUNT));
+	hnef_board_canonicalize(&c, &b, &transform);
+	ck_assert_int_lt(transform, HNEF_TRANSFORM_TRANSPOSE);
+
+	/* A symmetric position is its own canonical orientation */
+	hnef_variant_setup(&b, HNEF_VARIANT_COPENHAGEN);
+	ck_assert(hnef_board_canonicalize(&c, &b, &transform) == hnef_board_get_key(&b));
+	ck_assert_int_eq(transform, HNEF_TRANSFORM_IDENTITY);
+	assert_same_board(&b, &c);
+}
+END_TEST
+
+START_TEST (test_symmetry_inverse)
+{
+	int t, h, w, sq;
+
+	for( t=0; t<HNEF_TRANSFORM_COUNT; t++ ) {
+		ck_assert_int_eq(hnef_symmetry_inverse(hnef_symmetry_inverse(t)), t);
+		/* Transposing symmetries need a square board */
+		h = 9;
+		w = (t & HNEF_TRANSFORM_TRANSPOSE)? 9 : 7;
+		for( sq=0; sq<HNEF_SQUARE(0, h); sq++ ) {
+			if(HNEF_SQUARE_X(sq) >= w) {
+				continue;
+			}
+			ck_assert_int_eq(hnef_symmetry_square(hnef_symmetry_square(sq, t, h, w),
+							       hnef_symmetry_inverse(t),
+							       h, w), sq);
+		}
+	}
+	ck_assert_int_eq(hnef_symmetry_inverse(HNEF_TRANSFORM_ROTATE_CW), HNEF_TRANSFORM_ROTATE_CCW);
+}
+END_TEST
+
+START_TEST (test_symmetry_transpose)
+{
+	HnefBitboard a, b;
+	uint64_t rng = 7, r;
+	int i, k, x, y, size;
+
+	/* Random sets confined to 16x16 squares and spread over 32x32 */
+	for( i=0; i<64; i++ ) {
+		size = (i & 1)? 32 : 16;
+		hnef_bitboard_clear(&a);
+		for( k=0; k<size*4; k++ ) {
+			r = random_next(&rng);
+			hnef_bitboard_set(&a, HNEF_SQUARE(r % size, (r >> 12) % size));
+		}
+		hnef_bitboard_transpose(&b, &a);
+		for( y=0; y<HNEF_BITBOARD_ROWS; y++ ) {
+			for( x=0; x<HNEF_BITBOARD_STRIDE; x++ ) {
+				ck_assert_int_eq(hnef_bitboard_test(&a, HNEF_SQUARE(x, y)),
+						 hnef_bitboard_test(&b, HNEF_SQUARE(y, x)));
+			}
+		}
+	}
+}
+END_TEST
+
+Suite*
+hnef_suite(void) {
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create("Hnefatafl Symmetry");
+	tc_core = tcase_create("Core");
+
+	tcase_add_test(tc_core, test_symmetry_variants);
+	tcase_add_test(tc_core, test_symmetry_tracked);
+	tcase_add_test(tc_core, test_symmetry_rectangle);
+	tcase_add_test(tc_core, test_symmetry_inverse);
+	tcase_add_test(tc_core, test_symmetry_transpose);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+}
+
+int
+main(void) {
+	int number_failed;
+	Suite *s;
+	SRunner *sr;
+
+	s = hnef_suite();
+	sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,384 @@
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "../libhnef/tablebase.h"
+#include "../libhnef/search.h"
+#include "../libhnef/eval.h"
+#include "../libhnef/variant.h"
+#include "random_game.h"
+
+#define SAMPLES 4000
+
+static HnefTablebase tb;
+
+/* Every Brandubh endgame with up to one attacker and one defender */
+static void
+generate( void ) {
+	HnefBoard layout;
+
+	hnef_variant_setup(&layout, HNEF_VARIANT_BRANDUBH);
+	ck_assert(hnef_tablebase_generate(&tb, &layout, 1, 1, 1));
+}
+
+/* A Brandubh board with a king and the given tokens on random squares */
+static void
+random_position( HnefBoard *b, int attackers, int defenders, uint64_t *rng ) {
+	HnefToken t;
+	int x, y, i;
+
+	hnef_variant_setup(b, HNEF_VARIANT_BRANDUBH);
+	for( y=0; y<b->height; y++ ) {
+		for( x=0; x<b->width; x++ ) {
+			hnef_board_unset_token(b, x, y);
+		}
+	}
+	for( i=0; i<1 + attackers + defenders; i++ ) {
+		do {
+			x = random_next(rng) % b->width;
+			y = random_next(rng) % b->height;
+		} while( hnef_board_get_tile_is_occupied(b, x, y) );
+		if(i == 0) {
+			hnef_token_init(&t, HNEF_SWEDE, HNEF_KING);
+		} else if(i <= attackers) {
+			hnef_token_init(&t, HNEF_MUSCOVITE, HNEF_SOLDIER);
+		} else {
+			hnef_token_init(&t, HNEF_SWEDE, HNEF_SOLDIER);
+		}
+		hnef_board_set_token(b, x, y, t);
+	}
+	hnef_board_set_turn(b, random_next(rng) & 1);
+}
+
+START_TEST (test_tablebase_consistent)
+{
+	HnefBoard b;
+	HnefRays rays;
+	HnefMove moves[HNEF_MAX_MOVES], best;
+	HnefUndo records[1];
+	HnefUndoStack stack;
+	HnefToken token;
+	uint64_t rng = 5;
+	int i, j, n, r, d, cr, cd, wins, draws, losses, shortest, longest, seen[4], king;
+
+	generate();
+	memset(seen, 0, sizeof(seen));
+	hnef_rays_init(&rays, 7, 7);
+	hnef_undo_stack_init(&stack, records, 1);
+	for( i=0; i<SAMPLES; i++ ) {
+		random_position(&b, random_next(&rng) % 2, random_next(&rng) % 2, &rng);
+		r = hnef_tablebase_probe(&tb, &b, &d);
+		ck_assert_int_ne(r, HNEF_TB_UNKNOWN);
+		seen[r]++;
+		if(hnef_board_get_winner(&b) != HNEF_NO_WINNER) {
+			ck_assert_int_eq(d, 0);
+			continue;
+		}
+
+		/* Each result follows from the results of the moves */
+		n = hnef_board_generate_moves(&b, &rays, b.turn, moves, HNEF_MAX_MOVES);
+		wins = draws = losses = 0;
+		shortest = HNEF_TB_MAX_DISTANCE;
+		longest = 0;
+		for( j=0; j<n; j++ ) {
+			hnef_board_make_move(&b, moves[j], &stack);
+			cr = hnef_tablebase_probe(&tb, &b, &cd);
+			hnef_board_unmake_move(&b, &stack);
+			ck_assert_int_ne(cr, HNEF_TB_UNKNOWN);
+			if(cr == HNEF_TB_LOSS) {
+				losses++;
+				shortest = (cd < shortest)? cd : shortest;
+			} else if(cr == HNEF_TB_DRAW) {
+				draws++;
+			} else {
+				wins++;
+				longest = (cd > longest)? cd : longest;
+			}
+		}
+		if(losses) {
+			ck_assert_int_eq(r, HNEF_TB_WIN);
+			ck_assert_int_eq(d, shortest + 1);
+		} else if(draws) {
+			ck_assert_int_eq(r, HNEF_TB_DRAW);
+			ck_assert_int_eq(d, 0);
+		} else {
+			ck_assert_int_eq(r, HNEF_TB_LOSS);
+			ck_assert_int_eq(d, n? longest + 1 : 0);
+		}
+
+		/* The best move keeps the result */
+		if(n) {
+			ck_assert_int_eq(hnef_tablebase_best_move(&tb, &b, &rays, &best, NULL), r);
+			hnef_board_make_move(&b, best, &stack);
+			cr = hnef_tablebase_probe(&tb, &b, &cd);
+			hnef_board_unmake_move(&b, &stack);
+			if(r == HNEF_TB_WIN) {
+				ck_assert_int_eq(cr, HNEF_TB_LOSS);
+				ck_assert_int_eq(cd, d - 1);
+			} else if(r == HNEF_TB_DRAW) {
+				ck_assert_int_eq(cr, HNEF_TB_DRAW);
+			} else {
+				ck_assert_int_eq(cd, d - 1);
+			}
+		}
+	}
+	ck_assert_int_gt(seen[HNEF_TB_WIN], 0);
+	ck_assert_int_gt(seen[HNEF_TB_LOSS], 0);
+
+	/* Positions beyond the material generated are not covered */
+	random_position(&b, 2, 0, &rng);
+	ck_assert_int_eq(hnef_tablebase_probe(&tb, &b, NULL), HNEF_TB_UNKNOWN);
+	hnef_variant_setup(&b, HNEF_VARIANT_TABLUT);
+	ck_assert_int_eq(hnef_tablebase_probe(&tb, &b, NULL), HNEF_TB_UNKNOWN);
+
+	/* So are positions without exactly one defending king */
+	random_position(&b, 1, 0, &rng);
+	ck_assert_int_ne(hnef_tablebase_probe(&tb, &b, NULL), HNEF_TB_UNKNOWN);
+	king = hnef_bitboard_first(&(b.ranks[HNEF_KING]));
+	for( i=0; hnef_board_get_tile_is_occupied(&b, i % 7, i / 7); i++ );
+	hnef_token_init(&token, HNEF_SWEDE, HNEF_KING);
+	hnef_board_set_token(&b, i % 7, i / 7, token);
+	ck_assert_int_eq(hnef_tablebase_probe(&tb, &b, NULL), HNEF_TB_UNKNOWN);
+	hnef_board_unset_token(&b, i % 7, i / 7);
+	hnef_token_init(&token, HNEF_MUSCOVITE, HNEF_KING);
+	hnef_board_set_token(&b, HNEF_SQUARE_X(king), HNEF_SQUARE_Y(king), token);
+	ck_assert_int_eq(hnef_tablebase_probe(&tb, &b, NULL), HNEF_TB_UNKNOWN);
+	hnef_board_unset_token(&b, HNEF_SQUARE_X(king), HNEF_SQUARE_Y(king));
+	ck_assert_int_eq(hnef_tablebase_probe(&tb, &b, NULL), HNEF_TB_UNKNOWN);
+	hnef_tablebase_free(&tb);
+}
+END_TEST
+
+START_TEST (test_tablebase_threads)
+{
+	HnefTablebase other;
+	HnefBoard layout;
+	HnefEvalAccumulator acc;
+	HnefEvalFeatures fast, slow;
+
+	generate();
+	/* Threads share the work without changing the result, or the
+	 * sums of a tracked layout */
+	hnef_variant_setup(&layout, HNEF_VARIANT_BRANDUBH);
+	hnef_eval_track(&layout, &acc);
+	ck_assert(hnef_tablebase_generate(&other, &layout, 1, 1, 3));
+	ck_assert(other.size == tb.size);
+	ck_assert(memcmp(other.image, tb.image, tb.size) == 0);
+	hnef_tablebase_free(&other);
+	hnef_eval_get_features(&layout, &fast);
+	hnef_eval_compute_features(&layout, &slow);
+	ck_assert(memcmp(&fast, &slow, sizeof(fast)) == 0);
+
+	ck_assert(!hnef_tablebase_generate(&other, &layout, HNEF_TB_MAX_PIECES + 1, 0, 1));
+	ck_assert(other.image == NULL);
+	hnef_tablebase_free(&tb);
+}
+END_TEST
+
+/* Write an image with one byte changed and check that it is refused */
+static void
+refuse_patched( const char *path, uint64_t at, uint8_t byte ) {
+	HnefTablebase other;
+	FILE *f;
+	uint8_t *image;
+
+	image = malloc(tb.size);
+	ck_assert(image != NULL);
+	memcpy(image, tb.image, tb.size);
+	image[at] = byte;
+	f = fopen(path, "wb");
+	ck_assert(f != NULL);
+	ck_assert(fwrite(image, 1, tb.size, f) == tb.size);
+	fclose(f);
+	free(image);
+	ck_assert(!hnef_tablebase_open(&other, path));
+}
+
+START_TEST (test_tablebase_file)
+{
+	HnefTablebase other;
+	HnefBoard b;
+	FILE *f;
+	char path[] = "/tmp/check_tablebaseXXXXXX";
+	const HnefTablebaseTable *table;
+	uint64_t rng = 9, block;
+	int fd, i, d, e;
+
+	generate();
+	fd = mkstemp(path);
+	ck_assert_int_ge(fd, 0);
+	close(fd);
+
+	ck_assert(hnef_tablebase_save(&tb, path));
+	ck_assert(hnef_tablebase_open(&other, path));
+	ck_assert(other.size == tb.size);
+	ck_assert_int_eq(other.kings, tb.kings);
+	for( i=0; i<SAMPLES; i++ ) {
+		random_position(&b, random_next(&rng) % 2, random_next(&rng) % 2, &rng);
+		ck_assert_int_eq(hnef_tablebase_probe(&other, &b, &d), hnef_tablebase_probe(&tb, &b, &e));
+		ck_assert_int_eq(d, e);
+	}
+	hnef_tablebase_free(&other);
+	ck_assert(other.image == NULL);
+
+	/* Blocks which probes could not read safely are refused: an offset
+	 * past the end, a bad width, too many values for the width */
+	table = &(tb.tables[1][1]);
+	block = 0;
+	for( i=0; i<8; i++ ) {
+		block |= (uint64_t)tb.image[table->offset + i] << (8*i);
+	}
+	refuse_patched(path, table->offset + 7, 0x7f);
+	refuse_patched(path, block, 3);
+	if(tb.image[block] != 8) {
+		refuse_patched(path, block + 1, (uint8_t)(1 << tb.image[block]));
+	}
+
+	/* A damaged file is refused */
+	f = fopen(path, "r+b");
+	ck_assert(f != NULL);
+	fputc('X', f);
+	fclose(f);
+	ck_assert(!hnef_tablebase_open(&other, path));
+	f = fopen(path, "wb");
+	ck_assert(f != NULL);
+	fclose(f);
+	ck_assert(!hnef_tablebase_open(&other, path));
+	remove(path);
+	ck_assert(!hnef_tablebase_open(&other, path));
+	hnef_tablebase_free(&tb);
+}
+END_TEST
+
+/* Search a position with an empty table, and again once each of its
+ * children has been searched on its own, so that they are found in the
+ * table one ply below where they were stored */
+START_TEST (test_tablebase_transpositions)
+{
+	HnefBoard b, child;
+	HnefRays rays;
+	HnefTT tt;
+	HnefSearchLimits limits;
+	HnefSearchResult result;
+	HnefMove moves[HNEF_MAX_MOVES];
+	HnefUndo records[1];
+	HnefUndoStack stack;
+	uint64_t rng = 5;
+	int tries, found, n, i, score;
+
+	generate();
+	hnef_search_limits_init(&limits);
+	limits.tablebase = &tb;
+	found = 0;
+	for( tries=0; tries<2000 && found<10; tries++ ) {
+		/* One attacker more than the tablebase holds */
+		random_position(&b, 2, 1, &rng);
+		if(hnef_board_get_winner(&b) != HNEF_NO_WINNER) {
+			continue;
+		}
+		hnef_rays_init(&rays, b.height, b.width);
+
+		ck_assert(hnef_tt_init(&tt, 1));
+		limits.depth = 3;
+		ck_assert(hnef_search(&b, &tt, &limits, &result));
+		score = result.score;
+		hnef_tt_free(&tt);
+		if(abs(score) < HNEF_SCORE_FORCED || abs(score) >= HNEF_SCORE_MATE) {
+			continue;
+		}
+		found++;
+
+		ck_assert(hnef_tt_init(&tt, 1));
+		limits.depth = 2;
+		n = hnef_board_generate_moves(&b, &rays, b.turn, moves, HNEF_MAX_MOVES);
+		for( i=0; i<n; i++ ) {
+			child = b;
+			hnef_undo_stack_init(&stack, records, 1);
+			hnef_board_make_move(&child, moves[i], &stack);
+			if(hnef_board_get_winner(&child) == HNEF_NO_WINNER) {
+				ck_assert(hnef_search(&child, &tt, &limits, &result));
+			}
+		}
+		limits.depth = 3;
+		ck_assert(hnef_search(&b, &tt, &limits, &result));
+		ck_assert_int_eq(result.score, score);
+		hnef_tt_free(&tt);
+	}
+	ck_assert_int_gt(found, 0);
+	hnef_tablebase_free(&tb);
+}
+END_TEST
+
+START_TEST (test_tablebase_search)
+{
+	HnefBoard b;
+	HnefTT tt;
+	HnefSearchLimits limits;
+	HnefSearchResult result;
+	HnefUndo records[1];
+	HnefUndoStack stack;
+	uint64_t rng = 3;
+	int r, d, found;
+
+	generate();
+	/* Find a win a few plies deep */
+	found = 0;
+	while( !found ) {
+		random_position(&b, 1, 1, &rng);
+		r = hnef_tablebase_probe(&tb, &b, &d);
+		found = r == HNEF_TB_WIN && d >= 3 && hnef_board_get_winner(&b) == HNEF_NO_WINNER;
+	}
+
+	ck_assert(hnef_tt_init(&tt, 1));
+	hnef_search_limits_init(&limits);
+	ck_assert(limits.tablebase == NULL);
+	limits.depth = 2;
+	limits.tablebase = &tb;
+	ck_assert(hnef_search(&b, &tt, &limits, &result));
+	ck_assert_int_eq(result.score, HNEF_SCORE_TABLEBASE - d);
+
+	/* The move chosen keeps the shortest win */
+	hnef_undo_stack_init(&stack, records, 1);
+	hnef_board_make_move(&b, result.best, &stack);
+	ck_assert_int_eq(hnef_tablebase_probe(&tb, &b, &r), HNEF_TB_LOSS);
+	ck_assert_int_eq(r, d - 1);
+	hnef_tt_free(&tt);
+	hnef_tablebase_free(&tb);
+}
+END_TEST
+
+Suite*
+hnef_suite(void) {
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create("Hnefatafl Tablebase");
+	tc_core = tcase_create("Core");
+
+	tcase_set_timeout(tc_core, 60);
+	tcase_add_test(tc_core, test_tablebase_consistent);
+	tcase_add_test(tc_core, test_tablebase_threads);
+	tcase_add_test(tc_core, test_tablebase_file);
+	tcase_add_test(tc_core, test_tablebase_search);
+	tcase_add_test(tc_core, test_tablebase_transpositions);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+}
+
+int
+main(void) {
+	int number_failed;
+	Suite *s;
+	SRunner *sr;
+
+	s = hnef_suite();
+	sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,177 @@
+#include <check.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "../libhnef/tensor.h"
+#include "../libhnef/move.h"
+#include "../libhnef/variant.h"
+#include "random_game.h"
+
+#define BATCH 16
+
+/* Where square (x,y) of an n x n board lands under a transform */
+static void
+transform_square( int t, int n, int x, int y, int *tx, int *ty ) {
+	int s;
+
+	if(t & HNEF_TRANSFORM_TRANSPOSE) {
+		s = x;
+		x = y;
+		y = s;
+	}
+	*tx = (t & HNEF_TRANSFORM_FLIP_X)? n - 1 - x : x;
+	*ty = (t & HNEF_TRANSFORM_FLIP_Y)? n - 1 - y : y;
+}
+
+/* The value of a plane at a tile, found from the tile itself */
+static int
+tile_plane( HnefBoard *b, int p, int x, int y ) {
+	int occupied = hnef_board_get_tile_is_occupied(b, x, y);
+
+	switch(p) {
+	case HNEF_TENSOR_ATTACKERS:
+		return occupied && hnef_board_get_token_team(b, x, y) == HNEF_MUSCOVITE;
+	case HNEF_TENSOR_DEFENDERS:
+		return occupied && hnef_board_get_token_team(b, x, y) == HNEF_SWEDE &&
+			hnef_board_get_token_rank(b, x, y) == HNEF_SOLDIER;
+	case HNEF_TENSOR_KING:
+		return occupied && hnef_board_get_token_rank(b, x, y) == HNEF_KING;
+	case HNEF_TENSOR_THRONE:
+		return hnef_board_get_tile_type(b, x, y) == HNEF_THRONE;
+	case HNEF_TENSOR_ESCAPES:
+		return hnef_board_get_tile_is_escape(b, x, y);
+	default:
+		return hnef_board_get_turn(b) == HNEF_SWEDE;
+	}
+}
+
+START_TEST (test_tensor_export)
+{
+	static HnefBoard boards[BATCH];
+	HnefBoard *batch[BATCH];
+	HnefRays rays;
+	int transforms[BATCH];
+	float *f;
+	int8_t *q;
+	uint64_t rng = 5;
+	int variant, i, n, size, p, x, y, tx, ty, v, k;
+
+	for( variant=0; variant<HNEF_VARIANT_COUNT; variant++ ) {
+		/* A batch of random positions of the variant */
+		for( i=0; i<BATCH; i++ ) {
+			hnef_variant_setup(&boards[i], variant);
+			hnef_rays_init(&rays, boards[i].height, boards[i].width);
+			random_game(&boards[i], NULL, &rays, &rng, i*4, NULL, NULL, NULL);
+			batch[i] = &boards[i];
+			transforms[i] = i % HNEF_TRANSFORM_COUNT;
+		}
+
+		size = hnef_tensor_get_size(batch[0]);
+		n = boards[0].width;
+		ck_assert_int_eq(size, HNEF_TENSOR_PLANES * n * n);
+		f = malloc(BATCH * size * sizeof(float));
+		q = malloc(BATCH * size);
+
+		for( k=0; k<2; k++ ) {
+			ck_assert(hnef_tensor_export_float(batch, BATCH, k? transforms : NULL, f));
+			ck_assert(hnef_tensor_export_int8(batch, BATCH, k? transforms : NULL, q));
+			for( i=0; i<BATCH; i++ ) {
+				for( p=0; p<HNEF_TENSOR_PLANES; p++ ) {
+					for( y=0; y<n; y++ ) {
+						for( x=0; x<n; x++ ) {
+							transform_square(k? transforms[i] : 0, n, x, y, &tx, &ty);
+							v = tile_plane(&boards[i], p, x, y);
+							ck_assert(f[i*size + (p*n + ty)*n + tx] == (float)v);
+							ck_assert_int_eq(q[i*size + (p*n + ty)*n + tx], v);
+						}
+					}
+				}
+			}
+		}
+
+		free(f);
+		free(q);
+	}
+}
+END_TEST
+
+START_TEST (test_tensor_invalid)
+{
+	HnefBoard a, b;
+	HnefBoard *batch[2];
+	float f[HNEF_TENSOR_PLANES * 7 * 9 * 2];
+	int transforms[2] = { HNEF_TRANSFORM_FLIP_X, HNEF_TRANSFORM_ROTATE_CW };
+
+	hnef_board_init(&a, 7, 9);
+	hnef_board_init(&b, 9, 9);
+	batch[0] = &a;
+	batch[1] = &b;
+
+	/* Boards of a batch must share a size */
+	ck_assert(!hnef_tensor_export_float(batch, 2, NULL, f));
+
+	/* Only square boards can be transposed */
+	batch[1] = &a;
+	ck_assert(!hnef_tensor_export_float(batch, 2, transforms, f));
+	transforms[1] = HNEF_TRANSFORM_ROTATE_180;
+	ck_assert(hnef_tensor_export_float(batch, 2, transforms, f));
+	transforms[1] = HNEF_TRANSFORM_COUNT;
+	ck_assert(!hnef_tensor_export_float(batch, 2, transforms, f));
+}
+END_TEST
+
+START_TEST (test_bitboard_transform)
+{
+	HnefBitboard a, b;
+
+	/* A 3x5 board becomes 5x3 when transposed */
+	hnef_bitboard_clear(&a);
+	hnef_bitboard_set(&a, HNEF_SQUARE(4, 0));
+	hnef_bitboard_set(&a, HNEF_SQUARE(1, 2));
+
+	hnef_bitboard_transform(&b, &a, HNEF_TRANSFORM_ROTATE_CW, 3, 5);
+	ck_assert(hnef_bitboard_test(&b, HNEF_SQUARE(2, 4)));
+	ck_assert(hnef_bitboard_test(&b, HNEF_SQUARE(0, 1)));
+	ck_assert_int_eq(hnef_bitboard_popcount(&b), 2);
+
+	/* A rotation and its inverse cancel out */
+	hnef_bitboard_transform(&b, &b, HNEF_TRANSFORM_ROTATE_CCW, 5, 3);
+	ck_assert(memcmp(&a, &b, sizeof(a)) == 0);
+
+	hnef_bitboard_transform(&b, &a, HNEF_TRANSFORM_FLIP_X, 3, 5);
+	ck_assert(hnef_bitboard_test(&b, HNEF_SQUARE(0, 0)));
+	ck_assert(hnef_bitboard_test(&b, HNEF_SQUARE(3, 2)));
+}
+END_TEST
+
+Suite*
+hnef_suite(void) {
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create("Hnefatafl Tensor");
+	tc_core = tcase_create("Core");
+
+	tcase_add_test(tc_core, test_tensor_export);
+	tcase_add_test(tc_core, test_tensor_invalid);
+	tcase_add_test(tc_core, test_bitboard_transform);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+}
+
+int
+main(void) {
+	int number_failed;
+	Suite *s;
+	SRunner *sr;
+
+	s = hnef_suite();
+	sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,97 @@
+#include <check.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "../libhnef/tt.h"
+
+START_TEST(test_tt) {
+	HnefTT tt;
+	HnefTTData d;
+	HnefMove m;
+	uint64_t key, *words;
+	int i, found;
+
+	ck_assert(hnef_tt_init(&tt, 1));
+	ck_assert_int_eq(tt.bytes, 1 << 20);
+	ck_assert_int_eq((uintptr_t)tt.buckets % 64, 0);
+	ck_assert(!hnef_tt_probe(&tt, 12345, &d));
+
+	/* Round trip of every field */
+	m.from = HNEF_SQUARE(3, 4);
+	m.to = HNEF_SQUARE(3, 9);
+	hnef_tt_store(&tt, 12345, m, -321, 7, HNEF_BOUND_LOWER);
+	ck_assert(hnef_tt_probe(&tt, 12345, &d));
+	ck_assert_int_eq(d.move.from, m.from);
+	ck_assert_int_eq(d.move.to, m.to);
+	ck_assert_int_eq(d.score, -321);
+	ck_assert_int_eq(d.depth, 7);
+	ck_assert_int_eq(d.bound, HNEF_BOUND_LOWER);
+
+	/* Keys sharing a bucket do not collide */
+	key = 12345 + (tt.mask + 1);
+	ck_assert(!hnef_tt_probe(&tt, key, &d));
+	hnef_tt_store(&tt, key, m, 5, 1, HNEF_BOUND_EXACT);
+	ck_assert(hnef_tt_probe(&tt, 12345, &d));
+	ck_assert_int_eq(d.score, -321);
+
+	/* A torn entry reads as a miss. A bucket is two words, check
+	 * then data, per entry */
+	words = (uint64_t*)tt.buckets + (12345 & tt.mask)*2*HNEF_TT_BUCKET_SIZE;
+	words[1] = 99 | ((uint64_t)1 << 52);
+	ck_assert(!hnef_tt_probe(&tt, 12345, &d));
+
+	/* Deep entries survive a flood of shallow ones from the same
+	 * generation */
+	hnef_tt_clear(&tt);
+	hnef_tt_store(&tt, 7, m, 1, 20, HNEF_BOUND_EXACT);
+	for(i=1; i<=16; i++) {
+		hnef_tt_store(&tt, 7 + i*(tt.mask + 1), m, 0, 1, HNEF_BOUND_EXACT);
+	}
+	ck_assert(hnef_tt_probe(&tt, 7, &d));
+	ck_assert_int_eq(d.depth, 20);
+
+	/* but give way to fresh results once they grow old */
+	for(i=0; i<4; i++) {
+		hnef_tt_new_search(&tt);
+	}
+	for(i=1; i<=16; i++) {
+		hnef_tt_store(&tt, 7 + i*(tt.mask + 1), m, 0, 1, HNEF_BOUND_EXACT);
+	}
+	found = hnef_tt_probe(&tt, 7, &d);
+	ck_assert(!found);
+	ck_assert_int_gt(hnef_tt_hashfull(&tt), 0);
+
+	hnef_tt_free(&tt);
+}
+END_TEST
+
+Suite *
+hnef_suite(void) {
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create("Hnefatafl Transposition Table");
+
+	tc_core = tcase_create("Core");
+
+	tcase_add_test(tc_core, test_tt);
+	
+	suite_add_tcase(s, tc_core);
+
+	return s;	
+}
+
+int
+main(void) {
+	int nfailed;
+	Suite *s;
+	SRunner *sr;
+	
+	s = hnef_suite();
+	sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_NORMAL);
+	nfailed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+	
+	return (nfailed == 0)? EXIT_SUCCESS : EXIT_FAILURE;
+}
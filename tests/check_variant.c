@@ -0,0 +1,142 @@
+#include <check.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "../libhnef/variant.h"
+#include "../libhnef/perft.h"
+
+START_TEST (test_variant_setup)
+{
+	HnefBoard board;
+	int i, n;
+	static const int sizes[HNEF_VARIANT_COUNT] = { 7, 9, 11, 13 };
+	static const int attackers[HNEF_VARIANT_COUNT] = { 8, 16, 24, 24 };
+	static const int defenders[HNEF_VARIANT_COUNT] = { 5, 9, 13, 13 };
+
+	for( i=0; i<HNEF_VARIANT_COUNT; i++ ) {
+		ck_assert(hnef_variant_setup(&board, i));
+		n = sizes[i];
+		ck_assert_int_eq(hnef_variant_get_size(i), n);
+		ck_assert_int_eq(hnef_board_get_width(&board), n);
+		ck_assert_int_eq(hnef_board_get_height(&board), n);
+		ck_assert_int_eq(hnef_board_count_team(&board, HNEF_MUSCOVITE), attackers[i]);
+		ck_assert_int_eq(hnef_board_count_team(&board, HNEF_SWEDE), defenders[i]);
+		ck_assert_int_eq(hnef_board_count_rank(&board, HNEF_KING), 1);
+		ck_assert_int_eq(hnef_board_get_token_rank(&board, n/2, n/2), HNEF_KING);
+		ck_assert_int_eq(hnef_board_get_tile_type(&board, n/2, n/2), HNEF_THRONE);
+		ck_assert_int_eq(hnef_board_get_turn(&board), HNEF_MUSCOVITE);
+		ck_assert(hnef_board_get_key(&board) == hnef_board_compute_key(&board));
+	}
+
+	/* Corner castles, except in Tablut which escapes from the edge */
+	hnef_variant_setup(&board, HNEF_VARIANT_COPENHAGEN);
+	ck_assert_int_eq(hnef_board_get_tile_type(&board, 10, 10), HNEF_CASTLE);
+	ck_assert(hnef_board_get_tile_is_escape(&board, 0, 10));
+	ck_assert(!hnef_board_get_tile_is_escape(&board, 0, 5));
+
+	hnef_variant_setup(&board, HNEF_VARIANT_TABLUT);
+	ck_assert_int_eq(hnef_board_get_tile_type(&board, 0, 0), HNEF_EMPTY);
+	ck_assert(hnef_board_get_tile_is_escape(&board, 0, 2));
+	ck_assert_int_eq(hnef_board_get_tile_type(&board, 4, 1), HNEF_CAMP);
+
+	ck_assert(!hnef_variant_setup(&board, HNEF_VARIANT_COUNT));
+	ck_assert(hnef_variant_get_name(HNEF_VARIANT_COUNT) == NULL);
+}
+END_TEST
+
+START_TEST (test_variant_perft)
+{
+	HnefBoard board, copy;
+	HnefRays rays;
+
+	hnef_variant_setup(&board, HNEF_VARIANT_BRANDUBH);
+	hnef_rays_init(&rays, 7, 7);
+	copy = board;
+	ck_assert(hnef_perft(&board, &rays, 0) == 1);
+	ck_assert(hnef_perft(&board, &rays, 1) == 40);
+	ck_assert(hnef_perft(&board, &rays, 2) == 960);
+	ck_assert(hnef_perft(&board, &rays, 3) == 39512);
+	ck_assert(hnef_board_get_key(&board) == hnef_board_get_key(&copy));
+
+	hnef_variant_setup(&board, HNEF_VARIANT_COPENHAGEN);
+	hnef_rays_init(&rays, 11, 11);
+	ck_assert(hnef_perft(&board, &rays, 1) == 116);
+	ck_assert(hnef_perft(&board, &rays, 2) == 6788);
+	ck_assert(hnef_perft(&board, &rays, HNEF_PERFT_MAX_DEPTH+1) == 0);
+}
+END_TEST
+
+START_TEST (test_variant_perft_parallel)
+{
+	HnefBoard board;
+	HnefRays rays;
+	HnefPerftOptions options;
+	HnefPerftStats stats;
+	uint64_t expected, divide[HNEF_MAX_MOVES], sum;
+	int i, threads;
+
+	hnef_variant_setup(&board, HNEF_VARIANT_TABLUT);
+	hnef_rays_init(&rays, 9, 9);
+	expected = hnef_perft(&board, &rays, 4);
+	hnef_perft_options_init(&options);
+
+	for( threads=1; threads<=4; threads++ ) {
+		options.threads = threads;
+		options.split_depth = threads / 2;
+		options.cache_megabytes = (threads % 2) ? 0 : 1;
+		ck_assert(hnef_perft_parallel(&board, &rays, 4, &options, &stats));
+		ck_assert(stats.nodes == expected);
+		if(threads == 2) {
+			/* Lines transpose from the third ply on */
+			ck_assert(stats.cache_hits > 0);
+		}
+	}
+	ck_assert(hnef_board_get_key(&board) == hnef_board_compute_key(&board));
+
+	/* Divide must agree with walking each root move on its own */
+	options.divide = divide;
+	options.split_depth = 0;
+	ck_assert(hnef_perft_parallel(&board, &rays, 3, &options, &stats));
+	sum = 0;
+	for( i=0; i<HNEF_MAX_MOVES; i++ ) {
+		sum += divide[i];
+	}
+	ck_assert(sum == stats.nodes);
+	ck_assert(stats.nodes == hnef_perft(&board, &rays, 3));
+	ck_assert(divide[0] > 0);
+
+	ck_assert(hnef_perft_parallel(&board, &rays, 0, &options, &stats));
+	ck_assert(stats.nodes == 1);
+	ck_assert(!hnef_perft_parallel(&board, &rays, HNEF_PERFT_MAX_DEPTH+1, &options, &stats));
+}
+END_TEST
+
+Suite*
+hnef_suite(void) {
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create("Hnefatafl Variants");
+	tc_core = tcase_create("Core");
+
+	tcase_add_test(tc_core, test_variant_setup);
+	tcase_add_test(tc_core, test_variant_perft);
+	tcase_add_test(tc_core, test_variant_perft_parallel);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+}
+
+int
+main(void) {
+	int number_failed;
+	Suite *s;
+	SRunner *sr;
+
+	s = hnef_suite();
+	sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,195 @@
+#include <check.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../libhnef/wire.h"
+#include "../libhnef/move.h"
+#include "../libhnef/variant.h"
+#include "random_game.h"
+
+#define PLIES 160
+
+/* Two boards hold the same layout and position */
+static void
+assert_same_board( HnefBoard *a, HnefBoard *b ) {
+	int i;
+
+	ck_assert_int_eq(a->height, b->height);
+	ck_assert_int_eq(a->width, b->width);
+	ck_assert_int_eq(a->turn, b->turn);
+	ck_assert(a->key == b->key);
+	ck_assert(b->key == hnef_board_compute_key(b));
+	ck_assert(memcmp(&(a->occupied), &(b->occupied), sizeof(HnefBitboard)) == 0);
+	for( i=0; i<2; i++ ) {
+		ck_assert(memcmp(&(a->teams[i]), &(b->teams[i]), sizeof(HnefBitboard)) == 0);
+		ck_assert(memcmp(&(a->ranks[i]), &(b->ranks[i]), sizeof(HnefBitboard)) == 0);
+	}
+	for( i=0; i<4; i++ ) {
+		ck_assert(memcmp(&(a->types[i]), &(b->types[i]), sizeof(HnefBitboard)) == 0);
+	}
+	ck_assert(memcmp(&(a->escapes), &(b->escapes), sizeof(HnefBitboard)) == 0);
+}
+
+/* Every prefix of a record is refused, and the record itself accepted */
+static void
+check_truncated( HnefBoard *layout, const uint8_t *buffer, size_t length ) {
+	HnefBoard b;
+	size_t used, i;
+
+	for( i=0; i<length; i++ ) {
+		b = *layout;
+		ck_assert(!hnef_board_decode(&b, buffer, i, &used));
+		ck_assert(memcmp(&b, layout, sizeof(HnefBoard)) == 0);
+	}
+}
+
+/* The receiving end of a game sent one position at a time */
+typedef struct WireGame {
+	HnefBoard layout;         /* The last position decoded */
+	size_t total;             /* Bytes sent */
+	size_t plain;             /* Bytes hnef_board_serialize would send */
+	int formats[2];           /* Positions sent in each format */
+} WireGame;
+
+/* Send a position of a game to the WireGame passed as data */
+static int
+send_position( HnefBoard *b, int ply, const HnefMove *move, void *data ) {
+	WireGame *g = data;
+	uint8_t buffer[HNEF_WIRE_MAX_POSITION(MAX_HEIGHT, MAX_WIDTH)];
+	size_t length, used;
+
+	(void)move;
+	ck_assert(hnef_board_encode(b, buffer, sizeof(buffer), &length));
+	ck_assert_int_le(length, HNEF_WIRE_MAX_POSITION(b->height, b->width));
+	g->formats[(buffer[0] >> 5) & 0x01]++;
+	g->total += length;
+	g->plain += 2 + b->area;
+
+	/* Decoding onto the last position replaces it */
+	ck_assert(hnef_board_decode(&(g->layout), buffer, length, &used));
+	ck_assert_int_eq(used, length);
+	assert_same_board(b, &(g->layout));
+	if(ply % 40 == 0) {
+		check_truncated(&(g->layout), buffer, length);
+		ck_assert(!hnef_board_encode(b, buffer, length - 1, &used));
+		ck_assert_int_eq(used, length);
+	}
+	return 1;
+}
+
+START_TEST (test_wire_round_trip)
+{
+	HnefBoard b, c;
+	HnefRays rays;
+	WireGame g;
+	uint8_t buffer[HNEF_WIRE_MAX_POSITION(MAX_HEIGHT, MAX_WIDTH)];
+	uint8_t serialized[2 + MAX_HEIGHT*MAX_WIDTH];
+	uint64_t rng = 23;
+	size_t length, used;
+	int variant;
+
+	g.formats[0] = g.formats[1] = 0;
+	for( variant=0; variant<HNEF_VARIANT_COUNT; variant++ ) {
+		hnef_variant_setup(&b, variant);
+		hnef_rays_init(&rays, b.height, b.width);
+
+		/* The layout travels once */
+		ck_assert(hnef_board_encode_layout(&b, buffer, sizeof(buffer), &length));
+		ck_assert_int_le(length, HNEF_WIRE_MAX_LAYOUT(b.height, b.width));
+		ck_assert(hnef_board_decode_layout(&(g.layout), buffer, length, &used));
+		ck_assert_int_eq(used, length);
+		ck_assert(!hnef_board_decode_layout(&c, buffer, length - 1, NULL));
+
+		g.total = g.plain = 0;
+		random_game(&b, NULL, &rays, &rng, PLIES, NULL, send_position, &g);
+
+		/* Well under a fifth of hnef_board_serialize on large boards */
+		if(b.area >= 81) {
+			ck_assert_int_lt(g.total*5, g.plain);
+		}
+		hnef_board_serialize(&b, serialized);
+		ck_assert(hnef_board_deserialize(&c, serialized));
+		ck_assert(hnef_board_encode(&c, buffer, sizeof(buffer), &length));
+		ck_assert(hnef_board_encode(&b, serialized, sizeof(serialized), &used));
+		ck_assert_int_eq(length, used);
+	}
+	ck_assert_int_gt(g.formats[HNEF_WIRE_LISTS], 0);
+	ck_assert_int_gt(g.formats[HNEF_WIRE_BITSET], 0);
+}
+END_TEST
+
+START_TEST (test_wire_sparse)
+{
+	HnefBoard b, layout;
+	HnefToken t;
+	uint8_t buffer[64];
+	size_t length, used;
+
+	/* A lone king and an attacker on a 19x19 board */
+	hnef_board_init(&b, 19, 19);
+	hnef_board_set_tile_is_escape(&b, 18, 18, HNEF_ESCAPE);
+	hnef_token_init(&t, HNEF_SWEDE, HNEF_KING);
+	hnef_board_set_token(&b, 3, 17, t);
+	hnef_token_init(&t, HNEF_MUSCOVITE, HNEF_SOLDIER);
+	hnef_board_set_token(&b, 0, 0, t);
+	hnef_board_set_turn(&b, HNEF_SWEDE);
+
+	ck_assert(hnef_board_encode_layout(&b, buffer, sizeof(buffer), &length));
+	ck_assert(hnef_board_decode_layout(&layout, buffer, length, NULL));
+	ck_assert(hnef_board_encode(&b, buffer, sizeof(buffer), &length));
+	ck_assert_int_eq(buffer[0] >> 5, HNEF_WIRE_LISTS);
+	ck_assert_int_le(length, 10);
+	ck_assert(hnef_board_decode(&layout, buffer, length, &used));
+	assert_same_board(&b, &layout);
+
+	/* Damaged records are refused */
+	buffer[0] = (buffer[0] & 0xf0) | (HNEF_WIRE_VERSION + 1);
+	ck_assert(!hnef_board_decode(&layout, buffer, length, NULL));
+	buffer[0] = HNEF_WIRE_VERSION;
+	buffer[1] = 1;
+	buffer[2] = 0x90;
+	buffer[3] = 0x03;
+	ck_assert(!hnef_board_decode(&layout, buffer, length, NULL));
+	buffer[0] = HNEF_WIRE_VERSION;
+	buffer[1] = 0;
+	buffer[2] = 1;
+	buffer[3] = 5;
+	buffer[4] = 1;
+	buffer[5] = 7;
+	ck_assert(!hnef_board_decode(&layout, buffer, 6, NULL));
+	buffer[5] = 5;
+	ck_assert(hnef_board_decode(&layout, buffer, 6, NULL));
+	ck_assert_int_eq(hnef_board_get_token_team(&layout, 5, 0), HNEF_SWEDE);
+	ck_assert_int_eq(hnef_board_get_token_rank(&layout, 5, 0), HNEF_KING);
+}
+END_TEST
+
+Suite*
+hnef_suite(void) {
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create("Hnefatafl Wire Format");
+	tc_core = tcase_create("Core");
+
+	tcase_add_test(tc_core, test_wire_round_trip);
+	tcase_add_test(tc_core, test_wire_sparse);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+}
+
+int
+main(void) {
+	int number_failed;
+	Suite *s;
+	SRunner *sr;
+
+	s = hnef_suite();
+	sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,59 @@
+#include "random_game.h"
+
+/* Step the generator, returning its top 31 bits */
+uint64_t
+random_next( uint64_t *rng ) {
+	*rng = *rng * 6364136223846793005ULL + 1442695040888963407ULL;
+	return *rng >> 33;
+}
+
+/* Play up to max random moves on b, under the rule tables t or, if t
+ * is NULL, the rules of move.c. Moves are pushed on stack, which when
+ * NULL is a scratch stack of one record. ply, which may be NULL, sees
+ * every position of the game. Returns the number of moves made. */
+int
+random_game( HnefBoard *b, const HnefRuleTables *t, const HnefRays *rays, uint64_t *rng,
+             int max, HnefUndoStack *stack, RandomGamePly ply, void *data ) {
+	HnefMove moves[HNEF_MAX_MOVES];
+	HnefUndo records[1];
+	HnefUndoStack scratch;
+	int i, n, winner;
+
+	for( i=0; ; i++ ) {
+		winner = t? hnef_rules_get_winner(t, b) : hnef_board_get_winner(b);
+		n = 0;
+		if(i < max && winner == HNEF_NO_WINNER) {
+			n = hnef_board_generate_moves(b, rays, b->turn, moves, HNEF_MAX_MOVES);
+		}
+		if(n == 0) {
+			if(ply) {
+				ply(b, i, NULL, data);
+			}
+			return i;
+		}
+
+		n = (int)(random_next(rng) % n);
+		if(ply && !ply(b, i, &moves[n], data)) {
+			return i;
+		}
+		if(!stack) {
+			hnef_undo_stack_init(&scratch, records, 1);
+		}
+		if(t) {
+			hnef_rules_make_move(t, b, moves[n], stack? stack : &scratch);
+		} else {
+			hnef_board_make_move(b, moves[n], stack? stack : &scratch);
+		}
+	}
+}
+
+/* A RandomGamePly which notes each move in the HnefMove array passed
+ * as data */
+int
+random_record( HnefBoard *b, int ply, const HnefMove *move, void *data ) {
+	(void)b;
+	if(move) {
+		((HnefMove*)data)[ply] = *move;
+	}
+	return 1;
+}
@@ -0,0 +1,21 @@
+/* Random games for the tests. Moves are picked with a 64 bit LCG so
+ * that every run plays the same games for a seed. */
+#ifndef TESTS_RANDOM_GAME_H_
+#define TESTS_RANDOM_GAME_H_
+
+#include <stdint.h>
+#include "../libhnef/move.h"
+#include "../libhnef/rules.h"
+
+/* Called on each position of a game with the ply it was reached at and
+ * the move about to be made from it, or NULL once the game is over or
+ * max plies have been played. Returning 0 ends the game before the
+ * move is made. */
+typedef int (*RandomGamePly)( HnefBoard *b, int ply, const HnefMove *move, void *data );
+
+uint64_t random_next   ( uint64_t *rng );
+int      random_game   ( HnefBoard *b, const HnefRuleTables *t, const HnefRays *rays, uint64_t *rng,
+                         int max, HnefUndoStack *stack, RandomGamePly ply, void *data );
+int      random_record ( HnefBoard *b, int ply, const HnefMove *move, void *data );
+
+#endif